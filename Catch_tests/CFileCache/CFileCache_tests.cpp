@@ -0,0 +1,75 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <CFileCache.h>
+#include <IUtil.h>
+#include "TestFiles.h"
+
+SCENARIO( "CFileCache", "[filesystem]" ) {
+
+	GIVEN( "A cache and a file" ) {
+		CFileCache cache(1024);
+		CString fileName = writeTempFile("cfilecache_test.txt", "Hello world");
+
+		WHEN( "the file is loaded" ) {
+			auto file = cache.get(fileName);
+
+			THEN( "its contents and checksum are kept" ) {
+				REQUIRE( file != nullptr );
+				REQUIRE( file->data == "Hello world" );
+				REQUIRE( file->checksum == calculateCrc32Checksum(CString("Hello world")) );
+				REQUIRE( cache.getSize() == 11 );
+				REQUIRE( cache.get(fileName) == file );
+			}
+
+			THEN( "it is loaded again once it changes" ) {
+				writeTempFile("cfilecache_test.txt", "Hello world!");
+				auto changed = cache.get(fileName);
+				REQUIRE( changed != file );
+				REQUIRE( changed->data == "Hello world!" );
+				REQUIRE( cache.getSize() == 12 );
+			}
+
+			THEN( "it is loaded again once it is invalidated" ) {
+				cache.invalidate(fileName);
+				REQUIRE( cache.getFileCount() == 0 );
+				REQUIRE( cache.get(fileName) != file );
+			}
+		}
+
+		THEN( "missing and empty files aren't loaded" ) {
+			REQUIRE( cache.get(writeTempFile("cfilecache_empty.txt", "")) == nullptr );
+			REQUIRE( cache.get("cfilecache_missing.txt") == nullptr );
+			REQUIRE( cache.get("") == nullptr );
+		}
+
+		WHEN( "the cache is full" ) {
+			CString data;
+			for (int i = 0; i < 200; ++i)
+				data << "x";
+
+			std::vector<CString> fileNames;
+			for (int i = 0; i < 6; ++i)
+				fileNames.push_back(writeTempFile("cfilecache_test" + std::to_string(i) + ".txt", data));
+
+			for (auto& name : fileNames)
+				cache.get(name);
+
+			THEN( "the least recently used files are dropped" ) {
+				REQUIRE( cache.getSize() <= 1024 );
+				REQUIRE( cache.getFileCount() == 5 );
+				REQUIRE( cache.get(fileNames.back())->data == data );
+			}
+
+			THEN( "files too large to keep are still loaded" ) {
+				CString large;
+				for (int i = 0; i < 600; ++i)
+					large << "y";
+
+				auto file = cache.get(writeTempFile("cfilecache_large.txt", large));
+				REQUIRE( file != nullptr );
+				REQUIRE( file->data == large );
+				REQUIRE( cache.getFileCount() == 5 );
+			}
+		}
+	}
+}
@@ -0,0 +1,325 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <atomic>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <CFileSystem.h>
+#include <TServer.h>
+
+std::ostream& operator << ( std::ostream& os, CString const& value ) {
+	os << value.toString();
+	return os;
+}
+
+SCENARIO( "CFileSystem case-insensitive lookups", "[filesystem]" ) {
+
+	GIVEN( "A file system with a few files" ) {
+		TServer server("test");
+		CFileSystem fs(&server);
+		fs.addFile("accounts/Graal123.txt");
+		fs.addFile("accounts/bob.txt");
+
+		THEN( "files are found in any case" ) {
+			REQUIRE( fs.findi("graal123.TXT") == fs.find("Graal123.txt") );
+			REQUIRE( fs.fileExistsAs("BOB.txt") == "bob.txt" );
+			REQUIRE( fs.findi("bob.txt") == fs.find("bob.txt") );
+		}
+
+		THEN( "missing files aren't found" ) {
+			REQUIRE( fs.findi("alice.txt").isEmpty() );
+			REQUIRE( fs.fileExistsAs("graal123").isEmpty() );
+		}
+
+		WHEN( "many files are added at once" ) {
+			auto before = fs.getFileList();
+			std::vector<CString> files;
+			for (int i = 0; i < 1000; ++i)
+				files.push_back(CString() << "accounts/Player" << i << ".txt");
+			fs.addFiles(files);
+
+			THEN( "they are all found, and lists from before don't change" ) {
+				REQUIRE( fs.getFileCount() == 1002 );
+				REQUIRE( fs.fileExistsAs("player999.TXT") == "Player999.txt" );
+				REQUIRE( fs.findi("graal123.TXT") == fs.find("Graal123.txt") );
+				REQUIRE( before->size() == 2 );
+			}
+		}
+
+		THEN( "the file list is only built again after a change" ) {
+			auto list = fs.getFileList();
+			REQUIRE( fs.getFileList() == list );
+
+			fs.addFile("accounts/alice.txt");
+			REQUIRE( fs.getFileList() != list );
+			REQUIRE( fs.getFileList()->size() == 3 );
+			REQUIRE( list->size() == 2 );
+		}
+
+		WHEN( "a file is removed" ) {
+			fs.removeFile("accounts/Graal123.txt");
+
+			THEN( "it is no longer found in any case" ) {
+				REQUIRE( fs.findi("graal123.txt").isEmpty() );
+				REQUIRE( fs.fileExistsAs("GRAAL123.TXT").isEmpty() );
+			}
+		}
+
+		WHEN( "names only differ in case" ) {
+			fs.addFile("accounts/BOB.txt");
+
+			THEN( "the first name in the file list is found" ) {
+				REQUIRE( fs.fileExistsAs("bob.txt") == "BOB.txt" );
+				REQUIRE( fs.findi("Bob.Txt") == fs.find("BOB.txt") );
+			}
+
+			THEN( "the other name is found once the first is removed" ) {
+				fs.removeFile("accounts/BOB.txt");
+				REQUIRE( fs.fileExistsAs("bob.txt") == "bob.txt" );
+
+				fs.removeFile("accounts/bob.txt");
+				REQUIRE( fs.fileExistsAs("bob.txt").isEmpty() );
+			}
+		}
+
+		WHEN( "the file system is cleared" ) {
+			fs.clear();
+
+			THEN( "nothing is found" ) {
+				REQUIRE( fs.findi("bob.txt").isEmpty() );
+			}
+		}
+	}
+}
+
+SCENARIO( "CFileSystem lookups while the file list changes", "[filesystem]" ) {
+
+	GIVEN( "A file system that readers use while it is changed" ) {
+		TServer server("test");
+		CFileSystem fs(&server);
+		fs.addFile("world/levels/onlinestartlocal.nw");
+		const CString startLevel = fs.find("onlinestartlocal.nw");
+
+		std::atomic<bool> stop(false);
+		std::atomic<int> errors(0), reads(0);
+		std::vector<std::thread> readers;
+		for (int i = 0; i < 4; ++i)
+		{
+			readers.emplace_back([&]() {
+				while (!stop)
+				{
+					// Files that never change are always found.
+					if (fs.find("onlinestartlocal.nw") != startLevel || fs.findi("ONLINESTARTLOCAL.NW") != startLevel)
+						++errors;
+
+					// A list that is held never changes.
+					auto fileList = fs.getFileList();
+					size_t count = 0;
+					for (auto& file : *fileList)
+					{
+						if (file.second.isEmpty()) ++errors;
+						++count;
+					}
+					if (count != fileList->size())
+						++errors;
+
+					++reads;
+				}
+			});
+		}
+
+		WHEN( "files are added and removed" ) {
+			for (int i = 0; i < 20000; ++i)
+			{
+				CString file = CString() << "accounts/account" << (i / 2 % 100) << ".txt";
+				if (i % 2 == 0)
+					fs.addFile(file);
+				else
+					fs.removeFile(file);
+			}
+
+			while (reads < 100)
+				std::this_thread::yield();
+
+			stop = true;
+			for (auto& reader : readers)
+				reader.join();
+
+			THEN( "every lookup saw a whole file list" ) {
+				REQUIRE( errors == 0 );
+				REQUIRE( fs.getFileList()->size() == 1 );
+			}
+		}
+	}
+}
+
+SCENARIO( "CFileSystem directory scans", "[filesystem]" ) {
+
+	GIVEN( "A folder with nested subfolders" ) {
+		TServer server("test");
+
+		// Folders are added relative to the server, so reach the temp folder from there.
+		auto root = std::filesystem::temp_directory_path() / ("scan_test_" + std::to_string(std::random_device()()));
+		std::string folder = std::filesystem::relative(root, server.getServerPath().text()).generic_string();
+		for (auto dir : { "a", "a/b", "a/b/c", "d" })
+		{
+			std::filesystem::create_directories(root / dir);
+			CString(dir).save(CString((root / dir / "level.nw").string()));
+			CString(dir).save(CString((root / dir / (std::string(dir).substr(0, 1) + ".png")).string()));
+		}
+		CString("root").save(CString((root / "top.nw").string()));
+		CString("hidden").save(CString((root / ".hidden.nw").string()));
+
+		CFileSystem fs(&server);
+
+		WHEN( "it is added recursively" ) {
+			fs.addDir(folder, "*", true);
+
+			THEN( "every file in every subfolder is found" ) {
+				REQUIRE( fs.getFileList()->size() == 4 );
+				REQUIRE( fs.getDirList().size() == 5 );
+				REQUIRE( !fs.find("top.nw").isEmpty() );
+				REQUIRE( !fs.find("a.png").isEmpty() );
+				REQUIRE( !fs.find("d.png").isEmpty() );
+				REQUIRE( fs.find(".hidden.nw").isEmpty() );
+			}
+
+			THEN( "a name in more than one folder is taken from the last folder loaded" ) {
+				CString path = fs.find("level.nw");
+				fs.resync();
+				REQUIRE( fs.find("level.nw") == path );
+			}
+		}
+
+		WHEN( "several folders are added at once" ) {
+			fs.addDirs({ std::make_pair(CString(folder), CString("*.nw")), std::make_pair(CString(folder + "/a/b"), CString("*.png")) });
+
+			THEN( "each folder keeps its own wildcard" ) {
+				REQUIRE( !fs.find("top.nw").isEmpty() );
+				REQUIRE( !fs.find("a.png").isEmpty() );
+				REQUIRE( fs.find("level.nw").isEmpty() );
+				REQUIRE( fs.find("d.png").isEmpty() );
+				REQUIRE( fs.getDirList().size() == 2 );
+			}
+		}
+
+		std::filesystem::remove_all(root);
+	}
+
+	GIVEN( "A folder with enough subfolders to be read on several threads" ) {
+		TServer server("test");
+		auto root = std::filesystem::temp_directory_path() / ("scan_test_" + std::to_string(std::random_device()()));
+		std::string folder = std::filesystem::relative(root, server.getServerPath().text()).generic_string();
+		for (int i = 0; i < 200; ++i)
+		{
+			auto dir = root / std::to_string(i % 20) / std::to_string(i);
+			std::filesystem::create_directories(dir);
+			CString("file").save(CString((dir / ("file" + std::to_string(i) + ".txt")).string()));
+		}
+
+		CFileSystem fs(&server);
+		fs.addDir(folder, "*", true);
+
+		THEN( "every file is found" ) {
+			REQUIRE( fs.getFileCount() == 200 );
+			REQUIRE( fs.getDirList().size() == 221 );
+			REQUIRE( !fs.find("file199.txt").isEmpty() );
+		}
+
+		std::filesystem::remove_all(root);
+	}
+}
+
+SCENARIO( "CFileSystem sharing an index", "[filesystem]" ) {
+
+	GIVEN( "Two file systems that share an index" ) {
+		TServer server("test");
+		auto index = std::make_shared<CFileIndex>();
+		CFileSystem all(&server), levels(&server);
+		all.setIndex(index, 0);
+		levels.setIndex(index, 1);
+
+		all.addFile("world/levels/onlinestartlocal.nw");
+		all.addFile("world/images/Sign.png");
+		levels.addFile("world/levels/onlinestartlocal.nw");
+
+		THEN( "files they have in common are only kept once" ) {
+			REQUIRE( index->getFileCount() == 2 );
+			REQUIRE( index->getDirectoryCount() == 2 );
+			REQUIRE( all.getFileCount() == 2 );
+			REQUIRE( levels.getFileCount() == 1 );
+			REQUIRE( levels.find("onlinestartlocal.nw") == all.find("onlinestartlocal.nw") );
+		}
+
+		THEN( "each file system only finds its own files" ) {
+			REQUIRE( levels.find("Sign.png").isEmpty() );
+			REQUIRE( levels.findi("sign.png").isEmpty() );
+			REQUIRE( all.fileExistsAs("SIGN.PNG") == "Sign.png" );
+			REQUIRE( levels.getFileList()->size() == 1 );
+		}
+
+		WHEN( "the file is removed from one of them" ) {
+			levels.removeFile("onlinestartlocal.nw");
+
+			THEN( "the other still has it" ) {
+				REQUIRE( levels.find("onlinestartlocal.nw").isEmpty() );
+				REQUIRE( !all.find("onlinestartlocal.nw").isEmpty() );
+				REQUIRE( index->getFileCount() == 2 );
+			}
+		}
+
+		WHEN( "another file system on the same category goes away" ) {
+			{
+				CFileSystem view(&server);
+				view.setIndex(index, 1);
+				REQUIRE( view.getFileCount() == 1 );
+			}
+
+			THEN( "the files of the category are kept" ) {
+				REQUIRE( levels.getFileCount() == 1 );
+				REQUIRE( !levels.find("onlinestartlocal.nw").isEmpty() );
+			}
+		}
+
+		WHEN( "one of them is cleared" ) {
+			all.clear();
+
+			THEN( "only the files of the other are left" ) {
+				REQUIRE( all.getFileCount() == 0 );
+				REQUIRE( levels.getFileCount() == 1 );
+				REQUIRE( index->getFileCount() == 1 );
+			}
+		}
+	}
+}
+
+TEST_CASE( "CFileSystem case-insensitive lookup benchmarks", "[filesystem][!benchmark]" ) {
+	TServer server("test");
+
+	for (int fileCount : { 10000, 100000, 1000000 })
+	{
+		std::vector<CString> files;
+		for (int i = 0; i < fileCount; ++i)
+			files.push_back(CString() << "accounts/Account" << i << ".txt");
+
+		CFileSystem fs(&server);
+		fs.addFiles(files);
+
+		CString existing = CString() << "account" << (fileCount / 2) << ".TXT";
+		REQUIRE( fs.fileExistsAs(existing) == (CString() << "Account" << (fileCount / 2) << ".txt") );
+
+		BENCHMARK( "findi, " + std::to_string(fileCount) + " files" ) {
+			return fs.findi(existing);
+		};
+
+		BENCHMARK( "findi missing, " + std::to_string(fileCount) + " files" ) {
+			return fs.findi("nobody.txt");
+		};
+
+		BENCHMARK( "fileExistsAs, " + std::to_string(fileCount) + " files" ) {
+			return fs.fileExistsAs(existing);
+		};
+	}
+}
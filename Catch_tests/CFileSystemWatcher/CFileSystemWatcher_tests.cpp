@@ -0,0 +1,76 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <CFileSystemWatcher.h>
+
+SCENARIO( "CFileSystemWatcher", "[filesystem]" ) {
+
+#ifndef __linux__
+	GIVEN( "A watcher on a system without inotify" ) {
+		CFileSystemWatcher watcher;
+
+		THEN( "nothing can be watched" ) {
+			REQUIRE( !watcher.isAvailable() );
+			REQUIRE( !watcher.watch(CString(std::filesystem::temp_directory_path().string())) );
+		}
+	}
+#else
+	GIVEN( "A watched directory" ) {
+		CFileSystemWatcher watcher;
+		REQUIRE( watcher.isAvailable() );
+
+		auto dir = std::filesystem::temp_directory_path() / ("watcher_test_" + std::to_string(std::random_device()()));
+		std::filesystem::create_directories(dir);
+		CString directory = CString(dir.string()) << "/";
+		REQUIRE( watcher.watch(directory) );
+
+		WHEN( "a file is created and written a few times" ) {
+			{
+				std::ofstream file(dir / "test.txt");
+				file << "hello" << std::flush;
+				file << " world" << std::flush;
+			}
+			{
+				std::ofstream file(dir / "test.txt", std::ios::app);
+				file << "!";
+			}
+
+			THEN( "only its last change is reported" ) {
+				std::vector<CFileChange> changes;
+				REQUIRE( watcher.poll(changes) );
+				REQUIRE( changes.size() == 1 );
+				REQUIRE( changes[0].type == FILECHANGE_WRITTEN );
+				REQUIRE( changes[0].directory == directory );
+				REQUIRE( changes[0].file == "test.txt" );
+
+				AND_THEN( "it isn't reported again" ) {
+					changes.clear();
+					REQUIRE( watcher.poll(changes) );
+					REQUIRE( changes.empty() );
+				}
+			}
+		}
+
+		WHEN( "a file is written and then removed" ) {
+			std::ofstream(dir / "first.txt") << "first";
+			std::ofstream(dir / "second.txt") << "second";
+			std::filesystem::remove(dir / "first.txt");
+
+			THEN( "the changes are in the order of each file's last change" ) {
+				std::vector<CFileChange> changes;
+				REQUIRE( watcher.poll(changes) );
+				REQUIRE( changes.size() == 2 );
+				REQUIRE( changes[0].file == "second.txt" );
+				REQUIRE( changes[0].type == FILECHANGE_WRITTEN );
+				REQUIRE( changes[1].file == "first.txt" );
+				REQUIRE( changes[1].type == FILECHANGE_REMOVED );
+			}
+		}
+
+		watcher.clear();
+		std::filesystem::remove_all(dir);
+	}
+#endif
+}
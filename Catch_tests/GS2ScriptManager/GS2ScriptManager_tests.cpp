@@ -0,0 +1,97 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <filesystem>
+#include <random>
+#include <string>
+#include <GS2ScriptManager.h>
+#include <ScriptCodeCache.h>
+
+static std::filesystem::path cacheDirectory()
+{
+	return std::filesystem::temp_directory_path() / ("gs2scriptmanager_test_" + std::to_string(std::random_device()()));
+}
+
+static CompilerResponse makeResponse()
+{
+	CompilerResponse response{};
+	response.success = true;
+	response.joinedClasses = { "movement", "util" };
+	response.bytecode.write("\x01\x00\x02\xff bytecode", 13);
+	return response;
+}
+
+SCENARIO( "GS2ScriptManager bytecode on disk", "[script]" ) {
+
+	GIVEN( "Compiled bytecode" ) {
+		CompilerResponse response = makeResponse();
+		std::string data = GS2ScriptManager::encodeBytecode(response);
+
+		THEN( "it reads back the same" ) {
+			CompilerResponse decoded{};
+			REQUIRE( GS2ScriptManager::decodeBytecode(data, decoded) );
+			REQUIRE( decoded.success );
+			REQUIRE( decoded.joinedClasses.size() == 2 );
+			REQUIRE( decoded.bytecode.length() == 13 );
+			REQUIRE( GS2ScriptManager::encodeBytecode(decoded) == data );
+		}
+
+		THEN( "data cut off inside the class names is rejected" ) {
+			// Two classes of 8 and 4 characters, each after its length, after the class count.
+			const size_t classesLength = 4 + (4 + 8) + (4 + 4);
+			for (size_t length = 0; length < classesLength; ++length)
+			{
+				CompilerResponse decoded{};
+				REQUIRE_FALSE( GS2ScriptManager::decodeBytecode(std::string_view(data).substr(0, length), decoded) );
+			}
+		}
+	}
+
+	GIVEN( "A script stored on disk by another compiler version" ) {
+		auto directory = cacheDirectory();
+		const std::string script = "function onCreated() { this.chat = \"cached\"; }";
+
+		ScriptCodeCache otherCompiler;
+		REQUIRE( otherCompiler.open(directory, "another compiler") );
+		REQUIRE( otherCompiler.store(script, GS2ScriptManager::encodeBytecode(makeResponse())) );
+		otherCompiler.close();
+
+		WHEN( "the script manager looks for it" ) {
+			GS2ScriptManager manager;
+			REQUIRE( manager.setBytecodeCache(directory) );
+
+			THEN( "it is ignored" ) {
+				REQUIRE( manager.findBytecode(script) == nullptr );
+				REQUIRE( manager.getBytecodeCache().getStats().rejected == 1 );
+			}
+		}
+
+		std::filesystem::remove_all(directory);
+	}
+
+	GIVEN( "A script compiled by one script manager" ) {
+		auto directory = cacheDirectory();
+		const std::string script = "function onCreated() { this.chat = \"compiled\"; }";
+
+		std::string compiled;
+		{
+			GS2ScriptManager manager;
+			REQUIRE( manager.setBytecodeCache(directory) );
+			manager.compileScript(script, [&compiled](const CompilerResponse& response) {
+				REQUIRE( response.success );
+				compiled = GS2ScriptManager::encodeBytecode(response);
+			});
+		}
+
+		THEN( "the next script manager reads it from disk" ) {
+			GS2ScriptManager manager;
+			REQUIRE( manager.setBytecodeCache(directory) );
+
+			auto response = manager.findBytecode(script);
+			REQUIRE( response != nullptr );
+			REQUIRE( GS2ScriptManager::encodeBytecode(*response) == compiled );
+			REQUIRE( manager.getBytecodeCache().getStats().hits == 1 );
+		}
+
+		std::filesystem::remove_all(directory);
+	}
+}
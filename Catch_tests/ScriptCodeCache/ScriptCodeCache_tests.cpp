@@ -0,0 +1,165 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <ScriptCodeCache.h>
+
+static std::filesystem::path cacheDirectory(const std::string& name)
+{
+	auto directory = std::filesystem::temp_directory_path() / ("scriptcodecache_test_" + name);
+	std::filesystem::remove_all(directory);
+	return directory;
+}
+
+static std::vector<std::filesystem::path> cacheFiles(const std::filesystem::path& directory)
+{
+	std::vector<std::filesystem::path> files;
+	for (auto & entry : std::filesystem::directory_iterator(directory))
+		files.push_back(entry.path());
+	return files;
+}
+
+SCENARIO( "ScriptCodeCache", "[script]" ) {
+
+	GIVEN( "A cache without a directory" ) {
+		ScriptCodeCache cache;
+
+		THEN( "nothing is stored or loaded" ) {
+			REQUIRE( !cache.isOpen() );
+			REQUIRE( !cache.store("function() {}", "code") );
+			REQUIRE( !cache.load("function() {}") );
+			REQUIRE( cache.getStats().misses == 0 );
+		}
+	}
+
+	GIVEN( "A cache with compiled code in it" ) {
+		auto directory = cacheDirectory("stored");
+		ScriptCodeCache cache;
+		REQUIRE( cache.open(directory, "10.1.2") );
+		REQUIRE( cache.store("function onCreated() {}", std::string("compiled\0code", 13)) );
+
+		THEN( "the code is loaded for the same source" ) {
+			auto code = cache.load("function onCreated() {}");
+			REQUIRE( code );
+			REQUIRE( *code == std::string("compiled\0code", 13) );
+			REQUIRE( cache.getStats().hits == 1 );
+		}
+
+		THEN( "other sources miss" ) {
+			REQUIRE( !cache.load("function onCreated() { }") );
+			REQUIRE( cache.getStats().misses == 1 );
+		}
+
+		THEN( "it is still there after a restart" ) {
+			ScriptCodeCache restarted;
+			REQUIRE( restarted.open(directory, "10.1.2") );
+			REQUIRE( restarted.load("function onCreated() {}") );
+		}
+
+		WHEN( "the compiler version changes" ) {
+			ScriptCodeCache upgraded;
+			REQUIRE( upgraded.open(directory, "10.2.0") );
+
+			THEN( "the code is rejected and removed" ) {
+				REQUIRE( !upgraded.load("function onCreated() {}") );
+				REQUIRE( upgraded.getStats().rejected == 1 );
+				REQUIRE( cacheFiles(directory).empty() );
+
+				AND_THEN( "the new version's code replaces it" ) {
+					REQUIRE( upgraded.store("function onCreated() {}", "newer code") );
+					REQUIRE( *upgraded.load("function onCreated() {}") == "newer code" );
+					REQUIRE( !cache.load("function onCreated() {}") );
+				}
+			}
+		}
+
+		WHEN( "the cache file is damaged" ) {
+			auto files = cacheFiles(directory);
+			REQUIRE( files.size() == 1 );
+			{
+				std::fstream file(files[0], std::ios::binary | std::ios::in | std::ios::out);
+				file.seekp(-2, std::ios::end);
+				file.put('X');
+			}
+
+			THEN( "the code is rejected" ) {
+				REQUIRE( !cache.load("function onCreated() {}") );
+				REQUIRE( cache.getStats().rejected == 1 );
+			}
+		}
+
+		WHEN( "the cache file is cut short" ) {
+			auto files = cacheFiles(directory);
+			std::filesystem::resize_file(files[0], 10);
+
+			THEN( "the code is rejected" ) {
+				REQUIRE( !cache.load("function onCreated() {}") );
+				REQUIRE( cache.getStats().rejected == 1 );
+			}
+		}
+
+		WHEN( "the code hasn't been used for longer than the cache keeps it" ) {
+			REQUIRE( cache.store("function onCreated() { echo(1); }", "other code") );
+			auto files = cacheFiles(directory);
+			REQUIRE( files.size() == 2 );
+
+			auto longAgo = std::filesystem::file_time_type::clock::now() - ScriptCodeCache::DefaultMaxAge - std::chrono::hours(1);
+			for (auto & file : files)
+				std::filesystem::last_write_time(file, longAgo);
+			REQUIRE( cache.load("function onCreated() { echo(1); }") );
+
+			std::ofstream(directory / "unfinished.bin.tmp") << "half an entry";
+			std::ofstream(directory / "readme.txt") << "not an entry";
+
+			THEN( "it is removed the next time the cache is opened" ) {
+				ScriptCodeCache restarted;
+				REQUIRE( restarted.open(directory, "10.1.2") );
+				REQUIRE( restarted.getStats().pruned == 2 );
+				REQUIRE( !restarted.load("function onCreated() {}") );
+				REQUIRE( !std::filesystem::exists(directory / "unfinished.bin.tmp") );
+				REQUIRE( std::filesystem::exists(directory / "readme.txt") );
+
+				AND_THEN( "code that was loaded since is kept" ) {
+					REQUIRE( restarted.load("function onCreated() { echo(1); }") );
+				}
+			}
+		}
+
+		std::filesystem::remove_all(directory);
+	}
+}
+
+TEST_CASE( "ScriptCodeCache benchmarks", "[script][!benchmark]" ) {
+	// A server with a few hundred scripts, each with some 20 KB of compiled code.
+	const int scriptCount = 500;
+	std::vector<std::string> sources;
+	for (int i = 0; i < scriptCount; ++i)
+		sources.push_back("function onCreated() { this.id = " + std::to_string(i) + "; }");
+	std::string code(20 * 1024, 'c');
+
+	auto directory = cacheDirectory("benchmark");
+	ScriptCodeCache cache;
+	cache.open(directory, "10.1.2");
+
+	BENCHMARK( "storing the code of " + std::to_string(scriptCount) + " scripts" ) {
+		int stored = 0;
+		for (auto & source : sources)
+			stored += cache.store(source, code);
+		return stored;
+	};
+
+	BENCHMARK( "loading the code of " + std::to_string(scriptCount) + " scripts at startup" ) {
+		ScriptCodeCache startup;
+		startup.open(directory, "10.1.2");
+
+		size_t loaded = 0;
+		for (auto & source : sources)
+			loaded += startup.load(source)->size();
+		return loaded;
+	};
+
+	std::filesystem::remove_all(directory);
+}
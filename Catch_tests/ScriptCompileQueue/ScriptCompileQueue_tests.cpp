@@ -0,0 +1,167 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <string>
+#include <thread>
+#include <vector>
+#include <ScriptCompileQueue.h>
+
+using CompileQueue = ScriptCompileQueue<std::string>;
+
+// Stands in for the bytecode cache, which keeps every finished compile.
+static size_t dispatch(CompileQueue& queue, std::vector<std::string>& stored)
+{
+	return queue.dispatch([&stored](const std::string& source, std::string&& response) -> const std::string& {
+		stored.push_back(source);
+		static std::string result;
+		result = std::move(response);
+		return result;
+	});
+}
+
+SCENARIO( "ScriptCompileQueue", "[script]" ) {
+
+	GIVEN( "An npc waiting on its script" ) {
+		CompileQueue queue;
+		std::vector<std::string> stored;
+		int npc = 0;
+		std::vector<std::string> delivered;
+		auto deliver = [&delivered](const std::string& response) { delivered.push_back(response); };
+
+		REQUIRE( queue.wait("function onCreated() {}", &npc, deliver) );
+
+		THEN( "it waits until the compile is dispatched" ) {
+			REQUIRE( queue.isWaiting(&npc) );
+			queue.complete("function onCreated() {}", "bytecode");
+			REQUIRE( delivered.empty() );
+
+			REQUIRE( dispatch(queue, stored) == 1 );
+			REQUIRE( delivered == std::vector<std::string>{ "bytecode" } );
+			REQUIRE( !queue.isWaiting(&npc) );
+			REQUIRE( queue.getCompileCount() == 0 );
+		}
+
+		WHEN( "another npc has the same script" ) {
+			int otherNpc = 0;
+
+			THEN( "the compile is shared" ) {
+				REQUIRE( !queue.wait("function onCreated() {}", &otherNpc, deliver) );
+				REQUIRE( queue.getCompileCount() == 1 );
+
+				queue.complete("function onCreated() {}", "bytecode");
+				dispatch(queue, stored);
+				REQUIRE( delivered.size() == 2 );
+				REQUIRE( stored.size() == 1 );
+			}
+		}
+
+		WHEN( "another npc's script finishes first" ) {
+			int otherNpc = 0;
+			REQUIRE( queue.wait("function onCreated() { echo(2); }", &otherNpc, deliver) );
+
+			THEN( "the scripts are delivered in the order they finished" ) {
+				queue.complete("function onCreated() { echo(2); }", "other bytecode");
+				queue.complete("function onCreated() {}", "bytecode");
+				REQUIRE( dispatch(queue, stored) == 2 );
+				REQUIRE( delivered == std::vector<std::string>{ "other bytecode", "bytecode" } );
+			}
+		}
+
+		WHEN( "its script changes before the first compile finishes" ) {
+			REQUIRE( queue.wait("function onCreated() { echo(1); }", &npc, deliver) );
+
+			THEN( "only the newest script is delivered, even if the older one finishes last" ) {
+				queue.complete("function onCreated() { echo(1); }", "newer bytecode");
+				queue.complete("function onCreated() {}", "older bytecode");
+				REQUIRE( dispatch(queue, stored) == 2 );
+				REQUIRE( delivered == std::vector<std::string>{ "newer bytecode" } );
+
+				AND_THEN( "the older compile is still stored" ) {
+					REQUIRE( stored == std::vector<std::string>{ "function onCreated() { echo(1); }", "function onCreated() {}" } );
+				}
+			}
+		}
+
+		WHEN( "it is cancelled" ) {
+			REQUIRE( queue.cancel(&npc) );
+			REQUIRE( !queue.cancel(&npc) );
+
+			THEN( "its callback is never called" ) {
+				REQUIRE( !queue.isWaiting(&npc) );
+				queue.complete("function onCreated() {}", "bytecode");
+				REQUIRE( dispatch(queue, stored) == 1 );
+				REQUIRE( delivered.empty() );
+				REQUIRE( stored.size() == 1 );
+			}
+		}
+
+		WHEN( "a callback cancels another npc waiting on the same compile" ) {
+			int otherNpc = 0;
+			CompileQueue *queuePtr = &queue;
+			queue.wait("function onCreated() {}", &npc, [queuePtr, &otherNpc, &delivered](const std::string& response) {
+				delivered.push_back("cancelled other npc");
+				queuePtr->cancel(&otherNpc);
+			});
+			queue.wait("function onCreated() {}", &otherNpc, deliver);
+
+			THEN( "the other npc is skipped" ) {
+				queue.complete("function onCreated() {}", "bytecode");
+				dispatch(queue, stored);
+				REQUIRE( delivered == std::vector<std::string>{ "cancelled other npc" } );
+				REQUIRE( !queue.isWaiting(&otherNpc) );
+			}
+		}
+
+		WHEN( "a callback compiles the same script again" ) {
+			CompileQueue *queuePtr = &queue;
+			queue.wait("function onCreated() {}", &npc, [queuePtr, &npc, &delivered](const std::string& response) {
+				delivered.push_back(response);
+				REQUIRE( queuePtr->wait("function onCreated() {}", &npc, [](const std::string&) {}) );
+			});
+
+			THEN( "it waits on a new compile" ) {
+				queue.complete("function onCreated() {}", "bytecode");
+				dispatch(queue, stored);
+				REQUIRE( delivered == std::vector<std::string>{ "bytecode" } );
+				REQUIRE( queue.isWaiting(&npc) );
+				REQUIRE( queue.getCompileCount() == 1 );
+			}
+		}
+	}
+
+	GIVEN( "Compiles that finish on other threads" ) {
+		CompileQueue queue;
+		std::vector<std::string> stored;
+		const int compileCount = 64;
+		std::vector<int> npcs(compileCount);
+		std::vector<int> delivered;
+
+		for (int i = 0; i < compileCount; ++i)
+		{
+			queue.wait("script " + std::to_string(i), &npcs[i], [i, &delivered](const std::string& response) {
+				REQUIRE( response == "bytecode " + std::to_string(i) );
+				delivered.push_back(i);
+			});
+		}
+
+		THEN( "each callback gets its own compile" ) {
+			std::vector<std::thread> workers;
+			for (int worker = 0; worker < 4; ++worker)
+			{
+				workers.emplace_back([&queue, worker] {
+					for (int i = worker; i < compileCount; i += 4)
+						queue.complete("script " + std::to_string(i), "bytecode " + std::to_string(i));
+				});
+			}
+
+			size_t finished = 0;
+			while (finished < compileCount)
+				finished += dispatch(queue, stored);
+
+			for (auto & worker : workers)
+				worker.join();
+
+			REQUIRE( delivered.size() == compileCount );
+			REQUIRE( queue.getCompileCount() == 0 );
+		}
+	}
+}
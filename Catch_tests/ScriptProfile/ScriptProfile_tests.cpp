@@ -0,0 +1,65 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <chrono>
+#include <ScriptProfile.h>
+
+using namespace std::chrono_literals;
+using Clock = ScriptProfile::Clock;
+
+SCENARIO( "ScriptProfile", "[script]" ) {
+
+	GIVEN( "A script that hasn't run" ) {
+		ScriptProfile profile;
+
+		THEN( "its summary is empty" ) {
+			auto summary = profile.getSummary();
+			REQUIRE( summary.calls == 0 );
+			REQUIRE( summary.total == 0.0 );
+			REQUIRE( summary.getPercentile(0.99) == 0.0 );
+		}
+	}
+
+	GIVEN( "A script that ran over a few seconds" ) {
+		ScriptProfile profile;
+		auto start = Clock::now();
+		for (int i = 0; i < 10; ++i)
+		{
+			profile.addSample(0.00001, start + std::chrono::seconds(i));
+			profile.addSample(0.0005, start + std::chrono::seconds(i));
+		}
+		profile.addSample(0.02, start + 5s);
+
+		THEN( "the calls are added up" ) {
+			auto summary = profile.getSummary(start + 10s);
+			REQUIRE( summary.calls == 21 );
+			REQUIRE( summary.total == Catch::Approx(10 * 0.00051 + 0.02) );
+			REQUIRE( summary.max == Catch::Approx(0.02) );
+		}
+
+		THEN( "the histogram places each call by its time" ) {
+			auto summary = profile.getSummary(start + 10s);
+			REQUIRE( summary.histogram[0] == 10 );
+			REQUIRE( summary.histogram[3] == 10 );
+			REQUIRE( summary.histogram[6] == 1 );
+			REQUIRE( summary.getPercentile(0.4) == ScriptProfile::getBucketLimit(0) );
+			REQUIRE( summary.getPercentile(0.9) == ScriptProfile::getBucketLimit(3) );
+			REQUIRE( summary.getPercentile(1.0) == ScriptProfile::getBucketLimit(6) );
+		}
+
+		THEN( "calls more than a minute old are left out" ) {
+			auto summary = profile.getSummary(start + 64s);
+			REQUIRE( summary.calls == 5 * 2 + 1 );
+			REQUIRE( summary.max == Catch::Approx(0.02) );
+			REQUIRE( profile.getSummary(start + 80s).calls == 0 );
+		}
+
+		WHEN( "it runs again a minute later" ) {
+			profile.addSample(0.001, start + 62s);
+
+			THEN( "the old second is replaced" ) {
+				auto summary = profile.getSummary(start + 62s);
+				REQUIRE( summary.calls == 1 + 7 * 2 + 1 );
+			}
+		}
+	}
+}
@@ -0,0 +1,224 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+#include <ScriptScheduler.h>
+
+using namespace std::chrono_literals;
+using Scheduler = ScriptScheduler<int>;
+
+// An npc with queued actions that each keep the thread busy for a while.
+struct TestNpc
+{
+	std::deque<std::chrono::microseconds> actions;
+	int finishedTick = -1;
+};
+
+static void busyWait(std::chrono::microseconds time)
+{
+	auto end = Scheduler::Clock::now() + time;
+	while (Scheduler::Clock::now() < end);
+}
+
+// Runs actions until the deadline passes, like ScriptExecutionContext::runExecution.
+static bool runActions(TestNpc& npc, Scheduler::Clock::time_point deadline)
+{
+	while (!npc.actions.empty())
+	{
+		busyWait(npc.actions.front());
+		npc.actions.pop_front();
+		if (Scheduler::Clock::now() >= deadline)
+			break;
+	}
+
+	return !npc.actions.empty();
+}
+
+static void runTick(Scheduler& scheduler, std::vector<TestNpc>& npcs, int tick)
+{
+	scheduler.run([&](int id, Scheduler::Clock::time_point deadline) {
+		bool pending = runActions(npcs[id], deadline);
+		if (!pending && npcs[id].finishedTick < 0)
+			npcs[id].finishedTick = tick;
+		return pending;
+	});
+}
+
+SCENARIO( "ScriptScheduler", "[script]" ) {
+
+	GIVEN( "Npcs with a few quick actions each" ) {
+		Scheduler scheduler(10ms, 2ms);
+		std::vector<TestNpc> npcs(5);
+		for (int i = 0; i < 5; ++i)
+		{
+			npcs[i].actions.assign(3, 0us);
+			scheduler.add(i);
+		}
+
+		THEN( "all of them run in one tick" ) {
+			runTick(scheduler, npcs, 0);
+			REQUIRE( scheduler.empty() );
+			for (auto & npc : npcs)
+				REQUIRE( npc.finishedTick == 0 );
+			REQUIRE( scheduler.getStats().turns == 5 );
+			REQUIRE( scheduler.getStats().carriedOver == 0 );
+		}
+
+		THEN( "adding an npc twice queues it once" ) {
+			scheduler.add(0);
+			REQUIRE( scheduler.size() == 5 );
+		}
+
+		WHEN( "an npc is removed" ) {
+			scheduler.remove(2);
+
+			THEN( "it doesn't get a turn" ) {
+				runTick(scheduler, npcs, 0);
+				REQUIRE( npcs[2].finishedTick == -1 );
+				REQUIRE( npcs[2].actions.size() == 3 );
+				REQUIRE( !scheduler.contains(2) );
+			}
+		}
+	}
+
+	GIVEN( "Busy npcs queued ahead of quick ones" ) {
+		Scheduler scheduler(5ms, 1ms);
+		std::vector<TestNpc> npcs(13);
+		for (int i = 0; i < 3; ++i)
+		{
+			npcs[i].actions.assign(20, 2ms);
+			scheduler.add(i);
+		}
+		for (int i = 3; i < 13; ++i)
+		{
+			npcs[i].actions.assign(2, 10us);
+			scheduler.add(i);
+		}
+
+		WHEN( "the first tick runs out of time" ) {
+			runTick(scheduler, npcs, 0);
+
+			THEN( "the busy npcs ran one action each, and the rest wait for the next tick" ) {
+				for (int i = 0; i < 3; ++i)
+					REQUIRE( npcs[i].actions.size() == 19 );
+				REQUIRE( scheduler.getStats().deferred == 10 );
+				REQUIRE( scheduler.getStats().overruns == 3 );
+			}
+
+			THEN( "the quick npcs go first in the next tick" ) {
+				runTick(scheduler, npcs, 1);
+				for (int i = 3; i < 13; ++i)
+					REQUIRE( npcs[i].finishedTick == 1 );
+			}
+		}
+
+		WHEN( "the busy npcs use up their quota turn after turn" ) {
+			for (int tick = 0; tick < 3; ++tick)
+				runTick(scheduler, npcs, tick);
+
+			THEN( "they are deprioritized" ) {
+				for (int i = 0; i < 3; ++i)
+					REQUIRE( scheduler.isDemoted(i) );
+				REQUIRE( scheduler.getStats().demotions == 3 );
+
+				AND_THEN( "a new npc runs ahead of them" ) {
+					npcs.push_back(TestNpc{});
+					npcs.back().actions.assign(1, 0us);
+					scheduler.add(13);
+
+					int before = (int)npcs[0].actions.size() + (int)npcs[1].actions.size() + (int)npcs[2].actions.size();
+					runTick(scheduler, npcs, 3);
+					int after = (int)npcs[0].actions.size() + (int)npcs[1].actions.size() + (int)npcs[2].actions.size();
+
+					REQUIRE( npcs[13].finishedTick == 3 );
+					REQUIRE( after < before );
+				}
+			}
+
+			THEN( "they still finish, and are forgotten once they behave again" ) {
+				for (int tick = 3; !scheduler.empty(); ++tick)
+					runTick(scheduler, npcs, tick);
+
+				for (auto & npc : npcs)
+					REQUIRE( npc.actions.empty() );
+
+				for (int i = 0; i < 3; ++i)
+				{
+					for (int turn = 0; turn < 6; ++turn)
+					{
+						npcs[i].actions.assign(1, 0us);
+						scheduler.add(i);
+						runTick(scheduler, npcs, 100);
+					}
+					REQUIRE( !scheduler.isDemoted(i) );
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE( "ScriptScheduler tick time benchmarks", "[script][!benchmark]" ) {
+	// A level full of npcs with a couple of short actions each, and a few npcs that queued a lot of slow work.
+	const int npcCount = 200, busyCount = 5;
+	auto queueWork = [&](std::vector<TestNpc>& npcs) {
+		npcs.assign(npcCount + busyCount, TestNpc{});
+		for (int i = 0; i < busyCount; ++i)
+			npcs[i].actions.assign(30, 500us);
+		for (int i = busyCount; i < npcCount + busyCount; ++i)
+			npcs[i].actions.assign(2, 20us);
+	};
+
+	// Before, every queued action of every npc ran in the tick it was queued in.
+	BENCHMARK_ADVANCED( "busiest tick, running every queued action" )(Catch::Benchmark::Chronometer meter) {
+		std::vector<std::vector<TestNpc>> runs(meter.runs());
+		for (auto & npcs : runs)
+			queueWork(npcs);
+
+		meter.measure([&runs](int run) {
+			for (auto & npc : runs[run])
+				runActions(npc, Scheduler::Clock::time_point::max());
+			return runs[run].size();
+		});
+	};
+
+	BENCHMARK_ADVANCED( "busiest tick, 10 ms budget with 2 ms per npc" )(Catch::Benchmark::Chronometer meter) {
+		std::vector<std::vector<TestNpc>> runs(meter.runs());
+		std::vector<Scheduler> schedulers(meter.runs(), Scheduler(10ms, 2ms));
+		for (int run = 0; run < meter.runs(); ++run)
+		{
+			queueWork(runs[run]);
+			for (int i = 0; i < (int)runs[run].size(); ++i)
+				schedulers[run].add(i);
+		}
+
+		meter.measure([&](int run) {
+			runTick(schedulers[run], runs[run], 0);
+			return schedulers[run].size();
+		});
+	};
+
+	SECTION( "ticks until the quick npcs finished" ) {
+		std::vector<TestNpc> npcs;
+		Scheduler scheduler(10ms, 2ms);
+		queueWork(npcs);
+		for (int i = 0; i < (int)npcs.size(); ++i)
+			scheduler.add(i);
+
+		int tick = 0;
+		for (; !scheduler.empty(); ++tick)
+			runTick(scheduler, npcs, tick);
+
+		int lastQuick = 0;
+		for (int i = busyCount; i < npcCount + busyCount; ++i)
+			lastQuick = std::max(lastQuick, npcs[i].finishedTick);
+
+		auto& stats = scheduler.getStats();
+		UNSCOPED_INFO( "quick npcs finished by tick " << lastQuick << " of " << tick
+			<< ", tick time median " << scheduler.getTickTime(0.5).count() << " us, max " << scheduler.getTickTime(1.0).count() << " us"
+			<< ", " << stats.deferred << " turns deferred, " << stats.demotions << " npcs deprioritized" );
+		CHECK( lastQuick <= 1 );
+		CHECK( scheduler.getTickTime(1.0) < 15ms );
+	}
+}
@@ -0,0 +1,95 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <chrono>
+#include <thread>
+#include <TAccount.h>
+#include <TAccountIndex.h>
+#include <TServer.h>
+#include "TestFiles.h"
+
+static std::vector<CString> waitForSearch(TAccountIndex& index, const CString& name, const CString& conditions)
+{
+	std::vector<CString> found;
+	bool done = false;
+	index.search(name, conditions, [&](const std::vector<CString>& accounts) {
+		found = accounts;
+		done = true;
+	});
+
+	while (!done)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		index.update();
+	}
+
+	return found;
+}
+
+SCENARIO( "TAccountIndex", "[account]" ) {
+
+	GIVEN( "A few accounts" ) {
+		TServer server("test");
+		auto fileList = std::make_shared<CFileSystem::FileList>();
+		(*fileList)["alice.txt"] = writeAccount(server, "alice", "GRACC001\r\nNICK Alice\r\nLEVEL onlinestartlocal.nw\r\nRUPEES 150\r\nCHEST 1:2:bomb:a.nw\r\nCHEST 3:4:arrows:b.nw\r\nFLAG quest=3\r\n");
+		(*fileList)["bob.txt"] = writeAccount(server, "bob", "GRACC001\r\nNICK Bob\r\nLEVEL house.nw\r\nRUPEES 20\r\nFLAG started\r\n");
+		(*fileList)["broken.txt"] = writeAccount(server, "broken", "not an account\r\nRUPEES 500\r\n");
+
+		TAccountIndex index;
+		index.load(fileList);
+
+		WHEN( "the accounts are searched" ) {
+			THEN( "names are matched with wildcards, and every file is listed without conditions" ) {
+				REQUIRE( waitForSearch(index, "*", "") == std::vector<CString>{ "alice", "bob", "broken" } );
+				REQUIRE( waitForSearch(index, "b*", "") == std::vector<CString>{ "bob", "broken" } );
+			}
+
+			THEN( "numbers are compared as numbers and text with wildcards" ) {
+				REQUIRE( waitForSearch(index, "*", "rupees>=100") == std::vector<CString>{ "alice" } );
+				REQUIRE( waitForSearch(index, "*", "rupees<100") == std::vector<CString>{ "bob" } );
+				REQUIRE( waitForSearch(index, "*", "level='%.nw',nick!=Bob") == std::vector<CString>{ "alice" } );
+			}
+
+			THEN( "fields an account has many of only need one match" ) {
+				REQUIRE( waitForSearch(index, "*", "chest=*:arrows:*") == std::vector<CString>{ "alice" } );
+				REQUIRE( waitForSearch(index, "*", "flag=started") == std::vector<CString>{ "bob" } );
+				REQUIRE( waitForSearch(index, "*", "chest!=*:arrows:*").empty() );
+			}
+
+			THEN( "conditions on missing fields or without an operator are never met" ) {
+				REQUIRE( waitForSearch(index, "*", "email=*").empty() );
+				REQUIRE( waitForSearch(index, "*", "rupees").empty() );
+			}
+
+			THEN( "the results are the same as searching the account files" ) {
+				for (CString conditions : { "rupees>=100", "level=*.nw", "chest=*:arrows:*", "flag!=quest=*", "nick>Alice" })
+				{
+					std::vector<CString> expected;
+					for (auto & [file, path] : *fileList)
+					{
+						if (TAccount::meetsConditions(path, conditions))
+							expected.push_back(removeExtension(file));
+					}
+					REQUIRE( waitForSearch(index, "*", conditions) == expected );
+				}
+			}
+		}
+
+		WHEN( "an account is saved again" ) {
+			CString path = writeAccount(server, "bob", "GRACC001\r\nNICK Bob\r\nLEVEL house.nw\r\nRUPEES 400\r\n");
+			index.loadAccount("bob.txt", path);
+
+			THEN( "searches see the new values" ) {
+				REQUIRE( waitForSearch(index, "*", "rupees>=100") == std::vector<CString>{ "alice", "bob" } );
+				REQUIRE( waitForSearch(index, "*", "flag=started").empty() );
+			}
+		}
+
+		WHEN( "an account is removed" ) {
+			index.removeAccount("alice.txt");
+
+			THEN( "it is no longer found" ) {
+				REQUIRE( waitForSearch(index, "*", "") == std::vector<CString>{ "bob", "broken" } );
+			}
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <vector>
+#include <TAccountItems.h>
+
+static std::vector<CString> chestStrings(const TChestList& chests)
+{
+	std::vector<CString> strings;
+	for (auto chest : chests)
+		strings.push_back(TChestList::toString(chest));
+	return strings;
+}
+
+static std::vector<CString> weaponNames(const TWeaponList& weapons)
+{
+	return std::vector<CString>(weapons.begin(), weapons.end());
+}
+
+SCENARIO( "TChestList", "[account]" ) {
+
+	GIVEN( "Chests read from an account file" ) {
+		std::vector<CString> saved = { "30:20:level1.nw", "5:7:a:b.nw", "-3:12:level1.nw", "05:7:level2.nw", "garbage", "1:2:" };
+		TChestList chests;
+		for (auto & chest : saved)
+			REQUIRE( chests.add(chest) );
+
+		THEN( "they save back exactly as they were read, in order" ) {
+			REQUIRE( chestStrings(chests) == saved );
+		}
+
+		THEN( "they can be found by position or by their saved form" ) {
+			REQUIRE( chests.contains(TChestList::makeKey("level1.nw", 30, 20)) );
+			REQUIRE( chests.contains(TChestList::makeKey("level1.nw", -3, 12)) );
+			REQUIRE( chests.contains("5:7:a:b.nw") );
+			REQUIRE( chests.contains("garbage") );
+			REQUIRE_FALSE( chests.contains(TChestList::makeKey("level1.nw", 20, 30)) );
+			REQUIRE_FALSE( chests.contains(TChestList::makeKey("Level1.nw", 30, 20)) );
+			REQUIRE_FALSE( chests.contains(TChestList::makeKey("level2.nw", 5, 7)) );
+		}
+
+		THEN( "a chest that is already there isn't added twice" ) {
+			REQUIRE_FALSE( chests.add(TChestList::makeKey("level1.nw", 30, 20)) );
+			REQUIRE( chests.size() == saved.size() );
+		}
+	}
+}
+
+SCENARIO( "TWeaponList", "[account]" ) {
+
+	GIVEN( "A few weapons" ) {
+		TWeaponList weapons;
+		REQUIRE( weapons.add("bow") );
+		REQUIRE( weapons.add("-System") );
+		REQUIRE( weapons.add("Bow") );
+		REQUIRE_FALSE( weapons.add("bow") );
+
+		THEN( "they are kept in the order they were added" ) {
+			REQUIRE( weaponNames(weapons) == std::vector<CString>{ "bow", "-System", "Bow" } );
+			REQUIRE( weapons.contains("Bow") );
+			REQUIRE_FALSE( weapons.contains("never added anywhere") );
+		}
+
+		WHEN( "one is removed" ) {
+			REQUIRE( weapons.remove("-System") );
+			REQUIRE_FALSE( weapons.remove("-System") );
+
+			THEN( "the others keep their order" ) {
+				REQUIRE( weaponNames(weapons) == std::vector<CString>{ "bow", "Bow" } );
+				REQUIRE_FALSE( weapons.contains("-System") );
+			}
+		}
+	}
+}
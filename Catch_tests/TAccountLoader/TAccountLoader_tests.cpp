@@ -0,0 +1,127 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <TAccount.h>
+#include <TAccountLoader.h>
+#include <TServer.h>
+#include "TestFiles.h"
+
+static CString accountData(int i)
+{
+	return CString() << "GRACC001\r\nNICK Player " << i << "\r\nLEVEL level" << (i % 10) << ".nw\r\nMAXHP 20\r\nHP 20\r\nRUPEES " << i
+		<< "\r\nFLAG visits=" << i << "\r\nFLAG tutorial\r\nCHEST 30:20:bomb:level1.nw\r\nWEAPON bow\r\nLOCALRIGHTS 0\r\nIPRANGE 0.0.0.0\r\n";
+}
+
+SCENARIO( "TAccountLoader", "[account]" ) {
+
+	GIVEN( "An account on disk" ) {
+		TServer server("test");
+		writeAccount(server, "loadertest", accountData(7));
+		TAccountLoader loader;
+
+		WHEN( "it is loaded in the background" ) {
+			TAccount requester(&server);
+			requester.setAccountName("loadertest");
+
+			std::unique_ptr<TAccount> loaded;
+			bool done = false, fromDefault = true;
+			loader.load(requester, "loadertest", false, [&](std::unique_ptr<TAccount> account, bool loadedFromDefault) {
+				loaded = std::move(account);
+				fromDefault = loadedFromDefault;
+				done = true;
+			});
+
+			while (!done)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				loader.update();
+			}
+
+			THEN( "it matches the account loaded on the game thread" ) {
+				REQUIRE( loaded != nullptr );
+				REQUIRE( !fromDefault );
+				loaded->finishLoading("loadertest", fromDefault);
+
+				TAccount expected(&server);
+				REQUIRE( expected.loadAccount("loadertest") );
+
+				REQUIRE( loaded->getNickname() == expected.getNickname() );
+				REQUIRE( loaded->getLevelName() == expected.getLevelName() );
+				REQUIRE( loaded->getRupees() == expected.getRupees() );
+				REQUIRE( loaded->getMaxPower() == expected.getMaxPower() );
+				REQUIRE( loaded->getPower() == expected.getPower() );
+				REQUIRE( loaded->getFlag("visits") == "7" );
+				REQUIRE( *loaded->getFlagList() == *expected.getFlagList() );
+				REQUIRE( *loaded->getWeaponList() == *expected.getWeaponList() );
+			}
+		}
+	}
+}
+
+TEST_CASE( "TAccountLoader login benchmarks", "[account][!benchmark]" ) {
+	TServer server("test");
+	TAccountLoader loader;
+
+	const int loginCount = 1000;
+	for (int i = 0; i < loginCount; ++i)
+		writeAccount(server, "login" + std::to_string(i), accountData(i));
+
+	BENCHMARK( std::to_string(loginCount) + " logins, read on the game thread" ) {
+		int loadedCount = 0;
+		for (int i = 0; i < loginCount; ++i)
+		{
+			TAccount account(&server);
+			if (account.loadAccount(CString() << "login" << i))
+				++loadedCount;
+		}
+		return loadedCount;
+	};
+
+	BENCHMARK( std::to_string(loginCount) + " logins, read in the background" ) {
+		TAccount requester(&server);
+		int loadedCount = 0, finished = 0;
+		for (int i = 0; i < loginCount; ++i)
+		{
+			loader.load(requester, CString() << "login" << i, false, [&](std::unique_ptr<TAccount> account, bool loadedFromDefault) {
+				if (account)
+				{
+					account->finishLoading(CString(account->getAccountName()), loadedFromDefault);
+					++loadedCount;
+				}
+				++finished;
+			});
+		}
+
+		while (finished < loginCount)
+			loader.update();
+		return loadedCount;
+	};
+
+	// What the game thread is left with once the accounts have been read in the background.
+	BENCHMARK_ADVANCED( std::to_string(loginCount) + " logins, game thread time when read in the background" )(Catch::Benchmark::Chronometer meter) {
+		TAccount requester(&server);
+		std::vector<std::pair<std::unique_ptr<TAccount>, bool>> accounts;
+		for (int i = 0; i < loginCount; ++i)
+		{
+			loader.load(requester, CString() << "login" << i, false, [&](std::unique_ptr<TAccount> account, bool loadedFromDefault) {
+				accounts.emplace_back(std::move(account), loadedFromDefault);
+			});
+		}
+
+		while (accounts.size() < (size_t)loginCount)
+			loader.update();
+
+		meter.measure([&accounts] {
+			int loadedCount = 0;
+			for (auto & [account, loadedFromDefault] : accounts)
+			{
+				TAccount player(*account);
+				player.finishLoading(CString(player.getAccountName()), loadedFromDefault);
+				++loadedCount;
+			}
+			return loadedCount;
+		});
+	};
+}
@@ -0,0 +1,230 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#if !(defined(_WIN32) || defined(_WIN64))
+	#include <csignal>
+	#include <sys/wait.h>
+	#include <unistd.h>
+#endif
+#include <TAccountWriter.h>
+
+// A folder of its own in the temp folder, removed again when the test is done with it.
+struct TestDirectory : std::filesystem::path
+{
+	TestDirectory()
+	: std::filesystem::path(std::filesystem::temp_directory_path() / ("accountwriter_test_" + std::to_string(std::random_device()())))
+	{
+		std::filesystem::create_directories(*this);
+	}
+
+	~TestDirectory()
+	{
+		std::error_code ec;
+		std::filesystem::remove_all(*this, ec);
+	}
+};
+
+static CString loadFile(const std::filesystem::path& path)
+{
+	CString data;
+	data.load(CString(path.string()));
+	return data;
+}
+
+SCENARIO( "TAccountWriter", "[account]" ) {
+
+	GIVEN( "A writer that waits a while before writing" ) {
+		TestDirectory dir;
+		CString path((dir / "account.txt").string());
+		TAccountWriter writer(std::chrono::milliseconds(60000));
+
+		WHEN( "an account is saved several times" ) {
+			for (int i = 0; i < 10; ++i)
+				writer.save(path, CString() << "GRACC001\r\nRUPEES " << i << "\r\n");
+
+			THEN( "the newest save can be read back before it is written" ) {
+				CString pending;
+				REQUIRE( writer.getPending(path, pending) );
+				REQUIRE( pending == "GRACC001\r\nRUPEES 9\r\n" );
+				REQUIRE( !std::filesystem::exists(dir / "account.txt") );
+			}
+
+			THEN( "flushing writes the newest save once" ) {
+				writer.flush();
+				REQUIRE( loadFile(dir / "account.txt") == "GRACC001\r\nRUPEES 9\r\n" );
+				REQUIRE( writer.getWriteCount() == 1 );
+				REQUIRE( writer.getPendingCount() == 0 );
+				REQUIRE( !std::filesystem::exists(dir / "account.txt.tmp") );
+
+				CString pending;
+				REQUIRE( !writer.getPending(path, pending) );
+
+				auto writes = writer.update();
+				REQUIRE( writes.size() == 1 );
+				REQUIRE( writes[0].path == path );
+				REQUIRE( writes[0].saved );
+			}
+		}
+
+		WHEN( "an account is deleted after it was saved" ) {
+			writer.save(path, "GRACC001\r\nNICK deleted\r\n");
+			REQUIRE( writer.discard(path) );
+			REQUIRE( !writer.discard(path) );
+
+			THEN( "the save is never written" ) {
+				writer.flush();
+				REQUIRE( !std::filesystem::exists(dir / "account.txt") );
+				REQUIRE( writer.update().empty() );
+				REQUIRE( writer.getWriteCount() == 0 );
+
+				CString pending;
+				REQUIRE( !writer.getPending(path, pending) );
+			}
+		}
+
+		WHEN( "an account can't be written" ) {
+			CString badPath((dir / "missing" / "account.txt").string());
+			writer.save(badPath, "GRACC001\r\n");
+			writer.flush();
+
+			THEN( "the failure is reported" ) {
+				auto writes = writer.update();
+				REQUIRE( writes.size() == 1 );
+				REQUIRE( !writes[0].saved );
+				REQUIRE( writer.getWriteCount() == 0 );
+			}
+		}
+	}
+
+	GIVEN( "A writer with a short delay" ) {
+		TestDirectory dir;
+		CString path((dir / "account.txt").string());
+
+		WHEN( "the delay passes" ) {
+			TAccountWriter writer(std::chrono::milliseconds(10));
+			writer.save(path, "GRACC001\r\n");
+			while (writer.getPendingCount() != 0)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+			THEN( "the account is written without a flush" ) {
+				REQUIRE( loadFile(dir / "account.txt") == "GRACC001\r\n" );
+			}
+		}
+
+		WHEN( "accounts are deleted while they might be being written" ) {
+			TAccountWriter writer(std::chrono::milliseconds(0));
+			int recreated = 0;
+			for (int i = 0; i < 200; ++i)
+			{
+				writer.save(path, "GRACC001\r\n");
+				if (i % 2)
+					std::this_thread::sleep_for(std::chrono::microseconds(i * 5));
+
+				// Same order as the RC account delete: drop the save, then remove the file.
+				writer.discard(path);
+				std::filesystem::remove(dir / "account.txt");
+				writer.flush();
+				recreated += std::filesystem::exists(dir / "account.txt");
+			}
+
+			THEN( "no write brings them back" ) {
+				REQUIRE( recreated == 0 );
+				REQUIRE( !std::filesystem::exists(dir / "account.txt.tmp") );
+			}
+		}
+
+		WHEN( "the writer is destroyed before the delay passes" ) {
+			{
+				TAccountWriter writer(std::chrono::milliseconds(60000));
+				writer.save(path, "GRACC001\r\nNICK shutdown\r\n");
+			}
+
+			THEN( "the account is still written" ) {
+				REQUIRE( loadFile(dir / "account.txt") == "GRACC001\r\nNICK shutdown\r\n" );
+			}
+		}
+	}
+}
+
+#if !(defined(_WIN32) || defined(_WIN64))
+SCENARIO( "TAccountWriter crash consistency", "[account]" ) {
+
+	GIVEN( "Accounts that are being rewritten when the writer is killed" ) {
+		TestDirectory dir;
+		const int accountCount = 200;
+
+		auto makeData = [](int account, char fill) {
+			return CString() << "GRACC001\r\nNICK " << account << "\r\nCOMMENTS " << std::string(64 * 1024, fill).c_str() << "\r\n";
+		};
+
+		for (int i = 0; i < accountCount; ++i)
+			makeData(i, 'a').save(CString((dir / (std::to_string(i) + ".txt")).string()));
+
+		// The writer runs in a child process, which saves every account in one batch and is
+		// killed once killWhen says so.  killWhen gets the number of .tmp files now and at the
+		// last check.
+		auto runWriter = [&](auto killWhen) {
+			pid_t child = fork();
+			REQUIRE( child != -1 );
+			if (child == 0)
+			{
+				TAccountWriter writer(std::chrono::milliseconds(60000));
+				for (int i = 0; i < accountCount; ++i)
+					writer.save(CString((dir / (std::to_string(i) + ".txt")).string()), makeData(i, 'b'));
+				writer.flush();
+				_exit(0);
+			}
+
+			int status = 0, lastCount = 0;
+			while (waitpid(child, &status, WNOHANG) == 0)
+			{
+				int count = 0;
+				for (auto & entry : std::filesystem::directory_iterator(dir))
+				{
+					if (entry.path().extension() == ".tmp")
+						++count;
+				}
+
+				if (killWhen(count, lastCount))
+				{
+					kill(child, SIGKILL);
+					waitpid(child, nullptr, 0);
+					break;
+				}
+				lastCount = count;
+				std::this_thread::yield();
+			}
+		};
+
+		auto requireOldOrNew = [&]() {
+			for (int i = 0; i < accountCount; ++i)
+			{
+				CString data = loadFile(dir / (std::to_string(i) + ".txt"));
+				REQUIRE( (data == makeData(i, 'a') || data == makeData(i, 'b')) );
+			}
+		};
+
+		WHEN( "it is killed while the new versions are written" ) {
+			// The .tmp files only pile up while they are written.
+			runWriter([&](int count, int) { return count >= accountCount / 2; });
+
+			THEN( "every account is either the old or the new version" ) {
+				requireOldOrNew();
+			}
+		}
+
+		WHEN( "it is killed while the new versions are moved into place" ) {
+			// The .tmp files only go away once they are being renamed.
+			runWriter([&](int count, int lastCount) { return count < lastCount && count <= accountCount / 2; });
+
+			THEN( "every account is either the old or the new version" ) {
+				requireOldOrNew();
+			}
+		}
+	}
+}
+#endif
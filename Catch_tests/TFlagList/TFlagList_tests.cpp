@@ -0,0 +1,182 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <TFlagList.h>
+
+// Counts the bytes that are allocated, so the memory used by a flag list can be measured.
+// Every form of new and delete is replaced, so they all agree on where the size is kept.
+static std::atomic<long long> allocatedBytes{ 0 };
+
+static void* countedAlloc(size_t size)
+{
+	auto block = (size_t*)malloc(size + sizeof(std::max_align_t));
+	if (block == nullptr)
+		return nullptr;
+
+	*block = size;
+	allocatedBytes += (long long)size;
+	return (char*)block + sizeof(std::max_align_t);
+}
+
+static void countedFree(void* ptr)
+{
+	if (ptr == nullptr)
+		return;
+
+	auto block = (size_t*)((char*)ptr - sizeof(std::max_align_t));
+	allocatedBytes -= (long long)*block;
+	free(block);
+}
+
+void* operator new(size_t size)
+{
+	if (void* ptr = countedAlloc(size))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)									{ return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept		{ return countedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept	{ return countedAlloc(size); }
+void operator delete(void* ptr) noexcept							{ countedFree(ptr); }
+void operator delete[](void* ptr) noexcept							{ countedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept					{ countedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept					{ countedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept		{ countedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept	{ countedFree(ptr); }
+
+static std::unordered_map<std::string, std::string> toMap(const TFlagList& flags)
+{
+	std::unordered_map<std::string, std::string> map;
+	for (auto [flagName, flagValue] : flags)
+		map[flagName.text()] = flagValue.text();
+	return map;
+}
+
+SCENARIO( "TFlagList", "[account]" ) {
+
+	GIVEN( "A few flags" ) {
+		TFlagList flags;
+		flags.set("tutorial", "");
+		flags.set("visits", "7");
+		flags.set("quest.dialog", "This value is too long to be kept inside of the table");
+
+		THEN( "they can be read back" ) {
+			REQUIRE( flags.size() == 3 );
+			REQUIRE( flags.contains("tutorial") );
+			REQUIRE( flags.get("tutorial") == "" );
+			REQUIRE( flags.get("visits") == "7" );
+			REQUIRE( flags.get("quest.dialog") == "This value is too long to be kept inside of the table" );
+			REQUIRE_FALSE( flags.contains("Visits") );
+			REQUIRE( flags.get("a flag that was never set") == "" );
+		}
+
+		WHEN( "they are changed" ) {
+			flags.set("quest.dialog", "short");
+			flags.set("visits", "This value is too long to be kept inside of the table");
+			REQUIRE( flags.erase("tutorial") );
+			REQUIRE_FALSE( flags.erase("tutorial") );
+
+			THEN( "the new values are read back" ) {
+				REQUIRE( toMap(flags) == std::unordered_map<std::string, std::string>{
+					{ "quest.dialog", "short" },
+					{ "visits", "This value is too long to be kept inside of the table" } } );
+			}
+		}
+
+		WHEN( "they are copied" ) {
+			TFlagList copy(flags);
+			flags.set("visits", "8");
+
+			THEN( "the copy keeps its own values" ) {
+				REQUIRE( copy.get("visits") == "7" );
+				REQUIRE_FALSE( copy == flags );
+				copy.set("visits", "8");
+				REQUIRE( copy == flags );
+			}
+		}
+	}
+
+	GIVEN( "Flags that are set and erased at random" ) {
+		TFlagList flags;
+		std::unordered_map<std::string, std::string> expected;
+		std::mt19937 random(42);
+
+		for (int i = 0; i < 20000; ++i)
+		{
+			std::string name = "flag" + std::to_string(random() % 500);
+			if (random() % 3 == 0)
+			{
+				REQUIRE( flags.erase(name) == (expected.erase(name) == 1) );
+			}
+			else
+			{
+				std::string value(random() % 40, (char)('a' + random() % 26));
+				flags.set(name, CString(value));
+				expected[name] = value;
+			}
+		}
+
+		THEN( "they match a map that was given the same changes" ) {
+			REQUIRE( flags.size() == expected.size() );
+			REQUIRE( toMap(flags) == expected );
+			for (auto & [name, value] : expected)
+				REQUIRE( flags.get(name) == CString(value) );
+		}
+	}
+}
+
+TEST_CASE( "TFlagList memory", "[account][!benchmark]" ) {
+	const int playerCount = 100, flagCount = 300;
+
+	// The same flags on every player, mostly counters and a few longer strings.
+	auto flagName = [](int i) { return "quest" + std::to_string(i / 10) + ".stage" + std::to_string(i % 10); };
+	auto flagValue = [](int player, int i) { return (i % 10 == 0 ? "talked to the guard at " + std::to_string(player) : std::to_string(player + i)); };
+
+	long long before = allocatedBytes;
+	{
+		std::vector<std::unordered_map<std::string, CString>> players(playerCount);
+		for (int player = 0; player < playerCount; ++player)
+		{
+			for (int i = 0; i < flagCount; ++i)
+				players[player][flagName(i)] = CString(flagValue(player, i));
+		}
+
+		long long perPlayer = (allocatedBytes - before) / playerCount;
+		WARN( "std::unordered_map<std::string, CString>: " << perPlayer << " bytes per player with " << flagCount << " flags" );
+	}
+
+	// Flag names are shared by the whole server, so intern them before measuring.
+	TFlagList names;
+	for (int i = 0; i < flagCount; ++i)
+		names.set(flagName(i), "");
+
+	before = allocatedBytes;
+	{
+		std::vector<TFlagList> players(playerCount);
+		for (int player = 0; player < playerCount; ++player)
+		{
+			for (int i = 0; i < flagCount; ++i)
+				players[player].set(flagName(i), CString(flagValue(player, i)));
+		}
+
+		long long perPlayer = (allocatedBytes - before) / playerCount;
+		WARN( "TFlagList: " << perPlayer << " bytes per player with " << flagCount << " flags" );
+	}
+
+	TFlagList flags;
+	for (int i = 0; i < flagCount; ++i)
+		flags.set(flagName(i), CString(flagValue(0, i)));
+
+	BENCHMARK( "TFlagList::get, " + std::to_string(flagCount) + " flags" ) {
+		size_t length = 0;
+		for (int i = 0; i < flagCount; i += 7)
+			length += flags.get("quest3.stage" + std::to_string(i % 10)).length();
+		return length;
+	};
+}
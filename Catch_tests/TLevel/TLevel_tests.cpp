@@ -0,0 +1,165 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <TLevel.h>
+#include <TNPC.h>
+#include <TServer.h>
+#include "TestFiles.h"
+#include "TestPlayer.h"
+
+// Writes a board row of a .nw level, where every tile is the same apart from a few.
+static std::string boardRow(int y, short tile, const std::vector<std::pair<int, short>>& otherTiles = {})
+{
+	static const char base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	std::string row = "BOARD 0 " + std::to_string(y) + " 64 0 ";
+	for (int x = 0; x < 64; ++x)
+	{
+		short value = tile;
+		for (auto [otherX, otherTile] : otherTiles)
+		{
+			if (otherX == x)
+				value = otherTile;
+		}
+
+		row += base64[(value >> 6) & 63];
+		row += base64[value & 63];
+	}
+
+	return row + "\n";
+}
+
+static std::vector<int> deletedNpcIds(const TestPlayer& player)
+{
+	std::vector<int> ids;
+	for (CString packet : player.getPackets(PLO_NPCDEL2))
+	{
+		packet.readChars(packet.readGUChar());
+		ids.push_back(packet.readGInt());
+	}
+	return ids;
+}
+
+SCENARIO( "TLevel", "[level]" ) {
+
+	GIVEN( "A level with a horse in it" ) {
+		auto* server = new TServer("test");
+		CString path = createLevel(*server, "leveltest_reload.nw");
+
+		TLevel *level = TLevel::findLevel("leveltest_reload.nw", server);
+		REQUIRE( level != nullptr );
+
+		CString horseImage("horse.png");
+		REQUIRE( level->addHorse(horseImage, 30.0f, 30.0f, 2, 0) );
+		REQUIRE( !level->getHorsePacket().isEmpty() );
+
+		WHEN( "the level is reloaded" ) {
+			REQUIRE( level->reload() );
+
+			THEN( "the horse is gone, instead of staying without a timer" ) {
+				REQUIRE( level->getHorsePacket().isEmpty() );
+
+				AND_THEN( "a new horse can be put in its place" ) {
+					REQUIRE( level->addHorse(horseImage, 30.0f, 30.0f, 2, 0) );
+					level->removeHorse(30.0f, 30.0f);
+					REQUIRE( level->getHorsePacket().isEmpty() );
+				}
+			}
+		}
+
+		std::filesystem::remove(path.text());
+	}
+
+	GIVEN( "A level with a player in it" ) {
+		auto* server = new TServer("test");
+		CString otherPath = createLevel(*server, "leveltest_other.nw");
+
+		const std::string link = "LINK leveltest_other.nw 0 10 1 2 30 30\n";
+		const std::string sign = "SIGN 5 5\nHello\nSIGNEND\n";
+		const std::string blockNpc = "NPC block.png 30 30\nNPCEND\n";
+		const std::string doorNpc = "NPC door.png 40 40\nNPCEND\n";
+		CString path = createLevel(*server, "leveltest_changes.nw", boardRow(0, 0) + link + sign + blockNpc + doorNpc);
+
+		TLevel *level = TLevel::findLevel("leveltest_changes.nw", server);
+		REQUIRE( level != nullptr );
+		REQUIRE( level->getLevelNPCs()->size() == 2 );
+		TNPC *block = (*level->getLevelNPCs())[0];
+		TNPC *door = (*level->getLevelNPCs())[1];
+		int doorId = door->getId();
+
+		auto* player = new TestPlayer(server);
+		REQUIRE( player->setLevel("leveltest_changes.nw") );
+		player->clearPackets();
+
+		WHEN( "an npc is removed from the file" ) {
+			createLevel(*server, "leveltest_changes.nw", boardRow(0, 0) + link + sign + blockNpc);
+			REQUIRE( level->reloadChanges() );
+
+			THEN( "only that npc is deleted" ) {
+				REQUIRE( deletedNpcIds(*player) == std::vector<int>{ doorId } );
+				REQUIRE( player->getPackets(PLO_NPCPROPS).empty() );
+				REQUIRE( *level->getLevelNPCs() == std::vector<TNPC*>{ block } );
+			}
+		}
+
+		WHEN( "an npc is moved in the file" ) {
+			createLevel(*server, "leveltest_changes.nw", boardRow(0, 0) + link + sign + blockNpc + "NPC door.png 45 40\nNPCEND\n");
+			REQUIRE( level->reloadChanges() );
+
+			THEN( "it is replaced by a new npc in the new position, and the other npc is kept" ) {
+				REQUIRE( deletedNpcIds(*player) == std::vector<int>{ doorId } );
+				REQUIRE( player->getPackets(PLO_NPCPROPS).size() == 1 );
+				REQUIRE( level->getLevelNPCs()->size() == 2 );
+				REQUIRE( std::count(level->getLevelNPCs()->begin(), level->getLevelNPCs()->end(), block) == 1 );
+				REQUIRE( std::any_of(level->getLevelNPCs()->begin(), level->getLevelNPCs()->end(), [](TNPC *npc) { return npc->getX() == 45 * 16; }) );
+			}
+		}
+
+		WHEN( "a tile is changed in the file" ) {
+			createLevel(*server, "leveltest_changes.nw", boardRow(0, 0, { { 3, 511 }, { 4, 511 } }) + link + sign + blockNpc + doorNpc);
+			REQUIRE( level->reloadChanges() );
+
+			THEN( "only the changed tiles are sent" ) {
+				auto changes = player->getPackets(PLO_BOARDMODIFY);
+				REQUIRE( changes.size() == 1 );
+				REQUIRE( changes[0].readGChar() == 3 );
+				REQUIRE( changes[0].readGChar() == 0 );
+				REQUIRE( changes[0].readGChar() == 2 );
+				REQUIRE( changes[0].readGChar() == 1 );
+				REQUIRE( changes[0].readGShort() == 511 );
+				REQUIRE( deletedNpcIds(*player).empty() );
+			}
+		}
+
+		WHEN( "a link is added and a sign changed in the file" ) {
+			createLevel(*server, "leveltest_changes.nw", boardRow(0, 0) + link + "LINK leveltest_other.nw 63 10 1 2 0 30\n"
+				+ "SIGN 5 5\nGoodbye\nSIGNEND\n" + blockNpc + doorNpc);
+			REQUIRE( level->reloadChanges() );
+
+			THEN( "the new link and sign are sent, and nothing else" ) {
+				auto links = player->getPackets(PLO_LEVELLINK);
+				REQUIRE( links.size() == 1 );
+				REQUIRE( links[0] == "leveltest_other.nw 63 10 1 2 0 30" );
+				REQUIRE( player->getPackets(PLO_LEVELSIGN).size() == 1 );
+				REQUIRE( player->getPackets(PLO_BOARDMODIFY).empty() );
+				REQUIRE( deletedNpcIds(*player).empty() );
+			}
+		}
+
+		WHEN( "a link is removed from the file" ) {
+			createLevel(*server, "leveltest_changes.nw", boardRow(0, 0) + sign + blockNpc + doorNpc);
+			REQUIRE( level->reloadChanges() );
+
+			THEN( "the level is reloaded in full, since clients can't be told to remove a link" ) {
+				REQUIRE( deletedNpcIds(*player).size() == 2 );
+				REQUIRE( level->getLevelNPCs()->size() == 2 );
+			}
+		}
+
+		std::filesystem::remove(path.text());
+		std::filesystem::remove(otherPath.text());
+	}
+}
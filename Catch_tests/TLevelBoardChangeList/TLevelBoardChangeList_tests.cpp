@@ -0,0 +1,99 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <random>
+#include <TLevelBoardChangeList.h>
+
+static TLevelBoardChange makeChange(int x, int y, int width, int height, int respawn = -1)
+{
+	CString tiles;
+	for (int i = 0; i < width * height; ++i)
+		tiles.writeGShort(0x2ac);
+
+	return TLevelBoardChange(x, y, width, height, tiles, CString(), respawn);
+}
+
+SCENARIO( "TLevelBoardChangeList", "[level]" ) {
+
+	GIVEN( "A list with a few board changes" ) {
+		TLevelBoardChangeList changes;
+		auto a = changes.addChange(makeChange(10, 10, 2, 2));
+		auto b = changes.addChange(makeChange(11, 11, 2, 2));
+		auto c = changes.addChange(makeChange(30, 30, 1, 1));
+
+		REQUIRE( changes.size() == 3 );
+
+		WHEN( "erasing the changes contained in a region" ) {
+			auto erased = changes.eraseWithin(10, 10, 3, 3);
+
+			THEN( "only the fully contained changes are erased" ) {
+				REQUIRE( erased.size() == 2 );
+				REQUIRE( changes.getChange(a) == nullptr );
+				REQUIRE( changes.getChange(b) == nullptr );
+				REQUIRE( changes.getChange(c) != nullptr );
+			}
+		}
+
+		WHEN( "asking for the changes since a time" ) {
+			changes.setModTime(a, 100);
+			changes.setModTime(b, 200);
+			changes.setModTime(c, 300);
+
+			THEN( "only the newer changes are returned, oldest first" ) {
+				CString expected;
+				expected << changes.getChange(b)->getBoardStr() << changes.getChange(c)->getBoardStr();
+				REQUIRE( changes.getBoardStr(150) == expected );
+				REQUIRE( changes.getBoardStr(301).isEmpty() );
+			}
+		}
+
+		WHEN( "a newer change overwrites an older one" ) {
+			changes.setModTime(a, 100);
+			auto d = changes.addChange(makeChange(10, 10, 2, 2));
+			changes.setModTime(d, 200);
+			auto e = changes.addChange(makeChange(30, 30, 1, 1, 15));
+			changes.setModTime(e, 50);
+
+			THEN( "compaction drops the overwritten change" ) {
+				REQUIRE( changes.compact() == 1 );
+				REQUIRE( changes.getChange(a) == nullptr );
+				REQUIRE( changes.getChange(d) != nullptr );
+			}
+
+			THEN( "compaction keeps changes waiting to respawn" ) {
+				changes.compact();
+				REQUIRE( changes.getChange(e) != nullptr );
+			}
+		}
+	}
+}
+
+TEST_CASE( "TLevelBoardChangeList stress", "[level][!benchmark]" ) {
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<int> pos(0, 62);
+
+	BENCHMARK( "100k bush cuts" ) {
+		TLevelBoardChangeList changes;
+		for (int i = 0; i < 100000; ++i)
+		{
+			int x = pos(rng), y = pos(rng);
+			changes.eraseWithin(x, y, 2, 2);
+			changes.addChange(makeChange(x, y, 2, 2));
+		}
+		return changes.size();
+	};
+
+	TLevelBoardChangeList changes;
+	for (int i = 0; i < 100000; ++i)
+	{
+		int x = pos(rng), y = pos(rng);
+		changes.eraseWithin(x, y, 2, 2);
+		changes.addChange(makeChange(x, y, 2, 2));
+	}
+
+	// A 64x64 board can't keep more than 4096 live 2x2 changes.
+	REQUIRE( changes.size() <= 64 * 64 );
+
+	BENCHMARK( "changes since" ) {
+		return changes.getBoardStr(time(0) - 1).length();
+	};
+}
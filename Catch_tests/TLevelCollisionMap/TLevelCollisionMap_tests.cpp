@@ -0,0 +1,114 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <random>
+#include <vector>
+#include <tiletypes.h>
+#include <TLevelCollisionMap.h>
+
+// Finds the first tile of a tile type.
+static short tileOfType(unsigned char type)
+{
+	for (unsigned int tile = 0; tile < tiletypes_len; ++tile)
+	{
+		if (tiletypes[tile] == type)
+			return (short)tile;
+	}
+
+	return -1;
+}
+
+SCENARIO( "TLevelCollisionMap", "[level]" ) {
+
+	GIVEN( "A board with a wall and some water" ) {
+		short wall = tileOfType(22), water = tileOfType(11), floor = tileOfType(0);
+		REQUIRE( wall >= 0 );
+		REQUIRE( water >= 0 );
+		REQUIRE( floor >= 0 );
+
+		std::vector<short> tiles(TLevelCollisionMap::BoardWidth * TLevelCollisionMap::BoardHeight, floor);
+		tiles[10 + 20 * 64] = wall;
+		tiles[63 + 63 * 64] = wall;
+		tiles[0 + 5 * 64] = water;
+
+		TLevelCollisionMap map;
+		map.rebuild(tiles.data());
+
+		THEN( "tiles are blocking only where the walls are" ) {
+			REQUIRE( map.test(TILECLASS_WALL, 10, 20) );
+			REQUIRE_FALSE( map.test(TILECLASS_WALL, 11, 20) );
+			REQUIRE_FALSE( map.test(TILECLASS_WALL, 10, 21) );
+			REQUIRE_FALSE( map.test(TILECLASS_WATER, 10, 20) );
+			REQUIRE( map.test(TILECLASS_WATER, 0, 5) );
+			REQUIRE_FALSE( map.test(TILECLASS_WALL, 0, 5) );
+		}
+
+		THEN( "areas are blocking if any of their tiles is" ) {
+			REQUIRE( map.testArea(TILECLASS_WALL, 8, 18, 3, 3) );
+			REQUIRE_FALSE( map.testArea(TILECLASS_WALL, 11, 18, 3, 3) );
+			REQUIRE_FALSE( map.testArea(TILECLASS_WALL, 8, 21, 3, 3) );
+			REQUIRE( map.testArea(TILECLASS_WALL, 0, 0, 64, 64) );
+			REQUIRE_FALSE( map.testArea(TILECLASS_WALL, 10, 20, 0, 5) );
+		}
+
+		THEN( "tiles outside of the board never block, and areas are clipped to it" ) {
+			REQUIRE_FALSE( map.test(TILECLASS_WALL, 64, 63) );
+			REQUIRE_FALSE( map.test(TILECLASS_WALL, 63, 64) );
+			REQUIRE_FALSE( map.test(TILECLASS_WATER, -1, 5) );
+			REQUIRE( map.testArea(TILECLASS_WALL, 62, 62, 10, 10) );
+			REQUIRE( map.testArea(TILECLASS_WATER, -5, 4, 6, 2) );
+			REQUIRE_FALSE( map.testArea(TILECLASS_WATER, -5, 4, 5, 2) );
+			REQUIRE_FALSE( map.testArea(TILECLASS_WALL, 64, 0, 10, 64) );
+			REQUIRE_FALSE( map.testArea(TILECLASS_WALL, 0, -10, 64, 10) );
+		}
+
+		WHEN( "a tile changes" ) {
+			map.setTile(10, 20, floor);
+			map.setTile(30, 30, water);
+			map.setTile(64, 0, wall);
+
+			THEN( "only that tile's classes change" ) {
+				REQUIRE_FALSE( map.test(TILECLASS_WALL, 10, 20) );
+				REQUIRE( map.test(TILECLASS_WATER, 30, 30) );
+				REQUIRE( map.test(TILECLASS_WALL, 63, 63) );
+				REQUIRE_FALSE( map.testArea(TILECLASS_WALL, 0, 0, 64, 1) );
+			}
+		}
+	}
+
+	GIVEN( "Tiles that aren't in the tileset" ) {
+		THEN( "they don't belong to any class" ) {
+			REQUIRE( TLevelCollisionMap::getTileClasses(-1) == 0 );
+			REQUIRE( TLevelCollisionMap::getTileClasses((short)tiletypes_len) == 0 );
+		}
+	}
+}
+
+TEST_CASE( "TLevelCollisionMap matches the tile types", "[level]" ) {
+	std::mt19937 random(5);
+	std::vector<short> tiles(TLevelCollisionMap::BoardWidth * TLevelCollisionMap::BoardHeight);
+	for (auto & tile : tiles)
+		tile = (short)(random() % tiletypes_len);
+
+	TLevelCollisionMap map;
+	map.rebuild(tiles.data());
+
+	auto isBlocking = [&tiles](int x, int y) {
+		return x >= 0 && y >= 0 && x < 64 && y < 64 && tiletypes[tiles[x + y * 64]] >= 20;
+	};
+
+	for (int i = 0; i < 2000; ++i)
+	{
+		int x = (int)(random() % 80) - 8, y = (int)(random() % 80) - 8;
+		int width = (int)(random() % 6), height = (int)(random() % 6);
+
+		bool expected = false;
+		for (int ty = y; ty < y + height; ++ty)
+		{
+			for (int tx = x; tx < x + width; ++tx)
+				expected |= isBlocking(tx, ty);
+		}
+
+		REQUIRE( map.test(TILECLASS_WALL, x, y) == isBlocking(x, y) );
+		REQUIRE( map.testArea(TILECLASS_WALL, x, y, width, height) == expected );
+	}
+}
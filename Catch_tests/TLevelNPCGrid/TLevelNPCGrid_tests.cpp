@@ -0,0 +1,169 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <algorithm>
+#include <random>
+#include <TLevelNPCGrid.h>
+
+// The grid never dereferences the NPCs, so any distinct addresses will do.
+static std::vector<TNPC*> makeNpcIds(size_t count)
+{
+	static std::vector<char> storage;
+	storage.resize(std::max(storage.size(), count));
+
+	std::vector<TNPC*> ids;
+	for (size_t i = 0; i < count; ++i)
+		ids.push_back(reinterpret_cast<TNPC*>(&storage[i]));
+	return ids;
+}
+
+template<typename Fn>
+static std::vector<TNPC*> collect(Fn&& query)
+{
+	std::vector<TNPC*> result;
+	query([&result](TNPC* npc) { result.push_back(npc); });
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+SCENARIO( "TLevelNPCGrid", "[level]" ) {
+
+	GIVEN( "A grid with a few npcs" ) {
+		auto ids = makeNpcIds(4);
+		TLevelNPCGrid grid;
+		grid.insert(ids[0], 100, 100, 32, 32, NPCGRIDFLAG_VISIBLE | NPCGRIDFLAG_PLAYERTOUCHSME);
+		grid.insert(ids[1], 60, 60, 32, 32, NPCGRIDFLAG_VISIBLE);
+		grid.insert(ids[2], 500, 500, 32, 32, NPCGRIDFLAG_VISIBLE | NPCGRIDFLAG_PLAYERTOUCHSME);
+		grid.insert(ids[3], -200, 2000, 32, 32, NPCGRIDFLAG_VISIBLE | NPCGRIDFLAG_PLAYERTOUCHSME);
+
+		REQUIRE( grid.size() == 4 );
+
+		THEN( "point queries are inclusive and filtered by flags" ) {
+			auto touched = collect([&](auto fn) { grid.forEachAtPoint(132, 132, NPCGRIDFLAG_VISIBLE | NPCGRIDFLAG_PLAYERTOUCHSME, fn); });
+			REQUIRE( touched == std::vector<TNPC*>{ ids[0] } );
+
+			auto none = collect([&](auto fn) { grid.forEachAtPoint(70, 70, NPCGRIDFLAG_PLAYERTOUCHSME, fn); });
+			REQUIRE( none.empty() );
+
+			auto visible = collect([&](auto fn) { grid.forEachAtPoint(70, 70, NPCGRIDFLAG_VISIBLE, fn); });
+			REQUIRE( visible == std::vector<TNPC*>{ ids[1] } );
+		}
+
+		THEN( "area queries report npcs spanning several cells once" ) {
+			auto found = collect([&](auto fn) { grid.forEachInArea(0, 0, 200, 200, 0, fn); });
+			REQUIRE( found == std::vector<TNPC*>{ std::min(ids[0], ids[1]), std::max(ids[0], ids[1]) } );
+
+			auto edge = collect([&](auto fn) { grid.forEachInArea(132, 132, 10, 10, 0, fn); });
+			REQUIRE( edge.empty() );
+		}
+
+		THEN( "npcs outside of the level can still be found" ) {
+			auto found = collect([&](auto fn) { grid.forEachAtPoint(-190, 2010, 0, fn); });
+			REQUIRE( found == std::vector<TNPC*>{ ids[3] } );
+		}
+
+		WHEN( "an npc moves and another is removed" ) {
+			grid.update(ids[0], 800, 800, 32, 32, NPCGRIDFLAG_VISIBLE | NPCGRIDFLAG_PLAYERTOUCHSME);
+			grid.remove(ids[2]);
+
+			THEN( "queries follow the changes" ) {
+				REQUIRE( grid.size() == 3 );
+				REQUIRE( collect([&](auto fn) { grid.forEachAtPoint(110, 110, 0, fn); }).empty() );
+				REQUIRE( collect([&](auto fn) { grid.forEachAtPoint(510, 510, 0, fn); }).empty() );
+				REQUIRE( collect([&](auto fn) { grid.forEachAtPoint(810, 810, 0, fn); }) == std::vector<TNPC*>{ ids[0] } );
+			}
+		}
+
+		WHEN( "updating an npc that is not in the grid" ) {
+			auto other = makeNpcIds(5)[4];
+			THEN( "nothing is added" ) {
+				REQUIRE_FALSE( grid.update(other, 0, 0, 32, 32, 0) );
+				REQUIRE( grid.size() == 4 );
+			}
+		}
+	}
+}
+
+TEST_CASE( "TLevelNPCGrid matches a linear scan", "[level]" ) {
+	struct Bounds { int x, y, width, height; uint8_t flags; };
+
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<int> pos(-64, 1088), size(0, 96), flags(0, 3);
+
+	auto ids = makeNpcIds(500);
+	std::vector<Bounds> bounds;
+	TLevelNPCGrid grid;
+	for (auto id : ids)
+	{
+		Bounds b{ pos(rng), pos(rng), size(rng), size(rng), (uint8_t)flags(rng) };
+		bounds.push_back(b);
+		grid.insert(id, b.x, b.y, b.width, b.height, b.flags);
+	}
+
+	for (int i = 0; i < 2000; ++i)
+	{
+		int x = pos(rng), y = pos(rng), w = size(rng), h = size(rng);
+
+		std::vector<TNPC*> touchExpected, areaExpected;
+		for (size_t j = 0; j < ids.size(); ++j)
+		{
+			const Bounds& b = bounds[j];
+			if ((b.flags & 3) == 3 && b.x <= x && b.x + b.width >= x && b.y <= y && b.y + b.height >= y)
+				touchExpected.push_back(ids[j]);
+			if (x < b.x + b.width && x + w > b.x && y < b.y + b.height && y + h > b.y)
+				areaExpected.push_back(ids[j]);
+		}
+
+		REQUIRE( collect([&](auto fn) { grid.forEachAtPoint(x, y, 3, fn); }) == touchExpected );
+		REQUIRE( collect([&](auto fn) { grid.forEachInArea(x, y, w, h, 0, fn); }) == areaExpected );
+	}
+}
+
+TEST_CASE( "TLevelNPCGrid benchmarks", "[!benchmark]" ) {
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<int> pos(0, 1023);
+
+	auto ids = makeNpcIds(500);
+	std::vector<std::pair<int, int>> positions;
+	TLevelNPCGrid grid;
+	for (auto id : ids)
+	{
+		positions.emplace_back(pos(rng), pos(rng));
+		grid.insert(id, positions.back().first, positions.back().second, 32, 32, NPCGRIDFLAG_VISIBLE | NPCGRIDFLAG_PLAYERTOUCHSME);
+	}
+
+	BENCHMARK( "touch tests, 500 npcs, linear scan" ) {
+		size_t touched = 0;
+		for (int y = 0; y < 1024; y += 16)
+		{
+			for (int x = 0; x < 1024; x += 16)
+			{
+				for (auto& [npcX, npcY] : positions)
+				{
+					if (npcX <= x && npcX + 32 >= x && npcY <= y && npcY + 32 >= y)
+						++touched;
+				}
+			}
+		}
+		return touched;
+	};
+
+	BENCHMARK( "touch tests, 500 npcs, grid" ) {
+		size_t touched = 0;
+		for (int y = 0; y < 1024; y += 16)
+		{
+			for (int x = 0; x < 1024; x += 16)
+				grid.forEachAtPoint(x, y, NPCGRIDFLAG_VISIBLE | NPCGRIDFLAG_PLAYERTOUCHSME, [&touched](TNPC*) { ++touched; });
+		}
+		return touched;
+	};
+
+	BENCHMARK( "moving 500 npcs" ) {
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			auto& [npcX, npcY] = positions[i];
+			npcX = (npcX + 8) & 1023;
+			grid.update(ids[i], npcX, npcY, 32, 32, NPCGRIDFLAG_VISIBLE | NPCGRIDFLAG_PLAYERTOUCHSME);
+		}
+		return grid.size();
+	};
+}
@@ -0,0 +1,60 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <vector>
+#include <TLevelTileIndex.h>
+
+static std::vector<int> valuesAt(const TLevelTileIndex<int>& index, int x, int y)
+{
+	std::vector<int> values;
+	index.forEach(x, y, [&values](int value) { values.push_back(value); });
+	return values;
+}
+
+SCENARIO( "TLevelTileIndex", "[level]" ) {
+
+	GIVEN( "An index with a few values" ) {
+		TLevelTileIndex<int> index;
+		index.insert(10, 10, 1);
+		index.insert(10, 10, 2);
+		index.insert(20, 5, 3);
+		index.insertArea(0, 63, 63, 64, 4);
+
+		REQUIRE( index.size() == 3 + 64 );
+
+		THEN( "values are found in insertion order" ) {
+			REQUIRE( valuesAt(index, 10, 10) == std::vector<int>{ 1, 2 } );
+			REQUIRE( *index.find(10, 10, [](int value) { return value > 1; }) == 2 );
+			REQUIRE( index.find(11, 10, [](int) { return true; }) == nullptr );
+		}
+
+		THEN( "positions outside of the board share the border tiles" ) {
+			REQUIRE( valuesAt(index, 5, 70) == std::vector<int>{ 4 } );
+			REQUIRE( valuesAt(index, -3, 63) == std::vector<int>{ 4 } );
+		}
+
+		WHEN( "erasing a value" ) {
+			REQUIRE( index.erase(10, 10, 1) );
+			REQUIRE_FALSE( index.erase(10, 10, 1) );
+
+			THEN( "the other values remain" ) {
+				REQUIRE( valuesAt(index, 10, 10) == std::vector<int>{ 2 } );
+				REQUIRE( index.size() == 2 + 64 );
+			}
+
+			AND_WHEN( "inserting again" ) {
+				index.insert(10, 10, 5);
+
+				THEN( "the freed node is reused and the value appended" ) {
+					REQUIRE( valuesAt(index, 10, 10) == std::vector<int>{ 2, 5 } );
+				}
+			}
+		}
+	}
+
+	GIVEN( "A tile position" ) {
+		THEN( "fractional positions round down" ) {
+			REQUIRE( toLevelTile(30.5f) == 30 );
+			REQUIRE( toLevelTile(-0.5f) == -1 );
+		}
+	}
+}
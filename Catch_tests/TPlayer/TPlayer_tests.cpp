@@ -1,7 +1,14 @@
 #define CATCH_CONFIG_MAIN
 #include "catch2/catch_all.hpp"
+#include <chrono>
+#include <filesystem>
+#include <thread>
+#include <TLevel.h>
+#include <TNPC.h>
 #include <TPlayer.h>
 #include <TServer.h>
+#include "TestFiles.h"
+#include "TestPlayer.h"
 
 SCENARIO( "TPlayer", "[object]" ) {
 
@@ -23,4 +30,249 @@ SCENARIO( "TPlayer", "[object]" ) {
 			}
 		}
 	}
-}
\ No newline at end of file
+
+	GIVEN( "A client whose login is sent again before its account is read" ) {
+		auto* server = new TServer("test");
+		auto* player = new TestPlayer(server);
+
+		CString levelPath = createLevel(*server, "logintest.nw");
+		CString accountPath = writeAccount(*server, "logintest", "GRACC001\r\nLEVEL logintest.nw\r\nX 30\r\nY 30\r\nIPRANGE 0.0.0.0\r\n");
+		player->setAccountName("logintest");
+
+		REQUIRE( player->sendLogin() );
+		REQUIRE( player->sendLogin() );
+
+		WHEN( "both reads finish" ) {
+			while (server->getAccountLoader().isBusy())
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			server->getAccountLoader().update();
+
+			THEN( "the login is only finished once" ) {
+				REQUIRE( player->getPackets(PLO_SIGNATURE).size() == 1 );
+				REQUIRE( player->isLoaded() );
+			}
+		}
+
+		std::filesystem::remove(levelPath.text());
+		std::filesystem::remove(accountPath.text());
+	}
+
+	GIVEN( "A client warping to a level whose npc scripts are still compiling" ) {
+		auto* server = new TServer("test");
+		auto* socket = new CSocket();
+		auto* player = new TPlayer(server, (CSocket*)socket, 124);
+		player->setType(PLTYPE_CLIENT);
+		player->setVersion(CLVER_4_0211);
+
+		CString scriptedPath = createLevel(*server, "playertest_scripted.nw",
+			"NPC block.png 30 30\n//#CLIENTSIDE\n//#GS2\nfunction onCreated() { this.chat = \"compiled\"; }\nNPCEND\n");
+		CString plainPath = createLevel(*server, "playertest_plain.nw");
+
+		TLevel *scriptedLevel = TLevel::findLevel("playertest_scripted.nw", server);
+		TLevel *plainLevel = TLevel::findLevel("playertest_plain.nw", server);
+		REQUIRE( scriptedLevel != nullptr );
+		REQUIRE( plainLevel != nullptr );
+		REQUIRE( scriptedLevel->isCompilingScripts() );
+
+		REQUIRE( player->setLevel("playertest_scripted.nw") );
+		REQUIRE( player->isLevelPending(scriptedLevel) );
+
+		WHEN( "another level is sent before the scripts finish" ) {
+			REQUIRE( player->sendLevel(plainLevel, 0) );
+
+			THEN( "it waits behind the first level" ) {
+				REQUIRE( player->isLevelPending(plainLevel) );
+				player->sendPendingLevels();
+				REQUIRE( player->isLevelPending(scriptedLevel) );
+				REQUIRE( player->isLevelPending(plainLevel) );
+
+				AND_THEN( "both are sent once the scripts are done" ) {
+					for (auto npc : *scriptedLevel->getLevelNPCs())
+						server->cancelGS2Compile(npc);
+
+					player->sendPendingLevels();
+					REQUIRE( !player->isLevelPending(scriptedLevel) );
+					REQUIRE( !player->isLevelPending(plainLevel) );
+				}
+			}
+		}
+
+		WHEN( "the client leaves before the scripts finish" ) {
+			REQUIRE( player->leaveLevel() );
+
+			THEN( "the level is never sent, and isn't counted as cached by the client" ) {
+				REQUIRE( !player->isLevelPending(scriptedLevel) );
+				REQUIRE( player->getCachedLevelModTime(scriptedLevel) == 0 );
+			}
+		}
+
+		WHEN( "the client leaves a level that was sent" ) {
+			REQUIRE( player->leaveLevel() );
+			REQUIRE( player->setLevel("playertest_plain.nw") );
+			REQUIRE( !player->isLevelPending(plainLevel) );
+			REQUIRE( player->leaveLevel() );
+
+			THEN( "the level is counted as cached" ) {
+				REQUIRE( player->getCachedLevelModTime(plainLevel) != 0 );
+			}
+		}
+
+		std::filesystem::remove(scriptedPath.text());
+		std::filesystem::remove(plainPath.text());
+	}
+
+	GIVEN( "A client walking along a gmap" ) {
+		auto* server = new TServer("test");
+		auto* player = new TestPlayer(server);
+
+		// a b c d, with an npc in a and a board change in d.
+		std::vector<CString> paths;
+		paths.push_back(writeServerFile(*server, *server->getFileSystem(FS_LEVEL), "world", "streamtest.gmap",
+			"GRMAP001\nWIDTH 4\nHEIGHT 1\nLEVELNAMES\n\"streamtest_a.nw\",\"streamtest_b.nw\",\"streamtest_c.nw\",\"streamtest_d.nw\"\nLEVELNAMESEND\n"));
+		server->getSettings()->addKey("gmaps", "streamtest.gmap");
+		server->loadMaps();
+
+		paths.push_back(createLevel(*server, "streamtest_a.nw", "NPC block.png 30 30\nNPCEND\n"));
+		paths.push_back(createLevel(*server, "streamtest_b.nw"));
+		paths.push_back(createLevel(*server, "streamtest_c.nw"));
+		paths.push_back(createLevel(*server, "streamtest_d.nw"));
+
+		TLevel* levelA = TLevel::findLevel("streamtest_a.nw", server);
+		TLevel* levelB = TLevel::findLevel("streamtest_b.nw", server);
+		TLevel* levelC = TLevel::findLevel("streamtest_c.nw", server);
+		TLevel* levelD = TLevel::findLevel("streamtest_d.nw", server);
+		REQUIRE( levelA != nullptr );
+		REQUIRE( levelB != nullptr );
+		REQUIRE( levelC != nullptr );
+		REQUIRE( levelD != nullptr );
+		REQUIRE( levelA->getMap() != nullptr );
+
+		CString tile = CString().writeGShort(511);
+		REQUIRE( levelD->alterBoard(tile, 0, 0, 1, 1, nullptr) );
+
+		auto walkTo = [player](const char* levelName) {
+			REQUIRE( player->leaveLevel() );
+			REQUIRE( player->setLevel(levelName, -1) );
+		};
+
+		REQUIRE( player->warp("streamtest_b.nw", 30, 30) );
+
+		THEN( "the levels next to it are streamed in" ) {
+			REQUIRE( player->isGmapLevelStreamed(levelA) );
+			REQUIRE( player->isGmapLevelStreamed(levelC) );
+			REQUIRE( !player->isGmapLevelStreamed(levelB) );
+			REQUIRE( !player->isGmapLevelStreamed(levelD) );
+			REQUIRE( player->getPackets(PLO_NPCPROPS).size() == 1 );
+		}
+
+		WHEN( "a level that was only streamed goes out of view" ) {
+			walkTo("streamtest_c.nw");
+			REQUIRE( player->isGmapLevelStreamed(levelD) );
+			walkTo("streamtest_b.nw");
+
+			THEN( "its board changes are still sent when it is entered" ) {
+				REQUIRE( !player->isGmapLevelStreamed(levelD) );
+				REQUIRE( player->getCachedLevelModTime(levelD) == 0 );
+
+				walkTo("streamtest_c.nw");
+				walkTo("streamtest_d.nw");
+
+				auto boards = player->getPackets(PLO_LEVELBOARD);
+				REQUIRE( !boards.empty() );
+				REQUIRE( boards.back().length() > 4 );
+			}
+		}
+
+		WHEN( "a level leaves view and comes back into view" ) {
+			walkTo("streamtest_c.nw");
+			REQUIRE( !player->isGmapLevelStreamed(levelA) );
+			player->clearPackets();
+			walkTo("streamtest_b.nw");
+
+			THEN( "it is streamed in again" ) {
+				REQUIRE( player->isGmapLevelStreamed(levelA) );
+				REQUIRE( player->getPackets(PLO_NPCPROPS).size() == 1 );
+			}
+		}
+
+		WHEN( "the client walks into a level that was streamed in" ) {
+			player->clearPackets();
+			walkTo("streamtest_a.nw");
+
+			THEN( "its npcs aren't sent again, and the level it left stays in view" ) {
+				REQUIRE( player->getPackets(PLO_NPCPROPS).empty() );
+				REQUIRE( !player->isGmapLevelStreamed(levelA) );
+				REQUIRE( player->isGmapLevelStreamed(levelB) );
+			}
+
+			AND_WHEN( "the level is reloaded" ) {
+				player->clearPackets();
+				REQUIRE( levelA->reload() );
+
+				THEN( "its npcs are sent again" ) {
+					REQUIRE( player->getLevel() == levelA );
+					REQUIRE( player->getPackets(PLO_NPCPROPS).size() == 1 );
+				}
+			}
+		}
+
+		for (const auto& path : paths)
+			std::filesystem::remove(path.text());
+	}
+
+	GIVEN( "A client on a gmap that asked for a level whose npc scripts are still compiling" ) {
+		auto* server = new TServer("test");
+		auto* player = new TestPlayer(server, CLVER_4_0211);
+
+		// a b c, with a script in c.
+		std::vector<CString> paths;
+		paths.push_back(writeServerFile(*server, *server->getFileSystem(FS_LEVEL), "world", "pendingtest.gmap",
+			"GRMAP001\nWIDTH 3\nHEIGHT 1\nLEVELNAMES\n\"pendingtest_a.nw\",\"pendingtest_b.nw\",\"pendingtest_c.nw\"\nLEVELNAMESEND\n"));
+		server->getSettings()->addKey("gmaps", "pendingtest.gmap");
+		server->loadMaps();
+
+		paths.push_back(createLevel(*server, "pendingtest_a.nw"));
+		paths.push_back(createLevel(*server, "pendingtest_b.nw"));
+		paths.push_back(createLevel(*server, "pendingtest_c.nw",
+			"NPC block.png 30 30\n//#CLIENTSIDE\n//#GS2\nfunction onCreated() { this.chat = \"compiled\"; }\nNPCEND\n"));
+		paths.push_back(createLevel(*server, "pendingtest_off.nw"));
+
+		TLevel* levelB = TLevel::findLevel("pendingtest_b.nw", server);
+		TLevel* levelC = TLevel::findLevel("pendingtest_c.nw", server);
+		REQUIRE( levelB != nullptr );
+		REQUIRE( levelC != nullptr );
+		REQUIRE( levelC->isCompilingScripts() );
+
+		REQUIRE( player->warp("pendingtest_a.nw", 30, 30) );
+		REQUIRE( player->sendLevel(levelC, 0, true) );
+		REQUIRE( player->isLevelPending(levelC) );
+
+		WHEN( "the client walks to another level of the gmap" ) {
+			REQUIRE( player->leaveLevel() );
+			REQUIRE( player->setLevel("pendingtest_b.nw", -1) );
+
+			THEN( "the level it asked for is still sent once the scripts are done" ) {
+				REQUIRE( player->isLevelPending(levelC) );
+				REQUIRE( player->isLevelPending(levelB) );
+
+				for (auto npc : *levelC->getLevelNPCs())
+					server->cancelGS2Compile(npc);
+
+				player->sendPendingLevels();
+				REQUIRE( !player->isLevelPending(levelC) );
+				REQUIRE( !player->isLevelPending(levelB) );
+			}
+		}
+
+		WHEN( "the client warps off the gmap" ) {
+			REQUIRE( player->warp("pendingtest_off.nw", 30, 30) );
+
+			THEN( "the level it asked for isn't sent anymore" ) {
+				REQUIRE( !player->isLevelPending(levelC) );
+			}
+		}
+
+		for (const auto& path : paths)
+			std::filesystem::remove(path.text());
+	}
+}
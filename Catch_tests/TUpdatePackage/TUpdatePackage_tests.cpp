@@ -0,0 +1,118 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <chrono>
+#include <filesystem>
+#include <thread>
+#include <CFileCache.h>
+#include <CFileSystem.h>
+#include <IUtil.h>
+#include <TServer.h>
+#include <TUpdatePackageManager.h>
+#include "TestFiles.h"
+
+static std::shared_ptr<const TUpdatePackage> waitForPackage(TUpdatePackageManager& manager, const std::string& name)
+{
+	std::shared_ptr<const TUpdatePackage> package;
+	bool ready = false;
+	manager.whenReady(name, [&](const auto& updatePackage) {
+		package = updatePackage;
+		ready = true;
+	});
+
+	while (!ready)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		manager.update();
+	}
+
+	return package;
+}
+
+SCENARIO( "TUpdatePackageManager", "[updatepackage]" ) {
+
+	GIVEN( "A package that references a few files" ) {
+		TServer server("test");
+		CFileSystem fs(&server);
+		writeServerFile(server, fs, "updatepackage_test", "test.gupd", "FILE levels/a.png\r\nFILE b.png\r\nFILE c.png\r\n");
+		writeServerFile(server, fs, "updatepackage_test", "a.png", "aaaa");
+		writeServerFile(server, fs, "updatepackage_test", "b.png", "bb");
+
+		auto manifestPath = std::filesystem::path(server.getServerPath().text()) / "updatepackage_test" / ".test.gupd.manifest";
+		std::filesystem::remove(manifestPath);
+
+		TUpdatePackageManager manager(&fs);
+
+		WHEN( "the package is loaded" ) {
+			auto package = waitForPackage(manager, "test.gupd");
+
+			THEN( "it has the size and checksum of every file that exists" ) {
+				REQUIRE( package != nullptr );
+				REQUIRE( package->getPackageSize() == 6 );
+				REQUIRE( package->getFileList().at("a.png").checksum == calculateCrc32Checksum(CString("aaaa")) );
+				REQUIRE( package->getFileList().at("b.png").checksum == calculateCrc32Checksum(CString("bb")) );
+				REQUIRE( package->getMissingFiles() == std::vector<std::string>{ "c.png" } );
+				REQUIRE( manager.find("test.gupd") == package );
+				REQUIRE( std::filesystem::exists(manifestPath) );
+			}
+
+			THEN( "a changed file is read again" ) {
+				writeServerFile(server, fs, "updatepackage_test", "b.png", "bbbbb");
+				manager.fileChanged("b.png");
+				REQUIRE( manager.find("test.gupd") == nullptr );
+
+				auto changed = waitForPackage(manager, "test.gupd");
+				REQUIRE( changed->getPackageSize() == 9 );
+				REQUIRE( changed->getFileList().at("b.png").checksum == calculateCrc32Checksum(CString("bbbbb")) );
+			}
+
+			THEN( "a missing file is picked up once it is added" ) {
+				writeServerFile(server, fs, "updatepackage_test", "c.png", "c");
+				manager.fileChanged("c.png");
+
+				auto changed = waitForPackage(manager, "test.gupd");
+				REQUIRE( changed->getPackageSize() == 7 );
+				REQUIRE( changed->getMissingFiles().empty() );
+			}
+
+			THEN( "a manager with a file cache leaves the files it read in the cache" ) {
+				std::filesystem::remove(manifestPath);
+				CFileCache cache;
+				TUpdatePackageManager cached(&fs, &cache);
+				auto loaded = waitForPackage(cached, "test.gupd");
+				REQUIRE( loaded->getFileList().at("b.png").checksum == package->getFileList().at("b.png").checksum );
+				REQUIRE( cache.getFileCount() == 2 );
+				REQUIRE( cache.get(fs.find("a.png"))->checksum == calculateCrc32Checksum(CString("aaaa")) );
+			}
+
+			THEN( "another manager starts from the manifest" ) {
+				TUpdatePackageManager other(&fs);
+				auto loaded = waitForPackage(other, "test.gupd");
+				REQUIRE( loaded->getPackageSize() == package->getPackageSize() );
+				REQUIRE( loaded->getFileList().at("a.png").modTime == package->getFileList().at("a.png").modTime );
+			}
+		}
+
+		THEN( "packages that don't exist are reported as missing" ) {
+			REQUIRE( waitForPackage(manager, "missing.gupd") == nullptr );
+
+			AND_THEN( "they aren't kept track of" ) {
+				manager.queue("missing2.gupd");
+				manager.fileChanged("missing3.gupd");
+				REQUIRE( manager.getPackageCount() == 0 );
+				REQUIRE( !manager.isBusy() );
+			}
+		}
+
+		WHEN( "the package file is removed while it is loaded" ) {
+			REQUIRE( waitForPackage(manager, "test.gupd") != nullptr );
+			fs.removeFile("updatepackage_test/test.gupd");
+			std::filesystem::remove(std::filesystem::path(server.getServerPath().text()) / "updatepackage_test" / "test.gupd");
+			manager.queue("test.gupd");
+
+			THEN( "it is reported as missing and forgotten" ) {
+				REQUIRE( waitForPackage(manager, "test.gupd") == nullptr );
+				REQUIRE( manager.getPackageCount() == 0 );
+			}
+		}
+	}
+}
@@ -0,0 +1,48 @@
+#ifndef CATCH_TESTS_TESTFILES_H
+#define CATCH_TESTS_TESTFILES_H
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <CFileSystem.h>
+#include <CString.h>
+#include <TServer.h>
+
+//! Writes a file, creating the folders it goes in.
+inline CString writeFile(const std::filesystem::path& path, CString data)
+{
+	std::filesystem::create_directories(path.parent_path());
+
+	CString fileName(path.string());
+	data.save(fileName);
+	return fileName;
+}
+
+//! Writes a file into the temp folder.
+inline CString writeTempFile(const std::string& name, const CString& data)
+{
+	return writeFile(std::filesystem::temp_directory_path() / name, data);
+}
+
+//! Writes a file into a folder of the server, and adds it to one of the server's file systems.
+inline CString writeServerFile(TServer& server, CFileSystem& fileSystem, const std::string& folder, const std::string& name, const CString& data)
+{
+	CString path = writeFile(std::filesystem::path(server.getServerPath().text()) / folder / name, data);
+	fileSystem.addFile(path);
+	return path;
+}
+
+//! Writes an account into the server's accounts folder.
+inline CString writeAccount(TServer& server, const std::string& accountName, const CString& data)
+{
+	return writeServerFile(server, *server.getAccountsFileSystem(), "accounts", accountName + ".txt", data);
+}
+
+//! Writes a level into the server's world folder.
+inline CString createLevel(TServer& server, const std::string& levelName, const std::string& contents = "")
+{
+	return writeServerFile(server, *server.getFileSystem(FS_LEVEL), "world", levelName, CString() << "GLEVNW01\n" << contents);
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef CATCH_TESTS_TESTPLAYER_H
+#define CATCH_TESTS_TESTPLAYER_H
+
+#pragma once
+
+#include <vector>
+#include <CSocket.h>
+#include <CString.h>
+#include <IEnums.h>
+#include <TPlayer.h>
+#include <TServer.h>
+
+//! A client that keeps the packets sent to it instead of sending them.
+class TestPlayer : public TPlayer
+{
+public:
+	struct Packet
+	{
+		int id;
+		CString data;
+	};
+
+	explicit TestPlayer(TServer* server, int version = CLVER_2_17)
+		: TPlayer(server, new CSocket(), 0)
+	{
+		setType(PLTYPE_CLIENT);
+		setVersion(version);
+		server->addPlayer(this);
+	}
+
+	void sendPacket(CString pPacket, bool appendNL = true) override
+	{
+		// The packet after PLO_RAWDATA is binary, so it isn't split into lines.
+		if (rawDataNext)
+		{
+			rawDataNext = false;
+			packets.push_back({ -1, pPacket });
+			return;
+		}
+
+		while (pPacket.bytesLeft() > 0)
+		{
+			CString line = pPacket.readString("\n");
+			if (line.isEmpty())
+				continue;
+
+			int id = line.readGUChar();
+			packets.push_back({ id, line.subString(1) });
+			rawDataNext = (id == PLO_RAWDATA);
+		}
+	}
+
+	//! Gets the data of every packet of a type sent so far.
+	std::vector<CString> getPackets(int id) const
+	{
+		std::vector<CString> found;
+		for (const auto& packet : packets)
+		{
+			if (packet.id == id)
+				found.push_back(packet.data);
+		}
+		return found;
+	}
+
+	void clearPackets()				{ packets.clear(); }
+
+private:
+	std::vector<Packet> packets;
+	bool rawDataNext = false;
+};
+
+#endif
@@ -0,0 +1,183 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch_all.hpp"
+#include <random>
+#include <string>
+#include <vector>
+#include <TimerWheel.h>
+
+using Wheel = utilities::TimerWheel<int>;
+
+static std::vector<int> advanceTo(Wheel& wheel, Wheel::Tick tick)
+{
+	std::vector<int> fired;
+	wheel.advance(tick, [&fired](int value) { fired.push_back(value); });
+	return fired;
+}
+
+SCENARIO( "TimerWheel", "[timer]" ) {
+
+	GIVEN( "Timers with millisecond deadlines" ) {
+		Wheel wheel;
+		wheel.schedule(50, 1);
+		wheel.schedule(3, 2);
+		auto handle = wheel.schedule(1000, 3);
+		wheel.schedule(5 * 60 * 60 * 1000, 4);
+
+		THEN( "only the timers that run out are fired, in deadline order" ) {
+			REQUIRE( advanceTo(wheel, 49).empty() == false );
+			REQUIRE( wheel.size() == 3 );
+			REQUIRE( advanceTo(wheel, 50) == std::vector<int>{ 1 } );
+			REQUIRE( advanceTo(wheel, 999).empty() );
+			REQUIRE( advanceTo(wheel, 1000) == std::vector<int>{ 3 } );
+		}
+
+		THEN( "timers beyond the range of the wheel still fire on time" ) {
+			REQUIRE( advanceTo(wheel, 5 * 60 * 60 * 1000 - 1).size() == 3 );
+			REQUIRE( advanceTo(wheel, 5 * 60 * 60 * 1000) == std::vector<int>{ 4 } );
+			REQUIRE( wheel.empty() );
+		}
+
+		WHEN( "a timer is cancelled" ) {
+			REQUIRE( wheel.getDeadline(handle) == Wheel::Tick(1000) );
+			REQUIRE( wheel.cancel(handle) );
+			REQUIRE_FALSE( handle.isSet() );
+
+			THEN( "it never fires, and cancelling it again does nothing" ) {
+				REQUIRE( advanceTo(wheel, 2000) == std::vector<int>{ 2, 1 } );
+				REQUIRE_FALSE( wheel.cancel(handle) );
+			}
+		}
+
+		WHEN( "a timer has fired" ) {
+			advanceTo(wheel, 1000);
+
+			THEN( "its handle no longer refers to anything, even once its node is reused" ) {
+				auto reused = wheel.schedule(1500, 5);
+				REQUIRE_FALSE( wheel.isScheduled(handle) );
+				REQUIRE_FALSE( wheel.cancel(handle) );
+				REQUIRE( wheel.isScheduled(reused) );
+			}
+		}
+
+		WHEN( "the wheel is cleared" ) {
+			wheel.clear();
+			REQUIRE( wheel.empty() );
+
+			THEN( "handles from before the clear don't refer to the timers scheduled after it" ) {
+				std::vector<utilities::TimerHandle> scheduled;
+				for (int i = 0; i < 8; ++i)
+					scheduled.push_back(wheel.schedule(100 + i, 10 + i));
+
+				REQUIRE_FALSE( wheel.isScheduled(handle) );
+				REQUIRE_FALSE( wheel.cancel(handle) );
+				REQUIRE( wheel.size() == scheduled.size() );
+				REQUIRE( advanceTo(wheel, 200) == std::vector<int>{ 10, 11, 12, 13, 14, 15, 16, 17 } );
+			}
+		}
+	}
+
+	GIVEN( "Timers scheduled at random" ) {
+		Wheel wheel;
+		std::mt19937 random(7);
+		std::vector<Wheel::Tick> deadlines;
+		for (int i = 0; i < 5000; ++i)
+		{
+			deadlines.push_back(random() % 100000);
+			wheel.schedule(deadlines.back(), i);
+		}
+
+		THEN( "each fires exactly once, no earlier than its deadline" ) {
+			std::vector<int> fireCount(deadlines.size());
+			for (Wheel::Tick tick = 1; tick <= 100000; tick += random() % 97)
+			{
+				wheel.advance(tick, [&](int i) {
+					REQUIRE( deadlines[i] <= tick );
+					++fireCount[i];
+				});
+			}
+			wheel.advance(100000, [&](int i) { ++fireCount[i]; });
+
+			REQUIRE( wheel.empty() );
+			REQUIRE( std::count(fireCount.begin(), fireCount.end(), 1) == (long)fireCount.size() );
+		}
+	}
+}
+
+TEST_CASE( "TimerWheel npc timer benchmarks", "[timer][!benchmark]" ) {
+	const int npcCount = 50000;
+
+	// Most npcs have a timeout a while away, and a few have scheduled events as well.
+	struct SteppedNpc
+	{
+		int timeout;
+		std::vector<int> events;
+	};
+
+	std::mt19937 random(11);
+	std::vector<SteppedNpc> steppedNpcs(npcCount);
+	utilities::TimerWheel<int> wheel;
+	std::vector<utilities::TimerHandle> handles;
+	for (int i = 0; i < npcCount; ++i)
+	{
+		int timeout = 1 + (int)(random() % 1200);
+		steppedNpcs[i].timeout = timeout;
+		handles.push_back(wheel.schedule(timeout * 50, i));
+		if (i % 10 == 0)
+		{
+			int event = 1 + (int)(random() % 1200);
+			steppedNpcs[i].events.push_back(event);
+			wheel.schedule(event * 50, i);
+		}
+	}
+
+	// The old timers counted every npc down by one every 50 milliseconds.
+	BENCHMARK( "one second of timers, stepping " + std::to_string(npcCount) + " npcs" ) {
+		int fired = 0;
+		for (int step = 0; step < 20; ++step)
+		{
+			for (auto & npc : steppedNpcs)
+			{
+				if (npc.timeout > 0 && --npc.timeout == 0)
+				{
+					npc.timeout = 1200;
+					++fired;
+				}
+
+				for (auto it = npc.events.begin(); it != npc.events.end();)
+				{
+					if (--*it == 0)
+					{
+						it = npc.events.erase(it);
+						++fired;
+					}
+					else ++it;
+				}
+			}
+		}
+		return fired;
+	};
+
+	BENCHMARK( "one second of timers, timer wheel with " + std::to_string(npcCount) + " npcs" ) {
+		int fired = 0;
+		auto start = wheel.getCurrentTick();
+		for (int step = 1; step <= 20; ++step)
+		{
+			wheel.advance(start + step * 50, [&](int npc) {
+				handles[npc] = wheel.schedule(wheel.getCurrentTick() + 60000, npc);
+				++fired;
+			});
+		}
+		return fired;
+	};
+
+	BENCHMARK( "cancelling the timers of " + std::to_string(npcCount) + " deleted npcs" ) {
+		utilities::TimerWheel<int> deleted;
+		std::vector<utilities::TimerHandle> deletedHandles;
+		for (int i = 0; i < npcCount; ++i)
+			deletedHandles.push_back(deleted.schedule(1 + i % 60000, i));
+
+		for (auto & handle : deletedHandles)
+			deleted.cancel(handle);
+		return deleted.size();
+	};
+}
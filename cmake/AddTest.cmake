@@ -21,6 +21,7 @@ function(add_test_og TARGET_NAME TARGET_PATH)
   target_include_directories(${TARGET_NAME} PUBLIC ${PROJECT_SOURCE_DIR}/server/include/Misc)
   target_include_directories(${TARGET_NAME} PUBLIC ${PROJECT_SOURCE_DIR}/server/include/utilities)
   target_include_directories(${TARGET_NAME} PUBLIC ${PROJECT_SOURCE_DIR}/server/include/Animation)
+  target_include_directories(${TARGET_NAME} PUBLIC ${TARGET_PATH})
 
   add_dependencies(${TARGET_NAME} ${GSERVER_LIBRARY_NAME})
 
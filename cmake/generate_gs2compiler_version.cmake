@@ -0,0 +1,38 @@
+# Writes GS2COMPILER_VERSION into HEADER_FILE, so cached GS2 bytecode is only used by the compiler that produced it.
+# The version is a hash of the gs2compiler sources in SOURCE_DIR, taken on every build so local changes count too.
+# Without the sources, every build counts as a new compiler.
+file(GLOB_RECURSE GS2COMPILER_SOURCES
+	"${SOURCE_DIR}/CMakeLists.txt"
+	"${SOURCE_DIR}/*.c"
+	"${SOURCE_DIR}/*.cpp"
+	"${SOURCE_DIR}/*.h"
+	"${SOURCE_DIR}/*.hpp"
+	"${SOURCE_DIR}/*.l"
+	"${SOURCE_DIR}/*.y"
+	"${SOURCE_DIR}/*.yy"
+)
+list(FILTER GS2COMPILER_SOURCES EXCLUDE REGEX "/(\\.git|build[^/]*)/")
+list(SORT GS2COMPILER_SOURCES)
+
+set(GS2COMPILER_HASHES "")
+foreach(SOURCE ${GS2COMPILER_SOURCES})
+	file(RELATIVE_PATH SOURCE_NAME "${SOURCE_DIR}" "${SOURCE}")
+	file(SHA256 "${SOURCE}" SOURCE_HASH)
+	string(APPEND GS2COMPILER_HASHES "${SOURCE_NAME} ${SOURCE_HASH}\n")
+endforeach()
+
+if(GS2COMPILER_HASHES)
+	string(SHA256 GS2COMPILER_VERSION "${GS2COMPILER_HASHES}")
+else()
+	string(TIMESTAMP GS2COMPILER_VERSION "build-%Y%m%d%H%M%S" UTC)
+endif()
+
+set(HEADER_CONTENTS "#ifndef GS2COMPILERVERSION_H\n#define GS2COMPILERVERSION_H\n#pragma once\n\n#define GS2COMPILER_VERSION\t\"${GS2COMPILER_VERSION}\"\n\n#endif\n")
+
+# Only touch the header when the version changed, so the server isn't rebuilt every time.
+if(EXISTS "${HEADER_FILE}")
+	file(READ "${HEADER_FILE}" OLD_HEADER_CONTENTS)
+endif()
+if(NOT "${OLD_HEADER_CONTENTS}" STREQUAL "${HEADER_CONTENTS}")
+	file(WRITE "${HEADER_FILE}" "${HEADER_CONTENTS}")
+endif()
@@ -0,0 +1,175 @@
+#ifndef CFILEINDEX_H
+#define CFILEINDEX_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "CString.h"
+#include "CFileSystemWatcher.h"
+
+//! The files of one or more file systems.  Each file system is a category of the index with
+//! its own list of directories, and a file that several of them find is only kept once, along
+//! with the categories it belongs to.  Directories are kept once as well and shared by their files.
+//! Lookups read the published index without waiting for changes, so they can be made from any thread.
+//! Changes are made to a copy which then replaces it.  The copy only duplicates the parts it changes.
+class CFileIndex
+{
+	public:
+		using FileList = std::map<CString, CString>;
+		static constexpr unsigned int MaxCategories = 32;
+
+		CFileIndex();
+
+		CFileIndex(const CFileIndex&) = delete;
+		CFileIndex& operator=(const CFileIndex&) = delete;
+
+		//! Removes every file and directory from every category.
+		void clear();
+
+		//! Removes every file and directory from a category.
+		void clear(unsigned int category);
+
+		//! Adds directories to a category.  Directories that are already in it are loaded again,
+		//! along with every other category.
+		//! \param dirs Full paths of the directories, each followed by a wildcard.
+		//! \param recursive Whether subdirectories are loaded when the index is resynchronized.
+		//! \param forceRecursive Load the subdirectories of these directories either way.
+		void addDirs(unsigned int category, const std::vector<CString>& dirs, bool recursive, bool forceRecursive = false);
+
+		//! Adds a file to a category, no matter which directory it is in.
+		//! \param path The full path of the file.
+		void addFile(unsigned int category, const CString& path);
+
+		//! Adds several files to a category at once.
+		//! \param paths The full paths of the files.
+		void addFiles(unsigned int category, const std::vector<CString>& paths);
+
+		//! Removes a file from a category.
+		void removeFile(unsigned int category, const CString& file);
+
+		//! Applies the changes seen by a file system watcher to every category at once.
+		void syncFiles(const std::vector<CFileChange>& changes);
+
+		//! Loads the directories of every category again, reading each directory once.
+		void resync(bool recursive);
+
+		CString find(unsigned int category, const CString& file) const;
+		CString findi(unsigned int category, const CString& file) const;
+		CString fileExistsAs(unsigned int category, const CString& file) const;
+
+		//! Gets the list of the files in a category as they are right now, mapped to their full paths.
+		//! The list is built once per version of the index and shared until the index changes.
+		std::shared_ptr<const FileList> getFileList(unsigned int category) const;
+
+		//! Gets a copy of the directories of a category, each followed by its wildcard.
+		std::vector<CString> getDirList(unsigned int category) const;
+
+		//! Counts the files in a category.
+		size_t getFileCount(unsigned int category) const;
+
+		//! Gets the number of distinct files and directories across every category.
+		size_t getFileCount() const						{ return getIndex()->fileCount; }
+		size_t getDirectoryCount() const				{ return getIndex()->directories->paths.size(); }
+
+	private:
+		// A directory a file is in, and the categories that take the file from there.
+		struct Location
+		{
+			uint32_t directory;
+			uint32_t categories;
+		};
+
+		// Names that only differ in case share an entry, which holds the name that comes
+		// first in the file list along with how many names share it.
+		struct FoldedFile
+		{
+			CString file;
+			unsigned int count;
+		};
+
+		using FileMap = std::map<CString, std::vector<Location>>;
+
+		// Files are spread over the shards by their case-folded name, so every spelling of
+		// a name is in the same shard.
+		struct Shard
+		{
+			FileMap files;
+			std::unordered_map<std::string, FoldedFile> foldedFiles;
+		};
+
+		// Directories are only ever added, so they are shared until a new one is.
+		struct Directories
+		{
+			std::vector<CString> paths;
+			std::unordered_map<std::string, uint32_t> ids;
+		};
+
+		// File lists built from a published index.  A copy of the index starts without any.
+		struct FileLists
+		{
+			FileLists() = default;
+			FileLists(const FileLists&)					{}
+			FileLists& operator=(const FileLists&)		{ return *this; }
+
+			mutable std::array<std::shared_ptr<const FileList>, MaxCategories> lists;
+		};
+
+		// Copying an index only copies the pointers to its shards and directories.  Whatever
+		// a change touches is copied the first time it is changed.
+		struct Index
+		{
+			static constexpr size_t ShardCount = 256;
+
+			std::array<std::shared_ptr<Shard>, ShardCount> shards;
+			std::shared_ptr<Directories> directories = std::make_shared<Directories>();
+			size_t fileCount = 0;
+			uint32_t usedCategories = 0;
+			FileLists fileLists;
+
+			static size_t shardOf(const std::string& folded);
+			const Shard& getShard(size_t shard) const;
+			Shard& editShard(size_t shard);
+			uint32_t intern(const CString& directory);
+			void set(const CString& file, uint32_t directory, unsigned int category);
+			void erase(const CString& file, unsigned int category);
+			void eraseCategory(unsigned int category);
+			FileMap::iterator removeName(Shard& shard, FileMap::iterator it);
+			static const Location* locate(const std::vector<Location>& locations, unsigned int category);
+			const Location* find(const CString& file, unsigned int category) const;
+			const CString& getDirectory(uint32_t directory) const	{ return directories->paths[directory]; }
+			CString getPath(const CString& file, unsigned int category) const;
+		};
+
+		// The names found in a directory, before any wildcard is applied.
+		struct ScannedDirectory
+		{
+			std::vector<CString> files;
+			std::vector<CString> subDirs;
+		};
+
+		// Scanned directories, keyed by their full path ending in a path separator.
+		using ScanResults = std::unordered_map<std::string, ScannedDirectory>;
+
+		std::shared_ptr<const Index> getIndex() const		{ return std::atomic_load_explicit(&index, std::memory_order_acquire); }
+		void publish(std::shared_ptr<const Index> updated)	{ std::atomic_store_explicit(&index, std::move(updated), std::memory_order_release); }
+		CString findFolded(unsigned int category, const CString& file, CString* path) const;
+		CString resolveDirectory(unsigned int category, const CString& file, std::unordered_map<std::string, bool>& existing) const;
+		void loadDirectories(Index& target, const std::vector<std::pair<unsigned int, size_t>>& firstDirs, bool recursive);
+		void mergeDirectory(Index& target, unsigned int category, const ScanResults& scanned, std::unordered_set<std::string>& knownDirs, const CString& directory, bool recursive);
+		static ScanResults scanDirectories(const std::vector<std::string>& paths, bool recursive);
+		static void scanDirectory(const std::string& path, ScannedDirectory& result, bool recursive);
+
+		std::shared_ptr<const Index> index;
+		std::vector<CString> dirLists[MaxCategories];
+
+		// Held while changing the index or the directory lists.  Lookups never take it.
+		mutable std::recursive_mutex changeLock;
+};
+
+#endif
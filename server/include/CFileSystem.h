@@ -1,9 +1,12 @@
 #ifndef CFILESYSTEM_H
 #define CFILESYSTEM_H
 
-#include <map>
-#include <mutex>
+#include <memory>
+#include <utility>
+#include <vector>
 #include "CString.h"
+#include "CFileIndex.h"
+#include "CFileSystemWatcher.h"
 
 class TServer;
 class CFileSystem
@@ -17,17 +20,33 @@ class CFileSystem
 #endif
 
 	public:
+		using FileList = CFileIndex::FileList;
+
 		CFileSystem();
 		CFileSystem(TServer* pServer);
-		~CFileSystem();
+
+		// A copy would share the index and category of the original.
+		CFileSystem(const CFileSystem&) = delete;
+		CFileSystem& operator=(const CFileSystem&) = delete;
 		void clear();
 
 		void setServer(TServer* pServer) { server = pServer; }
 
+		//! Makes the file system a category of a shared index, so files it has in common with
+		//! the other categories are only kept once.  Its files and directories are cleared.
+		void setIndex(std::shared_ptr<CFileIndex> pIndex, unsigned int pCategory);
+
 		void addDir(const CString& dir, const CString& wildcard = "*", bool forceRecursive = false);
+		void addDirs(const std::vector<std::pair<CString, CString>>& dirs, bool forceRecursive = false);
 		void removeDir(const CString& dir);
 		void addFile(CString file);
+		void addFiles(const std::vector<CString>& files);
 		void removeFile(const CString& file);
+
+		//! Applies file changes to every file system that shares the index.
+		void syncFiles(const std::vector<CFileChange>& changes);
+
+		//! Loads every file system that shares the index again, reading each directory once.
 		void resync();
 
 		CString find(const CString& file) const;
@@ -37,21 +56,21 @@ class CFileSystem
 		time_t getModTime(const CString& file) const;
 		bool setModTime(const CString& file, time_t modTime) const;
 		int getFileSize(const CString& file) const;
-		std::map<CString, CString>& getFileList()	{ return fileList; }
-		std::vector<CString>* getDirList()			{ return &dirList; }
 
-		mutable std::recursive_mutex* m_preventChange;
+		//! Gets the file list as it is right now.  The list never changes, so it can be
+		//! held and read from any thread while the file system keeps changing.
+		std::shared_ptr<const FileList> getFileList() const;
+		std::vector<CString> getDirList() const		{ return index->getDirList(category); }
+		size_t getFileCount() const;
 
 		static constexpr char getPathSeparator();
 		static void fixPathSeparators(CString& pPath);
 
 	private:
-		void loadAllDirectories(const CString& directory, bool recursive = false);
-
 		TServer* server;
 		CString basedir;
-		std::map<CString, CString> fileList;
-		std::vector<CString> dirList;
+		std::shared_ptr<CFileIndex> index;
+		unsigned int category;
 };
 
 inline void CFileSystem::fixPathSeparators(CString& pPath)
@@ -0,0 +1,72 @@
+#ifndef CFILECACHE_H
+#define CFILECACHE_H
+
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "CString.h"
+
+//! The contents of a file as they were when it was loaded.
+struct SCachedFile
+{
+	CString data;
+	time_t modTime;
+	uint32_t checksum;
+};
+
+//! Keeps the contents of the files sent to clients in memory, along with their crc32 checksums.
+//! Files are kept by path, and are loaded again when their modification time or size changes
+//! on disk.  Once the cache is full, the least recently used files are dropped.
+//! It can be used from any thread.  Files are read without holding the lock.
+class CFileCache
+{
+	public:
+		//! \param pMaxSize The amount of file data to keep, in bytes.
+		explicit CFileCache(size_t pMaxSize = 64 * 1024 * 1024);
+
+		CFileCache(const CFileCache&) = delete;
+		CFileCache& operator=(const CFileCache&) = delete;
+
+		//! Gets a file, loading it if it isn't cached or has changed.
+		//! \param pPath The full path of the file.
+		//! \return The file, or nullptr if it doesn't exist or is empty.
+		std::shared_ptr<const SCachedFile> get(const CString& pPath);
+
+		//! Drops a file so it is loaded again the next time it is needed.
+		void invalidate(const CString& pPath);
+
+		//! Drops every file.
+		void clear();
+
+		//! Sets the amount of file data to keep, dropping files if needed.
+		void setMaxSize(size_t pMaxSize);
+
+		size_t getMaxSize() const						{ std::lock_guard<std::mutex> guard(lock); return maxSize; }
+		size_t getSize() const							{ std::lock_guard<std::mutex> guard(lock); return size; }
+		size_t getFileCount() const						{ std::lock_guard<std::mutex> guard(lock); return entries.size(); }
+
+	private:
+		struct Entry
+		{
+			std::string path;
+			long long fileSize;
+			std::shared_ptr<const SCachedFile> file;
+		};
+
+		void drop(std::list<Entry>::iterator it);
+		void dropPath(const std::string& path);
+		void trim(size_t pMaxSize);
+
+		mutable std::mutex lock;
+
+		size_t maxSize;
+		size_t size;
+		std::list<Entry> recentlyUsed;
+		std::unordered_map<std::string, std::list<Entry>::iterator> entries;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef CFILESYSTEMWATCHER_H
+#define CFILESYSTEMWATCHER_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "CString.h"
+
+enum
+{
+	FILECHANGE_CREATED	= 0,	// The file was created, but may not be written yet.
+	FILECHANGE_WRITTEN	= 1,	// The file was written and closed, or moved into the directory.
+	FILECHANGE_REMOVED	= 2,	// The file was deleted, or moved out of the directory.
+};
+
+struct CFileChange
+{
+	int type;
+	CString directory;			// Full path, ending in a path separator.
+	CString file;
+};
+
+//! Watches directories for files being created, written and removed.
+//! Only the files directly in a watched directory are reported, not those in subdirectories.
+//! Uses inotify on Linux.  Everywhere else nothing can be watched and isAvailable() is false.
+class CFileSystemWatcher
+{
+	public:
+		CFileSystemWatcher();
+		~CFileSystemWatcher();
+
+		CFileSystemWatcher(const CFileSystemWatcher&) = delete;
+		CFileSystemWatcher& operator=(const CFileSystemWatcher&) = delete;
+
+		//! Checks if directories can be watched on this system.
+		bool isAvailable() const						{ return fd != -1; }
+
+		//! Starts watching a directory.
+		//! \param directory The full path of the directory, ending in a path separator.
+		//! \return False if the directory couldn't be watched.
+		bool watch(const CString& directory);
+
+		//! Stops watching a directory.
+		void unwatch(const CString& directory);
+
+		//! Stops watching every directory.
+		void clear();
+
+		//! Gets the directories being watched.
+		std::vector<CString> getDirectories() const;
+
+		//! Reads the pending changes without blocking.
+		//! \param changes Receives the changes in the order they happened.  A file that changed
+		//!                more than once since the last poll only gets its last change.
+		//! \return False if changes were missed, in which case everything has to be rescanned.
+		//!         This happens when the event queue overflows, and when a directory is created,
+		//!         removed or renamed in a watched directory, or a watched directory goes away.
+		bool poll(std::vector<CFileChange>& changes);
+
+	private:
+		void forget(int wd);
+
+		int fd;
+		std::unordered_map<int, std::vector<CString>> watchDirs;
+		std::unordered_map<std::string, int> dirWatches;
+};
+
+#endif
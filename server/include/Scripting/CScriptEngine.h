@@ -7,15 +7,20 @@
 #include <string>
 #include <atomic>
 #include <chrono>
+#include <filesystem>
 #include <mutex>
+#include <optional>
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #include "ScriptBindings.h"
 #include "ScriptAction.h"
+#include "ScriptCodeCache.h"
 #include "ScriptFactory.h"
+#include "ScriptScheduler.h"
 #include "SourceCode.h"
+#include "TimerWheel.h"
 
 #ifdef V8NPCSERVER
 #include "V8ScriptWrappers.h"
@@ -28,6 +33,12 @@ class TNPC;
 class TServer;
 class TWeapon;
 
+//! A timeout or scheduled event of an npc.  Timeouts don't have an action.
+struct NpcTimer
+{
+	TNPC *npc;
+	std::optional<ScriptAction> action;
+};
 
 class CScriptEngine
 {
@@ -50,14 +61,28 @@ public:
 	bool ExecuteNpc(TNPC *npc);
 	bool ExecuteWeapon(TWeapon *weapon);
 
-	void RegisterNpcTimer(TNPC *npc);
+	//! Schedules a timer for an npc.  TNPC::runScriptTimer() is called with the action once it runs out.
+	//! \param delay Time until the timer runs out.
+	//! \param action The scheduled event to run, or none for the npc's timeout.
+	//! \return A handle to cancel the timer with.
+	utilities::TimerHandle ScheduleNpcTimer(TNPC *npc, std::chrono::milliseconds delay, std::optional<ScriptAction> action = std::nullopt);
+	void CancelNpcTimer(utilities::TimerHandle& handle);
+	bool isNpcTimerScheduled(const utilities::TimerHandle& handle) const;
+
+	//! Gets the time left on an npc timer, or zero if it isn't scheduled.
+	std::chrono::milliseconds getNpcTimerRemaining(const utilities::TimerHandle& handle) const;
+	size_t getNpcTimerCount() const;
+
 	void RegisterNpcUpdate(TNPC *npc);
 	void RegisterWeaponUpdate(TWeapon *weapon);
 
-	void UnregisterNpcTimer(TNPC *npc);
 	void UnregisterNpcUpdate(TNPC *npc);
 	void UnregisterWeaponUpdate(TWeapon *weapon);
 
+	//! Sets how long npc scripts may run per server tick, and per npc within a tick.
+	void setScriptBudget(std::chrono::microseconds tickBudget, std::chrono::microseconds npcQuota);
+	const ScriptScheduler<TNPC *>& getNpcScheduler() const;
+
 	// callbacks
 	IScriptFunction * getCallBack(const std::string& callback) const;
 	void removeCallBack(const std::string& callback);
@@ -66,6 +91,15 @@ public:
 	// Compile script into a ScriptFunction
 	IScriptFunction * CompileCache(const std::string& code, bool referenceCount = true);
 
+	//! Keeps compiled scripts in a directory, so they load faster after a restart.
+	//! \param directory The directory to use, or an empty path to turn the code cache off.
+	bool setCodeCache(const std::filesystem::path& directory);
+	const ScriptCodeCache& getCodeCache() const;
+
+	//! Gets the time spent compiling scripts, and the number of scripts compiled.
+	std::chrono::nanoseconds getCompileTime() const;
+	uint32_t getCompileCount() const;
+
 	// Clear cache for code
 	bool ClearCache(const std::string& code);
 
@@ -89,6 +123,7 @@ public:
 
 private:
 	void runTimers(const std::chrono::high_resolution_clock::time_point& time);
+	utilities::TimerWheel<NpcTimer>::Tick getTimerTick(const std::chrono::high_resolution_clock::time_point& time) const;
 
 	IScriptEnv *_env;
 	IScriptFunction *_bootstrapFunction;
@@ -96,8 +131,9 @@ private:
 	std::unique_ptr<IScriptObject<TServer>> _serverObject;
 	TServer *_server;
 
-	std::chrono::high_resolution_clock::time_point lastScriptTimer;
-	std::chrono::nanoseconds accumulator;
+	// Npc timers, in milliseconds since the engine was created.
+	std::chrono::high_resolution_clock::time_point _timerStartTime;
+	utilities::TimerWheel<NpcTimer> _npcTimers;
 
 	// Script watcher
 	std::atomic<bool> _scriptIsRunning;
@@ -107,9 +143,11 @@ private:
 	std::thread _scriptWatcherThread;
 
 	std::unordered_map<std::string, IScriptFunction *> _cachedScripts;
+	ScriptCodeCache _codeCache;
+	std::chrono::nanoseconds _compileTime;
+	uint32_t _compileCount;
 	std::unordered_map<std::string, IScriptFunction *> _callbacks;
-	std::unordered_set<TNPC *> _updateNpcs;
-	std::unordered_set<TNPC *> _updateNpcsTimer;
+	ScriptScheduler<TNPC *> _updateNpcs;
 	std::unordered_set<TWeapon *> _updateWeapons;
 	std::unordered_set<IScriptFunction *> _deletedCallbacks;
 };
@@ -157,14 +195,52 @@ inline const ScriptRunError& CScriptEngine::getScriptError() const {
 	return _env->getScriptError();
 }
 
-// Register scripts for processing
+inline const ScriptCodeCache& CScriptEngine::getCodeCache() const {
+	return _codeCache;
+}
+
+inline std::chrono::nanoseconds CScriptEngine::getCompileTime() const {
+	return _compileTime;
+}
 
-inline void CScriptEngine::RegisterNpcTimer(TNPC *npc) {
-	_updateNpcsTimer.insert(npc);
+inline uint32_t CScriptEngine::getCompileCount() const {
+	return _compileCount;
 }
 
+// Npc timers
+
+inline utilities::TimerWheel<NpcTimer>::Tick CScriptEngine::getTimerTick(const std::chrono::high_resolution_clock::time_point& time) const {
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(time - _timerStartTime).count();
+	return (elapsed > 0 ? (utilities::TimerWheel<NpcTimer>::Tick)elapsed : 0);
+}
+
+inline utilities::TimerHandle CScriptEngine::ScheduleNpcTimer(TNPC *npc, std::chrono::milliseconds delay, std::optional<ScriptAction> action) {
+	auto now = getTimerTick(std::chrono::high_resolution_clock::now());
+	return _npcTimers.schedule(now + (delay.count() > 0 ? delay.count() : 0), NpcTimer{ npc, std::move(action) });
+}
+
+inline void CScriptEngine::CancelNpcTimer(utilities::TimerHandle& handle) {
+	_npcTimers.cancel(handle);
+}
+
+inline bool CScriptEngine::isNpcTimerScheduled(const utilities::TimerHandle& handle) const {
+	return _npcTimers.isScheduled(handle);
+}
+
+inline std::chrono::milliseconds CScriptEngine::getNpcTimerRemaining(const utilities::TimerHandle& handle) const {
+	auto deadline = _npcTimers.getDeadline(handle);
+	auto now = getTimerTick(std::chrono::high_resolution_clock::now());
+	return std::chrono::milliseconds(deadline && *deadline > now ? *deadline - now : 0);
+}
+
+inline size_t CScriptEngine::getNpcTimerCount() const {
+	return _npcTimers.size();
+}
+
+// Register scripts for processing
+
 inline void CScriptEngine::RegisterNpcUpdate(TNPC *npc) {
-	_updateNpcs.insert(npc);
+	_updateNpcs.add(npc);
 }
 
 inline void CScriptEngine::RegisterWeaponUpdate(TWeapon *weapon) {
@@ -178,11 +254,17 @@ inline void CScriptEngine::UnregisterWeaponUpdate(TWeapon *weapon) {
 }
 
 inline void CScriptEngine::UnregisterNpcUpdate(TNPC *npc) {
-	_updateNpcs.erase(npc);
+	_updateNpcs.remove(npc);
+}
+
+// Script budget
+
+inline void CScriptEngine::setScriptBudget(std::chrono::microseconds tickBudget, std::chrono::microseconds npcQuota) {
+	_updateNpcs.setBudget(tickBudget, npcQuota);
 }
 
-inline void CScriptEngine::UnregisterNpcTimer(TNPC *npc) {
-	_updateNpcsTimer.erase(npc);
+inline const ScriptScheduler<TNPC *>& CScriptEngine::getNpcScheduler() const {
+	return _updateNpcs;
 }
 
 //
@@ -3,22 +3,34 @@
 
 #pragma once
 
-#include <mutex>
-#include <queue>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 
 #include "utils/ContextThreadPool.h"
 #include "CompilerThreadJob.h"
 #include "GS2Context.h"
+#include "ScriptCodeCache.h"
+#include "ScriptCompileQueue.h"
 #include "interface/ScriptUtils.h"
 
 class GS2ScriptManager
 {
-	using BytecodeCache = std::unordered_map<std::string, CompilerResponse>;
+	// Keyed by a hash of the source, so the cache doesn't hold on to a copy of every script.
+	// The length of the source is kept alongside to catch the odd hash collision.
+	struct CachedBytecode
+	{
+		size_t sourceLength;
+		CompilerResponse response;
+	};
+
+	using BytecodeCache = std::unordered_map<uint64_t, CachedBytecode>;
 	
 	// used for threadpool job queue
 	using CompilerThreadPool = CustomThreadPool<CallbackThreadJob>;
-	using internal_callback_type = std::function<void(CompilerResponse&)>;
-	using queue_item_type = std::pair<internal_callback_type, CompilerResponse>;
+	using CompileQueue = ScriptCompileQueue<CompilerResponse>;
 
 public:
 	using user_callback_type = std::function<void(const CompilerResponse&)>;
@@ -26,12 +38,42 @@ public:
 	GS2ScriptManager();
 	~GS2ScriptManager() {}
 
+	//! Compiles a script right away, or gets it from the cache.  The callback is called before this returns.
 	void compileScript(const std::string& script, user_callback_type finishedCb);
-	void runQueue();
+
+	//! Compiles a script on the compiler threads, unless it is in the cache.
+	//! The callback is called from runQueue once the script is compiled, and only for the last script
+	//! compiled for the owner.
+	//! \return The compiled script if it was in the cache, in which case the callback is never called.
+	const CompilerResponse *compileScriptAsync(const std::string& script, const void *owner, user_callback_type finishedCb);
+
+	//! Stops waiting on a script compiled for an owner, such as when the owner is deleted.
+	bool cancelCompile(const void *owner)				{ return _compileQueue.cancel(owner); }
+	bool isCompiling(const void *owner) const			{ return _compileQueue.isWaiting(owner); }
+	size_t getCompileCount() const						{ return _compileQueue.getCompileCount(); }
+
+	//! Calls the callbacks of scripts that finished compiling on the compiler threads.
+	//! \return The number of scripts that finished.
+	size_t runQueue();
+
+	//! Keeps compiled bytecode on disk, so scripts aren't compiled again after a restart.
+	//! \param directory The directory to keep the bytecode in, or an empty path to only keep it in memory.
+	bool setBytecodeCache(const std::filesystem::path& directory);
+	const ScriptCodeCache& getBytecodeCache() const		{ return _diskCache; }
+
+	//! Gets a compiled script from memory or from the bytecode cache on disk, without compiling it.
+	const CompilerResponse *findBytecode(const std::string& script);
+
+	//! Converts compiled bytecode to and from the way it is kept on disk.
+	static std::string encodeBytecode(const CompilerResponse& response);
+	static bool decodeBytecode(std::string_view data, CompilerResponse& response);
 
 private:
+	// Bytecode cache
+	const CompilerResponse& cacheBytecode(const std::string& script, CompilerResponse&& response);
+
 	// Async Compile
-	void queueCompileJob(const std::string &script, user_callback_type& finishedCb);
+	void queueCompileJob(const std::string &script);
 
 	// Sync Compile
 	GS2Context _context;
@@ -39,10 +81,11 @@ private:
 	
 	//
 	BytecodeCache _bytecodeCache;
-	CompilerThreadPool _compilerThreadPool;
+	ScriptCodeCache _diskCache;
 
-	std::queue<queue_item_type> _cbQueue;
-	std::mutex _cbQueueLock;
+	// The thread pool is declared last, so its workers are stopped before the queue they complete into goes away
+	CompileQueue _compileQueue;
+	CompilerThreadPool _compilerThreadPool;
 };
 
 #endif
@@ -0,0 +1,70 @@
+#pragma once
+
+#ifndef SCRIPTCODECACHE_H
+#define SCRIPTCODECACHE_H
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+//! Keeps compiled scripts on disk, so they don't need to be compiled from source again after a restart.
+//! Entries are keyed by a hash of the source, and are only handed out to the same compiler version that
+//! stored them.  Entries that don't match, or are damaged, are rejected and replaced on the next store.
+//! Entries that haven't been used for a while are removed when the cache is opened, so scripts that
+//! changed or went away don't pile up.
+class ScriptCodeCache
+{
+public:
+	struct Stats
+	{
+		uint32_t hits = 0;
+		uint32_t misses = 0;
+		uint32_t rejected = 0;
+		uint32_t stored = 0;
+		uint32_t pruned = 0;
+	};
+
+	//! How long an entry is kept without being loaded or stored.
+	static constexpr std::chrono::hours DefaultMaxAge{ 24 * 30 };
+
+	ScriptCodeCache() = default;
+
+	//! Starts using a directory for the cache, creating it if needed.
+	//! \param directory The directory to keep the cache in, or an empty path to turn the cache off.
+	//! \param version The compiler version.  Entries stored by any other version are rejected.
+	//! \param maxAge Entries not used for this long are removed.
+	//! \return True if the cache can be used.
+	bool open(const std::filesystem::path& directory, const std::string& version, std::chrono::hours maxAge = DefaultMaxAge);
+	void close();
+	bool isOpen() const					{ return !_directory.empty(); }
+
+	//! Gets the compiled code of a source, if it was stored by this compiler version.
+	std::optional<std::string> load(std::string_view source);
+
+	//! Stores the compiled code of a source, replacing any code stored before.
+	bool store(std::string_view source, std::string_view code);
+
+	//! Removes the code of a source that the compiler couldn't use after all.
+	void reject(std::string_view source);
+
+	//! Removes the entries that were last used before a point in time, and any unfinished entries.
+	//! \return The number of files removed.
+	size_t prune(std::filesystem::file_time_type usedBefore);
+
+	const Stats& getStats() const		{ return _stats; }
+
+	//! Hashes text the same way on every platform and run, so it can be used in file names.
+	static uint64_t hash(std::string_view data);
+
+private:
+	std::filesystem::path getPath(uint64_t sourceHash) const;
+
+	std::filesystem::path _directory;
+	std::string _version;
+	Stats _stats;
+};
+
+#endif
@@ -0,0 +1,142 @@
+#pragma once
+
+#ifndef SCRIPTCOMPILEQUEUE_H
+#define SCRIPTCOMPILEQUEUE_H
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//! Keeps track of scripts that are compiled in the background, and of whoever waits on them.
+//! Owners waiting on the same source share a single compile, and an owner only ever waits on the
+//! last source it asked for, so an older compile that finishes late can't overwrite a newer one.
+//! Compiles finish on any thread, but their callbacks only run from dispatch, in the order they finished.
+template<typename Response>
+class ScriptCompileQueue
+{
+public:
+	using callback_type = std::function<void(const Response&)>;
+
+	//! Waits on a compile of a source, replacing anything the owner waited on before.
+	//! \param owner The object the compile is for, or nullptr if it can't be cancelled.
+	//! \return True if the source isn't being compiled yet, and the caller should start a compile.
+	bool wait(const std::string& source, const void *owner, callback_type callback);
+
+	//! Stops an owner from waiting on its compile, so its callback is never called.
+	//! The compile itself keeps running, and is still handed to dispatch.
+	bool cancel(const void *owner);
+
+	//! Hands over a finished compile.  May be called from any thread.
+	void complete(std::string source, Response&& response);
+
+	//! Runs the callbacks of every compile that finished since the last call.
+	//! \param store Called with each finished compile before its callbacks, and returns the response to pass them.
+	//! \return The number of compiles that finished.
+	template<typename Store>
+	size_t dispatch(Store&& store);
+
+	bool isWaiting(const void *owner) const	{ return _owners.contains(owner); }
+	size_t getCompileCount() const			{ return _compiles.size(); }
+
+private:
+	struct Waiter
+	{
+		const void *owner;
+		callback_type callback;
+	};
+
+	// Only used from the thread that calls wait and dispatch.
+	std::unordered_map<std::string, std::vector<Waiter>> _compiles;
+	std::unordered_map<const void *, const std::string *> _owners;
+
+	std::mutex _finishedLock;
+	std::vector<std::pair<std::string, Response>> _finished;
+};
+
+template<typename Response>
+bool ScriptCompileQueue<Response>::wait(const std::string& source, const void *owner, callback_type callback)
+{
+	if (owner)
+		cancel(owner);
+
+	auto [compile, inserted] = _compiles.try_emplace(source);
+	compile->second.push_back({ owner, std::move(callback) });
+	if (owner)
+		_owners[owner] = &compile->first;
+
+	return inserted;
+}
+
+template<typename Response>
+bool ScriptCompileQueue<Response>::cancel(const void *owner)
+{
+	auto ownerIter = _owners.find(owner);
+	if (ownerIter == _owners.end())
+		return false;
+
+	auto compile = _compiles.find(*ownerIter->second);
+	if (compile != _compiles.end())
+		std::erase_if(compile->second, [owner](const Waiter& waiter) { return waiter.owner == owner; });
+
+	_owners.erase(ownerIter);
+	return true;
+}
+
+template<typename Response>
+void ScriptCompileQueue<Response>::complete(std::string source, Response&& response)
+{
+	std::scoped_lock lock(_finishedLock);
+	_finished.emplace_back(std::move(source), std::move(response));
+}
+
+template<typename Response>
+template<typename Store>
+size_t ScriptCompileQueue<Response>::dispatch(Store&& store)
+{
+	std::vector<std::pair<std::string, Response>> finished;
+	{
+		std::scoped_lock lock(_finishedLock);
+		finished.swap(_finished);
+	}
+
+	for (auto & [source, response] : finished)
+	{
+		// Take the waiters out first, so callbacks are free to wait on new compiles or cancel others.
+		std::vector<Waiter> waiters;
+		auto compile = _compiles.find(source);
+		if (compile != _compiles.end())
+		{
+			waiters = std::move(compile->second);
+			_compiles.erase(compile);
+		}
+
+		for (auto & waiter : waiters)
+		{
+			if (waiter.owner)
+				_owners[waiter.owner] = &source;
+		}
+
+		const Response& result = store(source, std::move(response));
+		for (auto & waiter : waiters)
+		{
+			// Skip owners that an earlier callback cancelled, or gave something else to wait on.
+			if (waiter.owner)
+			{
+				auto ownerIter = _owners.find(waiter.owner);
+				if (ownerIter == _owners.end() || ownerIter->second != &source)
+					continue;
+				_owners.erase(ownerIter);
+			}
+
+			waiter.callback(result);
+		}
+	}
+
+	return finished.size();
+}
+
+#endif
@@ -5,8 +5,10 @@
 
 #include <algorithm>
 #include <chrono>
+#include <iterator>
 #include <vector>
 #include "ScriptAction.h"
+#include "ScriptProfile.h"
 #include "ScriptUtils.h"
 #include "CScriptEngine.h"
 
@@ -19,18 +21,21 @@ public:
 	~ScriptExecutionContext() { resetExecution(); }
 
 	bool hasActions() const;
-	std::pair<unsigned int, double> getExecutionData();
+	const ScriptProfile& getProfile() const;
 
 	void addAction(ScriptAction& action);
 	void addAction(ScriptAction&& action);
 	void addExecutionSample(const ScriptTimeSample& sample);
 	void resetExecution();
-	bool runExecution();
+
+	//! Runs the queued actions.  Once the deadline passes, the actions that are left wait for the next run.
+	//! \return True if there are actions left to run.
+	bool runExecution(std::chrono::high_resolution_clock::time_point deadline = std::chrono::high_resolution_clock::time_point::max());
 
 private:
 	CScriptEngine *_scriptEngine;
 	std::vector<ScriptAction> _actions;
-	std::vector<ScriptTimeSample> _scriptTimeSamples;
+	ScriptProfile _profile;
 };
 
 inline bool ScriptExecutionContext::hasActions() const
@@ -41,49 +46,13 @@ inline bool ScriptExecutionContext::hasActions() const
 inline void ScriptExecutionContext::addExecutionSample(const ScriptTimeSample& sample)
 {
 #ifndef NOSCRIPTPROFILING
-	_scriptTimeSamples.push_back(sample);
-
-	// Remove any script samples over a minute old
-	//if (_scriptTimeSamples.size() > 1024)
-	{
-		auto curSampleTime = sample.sample_time;
-		while (!_scriptTimeSamples.empty())
-		{
-			auto oldSample = _scriptTimeSamples.begin();
-			auto sample_diff = std::chrono::duration_cast<std::chrono::minutes>(curSampleTime - oldSample->sample_time);
-			if (sample_diff.count() < 1)
-				break;
-
-			_scriptTimeSamples.erase(oldSample);
-		}
-	}
+	_profile.addSample(sample.sample, sample.sample_time);
 #endif
 }
 
-inline std::pair<unsigned int, double> ScriptExecutionContext::getExecutionData()
+inline const ScriptProfile& ScriptExecutionContext::getProfile() const
 {
-	double exectime = 0.0;
-	unsigned int calls = 0;
-
-#ifndef NOSCRIPTPROFILING
-	auto time_now = std::chrono::high_resolution_clock::now();
-
-	for (auto it = _scriptTimeSamples.begin(); it != _scriptTimeSamples.end();)
-	{
-		auto sample_diff = std::chrono::duration_cast<std::chrono::minutes>(time_now - (*it).sample_time);
-		if (sample_diff.count() >= 1)
-		{
-			it = _scriptTimeSamples.erase(it);
-			continue;
-		}
-
-		exectime += (*it).sample;
-		calls++;
-		++it;
-	}
-#endif
-
-	return { calls, exectime };
+	return _profile;
 }
 
 inline void ScriptExecutionContext::addAction(ScriptAction& action)
@@ -105,11 +74,11 @@ inline void ScriptExecutionContext::resetExecution()
 	_actions.clear();
 
 #ifndef NOSCRIPTPROFILING
-	//_scriptTimeSamples.clear();
+	//_profile.clear();
 #endif
 }
 
-inline bool ScriptExecutionContext::runExecution()
+inline bool ScriptExecutionContext::runExecution(std::chrono::high_resolution_clock::time_point deadline)
 {
 	// Take ownership of the queued actions, and clear them incase any scripts add actions.
 	std::vector<ScriptAction> iterateActions = std::move(_actions);
@@ -121,15 +90,24 @@ inline bool ScriptExecutionContext::runExecution()
 
 	// iterate over queued actions
 	SCRIPTENV_D("Running %zd actions:\n", iterateActions.size());
-	for (auto & action : iterateActions)
+	auto actionIt = iterateActions.begin();
+	while (actionIt != iterateActions.end())
 	{
+		auto& action = *actionIt++;
 		SCRIPTENV_D("Running action: %s\n", action.getAction().c_str());
 		auto res = action.Invoke();
 		if (!res) {
 			_scriptEngine->reportScriptException(_scriptEngine->getScriptError());
 		}
+
+		if (std::chrono::high_resolution_clock::now() >= deadline)
+			break;
 	}
 
+	// Actions that didn't get to run go ahead of any the scripts queued meanwhile.
+	if (actionIt != iterateActions.end())
+		_actions.insert(_actions.begin(), std::make_move_iterator(actionIt), std::make_move_iterator(iterateActions.end()));
+
 	if (!_scriptEngine->StopScriptExecution())
 	{
 		// TODO(joey): Report to server? What should we do, hm.
@@ -0,0 +1,144 @@
+#pragma once
+
+#ifndef SCRIPTPROFILE_H
+#define SCRIPTPROFILE_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+
+//! The execution times of a script over the last minute, added up per second.
+//! Each second keeps the number of calls, their total and longest time, and a histogram of call times,
+//! so a script costs the same amount of memory however often it runs.
+class ScriptProfile
+{
+public:
+	using Clock = std::chrono::high_resolution_clock;
+
+	static constexpr size_t Seconds = 60;
+	static constexpr size_t HistogramBuckets = 8;
+
+	//! The execution times of a script, added up over the last minute.
+	struct Summary
+	{
+		uint32_t calls = 0;
+		double total = 0.0;
+		double max = 0.0;
+		std::array<uint32_t, HistogramBuckets> histogram{};
+
+		//! Gets the time a share of the calls stayed under, rounded up to the limit of a histogram bucket.
+		//! \param percentile The share of calls, such as 0.99 for all but the slowest in a hundred.
+		double getPercentile(double percentile) const;
+	};
+
+	//! Gets the time, in seconds, that the calls of a histogram bucket stayed under.
+	//! The buckets go up by a factor of four from 16 microseconds, and the last one has no limit.
+	static double getBucketLimit(size_t bucket);
+
+	void addSample(double time, Clock::time_point sampleTime);
+	Summary getSummary(Clock::time_point now = Clock::now()) const;
+	void clear()	{ _seconds.reset(); }
+
+private:
+	struct Second
+	{
+		uint32_t second;
+		uint32_t calls;
+		float total;
+		float max;
+		std::array<uint16_t, HistogramBuckets> histogram;
+	};
+
+	static uint32_t toSecond(Clock::time_point time);
+	static size_t getBucket(double time);
+
+	// Only allocated once the script runs, so scripts that never do cost a pointer.
+	std::unique_ptr<std::array<Second, Seconds>> _seconds;
+};
+
+inline double ScriptProfile::Summary::getPercentile(double percentile) const
+{
+	if (calls == 0)
+		return 0.0;
+
+	// The histogram stops counting at a very high number of calls per second, so it may add up to less than the calls.
+	uint64_t histogramCalls = 0;
+	for (auto count : histogram)
+		histogramCalls += count;
+
+	auto limit = (uint64_t)(std::clamp(percentile, 0.0, 1.0) * histogramCalls);
+	uint64_t count = 0;
+	for (size_t i = 0; i < HistogramBuckets - 1; ++i)
+	{
+		count += histogram[i];
+		if (count >= limit)
+			return getBucketLimit(i);
+	}
+
+	return max;
+}
+
+inline double ScriptProfile::getBucketLimit(size_t bucket)
+{
+	return (bucket < HistogramBuckets - 1 ? (16u << (2 * bucket)) / 1000000.0 : HUGE_VAL);
+}
+
+inline uint32_t ScriptProfile::toSecond(Clock::time_point time)
+{
+	return (uint32_t)std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count();
+}
+
+inline size_t ScriptProfile::getBucket(double time)
+{
+	size_t bucket = 0;
+	while (bucket < HistogramBuckets - 1 && time >= getBucketLimit(bucket))
+		++bucket;
+	return bucket;
+}
+
+inline void ScriptProfile::addSample(double time, Clock::time_point sampleTime)
+{
+	if (!_seconds)
+		_seconds = std::make_unique<std::array<Second, Seconds>>();
+
+	// Reuse the slot of a second that is more than a minute old.
+	uint32_t second = toSecond(sampleTime);
+	Second& slot = (*_seconds)[second % Seconds];
+	if (slot.second != second || slot.calls == 0)
+		slot = Second{ second, 0, 0.0f, 0.0f, {} };
+
+	++slot.calls;
+	slot.total += (float)time;
+	slot.max = std::max(slot.max, (float)time);
+
+	auto& bucket = slot.histogram[getBucket(time)];
+	if (bucket < UINT16_MAX)
+		++bucket;
+}
+
+inline ScriptProfile::Summary ScriptProfile::getSummary(Clock::time_point now) const
+{
+	Summary summary;
+	if (!_seconds)
+		return summary;
+
+	uint32_t currentSecond = toSecond(now);
+	for (auto & slot : *_seconds)
+	{
+		if (slot.calls == 0 || currentSecond - slot.second >= Seconds)
+			continue;
+
+		summary.calls += slot.calls;
+		summary.total += slot.total;
+		summary.max = std::max(summary.max, (double)slot.max);
+		for (size_t i = 0; i < HistogramBuckets; ++i)
+			summary.histogram[i] += slot.histogram[i];
+	}
+
+	return summary;
+}
+
+#endif
@@ -0,0 +1,261 @@
+#pragma once
+
+#ifndef SCRIPTSCHEDULER_H
+#define SCRIPTSCHEDULER_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <initializer_list>
+#include <unordered_map>
+#include <vector>
+
+//! Runs the queued script actions of npcs (or anything else) round robin, within a time budget per tick.
+//! Each turn is limited to a quota, and whatever doesn't fit in a turn or in the tick is carried over
+//! to the next tick.  Objects that keep using up their whole quota are moved to a second queue, which
+//! only gets the time left once everyone else had their turn.
+template<typename T>
+class ScriptScheduler
+{
+public:
+	using Clock = std::chrono::high_resolution_clock;
+
+	//! Turns in a row an object has to use up its quota before it is deprioritized.
+	static constexpr uint8_t DemoteStrikes = 3;
+
+	//! Counters since the scheduler was created.
+	struct Stats
+	{
+		uint64_t ticks = 0;			//!< Ticks that had anything to run.
+		uint64_t turns = 0;			//!< Turns given to objects.
+		uint64_t carriedOver = 0;	//!< Turns that ended with actions left to run.
+		uint64_t deferred = 0;		//!< Turns put off to the next tick because the tick budget ran out.
+		uint64_t overruns = 0;		//!< Turns that used up their whole quota.
+		uint64_t demotions = 0;		//!< Times an object was deprioritized.
+	};
+
+	ScriptScheduler(std::chrono::microseconds tickBudget = std::chrono::milliseconds(10), std::chrono::microseconds quota = std::chrono::milliseconds(2))
+		: _tickBudget(tickBudget), _quota(quota), _tickTimes{}, _tickTimeCount(0) { }
+
+	//! Sets the time scripts may run per tick, and per turn of a single object.
+	void setBudget(std::chrono::microseconds tickBudget, std::chrono::microseconds quota);
+
+	//! Queues an object for a turn, if it isn't queued already.
+	void add(T obj);
+
+	//! Forgets an object, so it is neither run nor remembered as deprioritized.
+	void remove(T obj);
+
+	void clear();
+	bool contains(T obj) const;
+	bool isDemoted(T obj) const;
+	bool empty() const				{ return _queue.empty() && _demotedQueue.empty(); }
+	size_t size() const				{ return _queue.size() + _demotedQueue.size(); }
+
+	//! Gives every queued object at most one turn, until the tick budget runs out.
+	//! \param fn Called as fn(obj, deadline).  It runs the actions of the object until the deadline, and returns true if some are left.
+	template<typename Fn>
+	void run(Fn&& fn);
+
+	const Stats& getStats() const	{ return _stats; }
+
+	//! Gets the time spent in one of the recent ticks that had anything to run.
+	//! \param percentile Which tick to pick, such as 0.5 for the median, or 0.99 for the slowest in a hundred.
+	std::chrono::microseconds getTickTime(double percentile) const;
+
+private:
+	static constexpr uint8_t MaxStrikes = DemoteStrikes * 2;
+
+	struct Entry
+	{
+		uint8_t strikes = 0;
+		bool queued = false;
+	};
+
+	template<typename Fn>
+	void runTurn(T obj, Clock::time_point tickDeadline, Fn& fn);
+	void enqueue(T obj, Entry& entry);
+	void recordTickTime(Clock::duration time);
+
+	std::chrono::microseconds _tickBudget;
+	std::chrono::microseconds _quota;
+	std::deque<T> _queue;
+	std::deque<T> _demotedQueue;
+	std::unordered_map<T, Entry> _entries;
+	Stats _stats;
+
+	std::array<uint32_t, 256> _tickTimes;
+	size_t _tickTimeCount;
+};
+
+template<typename T>
+inline void ScriptScheduler<T>::setBudget(std::chrono::microseconds tickBudget, std::chrono::microseconds quota)
+{
+	_tickBudget = tickBudget;
+	_quota = quota;
+}
+
+template<typename T>
+inline void ScriptScheduler<T>::add(T obj)
+{
+	Entry& entry = _entries[obj];
+	if (!entry.queued)
+		enqueue(obj, entry);
+}
+
+template<typename T>
+inline void ScriptScheduler<T>::remove(T obj)
+{
+	auto it = _entries.find(obj);
+	if (it == _entries.end())
+		return;
+
+	// Objects that queue themselves again during their turn can be demoted after they were queued.
+	if (it->second.queued)
+	{
+		for (auto queue : { &_queue, &_demotedQueue })
+		{
+			auto queueIt = std::find(queue->begin(), queue->end(), obj);
+			if (queueIt != queue->end())
+				queue->erase(queueIt);
+		}
+	}
+
+	_entries.erase(it);
+}
+
+template<typename T>
+inline void ScriptScheduler<T>::clear()
+{
+	_queue.clear();
+	_demotedQueue.clear();
+	_entries.clear();
+}
+
+template<typename T>
+inline bool ScriptScheduler<T>::contains(T obj) const
+{
+	auto it = _entries.find(obj);
+	return it != _entries.end() && it->second.queued;
+}
+
+template<typename T>
+inline bool ScriptScheduler<T>::isDemoted(T obj) const
+{
+	auto it = _entries.find(obj);
+	return it != _entries.end() && it->second.strikes >= DemoteStrikes;
+}
+
+template<typename T>
+template<typename Fn>
+inline void ScriptScheduler<T>::run(Fn&& fn)
+{
+	if (empty())
+		return;
+
+	auto startTime = Clock::now();
+	auto tickDeadline = startTime + _tickBudget;
+
+	// Objects queued during this tick wait for the next one, so nobody gets two turns while others wait.
+	size_t turns = _queue.size();
+	size_t demotedTurns = _demotedQueue.size();
+	size_t turnsRun = 0;
+
+	// The first turn always runs, so a tick never passes without progress.
+	while (turns > 0 && !_queue.empty() && (turnsRun == 0 || Clock::now() < tickDeadline))
+	{
+		T obj = _queue.front();
+		_queue.pop_front();
+		--turns;
+		runTurn(obj, tickDeadline, fn);
+		++turnsRun;
+	}
+
+	// Deprioritized objects get the time that is left, and at least one of them runs every tick so they aren't starved.
+	size_t demotedRun = 0;
+	while (demotedTurns > 0 && !_demotedQueue.empty() && (demotedRun == 0 || Clock::now() < tickDeadline))
+	{
+		T obj = _demotedQueue.front();
+		_demotedQueue.pop_front();
+		--demotedTurns;
+		runTurn(obj, tickDeadline, fn);
+		++demotedRun;
+	}
+
+	_stats.deferred += std::min(turns, _queue.size()) + std::min(demotedTurns, _demotedQueue.size());
+	++_stats.ticks;
+	recordTickTime(Clock::now() - startTime);
+}
+
+template<typename T>
+template<typename Fn>
+inline void ScriptScheduler<T>::runTurn(T obj, Clock::time_point tickDeadline, Fn& fn)
+{
+	auto it = _entries.find(obj);
+	if (it == _entries.end())
+		return;
+	it->second.queued = false;
+
+	auto turnStart = Clock::now();
+	bool pending = fn(obj, std::min(turnStart + _quota, tickDeadline));
+	auto turnTime = Clock::now() - turnStart;
+	++_stats.turns;
+
+	// The object may have been removed, or queued itself again, while it ran.
+	it = _entries.find(obj);
+	if (it == _entries.end())
+		return;
+
+	Entry& entry = it->second;
+	if (turnTime >= _quota)
+	{
+		++_stats.overruns;
+		if (entry.strikes < MaxStrikes && ++entry.strikes == DemoteStrikes)
+			++_stats.demotions;
+	}
+	else if (entry.strikes > 0)
+		--entry.strikes;
+
+	if (pending)
+	{
+		++_stats.carriedOver;
+		if (!entry.queued)
+			enqueue(obj, entry);
+	}
+	else if (!entry.queued && entry.strikes == 0)
+		_entries.erase(it);
+}
+
+template<typename T>
+inline void ScriptScheduler<T>::enqueue(T obj, Entry& entry)
+{
+	entry.queued = true;
+	if (entry.strikes >= DemoteStrikes)
+		_demotedQueue.push_back(obj);
+	else
+		_queue.push_back(obj);
+}
+
+template<typename T>
+inline void ScriptScheduler<T>::recordTickTime(Clock::duration time)
+{
+	auto micros = std::chrono::duration_cast<std::chrono::microseconds>(time).count();
+	_tickTimes[_tickTimeCount++ % _tickTimes.size()] = (uint32_t)std::min<decltype(micros)>(micros, UINT32_MAX);
+}
+
+template<typename T>
+inline std::chrono::microseconds ScriptScheduler<T>::getTickTime(double percentile) const
+{
+	size_t count = std::min(_tickTimeCount, _tickTimes.size());
+	if (count == 0)
+		return std::chrono::microseconds(0);
+
+	std::vector<uint32_t> times(_tickTimes.begin(), _tickTimes.begin() + count);
+	auto nth = times.begin() + std::min((size_t)(std::clamp(percentile, 0.0, 1.0) * count), count - 1);
+	std::nth_element(times.begin(), nth, times.end());
+	return std::chrono::microseconds(*nth);
+}
+
+#endif
@@ -4,9 +4,11 @@
 #define SCRIPTENV_H
 
 #include <functional>
+#include <string>
 #include "ScriptUtils.h"
 
 class IScriptFunction;
+class ScriptCodeCache;
 
 class IScriptEnv
 {
@@ -15,10 +17,12 @@ class IScriptEnv
 		virtual ~IScriptEnv() {}
 		
 		virtual int GetType() const = 0;
+		virtual std::string GetVersion() const = 0;
 	
 		virtual void Initialize() = 0;
 		virtual void Cleanup(bool shutDown = false) = 0;
-		virtual IScriptFunction * Compile(const std::string& name, const std::string& source) = 0;
+		//! Compiles a script, using the compiled code in the cache if there is any, and adding it otherwise.
+		virtual IScriptFunction * Compile(const std::string& name, const std::string& source, ScriptCodeCache *codeCache = nullptr) = 0;
 		virtual void CallFunctionInScope(std::function<void()> function) = 0;
 		virtual void TerminateExecution() = 0;
 
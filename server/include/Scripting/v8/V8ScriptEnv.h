@@ -19,11 +19,12 @@ public:
 	virtual ~V8ScriptEnv();
 	
 	int GetType() const override { return 1; }
+	std::string GetVersion() const override { return v8::V8::GetVersion(); }
 	
 	void Initialize() override;
 	void Cleanup(bool shutDown = false) override;
 	
-	IScriptFunction * Compile(const std::string& name, const std::string& source) override;
+	IScriptFunction * Compile(const std::string& name, const std::string& source, ScriptCodeCache *codeCache = nullptr) override;
 	void CallFunctionInScope(std::function<void()> function) override;
 	void TerminateExecution() override;
 
@@ -6,6 +6,8 @@
 #include <vector>
 #include <unordered_map>
 #include "CString.h"
+#include "TAccountItems.h"
+#include "TFlagList.h"
 #include "TLevelChest.h"
 
 enum
@@ -137,11 +139,20 @@ class TAccount
 		// Load/Save Account
 		void reset();
 		bool loadAccount(const CString& pAccount, bool ignoreNickname = false);
+
+		//! Reads an account into this one without touching the rest of the server, so it can be
+		//! done away from the game thread.  finishLoading() has to be called on the game thread after.
+		//! \param loadedFromDefault Set when the account doesn't exist and defaultaccount was read instead.
+		bool readAccount(const CString& pAccount, bool ignoreNickname, bool& loadedFromDefault);
+
+		//! Sets up guests and new accounts, and applies the server's limits to an account that was read.
+		void finishLoading(const CString& pAccount, bool loadedFromDefault);
 		bool saveAccount();
 
 		// Attribute-Managing
-		bool hasChest(const CString& pChest);
-		bool hasWeapon(const CString& pWeapon);
+		bool hasChest(const CString& pChest) const;
+		bool hasChest(TChestList::Key pChest) const;
+		bool hasWeapon(const CString& pWeapon) const;
 
 		// Flag-Managing
 		CString getFlag(const std::string& pFlagName) const;
@@ -194,9 +205,9 @@ class TAccount
 		const CString& getEmail() const			{ return email; }
 		const CString& getIpStr() const			{ return accountIpStr; }
 		const CString& getComments() const		{ return accountComments; }
-		std::unordered_map<std::string, CString> * getFlagList()	{ return &flagList; }
+		TFlagList * getFlagList()									{ return &flagList; }
 		std::vector<CString> * getFolderList()						{ return &folderList; }
-		std::vector<CString> * getWeaponList()						{ return &weaponList; }
+		TWeaponList * getWeaponList()								{ return &weaponList; }
 
 		// set functions
 		void setDeviceId(int64_t newDeviceId)		{ deviceId = newDeviceId;}
@@ -248,16 +259,15 @@ class TAccount
 		unsigned int attachNPC;
 		time_t lastSparTime;
 		unsigned char statusMsg;
-		std::unordered_map<std::string, CString> flagList;
-		std::vector<CString> chestList, folderList, weaponList, PMServerList;
+		TFlagList flagList;
+		std::vector<CString> folderList, PMServerList;
+		TChestList chestList;
+		TWeaponList weaponList;
 };
 
 inline CString TAccount::getFlag(const std::string& pFlagName) const
 {
-	auto it = flagList.find(pFlagName);
-	if (it != flagList.end())
-		return it->second;
-	return "";
+	return flagList.get(pFlagName);
 }
 
 inline void TAccount::deleteFlag(const std::string& pFlagName)
@@ -0,0 +1,176 @@
+#ifndef TACCOUNTINDEX_H
+#define TACCOUNTINDEX_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "CString.h"
+#include "CFileSystem.h"
+
+//! Keeps the fields of every account in memory, so the RC account list can be searched
+//! without reading every account file.  Each field is a column that holds one value per
+//! account, and values are only kept once per column.  The index is built and searched
+//! on a background thread, and searches are answered on the game thread through update().
+class TAccountIndex
+{
+	public:
+		//! A value of an account field.
+		struct Value
+		{
+			CString text;
+			double number;
+			bool isNumber;
+		};
+
+		//! The conditions of an account search, such as "level=*onlinestartlocal.nw,rupees>=100".
+		//! Conditions are met the same way they always were when account files were searched:
+		//! every condition has to be met by one of the lines of the account, and any line that
+		//! fails one is enough to leave the account out.  Chests, weapons, flags and folder
+		//! rights are the exception, since an account has many of them.
+		class Query
+		{
+			public:
+				explicit Query(CString pConditions);
+
+				bool isEmpty() const					{ return conditions.empty(); }
+
+				//! Checks the lines of an account file against the conditions.
+				bool matches(const std::vector<CString>& pLines) const;
+
+			private:
+				friend class TAccountIndex;
+
+				enum Result { NOTMET, MET, FAILED };
+
+				struct Condition
+				{
+					std::string name;
+					int op;
+					CString value;
+					double number;
+					bool multiValued;
+				};
+
+				Result test(const Condition& pCondition, const Value& pValue) const;
+
+				std::vector<Condition> conditions;
+				bool valid;
+		};
+
+		using SearchCallback = std::function<void(const std::vector<CString>&)>;
+
+		TAccountIndex();
+		~TAccountIndex();
+
+		TAccountIndex(const TAccountIndex&) = delete;
+		TAccountIndex& operator=(const TAccountIndex&) = delete;
+
+		//! Brings the index in line with the accounts file system.  Accounts that haven't
+		//! changed on disk since they were last read are kept as they are.
+		//! \param pFileList The accounts, mapped to the full paths of their files.
+		void load(std::shared_ptr<const CFileSystem::FileList> pFileList);
+
+		//! Reads an account file again after it was saved or changed.
+		//! \param pFileName The name of the file, ex: account.txt
+		//! \param pPath The full path of the file.
+		void loadAccount(const CString& pFileName, const CString& pPath);
+
+		//! Removes an account that was deleted.
+		void removeAccount(const CString& pFileName);
+
+		//! Searches the accounts once every change made before it is in the index.
+		//! \param pName Account names to match, with wildcards.
+		//! \param pConditions Conditions the accounts have to meet, if any.
+		//! \param pCallback Receives the names of the matching accounts, called from update().
+		void search(const CString& pName, const CString& pConditions, SearchCallback pCallback);
+
+		//! Answers the searches the worker has finished.
+		void update();
+
+		//! Checks if the worker still has anything to do.
+		bool isBusy() const;
+
+		//! Gets the number of accounts and values in the index.  Only meant for when the worker isn't busy.
+		size_t getAccountCount() const				{ return rows.size(); }
+		size_t getValueCount() const;
+
+	private:
+		static constexpr uint32_t NoValue = UINT32_MAX;
+
+		struct Column
+		{
+			std::vector<Value> values;
+			std::vector<uint32_t> references;
+			std::vector<uint32_t> freeValues;
+			std::unordered_map<std::string, uint32_t> valueIds;
+
+			// The first value of each account, and the rest for the few accounts with more.
+			std::vector<uint32_t> firstValues;
+			std::unordered_map<uint32_t, std::vector<uint32_t>> moreValues;
+
+			uint32_t intern(const CString& pText);
+			void release(uint32_t pValue);
+			void add(uint32_t pRow, uint32_t pValue);
+			void clear(uint32_t pRow);
+		};
+
+		struct Account
+		{
+			time_t modTime;
+			long long size;
+			bool valid;
+		};
+
+		enum JobType { JOB_LOAD, JOB_LOADACCOUNT, JOB_REMOVEACCOUNT, JOB_SEARCH };
+
+		struct Job
+		{
+			JobType type;
+			CString fileName;
+			CString path;
+			CString name;
+			CString conditions;
+			std::shared_ptr<const CFileSystem::FileList> fileList;
+			SearchCallback callback;
+		};
+
+		struct Result
+		{
+			SearchCallback callback;
+			std::vector<CString> accounts;
+		};
+
+		void queueJob(Job pJob);
+		void runWorker();
+		void loadFile(const CString& pFileName, const CString& pPath, bool pOnlyIfChanged);
+		void removeRow(const CString& pFileName);
+		bool matches(const Query& pQuery, uint32_t pRow) const;
+		std::vector<CString> find(const CString& pName, const CString& pConditions) const;
+
+		// Only used by the worker.
+		std::map<CString, uint32_t> rows;
+		std::vector<Account> accounts;
+		std::vector<uint32_t> freeRows;
+		std::vector<Column> columns;
+		std::unordered_map<std::string, uint32_t> columnIds;
+
+		// Shared with the worker.
+		mutable std::mutex queueLock;
+		std::condition_variable queueCondition;
+		std::deque<Job> jobs;
+		std::deque<Result> results;
+		size_t pendingJobs;
+		bool running;
+		std::thread worker;
+};
+
+#endif
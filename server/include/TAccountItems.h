@@ -0,0 +1,104 @@
+#ifndef TACCOUNTITEMS_H
+#define TACCOUNTITEMS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <unordered_set>
+#include <vector>
+#include "CString.h"
+
+//! The chests an account has opened, in the order they were opened.
+//! Each chest is a key made of its interned level name and its position, so checking for one
+//! is a hash lookup that doesn't build or compare any strings.
+class TChestList
+{
+	public:
+		using Key = uint64_t;
+
+		//! Makes the key of the chest at a position in a level.
+		static Key makeKey(const CString& pLevel, int pX, int pY);
+
+		//! Makes the key of a chest saved as "x:y:level".
+		//! Anything else is kept as it is, so it is saved back the same way.
+		static Key makeKey(const CString& pChest);
+
+		//! Gets a chest the way it is saved, as "x:y:level".
+		static CString toString(Key pKey);
+
+		//! Adds a chest, unless it is already in the list.
+		//! \return True if the chest was added.
+		bool add(Key pKey);
+		bool add(const CString& pChest)				{ return add(makeKey(pChest)); }
+
+		bool contains(Key pKey) const				{ return keys.find(pKey) != keys.end(); }
+		bool contains(const CString& pChest) const	{ return contains(makeKey(pChest)); }
+
+		void clear();
+		size_t size() const							{ return order.size(); }
+		bool empty() const							{ return order.empty(); }
+
+		std::vector<Key>::const_iterator begin() const	{ return order.begin(); }
+		std::vector<Key>::const_iterator end() const	{ return order.end(); }
+
+		bool operator==(const TChestList& pOther) const	{ return order == pOther.order; }
+
+	private:
+		std::vector<Key> order;
+		std::unordered_set<Key> keys;
+};
+
+//! The weapons an account has, in the order they were added.
+//! Weapon names are interned, and the list holds their ids.
+class TWeaponList
+{
+	public:
+		class const_iterator
+		{
+			public:
+				using iterator_category = std::forward_iterator_tag;
+				using value_type = CString;
+				using difference_type = std::ptrdiff_t;
+				using pointer = const CString*;
+				using reference = const CString&;
+
+				explicit const_iterator(std::vector<uint32_t>::const_iterator pIt) : it(pIt) {}
+
+				reference operator*() const		{ return getName(*it); }
+				pointer operator->() const		{ return &getName(*it); }
+				const_iterator& operator++()	{ ++it; return *this; }
+				const_iterator operator++(int)	{ const_iterator prev(*this); ++it; return prev; }
+				bool operator==(const const_iterator& pOther) const	{ return it == pOther.it; }
+				bool operator!=(const const_iterator& pOther) const	{ return it != pOther.it; }
+
+			private:
+				std::vector<uint32_t>::const_iterator it;
+		};
+
+		//! Adds a weapon, unless it is already in the list.
+		//! \return True if the weapon was added.
+		bool add(const CString& pWeapon);
+
+		//! Removes a weapon.
+		//! \return True if the weapon was in the list.
+		bool remove(const CString& pWeapon);
+
+		bool contains(const CString& pWeapon) const;
+
+		void clear();
+		size_t size() const				{ return order.size(); }
+		bool empty() const				{ return order.empty(); }
+
+		const_iterator begin() const	{ return const_iterator(order.begin()); }
+		const_iterator end() const		{ return const_iterator(order.end()); }
+
+		bool operator==(const TWeaponList& pOther) const	{ return order == pOther.order; }
+
+	private:
+		static const CString& getName(uint32_t pId);
+
+		std::vector<uint32_t> order;
+		std::unordered_set<uint32_t> ids;
+};
+
+#endif
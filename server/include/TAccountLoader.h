@@ -0,0 +1,65 @@
+#ifndef TACCOUNTLOADER_H
+#define TACCOUNTLOADER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CString.h"
+#include "TAccount.h"
+
+//! Reads accounts on background threads, so logging in doesn't hold up the game thread.
+//! Each account is read into a copy of the account that asked for it, which the game
+//! thread takes over once update() hands it back.
+class TAccountLoader
+{
+	public:
+		//! Receives the account that was read, or nullptr if the account file isn't valid.
+		using LoadedCallback = std::function<void(std::unique_ptr<TAccount> pAccount, bool pLoadedFromDefault)>;
+
+		//! \param pThreadCount The number of accounts that can be read at once.
+		explicit TAccountLoader(unsigned int pThreadCount = 2);
+		~TAccountLoader();
+
+		TAccountLoader(const TAccountLoader&) = delete;
+		TAccountLoader& operator=(const TAccountLoader&) = delete;
+
+		//! Reads an account in the background.
+		//! \param pAccount The account to read into.  It is copied, so it can go away in the meantime.
+		//! \param pAccountName The name of the account to read.
+		//! \param pIgnoreNickname Keep the nickname of pAccount instead of the saved one.
+		//! \param pCallback Called from update() once the account is read.
+		void load(const TAccount& pAccount, const CString& pAccountName, bool pIgnoreNickname, LoadedCallback pCallback);
+
+		//! Hands the accounts that were read to their callbacks.
+		void update();
+
+		//! Checks if any account is still being read.
+		bool isBusy() const;
+
+	private:
+		struct Job
+		{
+			std::unique_ptr<TAccount> account;
+			CString accountName;
+			bool ignoreNickname;
+			bool loadedFromDefault;
+			bool valid;
+			LoadedCallback callback;
+		};
+
+		void runWorker();
+
+		mutable std::mutex queueLock;
+		std::condition_variable queueCondition;
+		std::deque<Job> jobs;
+		std::deque<Job> results;
+		size_t pendingJobs;
+		bool running;
+		std::vector<std::thread> workers;
+};
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef TACCOUNTWRITER_H
+#define TACCOUNTWRITER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "CString.h"
+
+//! Writes account files on a background thread.  Saves wait a short while before they are
+//! written, and saving the same account again in the meantime only replaces what is written.
+//! Each file is written next to the account and then renamed over it, so an account file is
+//! always either the old or the new version, even if the server dies in the middle of a write.
+class TAccountWriter
+{
+	public:
+		//! An account file the writer has finished with.
+		struct Write
+		{
+			CString path;
+			bool saved;
+		};
+
+		//! \param pDelay How long a save waits for more saves of the same account.
+		explicit TAccountWriter(std::chrono::milliseconds pDelay = std::chrono::milliseconds(2000));
+
+		//! Writes everything that is still waiting.
+		~TAccountWriter();
+
+		TAccountWriter(const TAccountWriter&) = delete;
+		TAccountWriter& operator=(const TAccountWriter&) = delete;
+
+		void setDelay(std::chrono::milliseconds pDelay);
+
+		//! Queues the contents of an account file to be written.
+		//! \param pPath The full path of the account file.
+		//! \param pData The contents of the file as they are right now.
+		void save(const CString& pPath, const CString& pData);
+
+		//! Drops a save that hasn't been written yet, such as when the account is deleted.
+		//! A write that is already in progress is stopped before it replaces the file.
+		//! \return true if a save was dropped.
+		bool discard(const CString& pPath);
+
+		//! Gets the contents of an account file that haven't been written yet.
+		//! \return false if the file isn't waiting to be written.
+		bool getPending(const CString& pPath, CString& pData) const;
+
+		//! Writes everything that is waiting right away, and returns once it is on disk.
+		void flush();
+
+		//! Gets the account files that were written, or failed to be, since the last call.
+		std::vector<Write> update();
+
+		size_t getPendingCount() const;
+
+		//! Gets the number of files written so far.  Saves that were replaced before they
+		//! were written aren't counted.
+		size_t getWriteCount() const;
+
+	private:
+		struct Pending
+		{
+			std::shared_ptr<const CString> data;
+			std::chrono::steady_clock::time_point queued;
+		};
+
+		void runWorker();
+		static bool writeFile(const std::string& pPath, const CString& pData);
+		static void syncDirectory(const std::string& pDirectory);
+
+		mutable std::mutex queueLock;
+		std::condition_variable queueCondition;
+		std::condition_variable flushCondition;
+		std::chrono::milliseconds delay;
+
+		// Saves waiting for their delay, and the batch the worker is writing.
+		std::unordered_map<std::string, Pending> pending;
+		std::unordered_map<std::string, std::shared_ptr<const CString>> writing;
+		std::unordered_set<std::string> discarded;
+
+		std::deque<Write> written;
+		size_t writeCount;
+		int flushing;
+		bool running;
+		std::thread worker;
+};
+
+#endif
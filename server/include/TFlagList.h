@@ -0,0 +1,107 @@
+#ifndef TFLAGLIST_H
+#define TFLAGLIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include "CString.h"
+
+//! The flags of a player or of the server, each a name and a value.
+//! Flag names are interned once for the whole server, and each list is an open addressing
+//! table keyed by the name's id.  Values of up to InlineLength characters are kept in the
+//! table itself, so setting a short flag doesn't allocate anything.
+class TFlagList
+{
+	public:
+		static constexpr uint32_t InlineLength = 16;
+
+		//! A flag as it is read out of the list: its interned name, and a copy of its value.
+		using Flag = std::pair<const CString&, CString>;
+
+		class const_iterator
+		{
+			public:
+				using iterator_category = std::forward_iterator_tag;
+				using value_type = Flag;
+				using difference_type = std::ptrdiff_t;
+				using pointer = void;
+				using reference = Flag;
+
+				const_iterator(const TFlagList* pList, uint32_t pIndex) : list(pList), index(pIndex) { skipEmpty(); }
+
+				Flag operator*() const			{ return list->getFlag(index); }
+				const_iterator& operator++()	{ ++index; skipEmpty(); return *this; }
+				const_iterator operator++(int)	{ const_iterator prev(*this); ++*this; return prev; }
+				bool operator==(const const_iterator& pOther) const	{ return index == pOther.index; }
+				bool operator!=(const const_iterator& pOther) const	{ return index != pOther.index; }
+
+			private:
+				void skipEmpty()	{ while (index < list->capacity && list->slots[index].name == EmptySlot) ++index; }
+
+				const TFlagList* list;
+				uint32_t index;
+		};
+
+		TFlagList();
+		~TFlagList();
+		TFlagList(const TFlagList& pOther);
+		TFlagList(TFlagList&& pOther) noexcept;
+		TFlagList& operator=(const TFlagList& pOther);
+		TFlagList& operator=(TFlagList&& pOther) noexcept;
+
+		//! Checks if a flag is set, even to an empty value.
+		bool contains(std::string_view pName) const;
+
+		//! Gets the value of a flag, or an empty string if it isn't set.
+		CString get(std::string_view pName) const;
+
+		//! Sets a flag, adding it if it isn't set yet.
+		void set(std::string_view pName, const CString& pValue);
+
+		//! Removes a flag.
+		//! \return True if the flag was set.
+		bool erase(std::string_view pName);
+
+		void clear();
+		size_t size() const				{ return count; }
+		bool empty() const				{ return count == 0; }
+
+		const_iterator begin() const	{ return const_iterator(this, 0); }
+		const_iterator end() const		{ return const_iterator(this, capacity); }
+
+		bool operator==(const TFlagList& pOther) const;
+
+	private:
+		static constexpr uint32_t EmptySlot = UINT32_MAX;
+
+		struct Slot
+		{
+			uint32_t name;
+			uint32_t length;
+			union
+			{
+				char text[InlineLength];
+				char* heapText;
+			};
+
+			const char* getText() const	{ return (length > InlineLength ? heapText : text); }
+			std::string_view getValue() const	{ return std::string_view(getText(), length); }
+		};
+
+		Flag getFlag(uint32_t pIndex) const;
+		static CString getValue(const Slot& pSlot);
+		uint32_t findSlot(uint32_t pName) const;
+		uint32_t homeSlot(uint32_t pName) const;
+		void storeValue(Slot& pSlot, std::string_view pValue);
+		void grow();
+		void release();
+
+		std::unique_ptr<Slot[]> slots;
+		uint32_t capacity;
+		uint32_t count;
+};
+
+#endif
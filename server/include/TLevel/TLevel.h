@@ -1,18 +1,26 @@
 #ifndef TLEVEL_H
 #define TLEVEL_H
 
+#include <functional>
+#include <list>
 #include <vector>
 #include <map>
 #include <optional>
 #include "IUtil.h"
 #include "CString.h"
+#include "TAccountItems.h"
 #include "TLevelBaddy.h"
 #include "TLevelBoardChange.h"
+#include "TLevelBoardChangeList.h"
 #include "TLevelChest.h"
+#include "TLevelCollisionMap.h"
 #include "TLevelHorse.h"
 #include "TLevelItem.h"
 #include "TLevelLink.h"
+#include "TLevelNPCGrid.h"
 #include "TLevelSign.h"
+#include "TLevelTileIndex.h"
+#include "TimerWheel.h"
 
 class TServer;
 class TPlayer;
@@ -35,6 +43,12 @@ class TLevel
 		//! \return True if it succeeds in re-loading the level.
 		bool reload();
 
+		//! Re-loads the level, only applying and sending what changed in the level file.
+		//! NPCs whose definition didn't change keep running with their current state.
+		//! Falls back to a full reload for changes clients can't be sent incrementally.
+		//! \return True if it succeeds in re-loading the level.
+		bool reloadChanges();
+
 		//! Returns a clone of the level.
 		TLevel* clone();
 
@@ -50,6 +64,10 @@ class TLevel
 		CString getNpcsPacket(time_t time, int clientVersion = CLVER_2_17);
 		CString getSignsPacket(TPlayer *pPlayer);
 
+		//! Checks if the GS2 scripts of any npcs in the level are still being compiled.
+		//! Clients shouldn't get the level until they are, or they would get the npcs without their scripts.
+		bool isCompilingScripts() const;
+
 		//! Gets the actual level name.
 		//! \return The action level name.
 		CString getActualLevelName() const				{ return actualLevelName; }
@@ -211,18 +229,32 @@ class TLevel
 		//! \param pMapY Y location on the map.
 		void setMap(TMap* pMap, int pMapX = 0, int pMapY = 0);
 
-		//! Does special events that should happen every second.
-		//! \return Currently, it always returns true.
-		bool doTimedEvents();
+		//! Sets the timeout of a baddy, replacing any timeout it already has.
+		//! \param baddy The baddy whose timeout is set.
+		//! \param seconds Seconds until the timeout runs out.
+		void setBaddyTimeout(TLevelBaddy* baddy, int seconds);
 
+		//! Collision checks against the current board, including board changes.
+		//! Tiles outside of the board count as walls.
 		bool isOnWall(int pX, int pY) const;
 		bool isOnWall2(int pX, int pY, int pWidth, int pHeight, uint8_t flags = 0) const;
 		bool isOnWater(int pX, int pY) const;
+
+		//! Gets the tile class bitmaps of the current board.
+		const TLevelCollisionMap& getCollisionMap() const	{ return collisionMap; }
 		std::optional<TLevelChest> getChest(int x, int y) const;
 		std::optional<TLevelLink> getLink(int pX, int pY) const;
-		CString getChestStr(const TLevelChest& chest) const;
+		TChestList::Key getChestKey(const TLevelChest& chest) const;
+
+		//! Calls fn(const TLevelSign&) for every sign placed on a tile.
+		template<typename Fn>
+		void forEachSignAt(int pX, int pY, Fn&& fn) const;
 
 #ifdef V8NPCSERVER
+		//! Updates the position, size and flags of an NPC in the level's NPC grid.
+		//! Called by the NPC whenever any of them change.  NPCs not in the level are ignored.
+		void updateNPC(TNPC* npc);
+
 		std::vector<TNPC *> findAreaNpcs(int pX, int pY, int pWidth, int pHeight);
 		std::vector<TNPC *> testTouch(int pX, int pY);
 		TNPC *isOnNPC(float pX, float pY, bool checkEventFlag = false);
@@ -239,36 +271,87 @@ class TLevel
 
 		// level-loading functions
 		bool loadLevel(const CString& pLevelName);
+		bool parseLevel(const CString& pLevelName);
 		bool detectLevelType(const CString& pLevelName);
 		bool loadGraal(const CString& pLevelName);
 		bool loadZelda(const CString& pLevelName);
 		bool loadNW(const CString& pLevelName);
 
+		// timed events
+		utilities::TimerHandle scheduleTimer(int seconds, std::function<void()> callback);
+		void cancelTimer(utilities::TimerHandle& handle);
+		void cancelAllTimers();
+		void respawnBoardChange(TLevelBoardChangeList::ChangeId id);
+		void doBaddyTimeout(TLevelBaddy* baddy);
+
+		// collision map
+		void updateCollisionMap(int pX, int pY, int pWidth, int pHeight, CString pTileData);
+
+		// object tile indexes
+		void rebuildObjectIndexes();
+		void eraseItem(std::list<TLevelItem>::iterator item);
+		void eraseHorse(std::list<TLevelHorse>::iterator horse);
+
+		// level npcs, as defined by the level file
+		struct NPCDefinition
+		{
+			CString image;
+			CString code;
+			float x, y;
+			TNPC* npc;
+		};
+		TNPC* spawnNPC(NPCDefinition& definition, bool sendToPlayers);
+
+		// incremental reloading
+		bool canReloadChanges(const TLevel& updated) const;
+		void reloadBoard(const TLevel& updated);
+		void reloadObjects(const TLevel& updated);
+		void reloadNPCs(TLevel& updated);
+
 		TServer* server;
 		time_t modTime;
 		bool levelSpar;
 		bool levelSingleplayer;
 		short levelTiles[256][4096];
 		std::vector<int> layers;
+		TLevelCollisionMap collisionMap;
 		int mapx, mapy;
 		TMap* levelMap;
 		CString fileName, fileVersion, actualLevelName, levelName;
 		std::vector<TLevelBaddy *> levelBaddies;
 		std::vector<TLevelBaddy *> levelBaddyIds;
-		std::vector<TLevelBoardChange> levelBoardChanges;
+		TLevelBoardChangeList levelBoardChanges;
 		std::vector<TLevelChest> levelChests;
-		std::vector<TLevelHorse> levelHorses;
-		std::vector<TLevelItem> levelItems;
+		std::list<TLevelHorse> levelHorses;
+		std::list<TLevelItem> levelItems;
 		std::vector<TLevelLink> levelLinks;
 		std::vector<TLevelSign> levelSigns;
+		std::vector<TChestList::Key> levelChestKeys;
+		TLevelTileIndex<uint32_t> chestIndex;
+		TLevelTileIndex<uint32_t> linkIndex;
+		TLevelTileIndex<uint32_t> signIndex;
+		TLevelTileIndex<std::list<TLevelHorse>::iterator> horseIndex;
+		TLevelTileIndex<std::list<TLevelItem>::iterator> itemIndex;
+		std::vector<NPCDefinition> levelNPCDefs;
 		std::vector<TNPC *> levelNPCs;
 		std::vector<TPlayer *> levelPlayerList;
 
 #ifdef V8NPCSERVER
+		TLevelNPCGrid npcGrid;
 		std::unique_ptr<IScriptObject<TLevel>> _scriptObject;
 #endif
 };
 
+template<typename Fn>
+void TLevel::forEachSignAt(int pX, int pY, Fn&& fn) const
+{
+	signIndex.forEach(pX, pY, [&](uint32_t index) {
+		const TLevelSign& sign = levelSigns[index];
+		if (sign.getX() == pX && sign.getY() == pY)
+			fn(sign);
+	});
+}
+
 #ifdef V8NPCSERVER
 
 inline IScriptObject<TLevel>* TLevel::getScriptObject() const {
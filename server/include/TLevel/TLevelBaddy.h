@@ -3,7 +3,7 @@
 
 #include <vector>
 #include "CString.h"
-#include "CTimeout.h"
+#include "TimerWheel.h"
 
 // Baddy props
 enum {
@@ -65,7 +65,7 @@ class TLevelBaddy
 		void setRespawn(const bool pRespawn)	{ respawn = pRespawn; }
 		void setId(const char pId)				{ id = pId; }
 
-		CTimeout timeout;
+		utilities::TimerHandle timer;
 
 	private:
 		TLevel* level;
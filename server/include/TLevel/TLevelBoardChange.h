@@ -3,8 +3,8 @@
 
 #include <vector>
 #include <time.h>
-#include "CTimeout.h"
 #include "CString.h"
+#include "TimerWheel.h"
 
 class TLevelBoardChange
 {
@@ -13,7 +13,7 @@ class TLevelBoardChange
 		TLevelBoardChange(const int pX, const int pY, const int pWidth, const int pHeight,
 			const CString& pTiles, const CString& pOldTiles, const int respawn = 15)
 			: x(pX), y(pY), width(pWidth), height(pHeight),
-			tiles(pTiles), oldTiles(pOldTiles), modTime(time(0)) { timeout.setTimeout(respawn); }
+			tiles(pTiles), oldTiles(pOldTiles), modTime(time(0)), respawnTime(respawn), respawnPending(respawn > 0) { }
 
 		// functions
 		CString getBoardStr() const;
@@ -26,16 +26,20 @@ class TLevelBoardChange
 		int getHeight() const			{ return height; }
 		CString getTiles() const		{ return tiles; }
 		time_t getModTime() const		{ return modTime; }
+		int getRespawnTime() const		{ return respawnTime; }
+		bool isRespawnPending() const	{ return respawnPending; }
 
 		// set private variables
 		void setModTime(time_t ntime)	{ modTime = ntime; }
 
-		CTimeout timeout;
+		utilities::TimerHandle timer;
 
 	private:
 		int x, y, width, height;
 		CString tiles, oldTiles;
 		time_t modTime;
+		int respawnTime;
+		bool respawnPending;
 };
 
 #endif // TLEVELBOARDCHANGE_H
@@ -0,0 +1,106 @@
+#ifndef TLEVELBOARDCHANGELIST_H
+#define TLEVELBOARDCHANGELIST_H
+
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+#include "CString.h"
+#include "TLevelBoardChange.h"
+
+//! Holds the board changes of a level.
+//! Changes are indexed by the tile of their top-left corner so region lookups only visit
+//! the tiles of the region, and by modification time so "changes since" queries only visit
+//! the changes that are actually sent.
+class TLevelBoardChangeList
+{
+	public:
+		using ChangeId = uint32_t;
+		static constexpr ChangeId InvalidId = UINT32_MAX;
+
+		TLevelBoardChangeList();
+
+		//! Removes every board change.
+		void clear();
+
+		//! Gets the amount of board changes stored.
+		size_t size() const								{ return activeCount; }
+		bool empty() const								{ return activeCount == 0; }
+
+		//! Adds a board change.  May compact the list first if it has grown large.
+		//! \param change The board change to add.
+		//! \return The id of the new change, or InvalidId if it lies outside of the board.
+		ChangeId addChange(TLevelBoardChange change);
+
+		//! Erases every change that lies entirely within the specified region.
+		//! \return The erased changes.
+		std::vector<TLevelBoardChange> eraseWithin(int pX, int pY, int pWidth, int pHeight);
+
+		//! Erases a single board change.
+		void erase(ChangeId id);
+
+		//! Gets a board change by id.
+		//! \return A pointer to the change, or nullptr if the id is not in use.
+		TLevelBoardChange* getChange(ChangeId id);
+
+		//! Sets the mod time of a change and moves it in the time index.
+		void setModTime(ChangeId id, time_t modTime);
+
+		//! Gets the concatenated board strings of every change modified at or after the specified time.
+		//! Changes are ordered by their mod time so later changes are applied last.
+		CString getBoardStr(time_t time) const;
+
+		//! Drops changes whose tiles are entirely overwritten by newer changes.
+		//! Changes waiting to respawn are never dropped.
+		//! \return The amount of changes dropped.
+		size_t compact();
+
+		//! Calls fn(ChangeId, TLevelBoardChange&) for every change.
+		template<typename Fn>
+		void forEach(Fn&& fn);
+
+	private:
+		struct Slot
+		{
+			std::optional<TLevelBoardChange> change;
+			std::pair<time_t, uint64_t> timeKey;
+			ChangeId nextInTile;
+		};
+
+		static constexpr int BoardWidth = 64;
+		static constexpr int BoardHeight = 64;
+		static constexpr size_t MinCompactThreshold = 64;
+
+		void linkTile(ChangeId id);
+		void unlinkTile(ChangeId id);
+
+		std::vector<Slot> slots;
+		std::vector<ChangeId> freeSlots;
+		std::vector<ChangeId> tileHeads;
+		std::map<std::pair<time_t, uint64_t>, ChangeId> timeIndex;
+		uint64_t nextSequence;
+		size_t activeCount;
+		size_t compactThreshold;
+};
+
+inline TLevelBoardChange* TLevelBoardChangeList::getChange(ChangeId id)
+{
+	if (id >= slots.size() || !slots[id].change)
+		return nullptr;
+
+	return &(*slots[id].change);
+}
+
+template<typename Fn>
+void TLevelBoardChangeList::forEach(Fn&& fn)
+{
+	for (ChangeId id = 0; id < slots.size(); ++id)
+	{
+		if (slots[id].change)
+			fn(id, *slots[id].change);
+	}
+}
+
+#endif // TLEVELBOARDCHANGELIST_H
@@ -0,0 +1,81 @@
+#ifndef TLEVELCOLLISIONMAP_H
+#define TLEVELCOLLISIONMAP_H
+
+#include <cstdint>
+
+// Tile classes tracked by the collision map.
+enum
+{
+	TILECLASS_WALL		= 0,	// Blocking, jump stones and throw-through tiles.
+	TILECLASS_WATER		= 1,
+	TILECLASS_NEARWATER	= 2,
+	TILECLASS_SWAMP		= 3,
+	TILECLASS_LAVA		= 4,	// Lava and lava swamp.
+	TILECLASS_CHAIR		= 5,
+	TILECLASS_BED		= 6,
+	TILECLASS_HURT		= 7,
+	TILECLASS_COUNT
+};
+
+//! Packed per-class bitmaps of the tile types of a level board.
+//! Every board row fits in a single 64-bit word, so a rectangle query is a handful of
+//! word-wide ORs followed by a single mask test.
+class TLevelCollisionMap
+{
+	public:
+		static constexpr int BoardWidth = 64;
+		static constexpr int BoardHeight = 64;
+
+		TLevelCollisionMap()							{ clear(); }
+
+		//! Clears every bitmap.
+		void clear();
+
+		//! Rebuilds every bitmap from a full board.
+		//! \param tiles All 4096 tiles of the board.
+		void rebuild(const short* tiles);
+
+		//! Updates the bitmaps for a single tile.
+		void setTile(int pX, int pY, short tile);
+
+		//! Checks if a tile belongs to a tile class.  Tiles outside of the board belong to no class.
+		bool test(int tileClass, int pX, int pY) const;
+
+		//! Checks if any tile of a rectangle belongs to a tile class.
+		//! The rectangle is clipped to the board.
+		bool testArea(int tileClass, int pX, int pY, int pWidth, int pHeight) const;
+
+		//! Gets the tile class bits of a tile type.
+		static uint8_t getTileClasses(short tile);
+
+	private:
+		uint64_t rows[TILECLASS_COUNT][BoardHeight];
+};
+
+inline bool TLevelCollisionMap::test(int tileClass, int pX, int pY) const
+{
+	if (pX < 0 || pY < 0 || pX >= BoardWidth || pY >= BoardHeight)
+		return false;
+
+	return (rows[tileClass][pY] >> pX) & 1;
+}
+
+inline bool TLevelCollisionMap::testArea(int tileClass, int pX, int pY, int pWidth, int pHeight) const
+{
+	int startX = (pX < 0 ? 0 : pX), endX = (pX + pWidth > BoardWidth ? BoardWidth : pX + pWidth);
+	int startY = (pY < 0 ? 0 : pY), endY = (pY + pHeight > BoardHeight ? BoardHeight : pY + pHeight);
+	if (startX >= endX || startY >= endY)
+		return false;
+
+	// OR the rows together first so the column mask only has to be applied once.
+	const uint64_t* classRows = rows[tileClass];
+	uint64_t merged = 0;
+	for (int y = startY; y < endY; ++y)
+		merged |= classRows[y];
+
+	int width = endX - startX;
+	uint64_t mask = (width == 64 ? ~uint64_t(0) : ((uint64_t(1) << width) - 1)) << startX;
+	return (merged & mask) != 0;
+}
+
+#endif // TLEVELCOLLISIONMAP_H
@@ -2,7 +2,7 @@
 #define TLEVELHORSE_H
 
 #include "CString.h"
-#include "CTimeout.h"
+#include "TimerWheel.h"
 
 class TServer;
 class TLevelHorse
@@ -11,7 +11,6 @@ class TLevelHorse
 		TLevelHorse(int horselife, const CString& pImage, float pX, float pY, char pDir = 0, char pBushes = 0)
 			: horselifetime(horselife), image(pImage), x(pX), y(pY), dir(pDir), bushes(pBushes)
 		{
-			timeout.setTimeout(horselifetime);
 		}
 
 		CString getHorseStr();
@@ -22,8 +21,9 @@ class TLevelHorse
 		float getY() const			{ return y; }
 		char getDir() const			{ return dir; }
 		char getBushes() const		{ return bushes; }
+		int getLifetime() const		{ return horselifetime; }
 
-		CTimeout timeout;
+		utilities::TimerHandle timer;
 
 	private:
 		CString image;
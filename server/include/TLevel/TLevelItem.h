@@ -2,8 +2,8 @@
 #define TLEVELITEM_H
 
 #include <ctime>
-#include "CTimeout.h"
 #include "CString.h"
+#include "TimerWheel.h"
 
 enum class LevelItemType
 {
@@ -43,9 +43,11 @@ class TLevelItem
 		TLevelItem(float pX, float pY, LevelItemType pItem) :
 			x(pX), y(pY), item(pItem), modTime(time(0))
 		{
-			timeout.setTimeout(10);
 		}
 
+		// Seconds until a dropped item disappears.
+		static constexpr int Lifetime = 10;
+
 		// Return the packet to be sent to the player.
 		CString getItemStr() const;
 
@@ -55,7 +57,7 @@ class TLevelItem
 		LevelItemType getItem() const { return item; }
 		time_t getModTime() const { return modTime; }
 
-		CTimeout timeout;
+		utilities::TimerHandle timer;
 
 		// Static functions.
 		static LevelItemType getItemId(signed char itemId);
@@ -0,0 +1,164 @@
+#ifndef TLEVELNPCGRID_H
+#define TLEVELNPCGRID_H
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class TNPC;
+
+// Filter flags kept alongside every NPC in the grid.
+enum
+{
+	NPCGRIDFLAG_VISIBLE			= 0x01,
+	NPCGRIDFLAG_PLAYERTOUCHSME	= 0x02,
+};
+
+//! Uniform bucket grid of the NPC bounds of a level.
+//! Every NPC is stored in each cell its bounds overlap, so point and area queries only visit
+//! the NPCs near the queried region instead of every NPC in the level.  NPCs outside of the
+//! level are kept in the border cells.
+class TLevelNPCGrid
+{
+	public:
+		static constexpr int CellSize = 64;			// In pixels, 4x4 tiles.
+		static constexpr int GridWidth = 16;
+		static constexpr int GridHeight = 16;
+
+		TLevelNPCGrid();
+
+		//! Removes every NPC.
+		void clear();
+
+		//! Gets the amount of NPCs in the grid.
+		size_t size() const								{ return entries.size(); }
+
+		//! Checks if an NPC is in the grid.
+		bool contains(TNPC* npc) const					{ return entries.find(npc) != entries.end(); }
+
+		//! Adds an NPC to the grid, or updates it if it is already in the grid.
+		//! \param npc The NPC.
+		//! \param pX, pY, pWidth, pHeight The bounds of the NPC in pixels.
+		//! \param flags The NPCGRIDFLAG_* flags of the NPC.
+		void insert(TNPC* npc, int pX, int pY, int pWidth, int pHeight, uint8_t flags);
+
+		//! Updates the bounds and flags of an NPC in the grid.
+		//! \return False if the NPC is not in the grid.
+		bool update(TNPC* npc, int pX, int pY, int pWidth, int pHeight, uint8_t flags);
+
+		//! Removes an NPC from the grid.
+		void remove(TNPC* npc);
+
+		//! Calls fn(TNPC*) for every NPC with all of the required flags whose bounds overlap the area.
+		//! Bounds are half-open, so an NPC that only touches the edge of the area is not included.
+		template<typename Fn>
+		void forEachInArea(int pX, int pY, int pWidth, int pHeight, uint8_t requiredFlags, Fn&& fn);
+
+		//! Calls fn(TNPC*) for every NPC with all of the required flags whose bounds contain the point.
+		//! Bounds are inclusive on every side.
+		template<typename Fn>
+		void forEachAtPoint(int pX, int pY, uint8_t requiredFlags, Fn&& fn) const;
+
+		//! Calls fn(TNPC*) for every NPC with all of the required flags stored in the cell of the point.
+		//! Every NPC whose bounds contain the point is visited, along with its neighbours.
+		//! \return The NPC fn returned true for, or nullptr.
+		template<typename Fn>
+		TNPC* findNearPoint(int pX, int pY, uint8_t requiredFlags, Fn&& fn) const;
+
+	private:
+		struct Entry
+		{
+			TNPC* npc;
+			int x, y, width, height;
+			int cellStartX, cellStartY, cellEndX, cellEndY;
+			uint32_t queryStamp;
+			uint8_t flags;
+		};
+
+		static int toCellX(int pX);
+		static int toCellY(int pY);
+
+		void setBounds(Entry& entry, int pX, int pY, int pWidth, int pHeight);
+		void linkCells(Entry* entry);
+		void unlinkCells(Entry* entry);
+
+		std::unordered_map<TNPC*, Entry> entries;
+		std::vector<std::vector<Entry*>> cells;
+		uint32_t queryStamp;
+};
+
+inline int TLevelNPCGrid::toCellX(int pX)
+{
+	int cell = (pX < 0 ? 0 : pX / CellSize);
+	return (cell >= GridWidth ? GridWidth - 1 : cell);
+}
+
+inline int TLevelNPCGrid::toCellY(int pY)
+{
+	int cell = (pY < 0 ? 0 : pY / CellSize);
+	return (cell >= GridHeight ? GridHeight - 1 : cell);
+}
+
+template<typename Fn>
+void TLevelNPCGrid::forEachInArea(int pX, int pY, int pWidth, int pHeight, uint8_t requiredFlags, Fn&& fn)
+{
+	int testEndX = pX + pWidth;
+	int testEndY = pY + pHeight;
+
+	// Empty and negative areas still match NPCs that span them, so search between both edges.
+	int cellStartX = toCellX(std::min(pX, testEndX - 1)), cellEndX = toCellX(std::max(pX, testEndX - 1));
+	int cellStartY = toCellY(std::min(pY, testEndY - 1)), cellEndY = toCellY(std::max(pY, testEndY - 1));
+
+	// NPCs spanning several cells are only reported once per query.
+	uint32_t stamp = ++queryStamp;
+	for (int cellY = cellStartY; cellY <= cellEndY; ++cellY)
+	{
+		for (int cellX = cellStartX; cellX <= cellEndX; ++cellX)
+		{
+			for (Entry* entry : cells[cellX + cellY * GridWidth])
+			{
+				if (entry->queryStamp == stamp || (entry->flags & requiredFlags) != requiredFlags)
+					continue;
+
+				entry->queryStamp = stamp;
+				if (pX < entry->x + entry->width && testEndX > entry->x &&
+					pY < entry->y + entry->height && testEndY > entry->y)
+				{
+					fn(entry->npc);
+				}
+			}
+		}
+	}
+}
+
+template<typename Fn>
+void TLevelNPCGrid::forEachAtPoint(int pX, int pY, uint8_t requiredFlags, Fn&& fn) const
+{
+	// A point lies in a single cell, so every NPC is visited at most once.
+	for (const Entry* entry : cells[toCellX(pX) + toCellY(pY) * GridWidth])
+	{
+		if ((entry->flags & requiredFlags) != requiredFlags)
+			continue;
+
+		if (entry->x <= pX && entry->x + entry->width >= pX &&
+			entry->y <= pY && entry->y + entry->height >= pY)
+		{
+			fn(entry->npc);
+		}
+	}
+}
+
+template<typename Fn>
+TNPC* TLevelNPCGrid::findNearPoint(int pX, int pY, uint8_t requiredFlags, Fn&& fn) const
+{
+	for (const Entry* entry : cells[toCellX(pX) + toCellY(pY) * GridWidth])
+	{
+		if ((entry->flags & requiredFlags) == requiredFlags && fn(entry->npc))
+			return entry->npc;
+	}
+
+	return nullptr;
+}
+
+#endif // TLEVELNPCGRID_H
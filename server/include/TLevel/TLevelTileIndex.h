@@ -0,0 +1,164 @@
+#ifndef TLEVELTILEINDEX_H
+#define TLEVELTILEINDEX_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+//! Maps the tiles of a level board to the objects placed on them.
+//! Every tile holds a chain of values in insertion order, so a lookup only visits the
+//! objects on a single tile.  Values are usually slots or iterators into the level's own
+//! object containers.  Positions outside of the board are kept on the nearest border tile,
+//! so lookups still have to check the exact position of what they find.
+template<typename T>
+class TLevelTileIndex
+{
+	public:
+		static constexpr int BoardWidth = 64;
+		static constexpr int BoardHeight = 64;
+
+		TLevelTileIndex() : tileHeads(BoardWidth * BoardHeight, InvalidIndex), freeHead(InvalidIndex), count(0) {}
+
+		//! Removes every value.
+		void clear();
+
+		//! Gets the amount of values stored.
+		size_t size() const								{ return count; }
+
+		//! Adds a value to a tile, after any values already on it.
+		void insert(int pX, int pY, T value);
+
+		//! Adds a value to every tile between two corners, inclusive.
+		void insertArea(int pX1, int pY1, int pX2, int pY2, const T& value);
+
+		//! Removes a value from a tile.
+		//! \return False if the value wasn't on the tile.
+		bool erase(int pX, int pY, const T& value);
+
+		//! Gets the first value on a tile that matches a predicate.
+		//! \return A pointer to the value, or nullptr if there isn't one.
+		template<typename Pred>
+		const T* find(int pX, int pY, Pred&& pred) const;
+
+		//! Calls fn(const T&) for every value on a tile, in insertion order.
+		template<typename Fn>
+		void forEach(int pX, int pY, Fn&& fn) const;
+
+	private:
+		static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+		static int clampX(int pX)						{ return (pX < 0 ? 0 : (pX >= BoardWidth ? BoardWidth - 1 : pX)); }
+		static int clampY(int pY)						{ return (pY < 0 ? 0 : (pY >= BoardHeight ? BoardHeight - 1 : pY)); }
+		uint32_t& headOf(int pX, int pY)				{ return tileHeads[clampX(pX) + clampY(pY) * BoardWidth]; }
+		uint32_t headOf(int pX, int pY) const			{ return tileHeads[clampX(pX) + clampY(pY) * BoardWidth]; }
+
+		struct Node
+		{
+			T value;
+			uint32_t next;
+		};
+
+		std::vector<uint32_t> tileHeads;
+		std::vector<Node> nodes;
+		uint32_t freeHead;
+		size_t count;
+};
+
+template<typename T>
+void TLevelTileIndex<T>::clear()
+{
+	std::fill(tileHeads.begin(), tileHeads.end(), InvalidIndex);
+	nodes.clear();
+	freeHead = InvalidIndex;
+	count = 0;
+}
+
+template<typename T>
+void TLevelTileIndex<T>::insert(int pX, int pY, T value)
+{
+	uint32_t index;
+	if (freeHead != InvalidIndex)
+	{
+		index = freeHead;
+		freeHead = nodes[index].next;
+		nodes[index].value = std::move(value);
+	}
+	else
+	{
+		index = (uint32_t)nodes.size();
+		nodes.push_back(Node{ std::move(value), InvalidIndex });
+	}
+	nodes[index].next = InvalidIndex;
+
+	// Append so lookups keep returning the oldest match first.
+	uint32_t* link = &headOf(pX, pY);
+	while (*link != InvalidIndex)
+		link = &nodes[*link].next;
+	*link = index;
+
+	++count;
+}
+
+template<typename T>
+void TLevelTileIndex<T>::insertArea(int pX1, int pY1, int pX2, int pY2, const T& value)
+{
+	int startX = clampX(std::min(pX1, pX2)), endX = clampX(std::max(pX1, pX2));
+	int startY = clampY(std::min(pY1, pY2)), endY = clampY(std::max(pY1, pY2));
+	for (int y = startY; y <= endY; ++y)
+	{
+		for (int x = startX; x <= endX; ++x)
+			insert(x, y, value);
+	}
+}
+
+template<typename T>
+bool TLevelTileIndex<T>::erase(int pX, int pY, const T& value)
+{
+	uint32_t* link = &headOf(pX, pY);
+	while (*link != InvalidIndex)
+	{
+		uint32_t index = *link;
+		if (nodes[index].value == value)
+		{
+			*link = nodes[index].next;
+			nodes[index].next = freeHead;
+			freeHead = index;
+			--count;
+			return true;
+		}
+		link = &nodes[index].next;
+	}
+
+	return false;
+}
+
+template<typename T>
+template<typename Pred>
+const T* TLevelTileIndex<T>::find(int pX, int pY, Pred&& pred) const
+{
+	for (uint32_t index = headOf(pX, pY); index != InvalidIndex; index = nodes[index].next)
+	{
+		if (pred(nodes[index].value))
+			return &nodes[index].value;
+	}
+
+	return nullptr;
+}
+
+template<typename T>
+template<typename Fn>
+void TLevelTileIndex<T>::forEach(int pX, int pY, Fn&& fn) const
+{
+	for (uint32_t index = headOf(pX, pY); index != InvalidIndex; index = nodes[index].next)
+		fn(nodes[index].value);
+}
+
+//! Gets the tile a position lies on.
+inline int toLevelTile(float pos)
+{
+	return (int)std::floor(pos);
+}
+
+#endif // TLEVELTILEINDEX_H
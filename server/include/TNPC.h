@@ -2,6 +2,7 @@
 #define TNPC_H
 
 #include <algorithm>
+#include <chrono>
 #include <ctime>
 #include "CString.h"
 #include "IUtil.h"
@@ -14,6 +15,7 @@
 #include "ScriptAction.h"
 #include "ScriptBindings.h"
 #include "ScriptExecutionContext.h"
+#include "TimerWheel.h"
 #endif
 
 enum
@@ -167,12 +169,6 @@ enum
 	NPCEVENTFLAG_NPCWARPED		= (int)(1 << 8),
 };
 
-struct ScriptEventTimer
-{
-	unsigned int timer;
-	ScriptAction action;
-};
-
 #endif
 
 class TServer;
@@ -238,15 +234,15 @@ class TNPC
 		// set functions
 		void setId(unsigned int pId)			{ id = pId; }
 		void setLevel(TLevel* pLevel)			{ level = pLevel; }
-		void setX(int val)						{ x = val; }
-		void setY(int val)						{ y = val; }
-		void setHeight(int val)					{ height = val; }
-		void setWidth(int val)					{ width = val; }
+		void setX(int val)						{ x = val; updateLevelGrid(); }
+		void setY(int val)						{ y = val; updateLevelGrid(); }
+		void setHeight(int val)					{ height = val; updateLevelGrid(); }
+		void setWidth(int val)					{ width = val; updateLevelGrid(); }
 		void setName(const std::string& name)	{ npcName = name; }
 		void setScripter(const CString& name)	{ npcScripter = name; }
 		void setScriptType(const CString& type)	{ npcScriptType = type; }
 		void setBlockingFlags(int val)			{ blockFlags = val; }
-		void setVisibleFlags(int val)			{ visFlags = val; }
+		void setVisibleFlags(int val)			{ visFlags = val; updateLevelGrid(); }
 		void setColorId(unsigned int idx, unsigned char val);
 		void setSprite(int val)					{ sprite = val; }
 
@@ -260,7 +256,6 @@ class TNPC
 		unsigned char getSprite() const			{ return sprite; }
 		int getBlockFlags() const 				{ return blockFlags; }
 		int getVisibleFlags() const 			{ return visFlags; }
-		int getTimeout() const 					{ return timeout; }
 
 		const SourceCode& getSource() const		{ return npcScript; }
 		const std::string& getName() const		{ return npcName; }
@@ -275,6 +270,8 @@ class TNPC
 			return npcBytecode;
 		}
 
+		CString getByteCodePacket() const;
+
 #ifdef V8NPCSERVER
 		bool joinedClass(const std::string& name) {
 			auto it = classMap.find(name); // std::find(classMap.begin(), classMap.end(), name);
@@ -282,7 +279,9 @@ class TNPC
 		}
 
 		TScriptClass * joinClass(const std::string& className);
-		void setTimeout(int val);
+		//! Gets the time left until the npc's timeout runs out.
+		std::chrono::milliseconds getTimeout() const;
+		void setTimeout(std::chrono::milliseconds delay);
 		void updatePropModTime(unsigned char propId);
 
 		//
@@ -320,10 +319,11 @@ class TNPC
 
 		void registerNpcUpdates();
 		void registerTriggerAction(const std::string& action, IScriptFunction *cbFunc);
-		void scheduleEvent(unsigned int timeout, ScriptAction& action);
+		void scheduleEvent(std::chrono::milliseconds delay, ScriptAction& action);
 
-		bool runScriptTimer();
-		NPCEventResponse runScriptEvents();
+		//! Runs a timeout or scheduled event once the script engine's timer runs out.
+		void runScriptTimer(std::optional<ScriptAction>& action);
+		NPCEventResponse runScriptEvents(std::chrono::high_resolution_clock::time_point deadline);
 
 		CString getVariableDump();
 
@@ -354,13 +354,14 @@ class TNPC
 		CString npcScripter, npcScriptType;
 		std::string npcName;
 		std::string clientScriptFormatted;
-		int timeout;
 		int width, height;
 
 		CString npcBytecode;
 
+		//! Tells the level the NPC is in that its bounds or touch flags changed.
+		void updateLevelGrid();
+
 #ifdef V8NPCSERVER
-		bool hasTimerUpdates() const;
 		void freeScriptResources();
 		void testTouch();
 		void testForLinks();
@@ -383,7 +384,8 @@ class TNPC
 		std::unique_ptr<IScriptObject<TNPC>> _scriptObject;
 		ScriptExecutionContext _scriptExecutionContext;
 		std::unordered_map<std::string, IScriptFunction *> _triggerActions;
-		std::vector<ScriptEventTimer> _scriptTimers;
+		utilities::TimerHandle _timeoutTimer;
+		std::vector<utilities::TimerHandle> _scriptTimers;
 #endif
 };
 
@@ -616,16 +618,13 @@ inline void TNPC::allowNpcWarping(NPCWarpType canWarp)
 /**
  * Script Engine
  */
-inline bool TNPC::hasTimerUpdates() const {
-	return (timeout > 0 || !_scriptTimers.empty());
-}
-
 inline bool TNPC::hasScriptEvent(int flag) const {
 	return ((_scriptEventsMask & flag) == flag);
 }
 
 inline void TNPC::setScriptEvents(int mask) {
 	_scriptEventsMask = mask;
+	updateLevelGrid();
 }
 
 inline ScriptExecutionContext& TNPC::getExecutionContext() {
@@ -678,8 +677,17 @@ inline void TNPC::registerNpcUpdates()
 	scriptEngine->RegisterNpcUpdate(this);
 }
 
-inline void TNPC::scheduleEvent(unsigned int timeout, ScriptAction& action) {
-	_scriptTimers.push_back({ timeout, std::move(action) });
+inline void TNPC::scheduleEvent(std::chrono::milliseconds delay, ScriptAction& action) {
+	// Handles of events that already ran are dropped once the list fills up.
+	if (_scriptTimers.size() == _scriptTimers.capacity())
+	{
+		auto scriptEngine = server->getScriptEngine();
+		_scriptTimers.erase(std::remove_if(_scriptTimers.begin(), _scriptTimers.end(), [scriptEngine](const utilities::TimerHandle& handle) {
+			return !scriptEngine->isNpcTimerScheduled(handle);
+		}), _scriptTimers.end());
+	}
+
+	_scriptTimers.push_back(server->getScriptEngine()->ScheduleNpcTimer(this, delay, std::move(action)));
 }
 
 #endif
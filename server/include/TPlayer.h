@@ -3,6 +3,7 @@
 
 #include <time.h>
 #include <map>
+#include <memory>
 #include <set>
 #include <unordered_set>
 #include <vector>
@@ -19,6 +20,7 @@
 class TLevel;
 class TServer;
 class TMap;
+class TUpdatePackage;
 class TWeapon;
 
 enum class LevelItemType;
@@ -37,6 +39,14 @@ struct SCachedLevel
 	time_t modTime;
 };
 
+// A level that is sent once the GS2 scripts of its npcs are compiled.
+struct SPendingLevel
+{
+	TLevel* level;
+	time_t modTime;
+	bool fromAdjacent;
+};
+
 class TPlayer : public TAccount, public CSocketStub
 {
 	public:
@@ -90,6 +100,11 @@ class TPlayer : public TAccount, public CSocketStub
 		bool leaveLevel(bool resetCache = false);
 		time_t getCachedLevelModTime(const TLevel* level) const;
 		void resetLevelCache(const TLevel* level);
+		bool isGmapLevelStreamed(const TLevel* pLevel) const;
+
+		// Levels waiting on their npcs' scripts to compile
+		bool isLevelPending(const TLevel* pLevel) const;
+		void sendPendingLevels();
 
 		// Prop-Manipulation
 		inline CString getProp(int pPropId) const;
@@ -103,9 +118,10 @@ class TPlayer : public TAccount, public CSocketStub
 
 		// Socket-Functions
 		bool doMain();
-		void sendPacket(CString pPacket, bool appendNL = true);
+		virtual void sendPacket(CString pPacket, bool appendNL = true);
 		bool sendFile(const CString& pFile);
 		bool sendFile(const CString& pPath, const CString& pFile);
+		void sendUpdatePackage(const CString& pPackageName, const TUpdatePackage* pPackage, CString pFileChecksums);
 
 		// Type of player
 		bool isAdminIp();
@@ -119,6 +135,7 @@ class TPlayer : public TAccount, public CSocketStub
 		bool isLoaded()	const			{ return loaded; }
 		int getType() const				{ return type; }
 		void setType(int val)			{ type = val; }
+		void setVersion(int val)		{ versionID = val; }
 
 		// Misc functions.
 		bool doTimedEvents();
@@ -156,6 +173,7 @@ class TPlayer : public TAccount, public CSocketStub
 
 		// NPC-Server Functionality
 		void sendNCAddr();
+		void sendScriptStats(size_t count);
 
 		inline IScriptObject<TPlayer> * getScriptObject() const {
 			return _scriptObject.get();
@@ -303,6 +321,7 @@ class TPlayer : public TAccount, public CSocketStub
 
 	private:
 		// Login functions.
+		bool finishLogin(std::unique_ptr<TAccount> pAccount, bool pLoadedFromDefault);
 		bool sendLoginClient();
 		bool sendLoginNC();
 		bool sendLoginRC();
@@ -315,6 +334,11 @@ class TPlayer : public TAccount, public CSocketStub
 		bool testSign();
 		void testTouch();
 
+		// Gmap streaming.
+		void setCachedLevelModTime(TLevel* pLevel, time_t modTime);
+		void updateGmapVisibility();
+		void streamGmapLevel(TLevel* pLevel);
+
 		// Misc.
 		void dropItemsOnDeath();
 		bool spawnLevelItem(CString& pPacket, bool playerDrop = true);
@@ -335,6 +359,8 @@ class TPlayer : public TAccount, public CSocketStub
 		int id, type, versionID;
 		time_t lastData, lastMovement, lastChat, lastNick, lastMessage, lastSave, last1m;
 		std::vector<SCachedLevel*> cachedLevels;
+		std::vector<TLevel*> gmapVisibleLevels;
+		std::vector<SPendingLevel> pendingLevels;
 		std::map<CString, CString> rcLargeFiles;
 		std::map<CString, TLevel*> spLevels;
 		std::set<std::string> channelList;
@@ -345,6 +371,7 @@ class TPlayer : public TAccount, public CSocketStub
 		bool carryNpcThrown;
 		CString guild;
 		bool loaded;
+		unsigned int pendingLogin;
 		bool nextIsRaw;
 		int rawPacketSize;
 		bool isFtp;
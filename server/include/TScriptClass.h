@@ -32,6 +32,7 @@ public:
 private:
 	void parseScripts(TServer *server, const std::string& classSource);
 
+	TServer *_server;
 	std::string _className;
 	SourceCode _source;
 	CString _bytecode;
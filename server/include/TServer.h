@@ -3,6 +3,7 @@
 
 #include <climits>
 #include <chrono>
+#include <functional>
 #include <vector>
 #include <map>
 #include <memory>
@@ -15,7 +16,9 @@
 #include "IEnums.h"
 #include "CString.h"
 #include "CLog.h"
+#include "CFileCache.h"
 #include "CFileSystem.h"
+#include "CFileSystemWatcher.h"
 #include "CSettings.h"
 #include "CSocket.h"
 #include "CTranslationManager.h"
@@ -23,6 +26,7 @@
 #include "TServerList.h"
 
 #include "CommandDispatcher.h"
+#include "TimerWheel.h"
 
 #ifdef UPNP
 #include "CUPNP.h"
@@ -30,6 +34,7 @@
 
 #ifdef V8NPCSERVER
 #include "CScriptEngine.h"
+#include "ScriptProfile.h"
 #endif
 
 #include "GS2ScriptManager.h"
@@ -38,7 +43,11 @@
 // Resources
 #include "ResourceManager.h"
 #include "Animation/TGameAni.h"
-#include "TUpdatePackage.h"
+#include "TUpdatePackageManager.h"
+#include "TAccountIndex.h"
+#include "TAccountLoader.h"
+#include "TAccountWriter.h"
+#include "TFlagList.h"
 
 class TPlayer;
 class TLevel;
@@ -66,8 +75,8 @@ enum
 #define FS_COUNT	7
 
 using AnimationManager = ResourceManager<TGameAni, TServer *>;
-using PackageManager = ResourceManager<TUpdatePackage, TServer *>;
 using TriggerDispatcher = CommandDispatcher<std::string, TPlayer *, std::vector<CString>&>;
+using LevelTimerWheel = utilities::TimerWheel<std::function<void()>>;
 
 class TServer : public CSocketStub
 {
@@ -102,6 +111,7 @@ class TServer : public CSocketStub
 		void loadIPBans();
 		void loadClasses(bool print = false);
 		void loadWeapons(bool print = false);
+		void reloadWeapon(const CString& pFile);
 		void loadMaps(bool print = false);
 		void loadMapLevels();
 #ifdef V8NPCSERVER
@@ -112,12 +122,18 @@ class TServer : public CSocketStub
 
 		void loadAllFolders();
 		void loadFolderConfig();
+		void addFolders(CFileSystem& fs, const char* fsName, const std::vector<std::pair<CString, CString>>& folders);
+		void reloadFile(const CString& pDir, const CString& pFile, bool pIsNewFile);
+		bool recordFileVersion(const CString& pFullPath);
 
 		void saveServerFlags();
 		void saveWeapons();
 #ifdef V8NPCSERVER
 		void saveNpcs();
-		std::vector<std::pair<double, std::string>> calculateNpcStats();
+
+		//! Gets the scripts that took the most execution time in the last minute.
+		//! \param count The number of scripts to get.
+		std::vector<std::pair<ScriptProfile::Summary, std::string>> calculateNpcStats(size_t count);
 #endif
 
 		void reportScriptException(const ScriptRunError& error);
@@ -127,6 +143,10 @@ class TServer : public CSocketStub
 		const CString& getName()						{ return name; }
 		CFileSystem* getFileSystem(int c = 0)			{ return &(filesystem[c]); }
 		CFileSystem* getAccountsFileSystem()			{ return &filesystem_accounts; }
+		TAccountIndex& getAccountIndex()				{ return accountIndex; }
+		TAccountLoader& getAccountLoader()				{ return accountLoader; }
+		TAccountWriter& getAccountWriter()				{ return accountWriter; }
+		CFileCache& getFileCache()						{ return fileCache; }
 		CLog& getNPCLog()								{ return npclog; }
 		CLog& getServerLog()							{ return serverlog; }
 		CLog& getRCLog()								{ return rclog; }
@@ -141,13 +161,14 @@ class TServer : public CSocketStub
 		CWordFilter* getWordFilter()					{ return &wordFilter; }
 		TServerList* getServerList()					{ return &serverlist; }
 		AnimationManager& getAnimationManager()			{ return animationManager; }
-		PackageManager& getPackageManager()				{ return packageManager; }
+		TUpdatePackageManager& getPackageManager()		{ return packageManager; }
+		LevelTimerWheel& getLevelTimers()				{ return levelTimers; }
 		unsigned int getNWTime() const					{ return serverTime; }
 		void calculateServerTime();
 
 		std::unordered_map<std::string, std::unique_ptr<TScriptClass>>& getClassList()	{ return classList; }
 		std::unordered_map<std::string, TNPC *>* getNPCNameList()		{ return &npcNameList; }
-		std::unordered_map<std::string, CString>* getServerFlags()		{ return &mServerFlags; }
+		TFlagList* getServerFlags()										{ return &mServerFlags; }
 		std::map<CString, TWeapon *>* getWeaponList()	{ return &weaponList; }
 		std::vector<TPlayer *>* getPlayerList()			{ return &playerList; }
 		std::vector<TNPC *>* getNPCList()				{ return &npcList; }
@@ -234,6 +255,8 @@ class TServer : public CSocketStub
 		void compileGS2Script(TNPC *npc, GS2ScriptManager::user_callback_type cb);
 		void compileGS2Script(TWeapon *weapon, GS2ScriptManager::user_callback_type cb);
 		void compileGS2Script(TScriptClass *cls, GS2ScriptManager::user_callback_type cb);
+		bool isCompilingGS2(const void *scriptObject) const		{ return gs2ScriptManager.isCompiling(scriptObject); }
+		void cancelGS2Compile(const void *scriptObject)			{ gs2ScriptManager.cancelCompile(scriptObject); }
 
 		std::time_t getServerStartTime() const {
 			return serverStartTime;
@@ -249,15 +272,33 @@ class TServer : public CSocketStub
 		template<typename ScriptObjType>
 		void compileScript(ScriptObjType& obj, GS2ScriptManager::user_callback_type& cb);
 
+		// Sends scripts that finished compiling in the background to the players that have them
+		void sendCompiledGS2Script(TNPC& npc);
+		void sendCompiledGS2Script(TWeapon& weapon);
+		void sendCompiledGS2Script(TScriptClass& cls);
+
 		void handleGS2Errors(const std::vector<GS2CompilerError>& errors, const std::string& origin);
 
 	private:
 		bool doTimedEvents();
 		void cleanupDeletedPlayers();
+		void handleFileChanges();
+		void resyncFileSystems();
+		void updateFileWatches();
+		void addWeapon(TWeapon* weapon, bool print);
 
 		bool doRestart;
 
+		// Respawns and timeouts of level objects, ticked once per second.  Declared before
+		// anything that can own levels so it outlives them.
+		LevelTimerWheel levelTimers;
+
+		std::shared_ptr<CFileIndex> fileIndex;
 		CFileSystem filesystem[FS_COUNT], filesystem_accounts;
+		CFileSystemWatcher fileWatcher;
+		CFileCache fileCache;
+		bool fileWatchesComplete;
+		std::unordered_map<std::string, std::pair<time_t, long long>> reloadedFiles;
 		CLog npclog, rclog, serverlog, scriptlog; //("logs/npclog|rclog|serverlog|scriptlog.txt");
 		CSettings adminsettings, settings;
 		CSocket playerSock;
@@ -267,9 +308,12 @@ class TServer : public CSocketStub
 		CWordFilter wordFilter;
 		CString overrideIP, overrideLocalIP, overridePort, overrideInterface;
 		AnimationManager animationManager;
-		PackageManager packageManager;
+		TUpdatePackageManager packageManager;
+		TAccountIndex accountIndex;
+		TAccountLoader accountLoader;
+		TAccountWriter accountWriter;
 
-		std::unordered_map<std::string, CString> mServerFlags;
+		TFlagList mServerFlags;
 		std::map<CString, TWeapon *> weaponList;
 		std::map<CString, std::map<CString, TLevel*> > groupLevels;
 		std::unordered_map<std::string, std::unique_ptr<TScriptClass>> classList;
@@ -2,11 +2,16 @@
 #define GS2EMU_UPDATEPACKAGE_H
 
 #include <cstdint>
+#include <ctime>
 #include <optional>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
-class TServer;
+class CFileCache;
+class CFileSystem;
+class CString;
 
 class TUpdatePackage
 {
@@ -15,6 +20,7 @@ public:
 	{
 		uint32_t size;
 		uint32_t checksum;
+		time_t modTime;
 	};
 	
 	using FileList = std::unordered_map<std::string, FileEntry>;
@@ -42,20 +48,37 @@ public:
 	//! \return hashmap of referenced files, and their size/crc32 checksum
 	const FileList& getFileList() const;
 	
+	//! Get the files referenced by this package that could not be found
+	//! \return filenames of the missing files
+	const std::vector<std::string>& getMissingFiles() const;
+	
 	//! Compare a checksum against the packages checksum
 	//! \param check crc32 checksum
 	//! \return true if the checksums match
 	bool compareChecksum(uint32_t check) const;
 	
-	//! Load an UpdatePackage from the filesystem
+	//! Load an UpdatePackage from the filesystem.  The size, checksum and modification time of
+	//! every referenced file is kept in a manifest next to the package (.name.manifest), so only
+	//! the files that changed since the manifest was written have to be read again.
+	//! Doesn't touch any server state, so it can be called from any thread.
 	//! \param fileSystem CFileSystem where the package file could be located
 	//! \param name filename of the package (ex: base_package.gupd)
+	//! \param previous an earlier version of the package whose entries can be reused instead of the manifest
+	//! \param changedFiles files that have to be read again even if they look unchanged
+	//! \param fileCache cache the files are read through, so they are already loaded when clients ask for them
 	//! \return UpdatePackage if it was successfully loaded, otherwise a nullopt
-	static std::optional<TUpdatePackage> load(TServer* const server, const std::string& name);
+	static std::optional<TUpdatePackage> load(const CFileSystem& fileSystem, const std::string& name,
+	                                          const TUpdatePackage* previous = nullptr,
+	                                          const std::unordered_set<std::string>& changedFiles = {},
+	                                          CFileCache* fileCache = nullptr);
 
 private:
+	bool loadManifest(const CString& path);
+	bool saveManifest(const CString& path) const;
+
 	std::string packageName;
 	std::unordered_map<std::string, FileEntry> fileList;
+	std::vector<std::string> missingFiles;
 	uint32_t checksum;
 	uint32_t packageSize;
 };
@@ -68,6 +91,7 @@ inline TUpdatePackage::TUpdatePackage(std::string packageName)
 
 inline TUpdatePackage::TUpdatePackage(TUpdatePackage&& o) noexcept
 	: packageName(std::move(o.packageName)), fileList(std::move(o.fileList)),
+	  missingFiles(std::move(o.missingFiles)),
 	  checksum(o.checksum), packageSize(o.packageSize)
 {
 }
@@ -76,6 +100,7 @@ inline TUpdatePackage& TUpdatePackage::operator=(TUpdatePackage&& o) noexcept
 {
 	packageName = std::move(o.packageName);
 	fileList = std::move(o.fileList);
+	missingFiles = std::move(o.missingFiles);
 	checksum = o.checksum;
 	packageSize = o.packageSize;
 	return *this;
@@ -91,6 +116,11 @@ inline const TUpdatePackage::FileList& TUpdatePackage::getFileList() const
 	return fileList;
 }
 
+inline const std::vector<std::string>& TUpdatePackage::getMissingFiles() const
+{
+	return missingFiles;
+}
+
 inline uint32_t TUpdatePackage::getPackageSize() const
 {
 	return packageSize;
@@ -0,0 +1,114 @@
+#ifndef GS2EMU_UPDATEPACKAGEMANAGER_H
+#define GS2EMU_UPDATEPACKAGEMANAGER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "TUpdatePackage.h"
+
+class CFileCache;
+class CFileSystem;
+
+//! Loads update packages on a background thread, and keeps them up to date as the
+//! files they reference change.  Everything except the worker itself runs on the
+//! game thread, which picks up finished packages through update().
+class TUpdatePackageManager
+{
+	using PackagePtr = std::shared_ptr<const TUpdatePackage>;
+	using ReadyCallback = std::function<void(const PackagePtr&)>;
+
+public:
+	//! \param pFileSystem file system used to find packages and the files they reference
+	//! \param pFileCache cache the referenced files are read through, or nullptr to read them directly
+	explicit TUpdatePackageManager(CFileSystem* pFileSystem, CFileCache* pFileCache = nullptr);
+	~TUpdatePackageManager();
+	
+	// Delete copy and move operations
+	TUpdatePackageManager(const TUpdatePackageManager&) = delete;
+	TUpdatePackageManager& operator=(const TUpdatePackageManager&) = delete;
+	
+	//! Load a package in the background, or load it again if it was already loaded
+	//! \param packageName filename of the package (ex: base_package.gupd)
+	void queue(const std::string& packageName);
+	
+	//! Load every package again, for when file changes might have been missed
+	void queueAll();
+	
+	//! Call a function once a package is up to date.  Called right away if it already is.
+	//! \param packageName filename of the package
+	//! \param callback receives the package, or nullptr if it couldn't be loaded
+	void whenReady(const std::string& packageName, ReadyCallback callback);
+	
+	//! Get a package that is up to date
+	//! \param packageName filename of the package
+	//! \return the package, or nullptr if it is still loading or couldn't be loaded
+	PackagePtr find(const std::string& packageName) const;
+	
+	//! Reload the packages that reference a file, or the package itself
+	//! \param fileName filename of the changed file
+	void fileChanged(const std::string& fileName);
+	
+	//! Pick up the packages the worker has finished, and call anything waiting on them
+	void update();
+	
+	//! Check if any package is still loading
+	bool isBusy() const;
+	
+	//! Get the number of packages that are loaded or loading
+	size_t getPackageCount() const			{ return packages.size(); }
+
+private:
+	struct Package
+	{
+		PackagePtr package;
+		bool ready = false;
+		bool loading = false;
+		bool stale = false;
+		std::unordered_set<std::string> changedFiles;
+		std::vector<ReadyCallback> waiting;
+	};
+	
+	struct Job
+	{
+		std::string packageName;
+		PackagePtr previous;
+		std::unordered_set<std::string> changedFiles;
+	};
+	
+	struct Result
+	{
+		std::string packageName;
+		std::optional<TUpdatePackage> package;
+	};
+	
+	void startJob(const std::string& packageName, Package& entry);
+	void finishJob(Result& result);
+	void setReferences(const std::string& packageName, const PackagePtr& previous, const PackagePtr& current);
+	void runWorker();
+	
+	CFileSystem* fileSystem;
+	CFileCache* fileCache;
+	std::unordered_map<std::string, Package> packages;
+	
+	// Packages that reference each file
+	std::unordered_map<std::string, std::unordered_set<std::string>> references;
+	
+	// Shared with the worker
+	mutable std::mutex queueLock;
+	std::condition_variable queueCondition;
+	std::deque<Job> jobs;
+	std::deque<Result> results;
+	size_t pendingJobs;
+	bool running;
+	std::thread worker;
+};
+
+#endif //GS2EMU_UPDATEPACKAGEMANAGER_H
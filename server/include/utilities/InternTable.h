@@ -0,0 +1,58 @@
+#ifndef UTILITIES_INTERNTABLE_H
+#define UTILITIES_INTERNTABLE_H
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "CString.h"
+
+namespace utilities
+{
+	//! Keeps one copy of each string it is given, and names it by a small id that stays the same
+	//! for as long as the table is around.  Strings are never removed.
+	//! Safe to use from any thread.
+	class InternTable
+	{
+	public:
+		static constexpr uint32_t InvalidId = UINT32_MAX;
+
+		InternTable() = default;
+
+		// Delete copy operations
+		InternTable(const InternTable&) = delete;
+		InternTable& operator=(const InternTable&) = delete;
+
+		//! Gets the id of a string, adding it to the table if it isn't there yet.
+		uint32_t intern(std::string_view str);
+
+		//! Gets the id of a string without adding it.
+		//! \return The id, or InvalidId if the string was never interned.
+		uint32_t find(std::string_view str) const;
+
+		//! Gets the string an id was given to.
+		const CString& get(uint32_t id) const;
+
+		//! Gets the amount of strings in the table.
+		size_t size() const;
+
+	private:
+		// Lets strings be looked up without copying them into a std::string first.
+		struct Hash
+		{
+			using is_transparent = void;
+			size_t operator()(std::string_view str) const { return std::hash<std::string_view>{}(str); }
+		};
+
+		mutable std::shared_mutex lock;
+		std::unordered_map<std::string, uint32_t, Hash, std::equal_to<>> ids;
+		std::deque<CString> strings;
+	};
+}
+
+#endif
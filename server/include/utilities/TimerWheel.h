@@ -0,0 +1,282 @@
+#ifndef UTILITIES_TIMERWHEEL_H
+#define UTILITIES_TIMERWHEEL_H
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace utilities
+{
+	//! Identifies a timer scheduled on a TimerWheel.  Handles of timers that have fired or
+	//! been cancelled are detected through the generation, so stale handles are harmless.
+	struct TimerHandle
+	{
+		uint32_t index = UINT32_MAX;
+		uint32_t generation = 0;
+
+		bool isSet() const { return index != UINT32_MAX; }
+		void reset() { index = UINT32_MAX; generation = 0; }
+	};
+
+	//! Hierarchical timing wheel keyed by absolute deadline ticks.
+	//! Each level has 2^SlotBits slots; level N holds timers that expire within 2^(SlotBits * (N + 1))
+	//! ticks and cascades them down a level as time reaches them.  Advancing only touches the
+	//! timers that expire and the slots that cascade, and an empty wheel costs nothing.
+	//! Scheduling and cancelling are O(1).
+	template<typename Payload, unsigned int Levels = 4, unsigned int SlotBits = 6>
+	class TimerWheel
+	{
+		static_assert(Levels > 0 && SlotBits > 0 && Levels * SlotBits < 64);
+
+	public:
+		using Tick = uint64_t;
+
+		explicit TimerWheel(Tick startTick = 0) : currentTick(startTick), activeCount(0), freeHead(InvalidIndex)
+		{
+			slotHeads.fill(InvalidIndex);
+		}
+
+		// Delete copy operations
+		TimerWheel(const TimerWheel&) = delete;
+		TimerWheel& operator=(const TimerWheel&) = delete;
+
+		//! Gets the tick the wheel has advanced to.
+		Tick getCurrentTick() const { return currentTick; }
+
+		//! Gets the amount of scheduled timers.
+		size_t size() const { return activeCount; }
+		bool empty() const { return activeCount == 0; }
+
+		//! Schedules a timer.  Deadlines that are not in the future fire on the next tick.
+		//! \param deadline The tick the timer expires at.
+		//! \param payload The payload passed to the advance() callback when it expires.
+		//! \return A handle to cancel the timer with.
+		TimerHandle schedule(Tick deadline, Payload payload)
+		{
+			uint32_t index = allocNode();
+			Node& node = nodes[index];
+			node.deadline = (deadline > currentTick ? deadline : currentTick + 1);
+			node.payload.emplace(std::move(payload));
+			insertNode(index);
+			++activeCount;
+
+			return TimerHandle{ index, node.generation };
+		}
+
+		//! Cancels a scheduled timer and resets the handle.
+		//! \return True if the timer was still scheduled.
+		bool cancel(TimerHandle& handle)
+		{
+			bool scheduled = isScheduled(handle);
+			if (scheduled)
+			{
+				unlinkNode(handle.index);
+				freeNode(handle.index);
+				--activeCount;
+			}
+
+			handle.reset();
+			return scheduled;
+		}
+
+		//! Checks if the handle refers to a timer that has not yet fired or been cancelled.
+		bool isScheduled(const TimerHandle& handle) const
+		{
+			return handle.index < nodes.size() && nodes[handle.index].generation == handle.generation
+				&& nodes[handle.index].payload.has_value();
+		}
+
+		//! Gets the deadline of a scheduled timer.
+		std::optional<Tick> getDeadline(const TimerHandle& handle) const
+		{
+			if (!isScheduled(handle))
+				return std::nullopt;
+			return nodes[handle.index].deadline;
+		}
+
+		//! Advances the wheel up to the specified tick, firing every timer that expires on the way.
+		//! The callback may schedule and cancel timers, including the one being fired.
+		//! \param tick The tick to advance to.
+		//! \param fn Called as fn(Payload&) for every expired timer, in deadline order.
+		//! \return The amount of timers fired.
+		template<typename Fn>
+		size_t advance(Tick tick, Fn&& fn)
+		{
+			size_t fired = 0;
+			while (currentTick < tick)
+			{
+				// Nothing to fire, so jump straight to the target tick.
+				if (activeCount == 0)
+				{
+					currentTick = tick;
+					break;
+				}
+
+				++currentTick;
+				cascade();
+
+				uint32_t& head = slotHeads[currentTick & SlotMask];
+				while (head != InvalidIndex)
+				{
+					uint32_t index = head;
+					unlinkNode(index);
+
+					Payload payload(std::move(*nodes[index].payload));
+					freeNode(index);
+					--activeCount;
+					++fired;
+
+					fn(payload);
+				}
+			}
+
+			return fired;
+		}
+
+		//! Cancels every timer.
+		//! The nodes are kept and freed like any cancelled timer, so handles from before the clear stay stale.
+		void clear()
+		{
+			overflow = InvalidIndex;
+			freeHead = InvalidIndex;
+			slotHeads.fill(InvalidIndex);
+			activeCount = 0;
+
+			for (uint32_t index = (uint32_t)nodes.size(); index-- > 0;)
+			{
+				if (nodes[index].payload.has_value())
+					freeNode(index);
+				else
+				{
+					nodes[index].next = freeHead;
+					freeHead = index;
+				}
+			}
+		}
+
+	private:
+		static constexpr uint32_t InvalidIndex = UINT32_MAX;
+		static constexpr uint32_t SlotCount = 1u << SlotBits;
+		static constexpr Tick SlotMask = SlotCount - 1;
+		static constexpr uint32_t OverflowSlot = Levels * SlotCount;
+
+		struct Node
+		{
+			Tick deadline = 0;
+			std::optional<Payload> payload;
+			uint32_t prev = InvalidIndex;
+			uint32_t next = InvalidIndex;
+			uint32_t slot = InvalidIndex;
+			uint32_t generation = 0;
+		};
+
+		uint32_t allocNode()
+		{
+			if (freeHead != InvalidIndex)
+			{
+				uint32_t index = freeHead;
+				freeHead = nodes[index].next;
+				nodes[index].next = InvalidIndex;
+				return index;
+			}
+
+			nodes.emplace_back();
+			return (uint32_t)(nodes.size() - 1);
+		}
+
+		void freeNode(uint32_t index)
+		{
+			Node& node = nodes[index];
+			node.payload.reset();
+			node.slot = InvalidIndex;
+			node.prev = InvalidIndex;
+			node.next = freeHead;
+			++node.generation;
+			freeHead = index;
+		}
+
+		uint32_t& headOf(uint32_t slot)
+		{
+			return (slot == OverflowSlot ? overflow : slotHeads[slot]);
+		}
+
+		void insertNode(uint32_t index)
+		{
+			Node& node = nodes[index];
+
+			// Place the timer in the lowest level that shares every higher bit with the current tick.
+			uint32_t slot = OverflowSlot;
+			for (unsigned int level = 0; level < Levels; ++level)
+			{
+				unsigned int shift = SlotBits * (level + 1);
+				if ((node.deadline >> shift) == (currentTick >> shift))
+				{
+					slot = level * SlotCount + (uint32_t)((node.deadline >> (SlotBits * level)) & SlotMask);
+					break;
+				}
+			}
+
+			uint32_t& head = headOf(slot);
+			node.slot = slot;
+			node.prev = InvalidIndex;
+			node.next = head;
+			if (head != InvalidIndex)
+				nodes[head].prev = index;
+			head = index;
+		}
+
+		void unlinkNode(uint32_t index)
+		{
+			Node& node = nodes[index];
+			if (node.prev != InvalidIndex)
+				nodes[node.prev].next = node.next;
+			else headOf(node.slot) = node.next;
+
+			if (node.next != InvalidIndex)
+				nodes[node.next].prev = node.prev;
+
+			node.prev = node.next = InvalidIndex;
+		}
+
+		void relink(uint32_t& head)
+		{
+			uint32_t index = head;
+			head = InvalidIndex;
+			while (index != InvalidIndex)
+			{
+				uint32_t next = nodes[index].next;
+				insertNode(index);
+				index = next;
+			}
+		}
+
+		void cascade()
+		{
+			// Timers beyond the range of the wheel are re-placed every time the top level wraps.
+			constexpr Tick rangeMask = (Tick(1) << (SlotBits * Levels)) - 1;
+			if ((currentTick & rangeMask) == 0)
+				relink(overflow);
+
+			// Cascade from the highest level that reached a slot boundary down to level 1.
+			for (unsigned int level = Levels - 1; level > 0; --level)
+			{
+				Tick lowMask = (Tick(1) << (SlotBits * level)) - 1;
+				if ((currentTick & lowMask) == 0)
+					relink(slotHeads[level * SlotCount + ((currentTick >> (SlotBits * level)) & SlotMask)]);
+			}
+		}
+
+		std::vector<Node> nodes;
+		std::array<uint32_t, Levels * SlotCount> slotHeads;
+		uint32_t overflow = InvalidIndex;
+		Tick currentTick;
+		size_t activeCount;
+		uint32_t freeHead;
+	};
+}
+
+#endif
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include "CString.h"
 
@@ -11,6 +12,9 @@ namespace utilities
 {
 	std::string retokenizeArray(const std::vector<CString>& triggerData, int start_idx = 0);
 	CString retokenizeCStringArray(const std::vector<CString>& triggerData, int start_idx = 0);
+
+	//! Views the text of a CString without copying it.
+	inline std::string_view toStringView(const CString& str) { return std::string_view(str.text(), str.length()); }
 }
 
 #endif
@@ -0,0 +1,676 @@
+#include <sys/stat.h>
+#if defined(_WIN32) || defined(_WIN64)
+	#include <windows.h>
+#else
+	#include <dirent.h>
+	#include <fcntl.h>
+#endif
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <thread>
+#include "CFileIndex.h"
+#include "CFileSystem.h"
+
+static constexpr char fSep = CFileSystem::getPathSeparator();
+
+// Gets the key that every spelling of a file name shares in the case-insensitive index.
+static std::string foldCase(const CString& file)
+{
+	std::string folded(file.text(), file.length());
+	for (auto& c : folded)
+		c = (char)tolower((unsigned char)c);
+	return folded;
+}
+
+CFileIndex::CFileIndex()
+: index(std::make_shared<Index>())
+{
+}
+
+size_t CFileIndex::Index::shardOf(const std::string& folded)
+{
+	return std::hash<std::string>()(folded) % ShardCount;
+}
+
+const CFileIndex::Shard& CFileIndex::Index::getShard(size_t shard) const
+{
+	static const Shard empty;
+	return (shards[shard] ? *shards[shard] : empty);
+}
+
+CFileIndex::Shard& CFileIndex::Index::editShard(size_t shard)
+{
+	// Shards that other copies of the index still use are copied before they are changed.
+	auto& current = shards[shard];
+	if (!current)
+		current = std::make_shared<Shard>();
+	else if (current.use_count() > 1)
+		current = std::make_shared<Shard>(*current);
+	return *current;
+}
+
+uint32_t CFileIndex::Index::intern(const CString& directory)
+{
+	auto it = directories->ids.find(directory.toString());
+	if (it != directories->ids.end())
+		return it->second;
+
+	if (directories.use_count() > 1)
+		directories = std::make_shared<Directories>(*directories);
+
+	auto id = (uint32_t)directories->paths.size();
+	directories->ids.emplace(directory.toString(), id);
+	directories->paths.push_back(directory);
+	return id;
+}
+
+void CFileIndex::Index::set(const CString& file, uint32_t directory, unsigned int category)
+{
+	uint32_t bit = 1u << category;
+	std::string foldedName = foldCase(file);
+	Shard& shard = editShard(shardOf(foldedName));
+	auto result = shard.files.try_emplace(file);
+	if (result.second)
+	{
+		auto folded = shard.foldedFiles.emplace(std::move(foldedName), FoldedFile{ file, 0 });
+		FoldedFile& entry = folded.first->second;
+		if (file < entry.file)
+			entry.file = file;
+		++entry.count;
+		++fileCount;
+	}
+
+	// A file is only taken from one directory per category.
+	auto& locations = result.first->second;
+	bool found = false;
+	for (auto it = locations.begin(); it != locations.end();)
+	{
+		if (it->directory == directory)
+		{
+			it->categories |= bit;
+			found = true;
+		}
+		else if ((it->categories &= ~bit) == 0)
+		{
+			it = locations.erase(it);
+			continue;
+		}
+		++it;
+	}
+
+	if (!found)
+		locations.push_back(Location{ directory, bit });
+	usedCategories |= bit;
+}
+
+void CFileIndex::Index::erase(const CString& file, unsigned int category)
+{
+	size_t shardId = shardOf(foldCase(file));
+	const auto& files = getShard(shardId).files;
+	auto found = files.find(file);
+	if (found == files.end() || locate(found->second, category) == nullptr)
+		return;
+
+	Shard& shard = editShard(shardId);
+	auto it = shard.files.find(file);
+	uint32_t bit = 1u << category;
+	auto& locations = it->second;
+	for (auto loc = locations.begin(); loc != locations.end();)
+	{
+		if ((loc->categories &= ~bit) == 0)
+			loc = locations.erase(loc);
+		else ++loc;
+	}
+
+	if (locations.empty())
+		removeName(shard, it);
+}
+
+void CFileIndex::Index::eraseCategory(unsigned int category)
+{
+	uint32_t bit = 1u << category;
+	if (!(usedCategories & bit))
+		return;
+
+	for (size_t shardId = 0; shardId < ShardCount; ++shardId)
+	{
+		// Only the shards that have files in the category are copied.
+		const auto& files = getShard(shardId).files;
+		bool used = std::any_of(files.begin(), files.end(), [bit](const auto& entry) {
+			return std::any_of(entry.second.begin(), entry.second.end(), [bit](const Location& loc) { return (loc.categories & bit) != 0; });
+		});
+		if (!used)
+			continue;
+
+		Shard& shard = editShard(shardId);
+		for (auto it = shard.files.begin(); it != shard.files.end();)
+		{
+			auto& locations = it->second;
+			for (auto loc = locations.begin(); loc != locations.end();)
+			{
+				if ((loc->categories &= ~bit) == 0)
+					loc = locations.erase(loc);
+				else ++loc;
+			}
+
+			if (locations.empty())
+				it = removeName(shard, it);
+			else ++it;
+		}
+	}
+
+	usedCategories &= ~bit;
+}
+
+CFileIndex::FileMap::iterator CFileIndex::Index::removeName(Shard& shard, FileMap::iterator it)
+{
+	CString file = it->first;
+	auto next = shard.files.erase(it);
+	--fileCount;
+
+	auto folded = shard.foldedFiles.find(foldCase(file));
+	if (folded == shard.foldedFiles.end())
+		return next;
+
+	FoldedFile& entry = folded->second;
+	if (--entry.count == 0)
+	{
+		shard.foldedFiles.erase(folded);
+		return next;
+	}
+
+	// Another spelling of the name is left.  This is rare, so just look for it.
+	if (entry.file == file)
+	{
+		for (auto i = shard.files.begin(); i != shard.files.end(); ++i)
+		{
+			if (i->first.comparei(file))
+			{
+				entry.file = i->first;
+				break;
+			}
+		}
+	}
+	return next;
+}
+
+const CFileIndex::Location* CFileIndex::Index::locate(const std::vector<Location>& locations, unsigned int category)
+{
+	uint32_t bit = 1u << category;
+	for (const auto& loc : locations)
+	{
+		if (loc.categories & bit)
+			return &loc;
+	}
+	return nullptr;
+}
+
+const CFileIndex::Location* CFileIndex::Index::find(const CString& file, unsigned int category) const
+{
+	const auto& files = getShard(shardOf(foldCase(file))).files;
+	auto it = files.find(file);
+	return (it != files.end() ? locate(it->second, category) : nullptr);
+}
+
+CString CFileIndex::Index::getPath(const CString& file, unsigned int category) const
+{
+	const Location* loc = find(file, category);
+	if (loc == nullptr)
+		return CString();
+
+	return CString(getDirectory(loc->directory)) << file;
+}
+
+void CFileIndex::clear()
+{
+	std::lock_guard<std::recursive_mutex> lock(changeLock);
+
+	publish(std::make_shared<Index>());
+	for (auto& dirList : dirLists)
+		dirList.clear();
+}
+
+void CFileIndex::clear(unsigned int category)
+{
+	std::lock_guard<std::recursive_mutex> lock(changeLock);
+
+	dirLists[category].clear();
+
+	auto current = getIndex();
+	if (!(current->usedCategories & (1u << category)))
+		return;
+
+	auto updated = std::make_shared<Index>(*current);
+	updated->eraseCategory(category);
+	publish(std::move(updated));
+}
+
+void CFileIndex::addDirs(unsigned int category, const std::vector<CString>& dirs, bool recursive, bool forceRecursive)
+{
+	std::lock_guard<std::recursive_mutex> lock(changeLock);
+
+	auto& dirList = dirLists[category];
+	size_t first = dirList.size();
+	bool exists = false;
+	for (const auto& dir : dirs)
+	{
+		auto pos = std::find(dirList.begin(), dirList.end(), dir);
+		if (pos == dirList.end())
+			dirList.push_back(dir);
+		else if ((size_t)(pos - dirList.begin()) < first)
+			exists = true;
+	}
+
+	if (exists)
+		resync(recursive);
+	else if (first != dirList.size())
+	{
+		// Load up the files in the new directories.
+		auto updated = std::make_shared<Index>(*getIndex());
+		loadDirectories(*updated, { std::make_pair(category, first) }, recursive || forceRecursive);
+		publish(std::move(updated));
+	}
+}
+
+void CFileIndex::addFile(unsigned int category, const CString& path)
+{
+	addFiles(category, { path });
+}
+
+void CFileIndex::addFiles(unsigned int category, const std::vector<CString>& paths)
+{
+	std::lock_guard<std::recursive_mutex> lock(changeLock);
+
+	// Every file goes into the same copy, which is published once.
+	auto updated = std::make_shared<Index>(*getIndex());
+	for (const auto& path : paths)
+	{
+		int pos = path.findl(fSep);
+		updated->set(path.subString(pos + 1), updated->intern(path.subString(0, pos + 1)), category);
+	}
+	publish(std::move(updated));
+}
+
+void CFileIndex::removeFile(unsigned int category, const CString& file)
+{
+	std::lock_guard<std::recursive_mutex> lock(changeLock);
+
+	auto current = getIndex();
+	if (current->find(file, category) == nullptr)
+		return;
+
+	auto updated = std::make_shared<Index>(*current);
+	updated->erase(file, category);
+	publish(std::move(updated));
+}
+
+void CFileIndex::resync(bool recursive)
+{
+	std::lock_guard<std::recursive_mutex> lock(changeLock);
+
+	// Build the new index on the side.  Lookups keep using the old one until it is done.
+	std::vector<std::pair<unsigned int, size_t>> firstDirs;
+	for (unsigned int category = 0; category < MaxCategories; ++category)
+	{
+		if (!dirLists[category].empty())
+			firstDirs.emplace_back(category, 0);
+	}
+
+	auto updated = std::make_shared<Index>();
+	loadDirectories(*updated, firstDirs, recursive);
+	publish(std::move(updated));
+}
+
+CString CFileIndex::resolveDirectory(unsigned int category, const CString& file, std::unordered_map<std::string, bool>& existing) const
+{
+	// Resolve the file the same way a resync would, where the last directory it is found in wins.
+	const auto& dirList = dirLists[category];
+	for (auto i = dirList.rbegin(); i != dirList.rend(); ++i)
+	{
+		int pos = i->findl(fSep);
+		if (!file.match(i->subString(pos + 1)))
+			continue;
+
+		// Categories often share directories, so each path is only checked once.
+		CString directory = i->subString(0, pos + 1);
+		CString fileName = CString() << directory << file;
+		auto result = existing.try_emplace(fileName.toString(), false);
+		if (result.second)
+		{
+			struct stat fileStat;
+			result.first->second = (stat(fileName.text(), &fileStat) != -1 && !(fileStat.st_mode & S_IFDIR));
+		}
+
+		if (result.first->second)
+			return directory;
+	}
+
+	return CString();
+}
+
+void CFileIndex::syncFiles(const std::vector<CFileChange>& changes)
+{
+	std::lock_guard<std::recursive_mutex> lock(changeLock);
+
+	// The index is only copied once something actually changed, and every change goes into
+	// that one copy.  Files that were rewritten in place usually don't change anything.
+	auto current = getIndex();
+	std::shared_ptr<Index> updated;
+	std::unordered_map<std::string, bool> existing;
+	for (const auto& change : changes)
+	{
+		const CString& file = change.file;
+		if (file.isEmpty() || file[0] == '.')
+			continue;
+
+		for (unsigned int category = 0; category < MaxCategories; ++category)
+		{
+			// Only changes in one of the category's directories that match its wildcard belong in it.
+			const auto& dirList = dirLists[category];
+			bool matched = false;
+			for (auto i = dirList.begin(); i != dirList.end() && !matched; ++i)
+			{
+				int pos = i->findl(fSep);
+				matched = (i->subString(0, pos + 1) == change.directory && file.match(i->subString(pos + 1)));
+			}
+			if (!matched) continue;
+
+			const Index& view = (updated ? *updated : *current);
+			const Location* loc = view.find(file, category);
+
+			CString directory = resolveDirectory(category, file, existing);
+			if (directory.isEmpty() ? loc == nullptr : (loc != nullptr && view.getDirectory(loc->directory) == directory))
+				continue;
+
+			if (!updated)
+				updated = std::make_shared<Index>(*current);
+
+			if (directory.isEmpty())
+				updated->erase(file, category);
+			else
+				updated->set(file, updated->intern(directory), category);
+		}
+	}
+
+	if (updated)
+		publish(std::move(updated));
+}
+
+CString CFileIndex::find(unsigned int category, const CString& file) const
+{
+	return getIndex()->getPath(file, category);
+}
+
+CString CFileIndex::findFolded(unsigned int category, const CString& file, CString* path) const
+{
+	auto current = getIndex();
+	std::string foldedName = foldCase(file);
+	const Shard& shard = current->getShard(Index::shardOf(foldedName));
+	auto folded = shard.foldedFiles.find(foldedName);
+	if (folded == shard.foldedFiles.end())
+		return CString();
+
+	auto it = shard.files.find(folded->second.file);
+	const Location* loc = (it != shard.files.end() ? Index::locate(it->second, category) : nullptr);
+
+	// The first spelling isn't in this category.  Other spellings are rare, so just look for them.
+	if (loc == nullptr && folded->second.count > 1)
+	{
+		for (auto i = shard.files.begin(); i != shard.files.end(); ++i)
+		{
+			if (i->first.comparei(file) && (loc = Index::locate(i->second, category)) != nullptr)
+			{
+				it = i;
+				break;
+			}
+		}
+	}
+
+	if (loc == nullptr)
+		return CString();
+
+	if (path != nullptr)
+		*path = CString(current->getDirectory(loc->directory)) << it->first;
+	return it->first;
+}
+
+CString CFileIndex::findi(unsigned int category, const CString& file) const
+{
+	CString path;
+	findFolded(category, file, &path);
+	return path;
+}
+
+CString CFileIndex::fileExistsAs(unsigned int category, const CString& file) const
+{
+	return findFolded(category, file, nullptr);
+}
+
+std::shared_ptr<const CFileIndex::FileList> CFileIndex::getFileList(unsigned int category) const
+{
+	// Readers can race to build the same list.  Whichever is stored last is kept.
+	auto current = getIndex();
+	auto& cached = current->fileLists.lists[category];
+	auto fileList = std::atomic_load_explicit(&cached, std::memory_order_acquire);
+	if (fileList)
+		return fileList;
+
+	auto built = std::make_shared<FileList>();
+	for (size_t shardId = 0; shardId < Index::ShardCount; ++shardId)
+	{
+		for (const auto& [file, locations] : current->getShard(shardId).files)
+		{
+			const Location* loc = Index::locate(locations, category);
+			if (loc != nullptr)
+				built->emplace(file, CString(current->getDirectory(loc->directory)) << file);
+		}
+	}
+
+	fileList = std::move(built);
+	std::atomic_store_explicit(&cached, fileList, std::memory_order_release);
+	return fileList;
+}
+
+std::vector<CString> CFileIndex::getDirList(unsigned int category) const
+{
+	std::lock_guard<std::recursive_mutex> lock(changeLock);
+	return dirLists[category];
+}
+
+size_t CFileIndex::getFileCount(unsigned int category) const
+{
+	auto current = getIndex();
+	size_t count = 0;
+	for (size_t shardId = 0; shardId < Index::ShardCount; ++shardId)
+	{
+		for (const auto& [file, locations] : current->getShard(shardId).files)
+		{
+			if (Index::locate(locations, category) != nullptr)
+				++count;
+		}
+	}
+	return count;
+}
+
+void CFileIndex::loadDirectories(Index& target, const std::vector<std::pair<unsigned int, size_t>>& firstDirs, bool recursive)
+{
+	// Read every directory of every category up front, then add them to the index in order.
+	// Directories found while adding are added to the end of the list and loaded right away,
+	// so where a file is in more than one directory, the last one still wins.
+	std::vector<std::string> paths;
+	for (const auto& [category, first] : firstDirs)
+	{
+		const auto& dirList = dirLists[category];
+		for (size_t i = first; i < dirList.size(); ++i)
+			paths.push_back(dirList[i].subString(0, dirList[i].findl(fSep) + 1).toString());
+	}
+
+	ScanResults scanned = scanDirectories(paths, recursive);
+
+	for (const auto& [category, first] : firstDirs)
+	{
+		auto& dirList = dirLists[category];
+		std::unordered_set<std::string> knownDirs;
+		for (const auto& dir : dirList)
+			knownDirs.insert(dir.toString());
+
+		for (size_t i = first, count = dirList.size(); i < count; ++i)
+			mergeDirectory(target, category, scanned, knownDirs, CString(dirList[i]), recursive);
+	}
+}
+
+void CFileIndex::mergeDirectory(Index& target, unsigned int category, const ScanResults& scanned, std::unordered_set<std::string>& knownDirs, const CString& directory, bool recursive)
+{
+	int pos = directory.findl(fSep);
+	std::string path = directory.subString(0, pos + 1).toString();
+	CString wildcard = directory.subString(pos + 1);
+
+	auto it = scanned.find(path);
+	if (it == scanned.end())
+		return;
+
+	// Files only refer to their directory, so no paths are built here.
+	uint32_t directoryId = target.intern(CString(path));
+	for (const auto& file : it->second.files)
+	{
+		if (file.match(wildcard))
+			target.set(file, directoryId, category);
+	}
+
+	if (!recursive)
+		return;
+
+	// Directories that are already in the directory list are loaded on their own.
+	for (const auto& subDir : it->second.subDirs)
+	{
+		CString ndir = CString() << path.c_str() << subDir << fSep << "*";
+		if (!knownDirs.insert(ndir.toString()).second)
+			continue;
+
+		dirLists[category].push_back(ndir);
+		mergeDirectory(target, category, scanned, knownDirs, ndir, true);
+	}
+}
+
+CFileIndex::ScanResults CFileIndex::scanDirectories(const std::vector<std::string>& paths, bool recursive)
+{
+	ScanResults results;
+	std::deque<std::string> pending;
+	for (const auto& path : paths)
+	{
+		if (results.try_emplace(path).second)
+			pending.push_back(path);
+	}
+
+	// Small trees are read on this thread alone.  Helper threads are only started once
+	// enough directories are queued to keep them busy.
+	static constexpr size_t DirsPerThread = 16;
+	unsigned int threadCount = std::max(1u, std::min(std::thread::hardware_concurrency(), 8u));
+	std::vector<std::thread> threads;
+
+	// Each thread takes a directory, reads it without holding the lock, then queues its subdirectories.
+	// The scan is done once nothing is queued and nothing is being read.
+	std::mutex scanLock;
+	std::condition_variable scanCondition;
+	size_t scanning = 0;
+	std::function<void(bool)> scanWorker = [&](bool startHelpers)
+	{
+		std::unique_lock<std::mutex> guard(scanLock);
+		for (;;)
+		{
+			scanCondition.wait(guard, [&] { return !pending.empty() || scanning == 0; });
+			if (pending.empty())
+				return;
+
+			std::string path = std::move(pending.front());
+			pending.pop_front();
+			++scanning;
+
+			guard.unlock();
+			ScannedDirectory result;
+			scanDirectory(path, result, recursive);
+			guard.lock();
+
+			--scanning;
+			for (const auto& subDir : result.subDirs)
+			{
+				std::string subPath = path + subDir.text() + fSep;
+				if (results.try_emplace(subPath).second)
+					pending.push_back(std::move(subPath));
+			}
+			results[path] = std::move(result);
+
+			while (startHelpers && threads.size() + 1 < threadCount && pending.size() > DirsPerThread * (threads.size() + 1))
+				threads.emplace_back(scanWorker, false);
+			scanCondition.notify_all();
+		}
+	};
+
+	scanWorker(true);
+	for (auto& thread : threads)
+		thread.join();
+
+	return results;
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+void CFileIndex::scanDirectory(const std::string& path, ScannedDirectory& result, bool recursive)
+{
+	WIN32_FIND_DATAA filedata;
+	HANDLE hFind = FindFirstFileA((path + "*").c_str(), &filedata);
+	if (hFind == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		if (filedata.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			if (filedata.cFileName[0] != '.' && recursive)
+				result.subDirs.emplace_back(filedata.cFileName);
+		}
+		else result.files.emplace_back(filedata.cFileName);
+	} while (FindNextFileA(hFind, &filedata));
+	FindClose(hFind);
+}
+#else
+void CFileIndex::scanDirectory(const std::string& path, ScannedDirectory& result, bool recursive)
+{
+	DIR *dir;
+	struct dirent *ent;
+
+	// Try to open the directory.
+	if ((dir = opendir(path.c_str())) == nullptr)
+		return;
+
+	// Read everything in it now.
+	while ((ent = readdir(dir)) != 0)
+	{
+		if (ent->d_name[0] == '.')
+			continue;
+
+		// Most file systems report the type of each entry, so only links and the
+		// rest need a stat.  It is done relative to the directory, so no path is built.
+		bool isDir;
+#ifdef _DIRENT_HAVE_D_TYPE
+		if (ent->d_type != DT_UNKNOWN && ent->d_type != DT_LNK)
+			isDir = (ent->d_type == DT_DIR);
+		else
+#endif
+		{
+			struct stat fileStat;
+			if (fstatat(dirfd(dir), ent->d_name, &fileStat, 0) == -1)
+				continue;
+			isDir = S_ISDIR(fileStat.st_mode);
+		}
+
+		if (!isDir)
+			result.files.emplace_back(ent->d_name);
+		else if (recursive)
+			result.subDirs.emplace_back(ent->d_name);
+	}
+	closedir(dir);
+}
+#endif
@@ -22,207 +22,129 @@
 #endif
 
 CFileSystem::CFileSystem()
-: server(nullptr)
+: server(nullptr), index(std::make_shared<CFileIndex>()), category(0)
 {
-	m_preventChange = new std::recursive_mutex();
 }
 
 CFileSystem::CFileSystem(TServer* pServer)
-: server(pServer)
+: server(pServer), index(std::make_shared<CFileIndex>()), category(0)
 {
-	m_preventChange = new std::recursive_mutex();
 }
 
-CFileSystem::~CFileSystem()
+void CFileSystem::clear()
 {
-	clear();
-	delete m_preventChange;
+	index->clear(category);
 }
 
-void CFileSystem::clear()
+void CFileSystem::setIndex(std::shared_ptr<CFileIndex> pIndex, unsigned int pCategory)
 {
-	fileList.clear();
-	dirList.clear();
+	clear();
+	index = std::move(pIndex);
+	category = pCategory;
 }
 
 void CFileSystem::addDir(const CString& dir, const CString& wildcard, bool forceRecursive)
 {
-	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
+	addDirs({ std::make_pair(dir, wildcard) }, forceRecursive);
+}
 
+void CFileSystem::addDirs(const std::vector<std::pair<CString, CString>>& dirs, bool forceRecursive)
+{
 	if (server == nullptr) return;
 
-	// Format the directory.
-	CString newDir(dir);
-	if (newDir[newDir.length() - 1] == '/' || newDir[newDir.length() - 1] == '\\')
-		CFileSystem::fixPathSeparators(newDir);
-	else
+	std::vector<CString> newDirs;
+	for (const auto& [dir, wildcard] : dirs)
 	{
-		newDir << fSep;
-		CFileSystem::fixPathSeparators(newDir);
-	}
-
-	// Add the directory to the directory list.
-	CString ndir = CString() << server->getServerPath() << newDir << wildcard;
-	if (vecSearch<CString>(dirList, ndir) != -1)	// Already exists?  Resync.
-		resync();
-	else
-	{
-		dirList.push_back(ndir);
+		// Format the directory.
+		CString newDir(dir);
+		if (newDir[newDir.length() - 1] == '/' || newDir[newDir.length() - 1] == '\\')
+			CFileSystem::fixPathSeparators(newDir);
+		else
+		{
+			newDir << fSep;
+			CFileSystem::fixPathSeparators(newDir);
+		}
 
-		// Load up the files in the directory.
-		loadAllDirectories(ndir, (forceRecursive ? true : server->getSettings()->getBool("nofoldersconfig", false)));
+		newDirs.push_back(CString() << server->getServerPath() << newDir << wildcard);
 	}
+
+	// Directories that were already there are loaded again, along with everything else.
+	index->addDirs(category, newDirs, server->getSettings()->getBool("nofoldersconfig", false), forceRecursive);
 }
 
 void CFileSystem::addFile(CString file)
 {
-	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
+	addFiles({ file });
+}
 
-	// Grab the file name and directory.
-	CFileSystem::fixPathSeparators(file);
-	CString filename(file.subString(file.findl(fSep) + 1));
-	CString directory(file.subString(0, file.find(filename)));
+void CFileSystem::addFiles(const std::vector<CString>& files)
+{
+	std::vector<CString> paths;
+	paths.reserve(files.size());
+	for (CString file : files)
+	{
+		// Grab the file name and directory.
+		CFileSystem::fixPathSeparators(file);
+		CString filename(file.subString(file.findl(fSep) + 1));
+		CString directory(file.subString(0, file.find(filename)));
 
-	// Fix directory path separators.
-	if (directory.find(server->getServerPath()) != -1)
-		directory.removeI(0, server->getServerPath().length());
+		// Fix directory path separators.
+		if (directory.find(server->getServerPath()) != -1)
+			directory.removeI(0, server->getServerPath().length());
+
+		paths.push_back(CString() << server->getServerPath() << directory << filename);
+	}
 
 	// Add to the map.
-	fileList[filename] = CString() << server->getServerPath() << directory << filename;
+	index->addFiles(category, paths);
 }
 
 void CFileSystem::removeFile(const CString& file)
 {
-	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
-
-	// Grab the file name and directory.
+	// Grab the file name.
 	CString filename(file.subString(file.findl(fSep) + 1));
-	CString directory(file.subString(0, file.find(filename)));
-
-	// Fix directory path separators.
-	CFileSystem::fixPathSeparators(directory);
 
 	// Remove it from the map.
-	fileList.erase(filename);
+	index->removeFile(category, filename);
 }
 
 void CFileSystem::resync()
 {
-	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
-
-	// Clear the file list.
-	fileList.clear();
+	index->resync(server->getSettings()->getBool("nofoldersconfig", false));
+}
 
-	// Iterate through all the directories, reloading their file list.
-	for (std::vector<CString>::const_iterator i = dirList.begin(); i != dirList.end(); ++i)
-		loadAllDirectories(*i, server->getSettings()->getBool("nofoldersconfig", false));
+void CFileSystem::syncFiles(const std::vector<CFileChange>& changes)
+{
+	index->syncFiles(changes);
 }
 
 CString CFileSystem::find(const CString& file) const
 {
-	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
-
-	std::map<CString, CString>::const_iterator i = fileList.find(file);
-	if (i == fileList.end()) return CString();
-	return CString(i->second);
+	return index->find(category, file);
 }
 
 CString CFileSystem::findi(const CString& file) const
 {
-	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
-
-	for (std::map<CString, CString>::const_iterator i = fileList.begin(); i != fileList.end(); ++i)
-		if (i->first.comparei(file)) return CString(i->second);
-	return CString();
+	return index->findi(category, file);
 }
 
 CString CFileSystem::fileExistsAs(const CString& file) const
 {
-	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
-
-	for (std::map<CString, CString>::const_iterator i = fileList.begin(); i != fileList.end(); ++i)
-		if (i->first.comparei(file)) return CString(i->first);
-	return CString();
+	return index->fileExistsAs(category, file);
 }
 
-#if (defined(_WIN32) || defined(_WIN64)) && !defined(__GNUC__)
-void CFileSystem::loadAllDirectories(const CString& directory, bool recursive)
+std::shared_ptr<const CFileSystem::FileList> CFileSystem::getFileList() const
 {
-	CString dir = CString() << directory.remove(directory.findl(fSep)) << fSep;
-	WIN32_FIND_DATAA filedata;
-	HANDLE hFind = FindFirstFileA(directory.text(), &filedata);
-
-	if (hFind != INVALID_HANDLE_VALUE)
-	{
-		do
-		{
-			if (filedata.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-			{
-				if (filedata.cFileName[0] != '.' && recursive)
-				{
-					// We need to add the directory to the directory list.
-					CString newDir = CString() << dir << filedata.cFileName << fSep;
-					newDir.removeI(0, server->getServerPath().length());
-					addDir(newDir, "*", true);
-				}
-			}
-			else
-			{
-				// Grab the file name.
-				CString file((char *)filedata.cFileName);
-				fileList[file] = CString(dir) << filedata.cFileName;
-			}
-		} while (FindNextFileA(hFind, &filedata));
-	}
-	FindClose(hFind);
+	return index->getFileList(category);
 }
-#else
-void CFileSystem::loadAllDirectories(const CString& directory, bool recursive)
-{
-	CString path = CString() << directory.remove(directory.findl(fSep)) << fSep;
-	CString wildcard = directory.subString(directory.findl(fSep) + 1);
-	DIR *dir;
-	struct stat statx;
-	struct dirent *ent;
-
-	// Try to open the directory.
-	if ((dir = opendir(path.text())) == nullptr)
-		return;
-
-	// Read everything in it now.
-	while ((ent = readdir(dir)) != 0)
-	{
-		if (ent->d_name[0] != '.')
-		{
-			CString dircheck = CString() << path << ent->d_name;
-			stat(dircheck.text(), &statx);
-			if ((statx.st_mode & S_IFDIR))
-			{
-				if (recursive)
-				{
-					// We need to add the directory to the directory list.
-					CString newDir = CString() << path << ent->d_name << fSep;
-					newDir.removeI(0, server->getServerPath().length());
-					addDir(newDir, "*", true);
-				}
-				continue;
-			}
-		}
-		else continue;
 
-		// Grab the file name.
-		CString file(ent->d_name);
-		if (file.match(wildcard))
-			fileList[file] = CString(path) << file;
-	}
-	closedir(dir);
+size_t CFileSystem::getFileCount() const
+{
+	return index->getFileCount(category);
 }
-#endif
 
 CString CFileSystem::load(const CString& file) const
 {
-	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
-
 	// Get the full path to the file.
 	CString fileName = find(file);
 	if (fileName.length() == 0) return CString();
@@ -236,8 +158,6 @@ CString CFileSystem::load(const CString& file) const
 
 time_t CFileSystem::getModTime(const CString& file) const
 {
-	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
-
 	// Get the full path to the file.
 	CString fileName = find(file);
 	if (fileName.length() == 0) return 0;
@@ -250,8 +170,6 @@ time_t CFileSystem::getModTime(const CString& file) const
 
 bool CFileSystem::setModTime(const CString& file, time_t modTime) const
 {
-	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
-
 	// Get the full path to the file.
 	CString fileName = find(file);
 	if (fileName.length() == 0) return false;
@@ -267,8 +185,6 @@ bool CFileSystem::setModTime(const CString& file, time_t modTime) const
 
 int CFileSystem::getFileSize(const CString& file) const
 {
-	std::lock_guard<std::recursive_mutex> lock(*m_preventChange);
-
 	// Get the full path to the file.
 	CString fileName = find(file);
 	if (fileName.length() == 0) return 0;
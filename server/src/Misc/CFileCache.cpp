@@ -0,0 +1,100 @@
+#include <sys/stat.h>
+#include "IUtil.h"
+#include "CFileCache.h"
+
+CFileCache::CFileCache(size_t pMaxSize)
+: maxSize(pMaxSize), size(0)
+{
+}
+
+std::shared_ptr<const SCachedFile> CFileCache::get(const CString& pPath)
+{
+	if (pPath.isEmpty())
+		return nullptr;
+
+	std::string path = pPath.toString();
+	struct stat fileStat;
+	if (stat(pPath.text(), &fileStat) == -1 || fileStat.st_size == 0)
+	{
+		invalidate(pPath);
+		return nullptr;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		auto it = entries.find(path);
+		if (it != entries.end())
+		{
+			auto entry = it->second;
+			if (entry->file->modTime == fileStat.st_mtime && entry->fileSize == (long long)fileStat.st_size)
+			{
+				recentlyUsed.splice(recentlyUsed.begin(), recentlyUsed, entry);
+				return entry->file;
+			}
+
+			drop(entry);
+		}
+	}
+
+	auto file = std::make_shared<SCachedFile>();
+	if (!file->data.load(pPath) || file->data.isEmpty())
+		return nullptr;
+
+	file->modTime = fileStat.st_mtime;
+	file->checksum = calculateCrc32Checksum(file->data);
+
+	// Files that would push out a large part of the cache are still served, but not kept.
+	std::lock_guard<std::mutex> guard(lock);
+	size_t length = (size_t)file->data.length();
+	if (length > maxSize / 4)
+		return file;
+
+	// Another thread may have loaded the file in the meantime.
+	dropPath(path);
+	trim(maxSize - length);
+	recentlyUsed.push_front(Entry{ path, (long long)fileStat.st_size, file });
+	entries[path] = recentlyUsed.begin();
+	size += length;
+	return file;
+}
+
+void CFileCache::invalidate(const CString& pPath)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	dropPath(pPath.toString());
+}
+
+void CFileCache::clear()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	recentlyUsed.clear();
+	entries.clear();
+	size = 0;
+}
+
+void CFileCache::setMaxSize(size_t pMaxSize)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	maxSize = pMaxSize;
+	trim(maxSize);
+}
+
+void CFileCache::drop(std::list<Entry>::iterator it)
+{
+	size -= (size_t)it->file->data.length();
+	entries.erase(it->path);
+	recentlyUsed.erase(it);
+}
+
+void CFileCache::dropPath(const std::string& path)
+{
+	auto it = entries.find(path);
+	if (it != entries.end())
+		drop(it->second);
+}
+
+void CFileCache::trim(size_t pMaxSize)
+{
+	while (size > pMaxSize && !recentlyUsed.empty())
+		drop(std::prev(recentlyUsed.end()));
+}
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <unordered_set>
+#ifdef __linux__
+	#include <sys/inotify.h>
+	#include <unistd.h>
+#endif
+#include "CFileSystemWatcher.h"
+
+CFileSystemWatcher::CFileSystemWatcher()
+: fd(-1)
+{
+#ifdef __linux__
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+CFileSystemWatcher::~CFileSystemWatcher()
+{
+#ifdef __linux__
+	if (fd != -1)
+		close(fd);
+#endif
+}
+
+bool CFileSystemWatcher::watch(const CString& directory)
+{
+#ifdef __linux__
+	if (fd == -1)
+		return false;
+
+	if (dirWatches.find(directory.toString()) != dirWatches.end())
+		return true;
+
+	int wd = inotify_add_watch(fd, directory.text(), IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+	if (wd == -1)
+		return false;
+
+	// Paths that lead to the same directory share a watch.
+	watchDirs[wd].push_back(directory);
+	dirWatches[directory.toString()] = wd;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void CFileSystemWatcher::unwatch(const CString& directory)
+{
+	auto it = dirWatches.find(directory.toString());
+	if (it == dirWatches.end())
+		return;
+
+	int wd = it->second;
+	dirWatches.erase(it);
+
+	auto& dirs = watchDirs[wd];
+	dirs.erase(std::remove(dirs.begin(), dirs.end(), directory), dirs.end());
+	if (dirs.empty())
+	{
+		watchDirs.erase(wd);
+#ifdef __linux__
+		inotify_rm_watch(fd, wd);
+#endif
+	}
+}
+
+void CFileSystemWatcher::clear()
+{
+#ifdef __linux__
+	for (auto& watch : watchDirs)
+		inotify_rm_watch(fd, watch.first);
+#endif
+	watchDirs.clear();
+	dirWatches.clear();
+}
+
+std::vector<CString> CFileSystemWatcher::getDirectories() const
+{
+	std::vector<CString> directories;
+	for (auto& watch : watchDirs)
+		directories.insert(directories.end(), watch.second.begin(), watch.second.end());
+	return directories;
+}
+
+void CFileSystemWatcher::forget(int wd)
+{
+	auto it = watchDirs.find(wd);
+	if (it == watchDirs.end())
+		return;
+
+	for (auto& dir : it->second)
+		dirWatches.erase(dir.toString());
+	watchDirs.erase(it);
+}
+
+bool CFileSystemWatcher::poll(std::vector<CFileChange>& changes)
+{
+#ifdef __linux__
+	if (fd == -1)
+		return false;
+
+	bool complete = true;
+	std::vector<CFileChange> found;
+	alignas(struct inotify_event) char buffer[16384];
+	for (;;)
+	{
+		// The descriptor is non-blocking, so this stops once the queue is drained.
+		ssize_t length = read(fd, buffer, sizeof(buffer));
+		if (length <= 0)
+			break;
+
+		for (char* ptr = buffer; ptr < buffer + length;)
+		{
+			const auto* event = (const struct inotify_event*)ptr;
+			ptr += sizeof(struct inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				complete = false;
+				continue;
+			}
+
+			// Events of watches we already removed can still be queued.
+			auto it = watchDirs.find(event->wd);
+			if (it == watchDirs.end())
+				continue;
+
+			// The watched directory itself went away.  A renamed directory keeps its watch,
+			// so drop it before it is watched again under its new path.
+			if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF))
+			{
+				if (!(event->mask & IN_IGNORED))
+					inotify_rm_watch(fd, event->wd);
+				forget(event->wd);
+				complete = false;
+				continue;
+			}
+
+			// New and removed subdirectories change which directories have to be watched.
+			if (event->mask & IN_ISDIR)
+			{
+				complete = false;
+				continue;
+			}
+
+			if (event->len == 0)
+				continue;
+
+			int type = FILECHANGE_WRITTEN;
+			if (event->mask & IN_CREATE)
+				type = FILECHANGE_CREATED;
+			else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+				type = FILECHANGE_REMOVED;
+
+			CString file(event->name);
+			for (auto& dir : it->second)
+				found.push_back(CFileChange{ type, dir, file });
+		}
+	}
+
+	// A file that changed several times since the last poll is only reported once, with its last change.
+	std::unordered_set<std::string> reported;
+	auto firstChange = changes.size();
+	for (auto change = found.rbegin(); change != found.rend(); ++change)
+	{
+		if (reported.insert((CString() << change->directory << change->file).toString()).second)
+			changes.push_back(*change);
+	}
+	std::reverse(changes.begin() + firstChange, changes.end());
+
+	return complete;
+#else
+	return false;
+#endif
+}
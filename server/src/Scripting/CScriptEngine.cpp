@@ -22,9 +22,9 @@ extern void bindClass_Weapon(CScriptEngine *scriptEngine);
 CScriptEngine::CScriptEngine(TServer *server)
 	: _server(server), _env(nullptr), _bootstrapFunction(nullptr), _environmentObject(nullptr), _serverObject(nullptr)
 	, _scriptIsRunning(false), _scriptWatcherRunning(false), _scriptWatcherThread()
+	, _compileTime(0), _compileCount(0)
 {
-	accumulator = std::chrono::nanoseconds(0);
-	lastScriptTimer = std::chrono::high_resolution_clock::now();
+	_timerStartTime = std::chrono::high_resolution_clock::now();
 }
 
 CScriptEngine::~CScriptEngine()
@@ -123,7 +123,7 @@ void CScriptEngine::Cleanup(bool shutDown)
 
 	// Clear any registered scripts
 	_updateNpcs.clear();
-	_updateNpcsTimer.clear();
+	_npcTimers.clear();
 	_updateWeapons.clear();
 
 	// Remove any registered callbacks
@@ -177,7 +177,10 @@ IScriptFunction * CScriptEngine::CompileCache(const std::string& code, bool refe
 	// Compile script, send errors to server
 	SCRIPTENV_D("Compiling script:\n---\n%s\n---\n", code.c_str());
 
-	IScriptFunction *compiledScript = _env->Compile(std::to_string(SCRIPT_ID++), code);
+	auto compileStart = std::chrono::high_resolution_clock::now();
+	IScriptFunction *compiledScript = _env->Compile(std::to_string(SCRIPT_ID++), code, _codeCache.isOpen() ? &_codeCache : nullptr);
+	_compileTime += std::chrono::high_resolution_clock::now() - compileStart;
+	_compileCount++;
 	if (compiledScript == nullptr)
 	{
 		reportScriptException(_env->getScriptError());
@@ -194,6 +197,17 @@ IScriptFunction * CScriptEngine::CompileCache(const std::string& code, bool refe
 	return compiledScript;
 }
 
+bool CScriptEngine::setCodeCache(const std::filesystem::path& directory)
+{
+	if (!_env || directory.empty())
+	{
+		_codeCache.close();
+		return false;
+	}
+
+	return _codeCache.open(directory, _env->GetVersion());
+}
+
 bool CScriptEngine::ClearCache(const std::string& code)
 {
 	auto scriptFunctionIter = _cachedScripts.find(code);
@@ -310,27 +324,10 @@ bool CScriptEngine::ExecuteWeapon(TWeapon *weapon)
 
 void CScriptEngine::runTimers(const std::chrono::high_resolution_clock::time_point& time)
 {
-	auto delta_time = time - lastScriptTimer;
-	lastScriptTimer = time;
-
-	// Run scripts every 0.05 seconds
-	constexpr std::chrono::nanoseconds timestep(std::chrono::milliseconds(50));
-	accumulator += std::chrono::duration_cast<std::chrono::nanoseconds>(delta_time);
-	while (accumulator >= timestep)
-	{
-		accumulator -= timestep;
-
-		for (auto it = _updateNpcsTimer.begin(); it != _updateNpcsTimer.end(); )
-		{
-			TNPC *npc = *it;
-			bool hasUpdates = npc->runScriptTimer();
-
-			if (!hasUpdates)
-				it = _updateNpcsTimer.erase(it);
-			else
-				it++;
-		}
-	}
+	// Only the timers that run out by now are touched, no matter how many npcs have one.
+	_npcTimers.advance(getTimerTick(time), [](NpcTimer& timer) {
+		timer.npc->runScriptTimer(timer.action);
+	});
 }
 
 void CScriptEngine::RunScripts(const std::chrono::high_resolution_clock::time_point& time)
@@ -342,23 +339,14 @@ void CScriptEngine::RunScripts(const std::chrono::high_resolution_clock::time_po
 		_env->CallFunctionInScope([&]() -> void {
 			std::vector<TNPC*> deleteNpcs;
 
-			// Iterate over npcs
-			for (auto it = _updateNpcs.begin(); it != _updateNpcs.end(); )
-			{
-				TNPC *npc = *it;
-				auto response = npc->runScriptEvents();
-
-				if (response == NPCEventResponse::PendingEvents)
-				{
-					it++;
-					continue;
-				}
-
+			// Npcs take turns running their actions, and whatever doesn't fit in this tick runs in the next one.
+			_updateNpcs.run([&deleteNpcs](TNPC *npc, std::chrono::high_resolution_clock::time_point deadline) {
+				auto response = npc->runScriptEvents(deadline);
 				if (response == NPCEventResponse::Delete)
 					deleteNpcs.push_back(npc);
 
-				it = _updateNpcs.erase(it);
-			}
+				return response == NPCEventResponse::PendingEvents;
+			});
 
 			// Iterate over weapons
 			for (auto weapon : _updateWeapons)
@@ -1,4 +1,8 @@
+#include <cstring>
+#include <string_view>
+#include <vector>
 #include "GS2ScriptManager.h"
+#include "GS2CompilerVersion.h"
 
 const uint32_t THREADPOOL_WORKERS = 4;
 
@@ -11,83 +15,146 @@ GS2ScriptManager::GS2ScriptManager()
 void GS2ScriptManager::compileScript(const std::string& script, user_callback_type finishedCb)
 {
 	// Check to see if we already compiled this code before
-	auto cacheSearch = _bytecodeCache.find(script);
-	if (cacheSearch != _bytecodeCache.end())
+	if (auto response = findBytecode(script))
 	{
-		finishedCb(cacheSearch->second);
+		finishedCb(*response);
 		return;
 	}
 
-	// Disabling any async functionality for now, npcs should be compiled during level-loading
-	// and level should not be sent until all the npcs are finished compiling. Can't really
-	// enforce this since TLevel is loaded synchronously, but if it does turn into a problem
-	// we can migrate to using the threadpool for script compilations and delay sending levels
-	// until we finish loading the level. We could also switch to some eager-level-loading method,
-	// preloading any levels that are links from other levels or listed in a loaded map etc..
-
-	// Queue a job to compile this script
-	// queueCompileJob(script, finishedCb);
-
 	// Synchronously compile script
 	syncCompileJob(script, finishedCb);
 }
 
+const CompilerResponse *GS2ScriptManager::compileScriptAsync(const std::string& script, const void *owner, user_callback_type finishedCb)
+{
+	// Check to see if we already compiled this code before, dropping anything the owner still waits on
+	if (auto response = findBytecode(script))
+	{
+		_compileQueue.cancel(owner);
+		return response;
+	}
+
+	// Queue a job to compile this script, unless it is already being compiled for someone else
+	if (_compileQueue.wait(script, owner, std::move(finishedCb)))
+		queueCompileJob(script);
+
+	return nullptr;
+}
+
 void GS2ScriptManager::syncCompileJob(const std::string& script, user_callback_type& finishedCb)
 {
 	// Compile code
 	auto result = _context.compile(script); // , "weapon", "TestCode", true);
 
-	// Insert into bytecode cache
-	auto ret = _bytecodeCache.insert({ script, std::move(result) });
-
-	// Call the user-defined callback after we insert the bytecode into the cache
-	finishedCb(ret.first->second);
+	// Insert into bytecode cache, and call the user-defined callback after
+	finishedCb(cacheBytecode(script, std::move(result)));
 }
 
-void GS2ScriptManager::queueCompileJob(const std::string& script, user_callback_type& finishedCb)
+void GS2ScriptManager::queueCompileJob(const std::string& script)
 {
 	// Worker job
-	auto threadFunction = [script, finishedCb, this](CallbackThreadJob::thread_context &context, auto &promise)
+	auto threadFunction = [script, this](CallbackThreadJob::thread_context &context, auto &promise)
 	{
-		// Compile code
+		// Compile code, the callbacks are called from runQueue on the main thread
 		auto result = context.gs2context.compile(script); // , "weapon", "TestCode", true);
-
-		// Call the user-defined callback after we insert the bytecode into the cache
-		auto completedFunc = [this, script, finishedCb](CompilerResponse &response)
-		{
-			auto ret = _bytecodeCache.insert({ script, std::move(response) });
-			finishedCb(ret.first->second);
-		};
-
-		// Create a tuple with the callback, and arguments
-		auto fnData = std::make_pair(std::move(completedFunc), std::move(result));
-
-		std::scoped_lock lock(_cbQueueLock);
-		_cbQueue.push(std::move(fnData));
+		_compileQueue.complete(script, std::move(result));
 	};
 
 	// Queue function into threadpool
 	_compilerThreadPool.queue(CallbackThreadJob{ std::move(threadFunction) });
 }
 
-void GS2ScriptManager::runQueue()
+size_t GS2ScriptManager::runQueue()
+{
+	// Insert into bytecode cache, and call the user-defined callbacks after
+	return _compileQueue.dispatch([this](const std::string& script, CompilerResponse&& response) -> const CompilerResponse& {
+		return cacheBytecode(script, std::move(response));
+	});
+}
+
+bool GS2ScriptManager::setBytecodeCache(const std::filesystem::path& directory)
+{
+	// Bytecode from another compiler revision is rejected when it is loaded
+	return _diskCache.open(directory, GS2COMPILER_VERSION);
+}
+
+const CompilerResponse *GS2ScriptManager::findBytecode(const std::string& script)
 {
-	std::queue<queue_item_type> tmpQueue;
+	auto sourceHash = ScriptCodeCache::hash(script);
+	auto cacheSearch = _bytecodeCache.find(sourceHash);
+	if (cacheSearch != _bytecodeCache.end())
+		return (cacheSearch->second.sourceLength == script.length() ? &cacheSearch->second.response : nullptr);
+
+	// Only read from disk once a script is needed, instead of loading the whole cache at startup
+	auto data = _diskCache.load(script);
+	if (!data)
+		return nullptr;
 
+	CompilerResponse response{};
+	if (!decodeBytecode(*data, response))
 	{
-		std::scoped_lock lock(_cbQueueLock);
-		if (!_cbQueue.empty())
-			tmpQueue.swap(_cbQueue);
+		_diskCache.reject(script);
+		return nullptr;
 	}
 
-	while (!tmpQueue.empty())
+	auto ret = _bytecodeCache.emplace(sourceHash, CachedBytecode{ script.length(), std::move(response) });
+	return &ret.first->second.response;
+}
+
+const CompilerResponse& GS2ScriptManager::cacheBytecode(const std::string& script, CompilerResponse&& response)
+{
+	// Scripts with errors are compiled again after a restart, so their errors are reported again
+	if (response.success)
+		_diskCache.store(script, encodeBytecode(response));
+
+	auto ret = _bytecodeCache.insert_or_assign(ScriptCodeCache::hash(script), CachedBytecode{ script.length(), std::move(response) });
+	return ret.first->second.response;
+}
+
+// Bytecode kept on disk: the number of joined classes, each class name prefixed by its
+// length, and then the bytecode itself.
+std::string GS2ScriptManager::encodeBytecode(const CompilerResponse& response)
+{
+	std::string data;
+	auto writeInt = [&data](uint32_t value) { data.append((const char *)&value, sizeof(value)); };
+
+	writeInt((uint32_t)response.joinedClasses.size());
+	for (const auto& joinedClass : response.joinedClasses)
 	{
-		auto& queueItem = tmpQueue.front();
+		writeInt((uint32_t)joinedClass.length());
+		data.append(joinedClass);
+	}
 
-		internal_callback_type& func = queueItem.first;
-		CompilerResponse& response = queueItem.second;
-		func(response);
+	data.append((const char *)response.bytecode.buffer(), response.bytecode.length());
+	return data;
+}
 
-		tmpQueue.pop();
+bool GS2ScriptManager::decodeBytecode(std::string_view data, CompilerResponse& response)
+{
+	auto readInt = [&data](uint32_t& value) {
+		if (data.length() < sizeof(value))
+			return false;
+		memcpy(&value, data.data(), sizeof(value));
+		data.remove_prefix(sizeof(value));
+		return true;
+	};
+
+	uint32_t classCount;
+	if (!readInt(classCount))
+		return false;
+
+	std::vector<std::string> joinedClasses;
+	for (uint32_t i = 0; i < classCount; ++i)
+	{
+		uint32_t length;
+		if (!readInt(length) || data.length() < length)
+			return false;
+		joinedClasses.emplace_back(data.substr(0, length));
+		data.remove_prefix(length);
 	}
+
+	response.success = true;
+	response.joinedClasses = decltype(response.joinedClasses)(joinedClasses.begin(), joinedClasses.end());
+	response.bytecode.write(data.data(), data.length());
+	return true;
 }
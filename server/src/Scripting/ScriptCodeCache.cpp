@@ -0,0 +1,193 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include "ScriptCodeCache.h"
+
+namespace
+{
+	constexpr char CacheMagic[4] = { 'G', 'S', 'C', 'C' };
+	constexpr uint32_t CacheFormat = 1;
+
+	// Written in front of the version string and the code in every cache file.
+	struct CacheHeader
+	{
+		char magic[4];
+		uint32_t format;
+		uint64_t sourceHash;
+		uint64_t sourceLength;
+		uint64_t codeHash;
+		uint32_t codeLength;
+		uint32_t versionLength;
+	};
+}
+
+bool ScriptCodeCache::open(const std::filesystem::path& directory, const std::string& version, std::chrono::hours maxAge)
+{
+	close();
+	if (directory.empty())
+		return false;
+
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (!std::filesystem::is_directory(directory, error))
+		return false;
+
+	_directory = directory;
+	_version = version;
+	prune(std::filesystem::file_time_type::clock::now() - maxAge);
+	return true;
+}
+
+void ScriptCodeCache::close()
+{
+	_directory.clear();
+	_version.clear();
+}
+
+std::optional<std::string> ScriptCodeCache::load(std::string_view source)
+{
+	if (!isOpen())
+		return std::nullopt;
+
+	uint64_t sourceHash = hash(source);
+	std::ifstream file(getPath(sourceHash), std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		++_stats.misses;
+		return std::nullopt;
+	}
+
+	std::string data((size_t)file.tellg(), '\0');
+	file.seekg(0);
+	file.read(data.data(), (std::streamsize)data.size());
+	file.close();
+
+	// Anything that doesn't add up is rejected, whether it came from another version or a damaged file.
+	CacheHeader header;
+	bool valid = data.size() >= sizeof(header);
+	if (valid)
+	{
+		memcpy(&header, data.data(), sizeof(header));
+		valid = memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) == 0 && header.format == CacheFormat
+			&& header.sourceHash == sourceHash && header.sourceLength == source.length()
+			&& data.size() == sizeof(header) + header.versionLength + header.codeLength
+			&& std::string_view(data).substr(sizeof(header), header.versionLength) == _version;
+	}
+
+	if (valid)
+	{
+		data.erase(0, sizeof(header) + header.versionLength);
+		valid = hash(data) == header.codeHash;
+	}
+
+	if (!valid)
+	{
+		reject(source);
+		return std::nullopt;
+	}
+
+	// Loading counts as a use, so entries that are still needed aren't pruned.
+	std::error_code error;
+	std::filesystem::last_write_time(getPath(sourceHash), std::filesystem::file_time_type::clock::now(), error);
+
+	++_stats.hits;
+	return data;
+}
+
+bool ScriptCodeCache::store(std::string_view source, std::string_view code)
+{
+	if (!isOpen())
+		return false;
+
+	CacheHeader header;
+	memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+	header.format = CacheFormat;
+	header.sourceHash = hash(source);
+	header.sourceLength = source.length();
+	header.codeHash = hash(code);
+	header.codeLength = (uint32_t)code.length();
+	header.versionLength = (uint32_t)_version.length();
+
+	// Write to a temporary file first, so a crash never leaves half an entry behind.
+	auto path = getPath(header.sourceHash);
+	auto tempPath = std::filesystem::path(path).concat(".tmp");
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		file.write((const char *)&header, sizeof(header));
+		file.write(_version.data(), (std::streamsize)_version.length());
+		file.write(code.data(), (std::streamsize)code.length());
+		if (!file)
+			return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error);
+	if (error)
+	{
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	++_stats.stored;
+	return true;
+}
+
+void ScriptCodeCache::reject(std::string_view source)
+{
+	if (!isOpen())
+		return;
+
+	std::error_code error;
+	std::filesystem::remove(getPath(hash(source)), error);
+	++_stats.rejected;
+}
+
+size_t ScriptCodeCache::prune(std::filesystem::file_time_type usedBefore)
+{
+	if (!isOpen())
+		return 0;
+
+	size_t removed = 0;
+	std::error_code iterateError, error;
+	for (std::filesystem::directory_iterator iter(_directory, iterateError), end; !iterateError && iter != end; iter.increment(iterateError))
+	{
+		auto& entry = *iter;
+		auto extension = entry.path().extension();
+		if (!entry.is_regular_file(error) || (extension != ".bin" && extension != ".tmp"))
+			continue;
+
+		// Temporary files are only left behind by a store that never finished.
+		if (extension == ".bin")
+		{
+			auto lastUsed = entry.last_write_time(error);
+			if (error || lastUsed >= usedBefore)
+				continue;
+		}
+
+		if (std::filesystem::remove(entry.path(), error))
+			++removed;
+	}
+
+	_stats.pruned += (uint32_t)removed;
+	return removed;
+}
+
+uint64_t ScriptCodeCache::hash(std::string_view data)
+{
+	// 64-bit FNV-1a
+	uint64_t result = 0xcbf29ce484222325ull;
+	for (unsigned char c : data)
+	{
+		result ^= c;
+		result *= 0x100000001b3ull;
+	}
+
+	return result;
+}
+
+std::filesystem::path ScriptCodeCache::getPath(uint64_t sourceHash) const
+{
+	char fileName[32];
+	snprintf(fileName, sizeof(fileName), "%016llx.bin", (unsigned long long)sourceHash);
+	return _directory / fileName;
+}
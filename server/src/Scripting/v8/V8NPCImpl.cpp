@@ -101,7 +101,7 @@ void NPC_GetNum_Timeout(v8::Local<v8::String> prop, const v8::PropertyCallbackIn
 {
 	V8ENV_SAFE_UNWRAP(info, TNPC, npcObject);
 
-	double timeout = npcObject->getTimeout() / 20;
+	double timeout = (double)npcObject->getTimeout().count() / 1000.0;
 	info.GetReturnValue().Set(timeout);
 }
 
@@ -110,7 +110,7 @@ void NPC_SetNum_Timeout(v8::Local<v8::String> prop, v8::Local<v8::Value> value,
 	V8ENV_SAFE_UNWRAP(info, TNPC, npcObject);
 
 	double timeout = value->NumberValue(info.GetIsolate()->GetCurrentContext()).ToChecked();
-	npcObject->setTimeout((int)(timeout * 20));
+	npcObject->setTimeout(std::chrono::milliseconds((int64_t)(timeout * 1000)));
 }
 
 // PROPERTY: Rupees
@@ -829,7 +829,7 @@ void NPC_Function_SetTimer(const v8::FunctionCallbackInfo<v8::Value>& args)
 		V8ENV_SAFE_UNWRAP(args, TNPC, npcObject);
 
 		double timeout = args[0]->NumberValue(isolate->GetCurrentContext()).ToChecked();
-		npcObject->setTimeout((int)(timeout * 20));
+		npcObject->setTimeout(std::chrono::milliseconds((int64_t)(timeout * 1000)));
 	}
 }
 
@@ -922,7 +922,7 @@ void NPC_Function_ScheduleEvent(const v8::FunctionCallbackInfo<v8::Value>& args)
 
 		// Callback name
 		double time_til = args[0]->NumberValue(context).ToChecked();
-		int timer_frames = (int)(time_til * 20);
+		auto delay = std::chrono::milliseconds((int64_t)(time_til * 1000));
 
 		// Persist the callback function so we can retrieve it later on
 		v8::Local<v8::Function> cbFunc = args[1].As<v8::Function>();
@@ -940,8 +940,7 @@ void NPC_Function_ScheduleEvent(const v8::FunctionCallbackInfo<v8::Value>& args)
 			v8args = ScriptFactory::CreateArguments(env, npcObject->getScriptObject());
 
 		ScriptAction action(cbFuncWrapper, v8args, "_scheduleevent");
-		npcObject->scheduleEvent(timer_frames, action);
-		scriptEngine->RegisterNpcTimer(npcObject);
+		npcObject->scheduleEvent(delay, action);
 	}
 
 	SCRIPTENV_D("End NPC::registerAction()\n");
@@ -1,6 +1,8 @@
 #include <cstring>
+#include <optional>
 #include <libplatform/libplatform.h>
 #include "ScriptBindings.h"
+#include "ScriptCodeCache.h"
 #include "V8ScriptEnv.h"
 #include "V8ScriptFunction.h"
 #include "V8ScriptArguments.h"
@@ -125,7 +127,7 @@ bool V8ScriptEnv::ParseErrors(v8::TryCatch *tryCatch)
 	return false;
 }
 
-IScriptFunction * V8ScriptEnv::Compile(const std::string& name, const std::string& source)
+IScriptFunction * V8ScriptEnv::Compile(const std::string& name, const std::string& source, ScriptCodeCache *codeCache)
 {
 	// Fetch the v8 isolate and context
 	v8::Isolate *isolate = this->Isolate();
@@ -151,14 +153,28 @@ IScriptFunction * V8ScriptEnv::Compile(const std::string& name, const std::strin
 	// Create a string containing the JavaScript source code.
 	v8::Local<v8::String> sourceStr = v8::String::NewFromUtf8(isolate, source.c_str(), v8::NewStringType::kNormal).ToLocalChecked();
 
+	// Use the code cache if this script was compiled before. The source takes ownership of the cached data,
+	// which only points into cachedCode.
+	std::optional<std::string> cachedCode = (codeCache ? codeCache->load(source) : std::nullopt);
+	v8::ScriptCompiler::CachedData *cachedData = nullptr;
+	if (cachedCode)
+		cachedData = new v8::ScriptCompiler::CachedData((const uint8_t *)cachedCode->data(), (int)cachedCode->length());
+
 	// Compile the source code.
 	v8::TryCatch try_catch(isolate);
 	v8::ScriptOrigin origin(v8::String::NewFromUtf8(isolate, name.c_str(), v8::NewStringType::kNormal).ToLocalChecked());
+	v8::ScriptCompiler::Source scriptSource(sourceStr, origin, cachedData);
 	v8::Local<v8::Script> script;
-	if (!v8::Script::Compile(context, sourceStr, &origin).ToLocal(&script)) {
+	auto compileOptions = (cachedData ? v8::ScriptCompiler::kConsumeCodeCache : v8::ScriptCompiler::kNoCompileOptions);
+	if (!v8::ScriptCompiler::Compile(context, &scriptSource, compileOptions).ToLocal(&script)) {
 		ParseErrors(&try_catch);
 		return nullptr;
 	}
+
+	// v8 checks the cached code against its own version, flags and the source, and compiles from source if it doesn't match.
+	bool cacheUsed = (cachedData && !scriptSource.GetCachedData()->rejected);
+	if (cachedData && !cacheUsed)
+		codeCache->reject(source);
 	
 	// Run the script to get the result.
 	v8::Local<v8::Value> result;
@@ -168,6 +184,14 @@ IScriptFunction * V8ScriptEnv::Compile(const std::string& name, const std::strin
 		return nullptr;
 	}
 
+	// Create the cache after running the script, so it includes the functions compiled while it ran.
+	if (codeCache && !cacheUsed)
+	{
+		std::unique_ptr<v8::ScriptCompiler::CachedData> newData(v8::ScriptCompiler::CreateCodeCache(script->GetUnboundScript()));
+		if (newData)
+			codeCache->store(source, std::string_view((const char *)newData->data, newData->length));
+	}
+
 	assert(!try_catch.HasCaught());
 	return new V8ScriptFunction(this, result.As<v8::Function>());
 }
@@ -259,8 +259,8 @@ void Server_Flags_Enumerator(const v8::PropertyCallbackInfo<v8::Array>& info)
 	v8::Local<v8::Array> result = v8::Array::New(isolate, (int)flagList->size());
 
 	int idx = 0;
-	for (auto it = flagList->begin(); it != flagList->end(); ++it)
-		result->Set(context, idx++, v8::String::NewFromUtf8(isolate, it->first.c_str()).ToLocalChecked()).Check();
+	for (auto [flagName, flagValue] : *flagList)
+		result->Set(context, idx++, v8::String::NewFromUtf8(isolate, flagName.text()).ToLocalChecked()).Check();
 
 	info.GetReturnValue().Set(result);
 }
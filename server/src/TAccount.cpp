@@ -3,6 +3,7 @@
 #include <memory.h>
 #include <time.h>
 #include "TAccount.h"
+#include "TAccountIndex.h"
 #include "TServer.h"
 #include "CFileSystem.h"
 
@@ -52,11 +53,21 @@ void TAccount::reset()
 }
 
 bool TAccount::loadAccount(const CString& pAccount, bool ignoreNickname)
+{
+	bool loadedFromDefault = false;
+	if (!readAccount(pAccount, ignoreNickname, loadedFromDefault))
+		return false;
+
+	finishLoading(pAccount, loadedFromDefault);
+	return true;
+}
+
+bool TAccount::readAccount(const CString& pAccount, bool ignoreNickname, bool& loadedFromDefault)
 {
 	// Just in case this account was loaded offline through RC.
 	accountName = pAccount;
 
-	bool loadedFromDefault = false;
+	loadedFromDefault = false;
 	CFileSystem* accfs = server->getAccountsFileSystem();
 	std::vector<CString> fileData;
 
@@ -69,8 +80,12 @@ bool TAccount::loadAccount(const CString& pAccount, bool ignoreNickname)
 		loadedFromDefault = true;
 	}
 
-	// Load file.
-	fileData = CString::loadToken(accpath, "\n");
+	// Load file.  Saves that haven't been written yet are newer than the file.
+	CString pendingData;
+	if (server->getAccountWriter().getPending(accpath, pendingData))
+		fileData = pendingData.tokenize("\n");
+	else
+		fileData = CString::loadToken(accpath, "\n");
 	if (fileData.empty() || fileData[0].trim() != "GRACC001")
 		return false;
 
@@ -105,15 +120,15 @@ bool TAccount::loadAccount(const CString& pAccount, bool ignoreNickname)
 		else if (section == "X") { x = (float)strtofloat(val); }
 		else if (section == "Y") { y = (float)strtofloat(val); }
 		else if (section == "Z") { z = (float)strtofloat(val); }
-		else if (section == "MAXHP") setMaxPower(strtoint(val));
-		else if (section == "HP") setPower((float)strtofloat(val));
+		else if (section == "MAXHP") maxPower = strtoint(val);
+		else if (section == "HP") power = (float)strtofloat(val);
 		else if (section == "RUPEES") gralatc = strtoint(val);
 		else if (section == "ANI") setGani(val);
 		else if (section == "ARROWS") arrowc = strtoint(val);
 		else if (section == "BOMBS") bombc = strtoint(val);
 		else if (section == "GLOVEP") glovePower = strtoint(val);
-		else if (section == "SHIELDP") setShieldPower(strtoint(val));
-		else if (section == "SWORDP") setSwordPower(strtoint(val));
+		else if (section == "SHIELDP") shieldPower = strtoint(val);
+		else if (section == "SWORDP") swordPower = strtoint(val);
 		else if (section == "BOWP") bowPower = strtoint(val);
 		else if (section == "BOW") bowImage = val;
 		else if (section == "HEAD") setHeadImage(val);
@@ -134,7 +149,7 @@ bool TAccount::loadAccount(const CString& pAccount, bool ignoreNickname)
 		else if (section == "RATING") rating = (float)strtofloat(val);
 		else if (section == "DEVIATION") deviation = (float)strtofloat(val);
 		else if (section == "LASTSPARTIME") lastSparTime = strtolong(val);
-		else if (section == "FLAG") setFlag(val);
+		else if (section == "FLAG") { CString flagName = val.readString("="); flagList.set(flagName.text(), val.readString("")); }
 		else if (section == "ATTR1") attrList[0] = val;
 		else if (section == "ATTR2") attrList[1] = val;
 		else if (section == "ATTR3") attrList[2] = val;
@@ -165,8 +180,8 @@ bool TAccount::loadAccount(const CString& pAccount, bool ignoreNickname)
 		else if (section == "ATTR28") attrList[27] = val;
 		else if (section == "ATTR29") attrList[28] = val;
 		else if (section == "ATTR30") attrList[29] = val;
-		else if (section == "WEAPON") weaponList.push_back(val);
-		else if (section == "CHEST") chestList.push_back(val);
+		else if (section == "WEAPON") weaponList.add(val);
+		else if (section == "CHEST") chestList.add(val);
 		else if (section == "BANNED") isBanned = (strtoint(val) == 0 ? false : true);
 		else if (section == "BANREASON") banReason = val;
 		else if (section == "BANLENGTH") banLength = val;
@@ -179,6 +194,19 @@ bool TAccount::loadAccount(const CString& pAccount, bool ignoreNickname)
 		else if (section == "LASTFOLDER") lastFolder = val;
 	}
 
+	return true;
+}
+
+void TAccount::finishLoading(const CString& pAccount, bool loadedFromDefault)
+{
+	// Hearts, shield and sword power and flags are limited by the server settings, so they are only limited now.
+	setMaxPower(maxPower);
+	setPower(power);
+	setShieldPower(shieldPower);
+	setSwordPower(swordPower);
+	for (auto [flagName, flagValue] : flagList)
+		setFlag(flagName.text(), flagValue);
+
 	// If this is a guest account, loadonly is set to true.
 	if (pAccount.toLower() == "guest")
 	{
@@ -230,11 +258,9 @@ bool TAccount::loadAccount(const CString& pAccount, bool ignoreNickname)
 		if (!isLoadOnly)
 		{
 			saveAccount();
-			accfs->addFile(CString() << "accounts/" << pAccount << ".txt");
+			server->getAccountsFileSystem()->addFile(CString() << "accounts/" << pAccount << ".txt");
 		}
 	}
-
-	return true;
 }
 
 bool TAccount::saveAccount()
@@ -289,18 +315,18 @@ bool TAccount::saveAccount()
 	}
 
 	// Chests
-	for (unsigned int i = 0; i < chestList.size(); i++)
-		newFile << "CHEST " << chestList[i] << "\r\n";
+	for (auto chest : chestList)
+		newFile << "CHEST " << TChestList::toString(chest) << "\r\n";
 
 	// Weapons
-	for (unsigned int i = 0; i < weaponList.size(); i++)
-		newFile << "WEAPON " << weaponList[i] << "\r\n";
+	for (auto & weapon : weaponList)
+		newFile << "WEAPON " << weapon << "\r\n";
 
 	// Flags
-	for (auto i = flagList.begin(); i != flagList.end(); ++i)
+	for (auto [flagName, flagValue] : flagList)
 	{
-		newFile << "FLAG " << i->first.c_str();
-		if (!i->second.isEmpty()) newFile << "=" << i->second;
+		newFile << "FLAG " << flagName;
+		if (!flagValue.isEmpty()) newFile << "=" << flagValue;
 		newFile << "\r\n";
 	}
 
@@ -322,13 +348,17 @@ bool TAccount::saveAccount()
 
 	// Get the file name for the account.
 	CString accountFileName = server->getAccountsFileSystem()->fileExistsAs(CString() << accountName << ".txt");
-	if (accountFileName.isEmpty()) accountFileName = CString() << accountName << ".txt";
+	bool isNewAccount = accountFileName.isEmpty();
+	if (isNewAccount) accountFileName = CString() << accountName << ".txt";
 
-	// Save the account now.
+	// Hand the account to the writer, which saves it in the background.
 	CString accpath = CString() << server->getServerPath() << "accounts/" << accountFileName;
 	CFileSystem::fixPathSeparators(accpath);
-	if (!newFile.save(accpath))
-		server->getRCLog().out("** Error saving account: %s\n", accountName.text());
+	server->getAccountWriter().save(accpath, newFile);
+
+	// New accounts are added to the file system right away, so they can be loaded before they are written.
+	if (isNewAccount)
+		server->getAccountsFileSystem()->addFile(CString() << "accounts/" << accountFileName);
 
 	return true;
 }
@@ -338,221 +368,32 @@ bool TAccount::saveAccount()
 */
 bool TAccount::meetsConditions( CString fileName, CString conditions )
 {
-	const char* conditional[] = { ">=", "<=", "!=", "=", ">", "<" };
-
 	// Load and check if the file is valid.
 	std::vector<CString> file;
 	file = CString::loadToken(fileName, "\n", true);
 	if (file.size() == 0 || (file.size() != 0 && file[0] != "GRACC001"))
 		return false;
 
-	// Load the conditions into a string list.
-	std::vector<CString> cond;
-	conditions.removeAllI("'");
-	conditions.replaceAllI("%", "*");
-	cond = conditions.tokenize(",");
-	bool* conditionsMet = new bool[cond.size()];
-	memset((void*)conditionsMet, 0, sizeof(bool) * cond.size());
-
-	// Go through each line of the loaded file.
-	for (std::vector<CString>::iterator i = file.begin(); i != file.end(); ++i)
-	{
-		int sep = (*i).find(' ');
-		CString section = (*i).subString(0, sep);
-		CString val = (*i).subString(sep + 1).removeAll("\r");
-		section.trimI();
-		val.trimI();
-
-		// Check each line against the conditions specified.
-		for (unsigned int j = 0; j < cond.size(); ++j)
-		{
-			int cond_num = -1;
-
-			// Read out the name and value.
-			cond[j].setRead(0);
-
-			// Find out what conditional we are using.
-			for (int k = 0; k < 6; ++k)
-			{
-				if (cond[j].find(conditional[k]) != -1)
-				{
-					cond_num = k;
-					k = 6;
-				}
-			}
-			if (cond_num == -1) continue;
-
-			CString cname = cond[j].readString(conditional[cond_num]);
-			CString cvalue = cond[j].readString("");
-			cname.trimI();
-			cvalue.trimI();
-			cond[j].setRead(0);
-
-			// Now, do a case-insensitive comparison of the section name.
-#ifdef WIN32
-			if (_stricmp(section.text(), cname.text()) == 0)
-#else
-			if (strcasecmp(section.text(), cname.text()) == 0)
-#endif
-			{
-				switch (cond_num)
-				{
-					case 0:
-					case 1:
-					{
-						// 0: >=
-						// 1: <=
-						// Check if it is a number.  If so, do a number comparison.
-						bool condmet = false;
-						if (val.isNumber())
-						{
-							double vNum[2] = { atof(val.text()), atof(cvalue.text()) };
-							if (((cond_num == 1) ? (vNum[0] <= vNum[1]) : (vNum[0] >= vNum[1])))
-							{
-								conditionsMet[j] = true;
-								condmet = true;
-							}
-						}
-						else
-						{
-							// If not a number, do a string comparison.
-							int ret = strcmp(val.text(), cvalue.text());
-							if (((cond_num == 1) ? (ret <= 0) : (ret >= 0)))
-							{
-								conditionsMet[j] = true;
-								condmet = true;
-							}
-						}
-
-						// No conditions met means we see if we can fail.
-						if (condmet == false)
-						{
-							CString cnameUp = cname.toUpper();
-							if (!(cnameUp == "CHEST" || cnameUp == "WEAPON" ||
-								cnameUp == "FLAG" || cnameUp == "FOLDERRIGHT"))
-								goto condAbort;
-						}
-						break;
-					}
-
-					case 4:
-					case 5:
-					{
-						// 4: >
-						// 5: <
-						bool condmet = false;
-						if (val.isNumber())
-						{
-							double vNum[2] = { atof(val.text()), atof(cvalue.text()) };
-							if (((cond_num == 5) ? (vNum[0] < vNum[1]) : (vNum[0] > vNum[1])))
-							{
-								conditionsMet[j] = true;
-								condmet = true;
-							}
-						}
-						else
-						{
-							int ret = strcmp(val.text(), cvalue.text());
-							if (((cond_num == 5) ? (ret < 0) : (ret > 0)))
-							{
-								conditionsMet[j] = true;
-								condmet = true;
-							}
-						}
-
-						if (condmet == false)
-						{
-							CString cnameUp = cname.toUpper();
-							if (!(cnameUp == "CHEST" || cnameUp == "WEAPON" ||
-								cnameUp == "FLAG" || cnameUp == "FOLDERRIGHT"))
-								goto condAbort;
-						}
-						break;
-					}
-
-					case 2:
-					{
-						// 2: !=
-						// If we find a match, return false.
-						if (val.isNumber())
-						{
-							double vNum[2] = { atof(val.text()), atof(cvalue.text()) };
-							if (vNum[0] == vNum[1]) goto condAbort;
-							conditionsMet[j] = true;
-						}
-						else
-						{
-							if (val.match(cvalue.text()) == true) goto condAbort;
-							conditionsMet[j] = true;
-						}
-						break;
-					}
-
-					case 3:
-					default:
-					{
-						// 0 - equals
-						// If it returns false, don't include this account in the search.
-						bool condmet = false;
-						if (val.isNumber())
-						{
-							double vNum[2] = { atof(val.text()), atof(cvalue.text()) };
-							if (vNum[0] == vNum[1])
-							{
-								conditionsMet[j] = true;
-								condmet = true;
-							}
-						}
-						else
-						{
-							if (val.match(cvalue.text()) == true)
-							{
-								conditionsMet[j] = true;
-								condmet = true;
-							}
-						}
-
-						if (condmet == false)
-						{
-							CString cnameUp = cname.toUpper();
-							if (!(cnameUp == "CHEST" || cnameUp == "WEAPON" ||
-								cnameUp == "FLAG" || cnameUp == "FOLDERRIGHT"))
-								goto condAbort;
-						}
-						break;
-					}
-				}
-			}
-		}
-	}
-
-	// Check if all the conditions were met.
-	for (unsigned int i = 0; i < cond.size(); ++i)
-		if (conditionsMet[i] == false) goto condAbort;
-
-	// Clean up.
-	delete [] conditionsMet;
-	return true;
-
-condAbort:
-	delete [] conditionsMet;
-	return false;
+	return TAccountIndex::Query(conditions).matches(file);
 }
 
 
 /*
 	TAccount: Attribute-Managing
 */
-bool TAccount::hasChest(const CString& pChest)
+bool TAccount::hasChest(const CString& pChest) const
+{
+	return chestList.contains(pChest);
+}
+
+bool TAccount::hasChest(TChestList::Key pChest) const
 {
-	auto it = std::find(chestList.begin(), chestList.end(), pChest);
-	return (it != chestList.end());
+	return chestList.contains(pChest);
 }
 
-bool TAccount::hasWeapon(const CString& pWeapon)
+bool TAccount::hasWeapon(const CString& pWeapon) const
 {
-	auto it = std::find(weaponList.begin(), weaponList.end(), pWeapon);
-	return (it != weaponList.end());
+	return weaponList.contains(pWeapon);
 }
 
 /*
@@ -570,9 +411,9 @@ void TAccount::setFlag(const std::string& pFlagName, const CString& pFlagValue)
 	if (server->getSettings()->getBool("cropflags", true))
 	{
 		int fixedLength = 223 - 1 - pFlagName.length();
-		flagList[pFlagName] = pFlagValue.subString(0, fixedLength);
+		flagList.set(pFlagName, pFlagValue.subString(0, fixedLength));
 	}
-	else flagList[pFlagName] = pFlagValue;
+	else flagList.set(pFlagName, pFlagValue);
 }
 
 /*
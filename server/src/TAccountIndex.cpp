@@ -0,0 +1,488 @@
+#include <cstring>
+#include <sys/stat.h>
+#include "TAccountIndex.h"
+
+namespace
+{
+	const char* conditional[] = { ">=", "<=", "!=", "=", ">", "<" };
+
+	void parseLine(const CString& pLine, CString& pSection, CString& pValue)
+	{
+		int sep = pLine.find(' ');
+		pSection = pLine.subString(0, sep);
+		pValue = pLine.subString(sep + 1).removeAll("\r");
+		pSection.trimI();
+		pValue.trimI();
+	}
+
+	TAccountIndex::Value makeValue(const CString& pText)
+	{
+		return TAccountIndex::Value{ pText, atof(pText.text()), pText.isNumber() };
+	}
+}
+
+/*
+	TAccountIndex::Query
+*/
+TAccountIndex::Query::Query(CString pConditions)
+: valid(true)
+{
+	pConditions.removeAllI("'");
+	pConditions.replaceAllI("%", "*");
+
+	for (auto & cond : pConditions.tokenize(","))
+	{
+		int op = -1, pos = -1;
+		for (int k = 0; k < 6; ++k)
+		{
+			pos = cond.find(conditional[k]);
+			if (pos != -1)
+			{
+				op = k;
+				break;
+			}
+		}
+
+		// A condition without an operator can never be met.
+		if (op == -1)
+		{
+			valid = false;
+			continue;
+		}
+
+		CString cname = cond.subString(0, pos);
+		CString cvalue = cond.subString(pos + (int)strlen(conditional[op]));
+		cname.trimI();
+		cvalue.trimI();
+
+		CString cnameUp = cname.toUpper();
+		conditions.push_back(Condition{
+			cnameUp.toString(), op, cvalue, atof(cvalue.text()),
+			cnameUp == "CHEST" || cnameUp == "WEAPON" || cnameUp == "FLAG" || cnameUp == "FOLDERRIGHT"
+		});
+	}
+}
+
+TAccountIndex::Query::Result TAccountIndex::Query::test(const Condition& pCondition, const Value& pValue) const
+{
+	bool condmet;
+	switch (pCondition.op)
+	{
+		// >=, <=, >, <
+		case 0:
+		case 1:
+		case 4:
+		case 5:
+		{
+			int ret;
+			if (pValue.isNumber)
+				ret = (pValue.number < pCondition.number ? -1 : (pValue.number > pCondition.number ? 1 : 0));
+			else
+				ret = strcmp(pValue.text.text(), pCondition.value.text());
+
+			switch (pCondition.op)
+			{
+				case 0: condmet = (ret >= 0); break;
+				case 1: condmet = (ret <= 0); break;
+				case 4: condmet = (ret > 0); break;
+				default: condmet = (ret < 0); break;
+			}
+			break;
+		}
+
+		// != fails the account as soon as a line matches.
+		case 2:
+		{
+			if (pValue.isNumber)
+				return (pValue.number == pCondition.number ? FAILED : MET);
+			return (pValue.text.match(pCondition.value.text()) ? FAILED : MET);
+		}
+
+		// =
+		default:
+		{
+			if (pValue.isNumber)
+				condmet = (pValue.number == pCondition.number);
+			else
+				condmet = pValue.text.match(pCondition.value.text());
+			break;
+		}
+	}
+
+	if (condmet)
+		return MET;
+
+	// Fields that an account has many of can fail on some lines, as long as another one passes.
+	return (pCondition.multiValued ? NOTMET : FAILED);
+}
+
+bool TAccountIndex::Query::matches(const std::vector<CString>& pLines) const
+{
+	if (!valid)
+		return false;
+
+	std::vector<bool> conditionsMet(conditions.size(), false);
+	for (auto & line : pLines)
+	{
+		CString section, val;
+		parseLine(line, section, val);
+		std::string sectionUp = section.toUpper().toString();
+
+		Value value = makeValue(val);
+		for (size_t j = 0; j < conditions.size(); ++j)
+		{
+			if (conditions[j].name != sectionUp)
+				continue;
+
+			Result result = test(conditions[j], value);
+			if (result == FAILED)
+				return false;
+			if (result == MET)
+				conditionsMet[j] = true;
+		}
+	}
+
+	for (bool met : conditionsMet)
+	{
+		if (!met)
+			return false;
+	}
+	return true;
+}
+
+/*
+	TAccountIndex::Column
+*/
+uint32_t TAccountIndex::Column::intern(const CString& pText)
+{
+	auto [it, inserted] = valueIds.emplace(pText.toString(), (uint32_t)values.size());
+	if (!inserted)
+	{
+		++references[it->second];
+		return it->second;
+	}
+
+	if (!freeValues.empty())
+	{
+		it->second = freeValues.back();
+		freeValues.pop_back();
+		values[it->second] = makeValue(pText);
+		references[it->second] = 1;
+	}
+	else
+	{
+		values.push_back(makeValue(pText));
+		references.push_back(1);
+	}
+	return it->second;
+}
+
+void TAccountIndex::Column::release(uint32_t pValue)
+{
+	if (--references[pValue] != 0)
+		return;
+
+	valueIds.erase(values[pValue].text.toString());
+	values[pValue].text.clear();
+	freeValues.push_back(pValue);
+}
+
+void TAccountIndex::Column::add(uint32_t pRow, uint32_t pValue)
+{
+	if (firstValues.size() <= pRow)
+		firstValues.resize(pRow + 1, NoValue);
+
+	if (firstValues[pRow] == NoValue)
+		firstValues[pRow] = pValue;
+	else
+		moreValues[pRow].push_back(pValue);
+}
+
+void TAccountIndex::Column::clear(uint32_t pRow)
+{
+	if (pRow >= firstValues.size() || firstValues[pRow] == NoValue)
+		return;
+
+	release(firstValues[pRow]);
+	firstValues[pRow] = NoValue;
+
+	auto it = moreValues.find(pRow);
+	if (it != moreValues.end())
+	{
+		for (auto value : it->second)
+			release(value);
+		moreValues.erase(it);
+	}
+}
+
+/*
+	TAccountIndex
+*/
+TAccountIndex::TAccountIndex()
+: pendingJobs(0), running(true)
+{
+	worker = std::thread(&TAccountIndex::runWorker, this);
+}
+
+TAccountIndex::~TAccountIndex()
+{
+	{
+		std::scoped_lock lock(queueLock);
+		running = false;
+	}
+
+	queueCondition.notify_all();
+	if (worker.joinable())
+		worker.join();
+}
+
+void TAccountIndex::load(std::shared_ptr<const CFileSystem::FileList> pFileList)
+{
+	Job job{ JOB_LOAD };
+	job.fileList = std::move(pFileList);
+	queueJob(std::move(job));
+}
+
+void TAccountIndex::loadAccount(const CString& pFileName, const CString& pPath)
+{
+	Job job{ JOB_LOADACCOUNT };
+	job.fileName = pFileName;
+	job.path = pPath;
+	queueJob(std::move(job));
+}
+
+void TAccountIndex::removeAccount(const CString& pFileName)
+{
+	Job job{ JOB_REMOVEACCOUNT };
+	job.fileName = pFileName;
+	queueJob(std::move(job));
+}
+
+void TAccountIndex::search(const CString& pName, const CString& pConditions, SearchCallback pCallback)
+{
+	Job job{ JOB_SEARCH };
+	job.name = pName;
+	job.conditions = pConditions;
+	job.callback = std::move(pCallback);
+	queueJob(std::move(job));
+}
+
+void TAccountIndex::update()
+{
+	std::deque<Result> finished;
+	{
+		std::scoped_lock lock(queueLock);
+		if (results.empty())
+			return;
+
+		finished.swap(results);
+	}
+
+	for (auto & result : finished)
+		result.callback(result.accounts);
+}
+
+bool TAccountIndex::isBusy() const
+{
+	std::scoped_lock lock(queueLock);
+	return pendingJobs > 0;
+}
+
+size_t TAccountIndex::getValueCount() const
+{
+	size_t count = 0;
+	for (auto & column : columns)
+		count += column.valueIds.size();
+	return count;
+}
+
+void TAccountIndex::queueJob(Job pJob)
+{
+	{
+		std::scoped_lock lock(queueLock);
+		jobs.push_back(std::move(pJob));
+		++pendingJobs;
+	}
+
+	queueCondition.notify_one();
+}
+
+void TAccountIndex::runWorker()
+{
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock lock(queueLock);
+			queueCondition.wait(lock, [this] { return !running || !jobs.empty(); });
+			if (!running)
+				return;
+
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		switch (job.type)
+		{
+			case JOB_LOAD:
+			{
+				// Drop the accounts that are gone, then read the ones that are new or changed.
+				for (auto it = rows.begin(); it != rows.end();)
+				{
+					auto next = std::next(it);
+					if (job.fileList->find(it->first) == job.fileList->end())
+						removeRow(it->first);
+					it = next;
+				}
+
+				for (auto & [file, path] : *job.fileList)
+					loadFile(file, path, true);
+				break;
+			}
+
+			case JOB_LOADACCOUNT:
+				loadFile(job.fileName, job.path, false);
+				break;
+
+			case JOB_REMOVEACCOUNT:
+				removeRow(job.fileName);
+				break;
+
+			case JOB_SEARCH:
+			{
+				Result result{ std::move(job.callback), find(job.name, job.conditions) };
+				std::scoped_lock lock(queueLock);
+				results.push_back(std::move(result));
+				break;
+			}
+		}
+
+		std::scoped_lock lock(queueLock);
+		--pendingJobs;
+	}
+}
+
+void TAccountIndex::loadFile(const CString& pFileName, const CString& pPath, bool pOnlyIfChanged)
+{
+	struct stat fileStat;
+	if (stat(pPath.text(), &fileStat) == -1)
+	{
+		removeRow(pFileName);
+		return;
+	}
+
+	uint32_t row;
+	auto it = rows.find(pFileName);
+	if (it != rows.end())
+	{
+		row = it->second;
+		Account& account = accounts[row];
+		if (pOnlyIfChanged && account.modTime == fileStat.st_mtime && account.size == (long long)fileStat.st_size)
+			return;
+
+		for (auto & column : columns)
+			column.clear(row);
+	}
+	else if (!freeRows.empty())
+	{
+		row = freeRows.back();
+		freeRows.pop_back();
+		rows[pFileName] = row;
+	}
+	else
+	{
+		row = (uint32_t)accounts.size();
+		accounts.emplace_back();
+		rows[pFileName] = row;
+	}
+
+	std::vector<CString> file = CString::loadToken(pPath, "\n", true);
+	accounts[row] = Account{ fileStat.st_mtime, (long long)fileStat.st_size, !file.empty() && file[0] == "GRACC001" };
+	if (!accounts[row].valid)
+		return;
+
+	for (auto & line : file)
+	{
+		CString section, val;
+		parseLine(line, section, val);
+
+		auto [columnIt, inserted] = columnIds.emplace(section.toUpper().toString(), (uint32_t)columns.size());
+		if (inserted)
+			columns.emplace_back();
+
+		Column& column = columns[columnIt->second];
+		column.add(row, column.intern(val));
+	}
+}
+
+void TAccountIndex::removeRow(const CString& pFileName)
+{
+	auto it = rows.find(pFileName);
+	if (it == rows.end())
+		return;
+
+	for (auto & column : columns)
+		column.clear(it->second);
+
+	freeRows.push_back(it->second);
+	rows.erase(it);
+}
+
+bool TAccountIndex::matches(const Query& pQuery, uint32_t pRow) const
+{
+	if (!pQuery.valid || !accounts[pRow].valid)
+		return false;
+
+	for (auto & condition : pQuery.conditions)
+	{
+		auto columnIt = columnIds.find(condition.name);
+		if (columnIt == columnIds.end())
+			return false;
+
+		const Column& column = columns[columnIt->second];
+		if (pRow >= column.firstValues.size() || column.firstValues[pRow] == NoValue)
+			return false;
+
+		Query::Result result = pQuery.test(condition, column.values[column.firstValues[pRow]]);
+		if (result == Query::FAILED)
+			return false;
+
+		bool met = (result == Query::MET);
+		auto moreIt = column.moreValues.find(pRow);
+		if (moreIt != column.moreValues.end())
+		{
+			for (auto value : moreIt->second)
+			{
+				result = pQuery.test(condition, column.values[value]);
+				if (result == Query::FAILED)
+					return false;
+				if (result == Query::MET)
+					met = true;
+			}
+		}
+
+		if (!met)
+			return false;
+	}
+	return true;
+}
+
+std::vector<CString> TAccountIndex::find(const CString& pName, const CString& pConditions) const
+{
+	Query query(pConditions);
+	bool checkConditions = (pConditions.length() != 0);
+
+	std::vector<CString> found;
+	for (auto & [file, row] : rows)
+	{
+		CString acc = removeExtension(file);
+		if (acc.isEmpty() || !acc.match(pName))
+			continue;
+
+		if (checkConditions && !matches(query, row))
+			continue;
+
+		found.push_back(acc);
+	}
+	return found;
+}
@@ -0,0 +1,113 @@
+#include <algorithm>
+#include "TAccountItems.h"
+#include "InternTable.h"
+#include "stringutils.h"
+
+namespace
+{
+	// Level names of chests, and whole chests that aren't in the "x:y:level" form.
+	utilities::InternTable& getChestNames()
+	{
+		static utilities::InternTable chestNames;
+		return chestNames;
+	}
+
+	utilities::InternTable& getWeaponNames()
+	{
+		static utilities::InternTable weaponNames;
+		return weaponNames;
+	}
+
+	// Keys that don't hold a position are whole chests, with the id in the low bits.
+	constexpr TChestList::Key RawChest = (TChestList::Key)1 << 63;
+
+	// Reads a position the way it is written out, so the chest saves back exactly as it was.
+	bool readPosition(const CString& pText, int& pValue)
+	{
+		if (pText.isEmpty() || pText.length() > 6)
+			return false;
+
+		pValue = strtoint(pText);
+		return pValue >= INT16_MIN && pValue <= INT16_MAX && CString(pValue) == pText;
+	}
+}
+
+TChestList::Key TChestList::makeKey(const CString& pLevel, int pX, int pY)
+{
+	Key level = getChestNames().intern(utilities::toStringView(pLevel));
+	return (level << 32) | ((Key)(uint16_t)pX << 16) | (Key)(uint16_t)pY;
+}
+
+TChestList::Key TChestList::makeKey(const CString& pChest)
+{
+	int xPos = pChest.find(":");
+	int yPos = (xPos >= 0 ? pChest.find(":", xPos + 1) : -1);
+
+	int x, y;
+	if (yPos >= 0 && readPosition(pChest.subString(0, xPos), x) && readPosition(pChest.subString(xPos + 1, yPos - xPos - 1), y))
+		return makeKey(pChest.subString(yPos + 1), x, y);
+
+	return RawChest | getChestNames().intern(utilities::toStringView(pChest));
+}
+
+CString TChestList::toString(Key pKey)
+{
+	if (pKey & RawChest)
+		return getChestNames().get((uint32_t)pKey);
+
+	int x = (int16_t)(uint16_t)(pKey >> 16);
+	int y = (int16_t)(uint16_t)pKey;
+	return CString() << CString(x) << ":" << CString(y) << ":" << getChestNames().get((uint32_t)(pKey >> 32));
+}
+
+bool TChestList::add(Key pKey)
+{
+	if (!keys.insert(pKey).second)
+		return false;
+
+	order.push_back(pKey);
+	return true;
+}
+
+void TChestList::clear()
+{
+	order.clear();
+	keys.clear();
+}
+
+const CString& TWeaponList::getName(uint32_t pId)
+{
+	return getWeaponNames().get(pId);
+}
+
+bool TWeaponList::add(const CString& pWeapon)
+{
+	uint32_t id = getWeaponNames().intern(utilities::toStringView(pWeapon));
+	if (!ids.insert(id).second)
+		return false;
+
+	order.push_back(id);
+	return true;
+}
+
+bool TWeaponList::remove(const CString& pWeapon)
+{
+	uint32_t id = getWeaponNames().find(utilities::toStringView(pWeapon));
+	if (ids.erase(id) == 0)
+		return false;
+
+	order.erase(std::find(order.begin(), order.end(), id));
+	return true;
+}
+
+bool TWeaponList::contains(const CString& pWeapon) const
+{
+	uint32_t id = getWeaponNames().find(utilities::toStringView(pWeapon));
+	return id != utilities::InternTable::InvalidId && ids.find(id) != ids.end();
+}
+
+void TWeaponList::clear()
+{
+	order.clear();
+	ids.clear();
+}
@@ -0,0 +1,81 @@
+#include <algorithm>
+#include "TAccountLoader.h"
+
+TAccountLoader::TAccountLoader(unsigned int pThreadCount)
+: pendingJobs(0), running(true)
+{
+	for (unsigned int i = 0; i < std::max(pThreadCount, 1u); ++i)
+		workers.emplace_back(&TAccountLoader::runWorker, this);
+}
+
+TAccountLoader::~TAccountLoader()
+{
+	{
+		std::scoped_lock lock(queueLock);
+		running = false;
+	}
+
+	queueCondition.notify_all();
+	for (auto & worker : workers)
+	{
+		if (worker.joinable())
+			worker.join();
+	}
+}
+
+void TAccountLoader::load(const TAccount& pAccount, const CString& pAccountName, bool pIgnoreNickname, LoadedCallback pCallback)
+{
+	Job job{ std::make_unique<TAccount>(pAccount), pAccountName, pIgnoreNickname, false, false, std::move(pCallback) };
+
+	{
+		std::scoped_lock lock(queueLock);
+		jobs.push_back(std::move(job));
+		++pendingJobs;
+	}
+
+	queueCondition.notify_one();
+}
+
+void TAccountLoader::update()
+{
+	std::deque<Job> finished;
+	{
+		std::scoped_lock lock(queueLock);
+		if (results.empty())
+			return;
+
+		finished.swap(results);
+	}
+
+	for (auto & job : finished)
+		job.callback(job.valid ? std::move(job.account) : nullptr, job.loadedFromDefault);
+}
+
+bool TAccountLoader::isBusy() const
+{
+	std::scoped_lock lock(queueLock);
+	return pendingJobs > 0;
+}
+
+void TAccountLoader::runWorker()
+{
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock lock(queueLock);
+			queueCondition.wait(lock, [this] { return !running || !jobs.empty(); });
+			if (!running)
+				return;
+
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		job.valid = job.account->readAccount(job.accountName, job.ignoreNickname, job.loadedFromDefault);
+
+		std::scoped_lock lock(queueLock);
+		results.push_back(std::move(job));
+		--pendingJobs;
+	}
+}
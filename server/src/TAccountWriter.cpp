@@ -0,0 +1,249 @@
+#include <cstdio>
+#include <set>
+#if defined(_WIN32) || defined(_WIN64)
+	#include <io.h>
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+#include "TAccountWriter.h"
+#include "CFileSystem.h"
+
+TAccountWriter::TAccountWriter(std::chrono::milliseconds pDelay)
+: delay(pDelay), writeCount(0), flushing(0), running(true)
+{
+	worker = std::thread(&TAccountWriter::runWorker, this);
+}
+
+TAccountWriter::~TAccountWriter()
+{
+	{
+		std::scoped_lock lock(queueLock);
+		running = false;
+	}
+
+	// The worker writes whatever is left before it stops.
+	queueCondition.notify_all();
+	if (worker.joinable())
+		worker.join();
+}
+
+void TAccountWriter::setDelay(std::chrono::milliseconds pDelay)
+{
+	{
+		std::scoped_lock lock(queueLock);
+		delay = pDelay;
+	}
+
+	queueCondition.notify_all();
+}
+
+void TAccountWriter::save(const CString& pPath, const CString& pData)
+{
+	{
+		std::scoped_lock lock(queueLock);
+
+		// A save that is already waiting keeps its place, and just writes the newer contents.
+		auto [it, inserted] = pending.try_emplace(pPath.toString());
+		it->second.data = std::make_shared<const CString>(pData);
+		if (inserted)
+			it->second.queued = std::chrono::steady_clock::now();
+	}
+
+	queueCondition.notify_all();
+}
+
+bool TAccountWriter::discard(const CString& pPath)
+{
+	std::scoped_lock lock(queueLock);
+
+	std::string path = pPath.toString();
+	bool dropped = (pending.erase(path) > 0);
+
+	// The worker checks for this before it moves the file into place.
+	if (writing.erase(path) > 0)
+	{
+		discarded.insert(path);
+		dropped = true;
+	}
+
+	if (dropped)
+		flushCondition.notify_all();
+	return dropped;
+}
+
+bool TAccountWriter::getPending(const CString& pPath, CString& pData) const
+{
+	std::scoped_lock lock(queueLock);
+
+	std::string path = pPath.toString();
+	auto it = pending.find(path);
+	if (it != pending.end())
+	{
+		pData = *it->second.data;
+		return true;
+	}
+
+	auto writingIt = writing.find(path);
+	if (writingIt != writing.end())
+	{
+		pData = *writingIt->second;
+		return true;
+	}
+
+	return false;
+}
+
+void TAccountWriter::flush()
+{
+	std::unique_lock lock(queueLock);
+	++flushing;
+	queueCondition.notify_all();
+	flushCondition.wait(lock, [this] { return pending.empty() && writing.empty(); });
+	--flushing;
+}
+
+std::vector<TAccountWriter::Write> TAccountWriter::update()
+{
+	std::scoped_lock lock(queueLock);
+	std::vector<Write> finished(std::make_move_iterator(written.begin()), std::make_move_iterator(written.end()));
+	written.clear();
+	return finished;
+}
+
+size_t TAccountWriter::getPendingCount() const
+{
+	std::scoped_lock lock(queueLock);
+	return pending.size() + writing.size();
+}
+
+size_t TAccountWriter::getWriteCount() const
+{
+	std::scoped_lock lock(queueLock);
+	return writeCount;
+}
+
+void TAccountWriter::runWorker()
+{
+	std::unique_lock lock(queueLock);
+	for (;;)
+	{
+		queueCondition.wait(lock, [this] { return !running || !pending.empty(); });
+		if (pending.empty())
+			return;
+
+		// Give the oldest save its delay, unless everything has to be written now.
+		for (;;)
+		{
+			if (!running || flushing > 0)
+				break;
+
+			auto oldest = pending.begin()->second.queued;
+			for (auto & [path, entry] : pending)
+			{
+				if (entry.queued < oldest)
+					oldest = entry.queued;
+			}
+
+			if (std::chrono::steady_clock::now() >= oldest + delay)
+				break;
+			queueCondition.wait_until(lock, oldest + delay);
+		}
+
+		// Everything waiting goes out in one batch.
+		for (auto & [path, entry] : pending)
+			writing[path] = std::move(entry.data);
+		pending.clear();
+
+		std::vector<std::pair<std::string, std::shared_ptr<const CString>>> batch(writing.begin(), writing.end());
+		lock.unlock();
+
+		// Write and sync every file first, then move them all into place, then sync the
+		// directories they are in once for the whole batch.
+		std::vector<bool> saved(batch.size());
+		std::set<std::string> directories;
+		for (size_t i = 0; i < batch.size(); ++i)
+			saved[i] = writeFile(batch[i].first + ".tmp", *batch[i].second);
+
+		std::vector<bool> skipped(batch.size());
+		for (size_t i = 0; i < batch.size(); ++i)
+		{
+			const std::string& path = batch[i].first;
+			std::string tempPath = path + ".tmp";
+
+			// Files that were discarded in the meantime are left alone.  The check and the rename
+			// happen under the lock, so a discard either comes before the rename or after it.
+			std::scoped_lock discardLock(queueLock);
+			skipped[i] = (discarded.erase(path) > 0);
+			if (skipped[i])
+			{
+				std::remove(tempPath.c_str());
+				continue;
+			}
+
+			if (!saved[i])
+				continue;
+
+#if defined(_WIN32) || defined(_WIN64)
+			saved[i] = (MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0);
+#else
+			saved[i] = (std::rename(tempPath.c_str(), path.c_str()) == 0);
+#endif
+			if (saved[i])
+				directories.insert(path.substr(0, path.find_last_of(CFileSystem::getPathSeparator()) + 1));
+			else
+				std::remove(tempPath.c_str());
+		}
+
+		for (auto & directory : directories)
+			syncDirectory(directory);
+
+		lock.lock();
+		for (size_t i = 0; i < batch.size(); ++i)
+		{
+			if (skipped[i])
+				continue;
+
+			written.push_back(Write{ CString(batch[i].first), saved[i] });
+			if (saved[i])
+				++writeCount;
+		}
+
+		writing.clear();
+		discarded.clear();
+		flushCondition.notify_all();
+	}
+}
+
+bool TAccountWriter::writeFile(const std::string& pPath, const CString& pData)
+{
+	FILE* file = fopen(pPath.c_str(), "wb");
+	if (file == nullptr)
+		return false;
+
+	bool saved = (fwrite(pData.text(), 1, pData.length(), file) == (size_t)pData.length() && fflush(file) == 0);
+#if defined(_WIN32) || defined(_WIN64)
+	saved = saved && (_commit(_fileno(file)) == 0);
+#else
+	saved = saved && (fsync(fileno(file)) == 0);
+#endif
+	saved = (fclose(file) == 0) && saved;
+
+	if (!saved)
+		std::remove(pPath.c_str());
+	return saved;
+}
+
+void TAccountWriter::syncDirectory(const std::string& pDirectory)
+{
+	// Windows writes the rename through on its own.
+#if !(defined(_WIN32) || defined(_WIN64))
+	int fd = open(pDirectory.empty() ? "." : pDirectory.c_str(), O_RDONLY);
+	if (fd == -1)
+		return;
+
+	fsync(fd);
+	close(fd);
+#endif
+}
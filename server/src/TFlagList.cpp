@@ -0,0 +1,251 @@
+#include <cstring>
+#include "TFlagList.h"
+#include "InternTable.h"
+#include "stringutils.h"
+
+namespace
+{
+	utilities::InternTable& getFlagNames()
+	{
+		static utilities::InternTable flagNames;
+		return flagNames;
+	}
+
+	constexpr uint32_t MinCapacity = 8;
+}
+
+TFlagList::TFlagList()
+: capacity(0), count(0)
+{
+}
+
+TFlagList::~TFlagList()
+{
+	release();
+}
+
+TFlagList::TFlagList(const TFlagList& pOther)
+: capacity(0), count(0)
+{
+	*this = pOther;
+}
+
+TFlagList::TFlagList(TFlagList&& pOther) noexcept
+: slots(std::move(pOther.slots)), capacity(pOther.capacity), count(pOther.count)
+{
+	pOther.capacity = pOther.count = 0;
+}
+
+TFlagList& TFlagList::operator=(const TFlagList& pOther)
+{
+	if (this == &pOther)
+		return *this;
+
+	release();
+	if (pOther.count == 0)
+		return *this;
+
+	slots = std::make_unique<Slot[]>(pOther.capacity);
+	capacity = pOther.capacity;
+	count = pOther.count;
+	for (uint32_t i = 0; i < capacity; ++i)
+	{
+		slots[i].name = pOther.slots[i].name;
+		slots[i].length = 0;
+		if (slots[i].name != EmptySlot)
+			storeValue(slots[i], pOther.slots[i].getValue());
+	}
+
+	return *this;
+}
+
+TFlagList& TFlagList::operator=(TFlagList&& pOther) noexcept
+{
+	if (this == &pOther)
+		return *this;
+
+	release();
+	slots = std::move(pOther.slots);
+	capacity = pOther.capacity;
+	count = pOther.count;
+	pOther.capacity = pOther.count = 0;
+	return *this;
+}
+
+bool TFlagList::contains(std::string_view pName) const
+{
+	uint32_t name = getFlagNames().find(pName);
+	return name != utilities::InternTable::InvalidId && findSlot(name) != EmptySlot;
+}
+
+CString TFlagList::get(std::string_view pName) const
+{
+	uint32_t name = getFlagNames().find(pName);
+	uint32_t index = (name != utilities::InternTable::InvalidId ? findSlot(name) : EmptySlot);
+	if (index == EmptySlot)
+		return CString();
+
+	return getValue(slots[index]);
+}
+
+void TFlagList::set(std::string_view pName, const CString& pValue)
+{
+	uint32_t name = getFlagNames().intern(pName);
+	uint32_t index = findSlot(name);
+	if (index == EmptySlot)
+	{
+		// Keep the table at most three quarters full.
+		if ((count + 1) * 4 > capacity * 3)
+			grow();
+
+		index = homeSlot(name);
+		while (slots[index].name != EmptySlot)
+			index = (index + 1) & (capacity - 1);
+
+		slots[index].name = name;
+		slots[index].length = 0;
+		++count;
+	}
+
+	storeValue(slots[index], utilities::toStringView(pValue));
+}
+
+bool TFlagList::erase(std::string_view pName)
+{
+	uint32_t name = getFlagNames().find(pName);
+	uint32_t index = (name != utilities::InternTable::InvalidId ? findSlot(name) : EmptySlot);
+	if (index == EmptySlot)
+		return false;
+
+	storeValue(slots[index], std::string_view());
+	slots[index].name = EmptySlot;
+	--count;
+
+	// Move the flags that follow back into the gap if that brings them closer to their home
+	// slot, so lookups never have to step over removed flags.
+	uint32_t mask = capacity - 1;
+	uint32_t gap = index;
+	for (uint32_t next = (gap + 1) & mask; slots[next].name != EmptySlot; next = (next + 1) & mask)
+	{
+		uint32_t home = homeSlot(slots[next].name);
+		if (((next - home) & mask) >= ((next - gap) & mask))
+		{
+			slots[gap] = slots[next];
+			slots[next].name = EmptySlot;
+			slots[next].length = 0;
+			gap = next;
+		}
+	}
+
+	return true;
+}
+
+void TFlagList::clear()
+{
+	release();
+}
+
+bool TFlagList::operator==(const TFlagList& pOther) const
+{
+	if (count != pOther.count)
+		return false;
+
+	for (uint32_t i = 0; i < capacity; ++i)
+	{
+		if (slots[i].name == EmptySlot)
+			continue;
+
+		uint32_t index = pOther.findSlot(slots[i].name);
+		if (index == EmptySlot || pOther.slots[index].getValue() != slots[i].getValue())
+			return false;
+	}
+
+	return true;
+}
+
+TFlagList::Flag TFlagList::getFlag(uint32_t pIndex) const
+{
+	return Flag(getFlagNames().get(slots[pIndex].name), getValue(slots[pIndex]));
+}
+
+CString TFlagList::getValue(const Slot& pSlot)
+{
+	CString value;
+	if (pSlot.length > 0)
+		value.write(pSlot.getText(), (int)pSlot.length);
+	return value;
+}
+
+uint32_t TFlagList::findSlot(uint32_t pName) const
+{
+	if (count == 0)
+		return EmptySlot;
+
+	for (uint32_t index = homeSlot(pName); slots[index].name != EmptySlot; index = (index + 1) & (capacity - 1))
+	{
+		if (slots[index].name == pName)
+			return index;
+	}
+
+	return EmptySlot;
+}
+
+uint32_t TFlagList::homeSlot(uint32_t pName) const
+{
+	// Name ids are handed out in order, so spread them out before picking a slot.
+	return (uint32_t)(((uint64_t)pName * 0x9E3779B97F4A7C15ull) >> 32) & (capacity - 1);
+}
+
+void TFlagList::storeValue(Slot& pSlot, std::string_view pValue)
+{
+	if (pSlot.length > InlineLength)
+		delete[] pSlot.heapText;
+
+	pSlot.length = (uint32_t)pValue.length();
+	if (pSlot.length > InlineLength)
+	{
+		pSlot.heapText = new char[pSlot.length];
+		memcpy(pSlot.heapText, pValue.data(), pSlot.length);
+	}
+	else if (pSlot.length > 0)
+		memcpy(pSlot.text, pValue.data(), pSlot.length);
+}
+
+void TFlagList::grow()
+{
+	uint32_t newCapacity = (capacity == 0 ? MinCapacity : capacity * 2);
+	auto oldSlots = std::move(slots);
+	uint32_t oldCapacity = capacity;
+
+	slots = std::make_unique<Slot[]>(newCapacity);
+	capacity = newCapacity;
+	for (uint32_t i = 0; i < capacity; ++i)
+	{
+		slots[i].name = EmptySlot;
+		slots[i].length = 0;
+	}
+
+	// The values move along with their slots, heap copies included.
+	for (uint32_t i = 0; i < oldCapacity; ++i)
+	{
+		if (oldSlots[i].name == EmptySlot)
+			continue;
+
+		uint32_t index = homeSlot(oldSlots[i].name);
+		while (slots[index].name != EmptySlot)
+			index = (index + 1) & (capacity - 1);
+		slots[index] = oldSlots[i];
+	}
+}
+
+void TFlagList::release()
+{
+	for (uint32_t i = 0; i < capacity; ++i)
+	{
+		if (slots[i].name != EmptySlot && slots[i].length > InlineLength)
+			delete[] slots[i].heapText;
+	}
+
+	slots.reset();
+	capacity = count = 0;
+}
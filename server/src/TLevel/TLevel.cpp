@@ -1,5 +1,3 @@
-#include <set>
-#include <tiletypes.h>
 #include <cmath>
 #include "IDebug.h"
 #include "IEnums.h"
@@ -55,6 +53,9 @@ server(pServer), modTime(0), levelSpar(false), levelSingleplayer(false), levelMa
 
 TLevel::~TLevel()
 {
+	// Stop any pending respawns and timeouts.
+	cancelAllTimers();
+
 	// Delete NPCs.
 	{
 		// Remove every NPC in the level.
@@ -65,6 +66,9 @@ TLevel::~TLevel()
 				server->deleteNPC(levelNPC, false);
 		}
 		levelNPCs.clear();
+#ifdef V8NPCSERVER
+		npcGrid.clear();
+#endif
 	}
 
 	// Delete baddies.
@@ -143,24 +147,14 @@ CString TLevel::getLayerPacket(int layer)
 CString TLevel::getBoardChangesPacket(time_t time)
 {
 	CString retVal;
-	retVal >> (char)PLO_LEVELBOARD;
-	for (const auto& change : levelBoardChanges)
-	{
-		if (change.getModTime() >= time)
-			retVal << change.getBoardStr();
-	}
+	retVal >> (char)PLO_LEVELBOARD << levelBoardChanges.getBoardStr(time);
 	return retVal;
 }
 
 CString TLevel::getBoardChangesPacket2(time_t time)
 {
 	CString retVal;
-	retVal >> (char)PLO_BOARDMODIFY;
-	for (const auto& change : levelBoardChanges)
-	{
-		if (change.getModTime() >= time)
-			retVal << change.getBoardStr();
-	}
+	retVal >> (char)PLO_BOARDMODIFY << levelBoardChanges.getBoardStr(time);
 	return retVal;
 }
 
@@ -170,9 +164,10 @@ CString TLevel::getChestPacket(TPlayer *pPlayer)
 
 	if (pPlayer)
 	{
-		for (auto& chest : levelChests)
+		for (size_t i = 0; i < levelChests.size(); ++i)
 		{
-			bool hasChest = pPlayer->hasChest(getChestStr(chest));
+			const TLevelChest& chest = levelChests[i];
+			bool hasChest = pPlayer->hasChest(levelChestKeys[i]);
 
 			retVal >> (char)PLO_LEVELCHEST >> (char)(hasChest ? 1 : 0) >> (char)chest.getX() >> (char)chest.getY();
 			if (!hasChest) retVal >> (char)chest.getItemIndex() >> (char)chest.getSignIndex();
@@ -213,19 +208,23 @@ CString TLevel::getNpcsPacket(time_t time, int clientVersion)
 		retVal >> (char)PLO_NPCPROPS >> (int)npc->getId() << npc->getProps(time, clientVersion) << "\n";
 
 		if (clientVersion >= CLVER_4_0211 && !npc->getByteCode().isEmpty())
-		{
-			CString byteCodePacket = CString() >> (char)PLO_NPCBYTECODE >> (int)npc->getId() << npc->getByteCode();
-			if (byteCodePacket[byteCodePacket.length() - 1] != '\n')
-				byteCodePacket << "\n";
-
-			retVal >> (char)PLO_RAWDATA >> (int)byteCodePacket.length() << "\n";
-			retVal << byteCodePacket;
-		}
+			retVal << npc->getByteCodePacket();
 	}
 
 	return retVal;
 }
 
+bool TLevel::isCompilingScripts() const
+{
+	for (auto npc : levelNPCs)
+	{
+		if (server->isCompilingGS2(npc))
+			return true;
+	}
+
+	return false;
+}
+
 CString TLevel::getSignsPacket(TPlayer *pPlayer = 0)
 {
 	CString retVal;
@@ -241,6 +240,9 @@ CString TLevel::getSignsPacket(TPlayer *pPlayer = 0)
 */
 bool TLevel::reload()
 {
+	// Stop any pending respawns and timeouts.
+	cancelAllTimers();
+
 	// Delete NPCs.
 	// Don't delete NPCs if this level is on a gmap!  If we are on a gmap, just set them
 	// back to their original positions.
@@ -253,6 +255,9 @@ bool TLevel::reload()
 			{
 				server->deleteNPC(npc, false);
 				it = levelNPCs.erase(it);
+#ifdef V8NPCSERVER
+				npcGrid.remove(npc);
+#endif
 			}
 			else
 			{
@@ -262,6 +267,7 @@ bool TLevel::reload()
 				it++;
 			}
 		}
+		levelNPCDefs.clear();
 	}
 
 	// Delete baddies.
@@ -286,6 +292,17 @@ bool TLevel::reload()
 			player->sendPacket(packet);
 	}
 	levelItems.clear();
+	itemIndex.clear();
+
+	// Delete horses.  Their timers were cancelled above, so they would never expire otherwise.
+	for (const auto& horse : levelHorses)
+	{
+		CString packet = CString() >> (char)PLO_HORSEDEL >> (char)(horse.getX() * 2) >> (char)(horse.getY() * 2);
+		for (auto player : levelPlayerList)
+			player->sendPacket(packet);
+	}
+	levelHorses.clear();
+	horseIndex.clear();
 
 	// Delete board changes.
 	levelBoardChanges.clear();
@@ -340,11 +357,35 @@ bool TLevel::loadLevel(const CString& pLevelName)
 	server->getScriptEngine()->wrapScriptObject(this);
 #endif
 
+	bool ret = parseLevel(pLevelName);
+
+	// Build the collision bitmaps from the loaded board.
+	collisionMap.rebuild(levelTiles[0]);
+
+	// Index the links, chests and signs by tile.
+	rebuildObjectIndexes();
+
+	// Create the level npcs once the rest of the level is in place.
+	for (auto& definition : levelNPCDefs)
+		spawnNPC(definition, false);
+
+	return ret;
+}
+
+bool TLevel::parseLevel(const CString& pLevelName)
+{
 	CString ext(getExtension(pLevelName));
 	if (ext == ".nw") return loadNW(pLevelName);
-	else if (ext == ".graal") return loadGraal(pLevelName);
-	else if (ext == ".zelda") return loadZelda(pLevelName);
-	else return detectLevelType(pLevelName);
+	if (ext == ".graal") return loadGraal(pLevelName);
+	if (ext == ".zelda") return loadZelda(pLevelName);
+	return detectLevelType(pLevelName);
+}
+
+TNPC* TLevel::spawnNPC(NPCDefinition& definition, bool sendToPlayers)
+{
+	definition.npc = server->addNPC(definition.image, definition.code, definition.x, definition.y, this, true, sendToPlayers);
+	addNPC(definition.npc);
+	return definition.npc;
 }
 
 bool TLevel::detectLevelType(const CString& pLevelName)
@@ -736,8 +777,7 @@ bool TLevel::loadGraal(const CString& pLevelName)
 			CString image = line.readString("#");
 			CString code = line.readString("").replaceAll("\xa7", "\n");
 
-			TNPC* npc = server->addNPC(image, code, x, y, this, true, false);
-			levelNPCs.push_back(npc);
+			levelNPCDefs.push_back(NPCDefinition{ image, code, (float)x, (float)y, nullptr });
 		}
 	}
 
@@ -898,8 +938,7 @@ bool TLevel::loadNW(const CString& pLevelName)
 			}
 			//printf( "image: %s, x: %.2f, y: %.2f, code: %s\n", image.text(), x, y, code.text() );
 			// Add the new NPC.
-			TNPC* npc = server->addNPC(image, code, x, y, this, true, false);
-			levelNPCs.push_back(npc);
+			levelNPCDefs.push_back(NPCDefinition{ image, code, x, y, nullptr });
 		}
 		else if (curLine[0] == "SIGN")
 		{
@@ -1063,16 +1102,8 @@ bool TLevel::alterBoard(CString& pTileData, int pX, int pY, int pWidth, int pHei
 	}
 
 	// Delete any existing changes within the same region.
-	for (auto i = levelBoardChanges.begin(); i != levelBoardChanges.end(); )
-	{
-		TLevelBoardChange& change = *i;
-		if ((change.getX() >= pX && change.getX() + change.getWidth() <= pX + pWidth) &&
-			(change.getY() >= pY && change.getY() + change.getHeight() <= pY + pHeight))
-		{
-			i = levelBoardChanges.erase(i);
-		}
-		else ++i;
-	}
+	for (auto& change : levelBoardChanges.eraseWithin(pX, pY, pWidth, pHeight))
+		cancelTimer(change.timer);
 
 	// Check if the tiles should be respawned.
 	// Only tiles in the respawningTiles array are allowed to respawn.
@@ -1097,7 +1128,15 @@ bool TLevel::alterBoard(CString& pTileData, int pX, int pY, int pWidth, int pHei
 
 	// TODO: old gserver didn't save the board change if oldTiles.length() == 0.
 	// Should we do it that way still?
-	levelBoardChanges.push_back(TLevelBoardChange(pX, pY, pWidth, pHeight, pTileData, oldTiles, (doRespawn ? respawnTime : -1)));
+	updateCollisionMap(pX, pY, pWidth, pHeight, pTileData);
+
+	auto changeId = levelBoardChanges.addChange(TLevelBoardChange(pX, pY, pWidth, pHeight, pTileData, oldTiles, (doRespawn ? respawnTime : -1)));
+	if (doRespawn && changeId != TLevelBoardChangeList::InvalidId)
+	{
+		levelBoardChanges.getChange(changeId)->timer = scheduleTimer(respawnTime, [this, changeId]() {
+			respawnBoardChange(changeId);
+		});
+	}
 	return true;
 }
 
@@ -1182,44 +1221,66 @@ bool TLevel::addItem(float pX, float pY, LevelItemType pItem)
 #endif
 #endif
 
-	levelItems.push_back(TLevelItem(pX, pY, pItem));
+	// Items disappear after a while.  This allows us to delete items that have disappeared
+	// if nobody is in the level to send the PLI_ITEMDEL packet.
+	auto item = levelItems.emplace(levelItems.end(), pX, pY, pItem);
+	itemIndex.insert(toLevelTile(pX), toLevelTile(pY), item);
+	item->timer = scheduleTimer(TLevelItem::Lifetime, [this, item]() {
+		eraseItem(item);
+	});
 	return true;
 }
 
 LevelItemType TLevel::removeItem(float pX, float pY)
 {
-	for (auto i = levelItems.begin(); i != levelItems.end(); ++i)
-	{
-		TLevelItem& item = *i;
-		if (item.getX() == pX && item.getY() == pY)
-		{
-			LevelItemType itemType = item.getItem();
-			levelItems.erase(i);
-			return itemType;
-		}
-	}
+	auto found = itemIndex.find(toLevelTile(pX), toLevelTile(pY), [pX, pY](const auto& item) {
+		return item->getX() == pX && item->getY() == pY;
+	});
+	if (found == nullptr)
+		return LevelItemType::INVALID;
+
+	auto item = *found;
+	LevelItemType itemType = item->getItem();
+	cancelTimer(item->timer);
+	eraseItem(item);
+	return itemType;
+}
 
-	return LevelItemType::INVALID;
+void TLevel::eraseItem(std::list<TLevelItem>::iterator item)
+{
+	itemIndex.erase(toLevelTile(item->getX()), toLevelTile(item->getY()), item);
+	levelItems.erase(item);
 }
 
 bool TLevel::addHorse(CString& pImage, float pX, float pY, char pDir, char pBushes)
 {
 	auto horseLife = server->getSettings()->getInt("horselifetime", 30);
-	levelHorses.push_back(TLevelHorse(horseLife, pImage, pX, pY, pDir, pBushes));
+	auto horse = levelHorses.emplace(levelHorses.end(), horseLife, pImage, pX, pY, pDir, pBushes);
+	horseIndex.insert(toLevelTile(pX), toLevelTile(pY), horse);
+	horse->timer = scheduleTimer(horse->getLifetime(), [this, horse]() {
+		server->sendPacketToLevel(CString() >> (char)PLO_HORSEDEL >> (char)(horse->getX() * 2) >> (char)(horse->getY() * 2), 0, this);
+		eraseHorse(horse);
+	});
 	return true;
 }
 
 void TLevel::removeHorse(float pX, float pY)
 {
-	for (auto it = levelHorses.begin(); it != levelHorses.end(); ++it)
-	{
-		TLevelHorse& horse = *it;
-		if (horse.getX() == pX && horse.getY() == pY)
-		{
-			levelHorses.erase(it);
-			return;
-		}
-	}
+	auto found = horseIndex.find(toLevelTile(pX), toLevelTile(pY), [pX, pY](const auto& horse) {
+		return horse->getX() == pX && horse->getY() == pY;
+	});
+	if (found == nullptr)
+		return;
+
+	auto horse = *found;
+	cancelTimer(horse->timer);
+	eraseHorse(horse);
+}
+
+void TLevel::eraseHorse(std::list<TLevelHorse>::iterator horse)
+{
+	horseIndex.erase(toLevelTile(horse->getX()), toLevelTile(horse->getY()), horse);
+	levelHorses.erase(horse);
 }
 
 TLevelBaddy* TLevel::addBaddy(float pX, float pY, char pType)
@@ -1273,6 +1334,7 @@ void TLevel::removeBaddy(char pId)
 	levelBaddyIds[pId] = nullptr;
 
 	// Clean up.
+	cancelTimer(baddy->timer);
 	delete baddy;
 }
 
@@ -1338,6 +1400,10 @@ bool TLevel::addNPC(TNPC* npc)
 	}
 
 	levelNPCs.push_back(npc);
+#ifdef V8NPCSERVER
+	npcGrid.insert(npc, 0, 0, 0, 0, 0);
+	updateNPC(npc);
+#endif
 	return true;
 }
 
@@ -1350,6 +1416,17 @@ void TLevel::removeNPC(TNPC* npc)
 			i = levelNPCs.erase(i);
 		else ++i;
 	}
+
+	// Level npcs that are removed no longer belong to their definition.
+	for (auto& definition : levelNPCDefs)
+	{
+		if (definition.npc == npc)
+			definition.npc = nullptr;
+	}
+
+#ifdef V8NPCSERVER
+	npcGrid.remove(npc);
+#endif
 }
 
 void TLevel::setMap(TMap* pMap, int pMapX, int pMapY)
@@ -1359,107 +1436,91 @@ void TLevel::setMap(TMap* pMap, int pMapX, int pMapY)
 	mapy = pMapY;
 }
 
-bool TLevel::doTimedEvents()
+utilities::TimerHandle TLevel::scheduleTimer(int seconds, std::function<void()> callback)
 {
-	// Check if we should revert any board changes.
-	for (auto& change : levelBoardChanges)
-	{
-		int respawnTimer = change.timeout.doTimeout();
-		if (respawnTimer == 0)
-		{
-			// Put the old data back in.  DON'T DELETE THE CHANGE.
-			// The client remembers board changes and if we delete the
-			// change, the client won't get the new data.
-			change.swapTiles();
-			change.setModTime(time(0));
-			server->sendPacketToLevel(CString() >> (char)PLO_BOARDMODIFY << change.getBoardStr(), 0, this);
-		}
-	}
+	if (seconds <= 0)
+		return {};
 
-	// Check if any items have timed out.
-	// This allows us to delete items that have disappeared if nobody is in the level to send
-	// the PLI_ITEMDEL packet.
-	for (auto i = levelItems.begin(); i != levelItems.end(); )
-	{
-		TLevelItem& item = *i;
-		int deleteTimer = item.timeout.doTimeout();
-		if (deleteTimer == 0)
-		{
-			i = levelItems.erase(i);
-		}
-		else ++i;
-	}
+	auto& levelTimers = server->getLevelTimers();
+	return levelTimers.schedule(levelTimers.getCurrentTick() + seconds, std::move(callback));
+}
+
+void TLevel::cancelTimer(utilities::TimerHandle& handle)
+{
+	if (handle.isSet())
+		server->getLevelTimers().cancel(handle);
+}
+
+void TLevel::cancelAllTimers()
+{
+	levelBoardChanges.forEach([this](auto id, TLevelBoardChange& change) {
+		cancelTimer(change.timer);
+	});
+
+	for (auto& item : levelItems)
+		cancelTimer(item.timer);
+
+	for (auto& horse : levelHorses)
+		cancelTimer(horse.timer);
+
+	for (auto baddy : levelBaddies)
+		cancelTimer(baddy->timer);
+}
+
+void TLevel::setBaddyTimeout(TLevelBaddy* baddy, int seconds)
+{
+	cancelTimer(baddy->timer);
+	baddy->timer = scheduleTimer(seconds, [this, baddy]() {
+		doBaddyTimeout(baddy);
+	});
+}
+
+void TLevel::respawnBoardChange(TLevelBoardChangeList::ChangeId id)
+{
+	TLevelBoardChange* change = levelBoardChanges.getChange(id);
+	if (change == nullptr)
+		return;
+
+	// Put the old data back in.  DON'T DELETE THE CHANGE.
+	// The client remembers board changes and if we delete the
+	// change, the client won't get the new data.
+	change->swapTiles();
+	levelBoardChanges.setModTime(id, time(0));
+	updateCollisionMap(change->getX(), change->getY(), change->getWidth(), change->getHeight(), change->getTiles());
+	server->sendPacketToLevel(CString() >> (char)PLO_BOARDMODIFY << change->getBoardStr(), 0, this);
+}
 
-	// Check if any horses need to be deleted.
-	for (auto i = levelHorses.begin(); i != levelHorses.end(); )
+void TLevel::doBaddyTimeout(TLevelBaddy* baddy)
+{
+	if (baddy->getType() == 4 /*swamp arrow baddy*/ && baddy->getMode() == BDMODE_HURT)
 	{
-		TLevelHorse& horse = *i;
-		int deleteTimer = horse.timeout.doTimeout();
-		if (deleteTimer == 0)
+		if (baddy->getPower() == 1)
 		{
-			server->sendPacketToLevel(CString() >> (char)PLO_HORSEDEL >> (char)(horse.getX() * 2) >> (char)(horse.getY() * 2), 0, this);
-			i = levelHorses.erase(i);
+			// Unset the hurt mode on the baddy.
+			CString props = CString() >> (char)BDPROP_MODE >> (char)BDMODE_SWAMPSHOT;
+			baddy->setProps(props);
+			for (unsigned int i = 1; i < levelPlayerList.size(); ++i)
+				levelPlayerList[i]->sendPacket(CString() >> (char)PLO_BADDYPROPS >> (char)baddy->getId() << props);
 		}
-		else ++i;
 	}
-
-	// Check if any baddies need to be marked as dead or respawned.
-	std::set<TLevelBaddy*> set_dead;
-	for (auto i = levelBaddies.begin(); i != levelBaddies.end(); )
+	else if (baddy->getMode() == BDMODE_DIE)
 	{
-		TLevelBaddy* baddy = *i;
-		if (baddy == nullptr)
-		{
-			i = levelBaddies.erase(i);
-			continue;
-		}
-		++i;
+		// Set the baddy as dead for all the other players in the level.
+		CString props = CString() >> (char)BDPROP_MODE >> (char)BDMODE_DEAD;
+		for (unsigned int i = 1; i < levelPlayerList.size(); ++i)
+			levelPlayerList[i]->sendPacket(CString() >> (char)PLO_BADDYPROPS >> (char)baddy->getId() << props);
 
-		// See if we can respawn him.
-		int respawnTimer = baddy->timeout.doTimeout();
-		if (respawnTimer == 0)
-		{
-			if (baddy->getType() == 4 /*swamp arrow baddy*/ && baddy->getMode() == BDMODE_HURT)
-			{
-				if (baddy->getPower() == 1)
-				{
-					// Unset the hurt mode on the baddy.
-					CString props = CString() >> (char)BDPROP_MODE >> (char)BDMODE_SWAMPSHOT;
-					baddy->setProps(props);
-					for (unsigned int i = 1; i < levelPlayerList.size(); ++i)
-						levelPlayerList[i]->sendPacket(CString() >> (char)PLO_BADDYPROPS >> (char)baddy->getId() << props);
-				}
-			}
-			else if (baddy->getMode() == BDMODE_DIE)
-			{
-				// Setting the baddy props could delete the baddy and invalidate our iterator.
-				// So, save a list of all the baddies we are setting as dead and do it after this loop.
-				set_dead.insert(baddy);
-
-				// Set the baddy as dead for all the other players in the level.
-				CString props = CString() >> (char)BDPROP_MODE >> (char)BDMODE_DEAD;
-				for (unsigned int i = 1; i < levelPlayerList.size(); ++i)
-					levelPlayerList[i]->sendPacket(CString() >> (char)PLO_BADDYPROPS >> (char)baddy->getId() << props);
-			}
-			else
-			{
-				baddy->reset();
-				for (auto p : levelPlayerList)
-				{
-					p->sendPacket(CString() >> (char)PLO_BADDYPROPS >> (char)baddy->getId() << baddy->getProps(p->getVersion()));
-				}
-			}
-		}
+		// Setting the baddy props could delete the baddy, so do it last.
+		baddy->setProps(props);
 	}
-	{	// Mark all the baddies as dead now.
-		CString props = CString() >> (char)BDPROP_MODE >> (char)BDMODE_DEAD;
-		for (auto baddy : set_dead)
+	else
+	{
+		baddy->reset();
+		for (auto p : levelPlayerList)
 		{
-			baddy->setProps(props);
+			p->sendPacket(CString() >> (char)PLO_BADDYPROPS >> (char)baddy->getId() << baddy->getProps(p->getVersion()));
 		}
 	}
-
-	return true;
 }
 
 bool TLevel::isOnWall(int pX, int pY) const
@@ -1469,124 +1530,141 @@ bool TLevel::isOnWall(int pX, int pY) const
 		return true;
 	}
 
-	return tiletypes[levelTiles[0][pY * 64 + pX]] >= 20;
+	return collisionMap.test(TILECLASS_WALL, pX, pY);
 }
 
 bool TLevel::isOnWall2(int pX, int pY, int pWidth, int pHeight, uint8_t flags) const
 {
-	for (int cy = pY; cy < pY + pHeight; ++cy)
-	{
-		for (int cx = pX; cx < pX + pWidth; ++cx)
-		{
-			if (isOnWall(cx, cy))
-			{
-				return true;
-			}
-		}
-	}
+	if (pWidth <= 0 || pHeight <= 0)
+		return false;
 
-	return false;
+	// Any part of the area outside of the board counts as a wall.
+	if (pX < 0 || pY < 0 || pX + pWidth > 64 || pY + pHeight > 64)
+		return true;
+
+	return collisionMap.testArea(TILECLASS_WALL, pX, pY, pWidth, pHeight);
 }
 
 bool TLevel::isOnWater(int pX, int pY) const
 {
-	return (tiletypes[levelTiles[0][pY * 64 + pX]] == 11);
+	return collisionMap.test(TILECLASS_WATER, pX, pY);
 }
 
-std::optional<TLevelLink> TLevel::getLink(int pX, int pY) const
+void TLevel::updateCollisionMap(int pX, int pY, int pWidth, int pHeight, CString pTileData)
 {
-	for (const auto& link : levelLinks)
+	pTileData.setRead(0);
+	for (int j = pY; j < pY + pHeight; ++j)
 	{
-		if ((pX >= link.getX() && pX <= link.getX() + link.getWidth()) &&
-			(pY >= link.getY() && pY <= link.getY() + link.getHeight()))
+		for (int i = pX; i < pX + pWidth; ++i)
 		{
-			return std::make_optional(link);
+			if (pTileData.bytesLeft() < 2)
+				return;
+			collisionMap.setTile(i, j, pTileData.readGShort());
 		}
 	}
-
-	return std::nullopt;
 }
 
-std::optional<TLevelChest> TLevel::getChest(int x, int y) const
+void TLevel::rebuildObjectIndexes()
 {
-	for (const auto& chest : levelChests)
+	linkIndex.clear();
+	for (uint32_t i = 0; i < levelLinks.size(); ++i)
 	{
-		if (chest.getX() == x && chest.getY() == y)
-		{
-			return std::make_optional(chest);
-		}
+		const TLevelLink& link = levelLinks[i];
+		linkIndex.insertArea(link.getX(), link.getY(), link.getX() + link.getWidth(), link.getY() + link.getHeight(), i);
 	}
 
-	return std::nullopt;
+	// Chest keys only depend on the level name, so build them once instead of on every lookup.
+	chestIndex.clear();
+	levelChestKeys.clear();
+	levelChestKeys.reserve(levelChests.size());
+	for (uint32_t i = 0; i < levelChests.size(); ++i)
+	{
+		const TLevelChest& chest = levelChests[i];
+		chestIndex.insert(chest.getX(), chest.getY(), i);
+		levelChestKeys.push_back(TChestList::makeKey(levelName, chest.getX(), chest.getY()));
+	}
+
+	signIndex.clear();
+	for (uint32_t i = 0; i < levelSigns.size(); ++i)
+		signIndex.insert(levelSigns[i].getX(), levelSigns[i].getY(), i);
+}
+
+std::optional<TLevelLink> TLevel::getLink(int pX, int pY) const
+{
+	auto found = linkIndex.find(pX, pY, [this, pX, pY](uint32_t index) {
+		const TLevelLink& link = levelLinks[index];
+		return (pX >= link.getX() && pX <= link.getX() + link.getWidth()) &&
+			(pY >= link.getY() && pY <= link.getY() + link.getHeight());
+	});
+
+	if (found == nullptr)
+		return std::nullopt;
+
+	return std::make_optional(levelLinks[*found]);
+}
+
+std::optional<TLevelChest> TLevel::getChest(int x, int y) const
+{
+	auto found = chestIndex.find(x, y, [this, x, y](uint32_t index) {
+		return levelChests[index].getX() == x && levelChests[index].getY() == y;
+	});
+
+	if (found == nullptr)
+		return std::nullopt;
+
+	return std::make_optional(levelChests[*found]);
 }
 
-CString TLevel::getChestStr(const TLevelChest& chest) const
+TChestList::Key TLevel::getChestKey(const TLevelChest& chest) const
 {
-	static char retVal[500];
-	sprintf(retVal, "%i:%i:%s", chest.getX(), chest.getY(), levelName.text());
-	return retVal;
+	auto found = chestIndex.find(chest.getX(), chest.getY(), [this, &chest](uint32_t index) {
+		return levelChests[index].getX() == chest.getX() && levelChests[index].getY() == chest.getY();
+	});
+
+	if (found != nullptr)
+		return levelChestKeys[*found];
+
+	return TChestList::makeKey(levelName, chest.getX(), chest.getY());
 }
 
 #ifdef V8NPCSERVER
 
-std::vector<TNPC*> TLevel::findAreaNpcs(int pX, int pY, int pWidth, int pHeight)
+void TLevel::updateNPC(TNPC* npc)
 {
-	int testEndX = pX + pWidth;
-	int testEndY = pY + pHeight;
+	uint8_t flags = 0;
+	if ((npc->getVisibleFlags() & NPCVISFLAG_VISIBLE) != 0)
+		flags |= NPCGRIDFLAG_VISIBLE;
+	if (npc->hasScriptEvent(NPCEVENTFLAG_PLAYERTOUCHSME))
+		flags |= NPCGRIDFLAG_PLAYERTOUCHSME;
 
-	std::vector<TNPC *> npcList;
-	for (const auto& npc : levelNPCs)
-	{
-		if (pX < npc->getX() + npc->getWidth() && testEndX > npc->getX() &&
-			pY < npc->getY() + npc->getHeight() && testEndY > npc->getY())
-		{
-			npcList.push_back(npc);
-		}
-	}
+	npcGrid.update(npc, npc->getX(), npc->getY(), npc->getWidth(), npc->getHeight(), flags);
+}
 
+std::vector<TNPC*> TLevel::findAreaNpcs(int pX, int pY, int pWidth, int pHeight)
+{
+	std::vector<TNPC *> npcList;
+	npcGrid.forEachInArea(pX, pY, pWidth, pHeight, 0, [&npcList](TNPC* npc) { npcList.push_back(npc); });
 	return npcList;
 }
 
 std::vector<TNPC*> TLevel::testTouch(int pX, int pY)
 {
 	std::vector<TNPC*> npcList;
-	for (const auto& npc : levelNPCs)
-	{
-		if (npc->hasScriptEvent(NPCEVENTFLAG_PLAYERTOUCHSME) && (npc->getVisibleFlags() & NPCVISFLAG_VISIBLE) != 0)
-		{
-			if (npc->getX() <= pX && npc->getX() + npc->getWidth() >= pX &&
-				npc->getY() <= pY && npc->getY() + npc->getHeight() >= pY)
-			{
-				npcList.push_back(npc);
-			}
-		}
-	}
-
+	npcGrid.forEachAtPoint(pX, pY, NPCGRIDFLAG_VISIBLE | NPCGRIDFLAG_PLAYERTOUCHSME, [&npcList](TNPC* npc) { npcList.push_back(npc); });
 	return npcList;
 }
 
 TNPC * TLevel::isOnNPC(float pX, float pY, bool checkEventFlag)
 {
-	for (const auto& npc : levelNPCs)
-	{
-		if (checkEventFlag && !npc->hasScriptEvent(NPCEVENTFLAG_PLAYERTOUCHSME))
-			continue;
-
-		//if (!npc->getImage().isEmpty())
-		{
-			if ((npc->getVisibleFlags() & 1) != 0)
-			{
-				if ((pX >= npc->getX() && pX <= npc->getX() + (float)(npc->getWidth() / 16.0f)) &&
-					(pY >= npc->getY() && pY <= npc->getY() + (float)(npc->getHeight() / 16.0f)))
-				{
-					// what if it touches multiple npcs? hm. not sure how graal did it.
-					return npc;
-				}
-			}
-		}
-	}
-
-	return nullptr;
+	uint8_t requiredFlags = NPCGRIDFLAG_VISIBLE | (checkEventFlag ? NPCGRIDFLAG_PLAYERTOUCHSME : 0);
+
+	// The bounds tested here are always within the grid bounds of the npc, so only the
+	// cell of the point has to be searched.
+	// what if it touches multiple npcs? hm. not sure how graal did it.
+	return npcGrid.findNearPoint((int)pX, (int)pY, requiredFlags, [pX, pY](TNPC* npc) {
+		return (pX >= npc->getX() && pX <= npc->getX() + (float)(npc->getWidth() / 16.0f)) &&
+			(pY >= npc->getY() && pY <= npc->getY() + (float)(npc->getHeight() / 16.0f));
+	});
 }
 
 void TLevel::sendChatToLevel(const TPlayer *player, const std::string& message)
@@ -1604,11 +1682,12 @@ void TLevel::modifyBoardDirect(uint32_t index, short tile) {
 
 	short oldTile = levelTiles[0][index];
 	levelTiles[0][index] = tile;
+	collisionMap.setTile(pX, pY, tile);
 
 	auto change = TLevelBoardChange(pX, pY, 1, 1, CString() >> tile, CString() >> oldTile, -1);
-
-	levelBoardChanges.push_back(change);
 	server->sendPacketToLevel(CString() >> (char)PLO_BOARDMODIFY << change.getBoardStr(), 0, this);
+
+	levelBoardChanges.addChange(std::move(change));
 }
 
 #endif
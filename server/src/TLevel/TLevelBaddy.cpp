@@ -182,12 +182,14 @@ void TLevelBaddy::setProps(CString &pProps)
 				{
 					// Workaround for buggy client.  In 2 seconds, set us back to BDMODE_SWAMPSHOT from
 					// inside TLevel.cpp.
-					timeout.setTimeout(2);
+					if (level)
+						level->setBaddyTimeout(this, 2);
 				}
 				else if (mode == BDMODE_DIE)
 				{
 					// In 2 seconds, set our mode to BDMODE_DEAD inside TLevel.cpp.
-					timeout.setTimeout(2);
+					if (level)
+						level->setBaddyTimeout(this, 2);
 
 					// Drop items when dead.
 					if (server->getSettings()->getBool("baddyitems", false) == true)
@@ -196,7 +198,10 @@ void TLevelBaddy::setProps(CString &pProps)
 				else if (mode == BDMODE_DEAD)
 				{
 					if (respawn)
-						timeout.setTimeout(server->getSettings()->getInt("baddyrespawntime", 60));
+					{
+						if (level)
+							level->setBaddyTimeout(this, server->getSettings()->getInt("baddyrespawntime", 60));
+					}
 					else
 					{
 						if (level)
@@ -11,4 +11,5 @@ void TLevelBoardChange::swapTiles()
 	CString temp = tiles;
 	tiles = oldTiles;
 	oldTiles = temp;
+	respawnPending = false;
 }
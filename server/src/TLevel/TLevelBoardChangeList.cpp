@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <bitset>
+#include "IDebug.h"
+#include "TLevelBoardChangeList.h"
+
+TLevelBoardChangeList::TLevelBoardChangeList()
+: tileHeads(BoardWidth * BoardHeight, InvalidId), nextSequence(0), activeCount(0), compactThreshold(MinCompactThreshold)
+{
+}
+
+void TLevelBoardChangeList::clear()
+{
+	slots.clear();
+	freeSlots.clear();
+	timeIndex.clear();
+	std::fill(tileHeads.begin(), tileHeads.end(), InvalidId);
+	activeCount = 0;
+	compactThreshold = MinCompactThreshold;
+}
+
+TLevelBoardChangeList::ChangeId TLevelBoardChangeList::addChange(TLevelBoardChange change)
+{
+	if (change.getX() < 0 || change.getY() < 0 || change.getX() >= BoardWidth || change.getY() >= BoardHeight)
+		return InvalidId;
+
+	// Drop overwritten changes before the list grows any further.
+	if (activeCount >= compactThreshold)
+	{
+		compact();
+		compactThreshold = std::max(MinCompactThreshold, activeCount * 2);
+	}
+
+	ChangeId id;
+	if (!freeSlots.empty())
+	{
+		id = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		id = (ChangeId)slots.size();
+		slots.emplace_back();
+	}
+
+	Slot& slot = slots[id];
+	slot.timeKey = std::make_pair(change.getModTime(), nextSequence++);
+	slot.change.emplace(std::move(change));
+	timeIndex.emplace(slot.timeKey, id);
+	linkTile(id);
+	++activeCount;
+
+	return id;
+}
+
+std::vector<TLevelBoardChange> TLevelBoardChangeList::eraseWithin(int pX, int pY, int pWidth, int pHeight)
+{
+	int startX = std::max(pX, 0), endX = std::min(pX + pWidth, BoardWidth);
+	int startY = std::max(pY, 0), endY = std::min(pY + pHeight, BoardHeight);
+
+	// Only changes whose top-left corner is inside the region can be contained by it.
+	std::vector<ChangeId> contained;
+	for (int y = startY; y < endY; ++y)
+	{
+		for (int x = startX; x < endX; ++x)
+		{
+			for (ChangeId id = tileHeads[x + y * BoardWidth]; id != InvalidId; id = slots[id].nextInTile)
+			{
+				const TLevelBoardChange& change = *slots[id].change;
+				if (change.getX() + change.getWidth() <= pX + pWidth && change.getY() + change.getHeight() <= pY + pHeight)
+					contained.push_back(id);
+			}
+		}
+	}
+
+	std::vector<TLevelBoardChange> erased;
+	erased.reserve(contained.size());
+	for (auto id : contained)
+	{
+		erased.push_back(std::move(*slots[id].change));
+		erase(id);
+	}
+
+	return erased;
+}
+
+void TLevelBoardChangeList::erase(ChangeId id)
+{
+	if (id >= slots.size() || !slots[id].change)
+		return;
+
+	Slot& slot = slots[id];
+	unlinkTile(id);
+	timeIndex.erase(slot.timeKey);
+	slot.change.reset();
+	freeSlots.push_back(id);
+	--activeCount;
+}
+
+void TLevelBoardChangeList::setModTime(ChangeId id, time_t modTime)
+{
+	TLevelBoardChange* change = getChange(id);
+	if (change == nullptr)
+		return;
+
+	Slot& slot = slots[id];
+	timeIndex.erase(slot.timeKey);
+	change->setModTime(modTime);
+	slot.timeKey = std::make_pair(modTime, nextSequence++);
+	timeIndex.emplace(slot.timeKey, id);
+}
+
+CString TLevelBoardChangeList::getBoardStr(time_t time) const
+{
+	CString retVal;
+	for (auto it = timeIndex.lower_bound(std::make_pair(time, (uint64_t)0)); it != timeIndex.end(); ++it)
+		retVal << slots[it->second].change->getBoardStr();
+
+	return retVal;
+}
+
+size_t TLevelBoardChangeList::compact()
+{
+	// Walk from the newest change to the oldest.  Any change whose tiles have all been
+	// covered by newer changes will be entirely overwritten by the time a client applies them.
+	std::bitset<BoardWidth * BoardHeight> covered;
+	std::vector<ChangeId> overwritten;
+	for (auto it = timeIndex.rbegin(); it != timeIndex.rend(); ++it)
+	{
+		const TLevelBoardChange& change = *slots[it->second].change;
+		int endX = std::min(change.getX() + change.getWidth(), BoardWidth);
+		int endY = std::min(change.getY() + change.getHeight(), BoardHeight);
+
+		bool isCovered = true;
+		for (int y = change.getY(); y < endY; ++y)
+		{
+			for (int x = change.getX(); x < endX; ++x)
+			{
+				if (!covered.test(x + y * BoardWidth))
+				{
+					covered.set(x + y * BoardWidth);
+					isCovered = false;
+				}
+			}
+		}
+
+		if (isCovered && !change.isRespawnPending())
+			overwritten.push_back(it->second);
+	}
+
+	for (auto id : overwritten)
+		erase(id);
+
+	return overwritten.size();
+}
+
+void TLevelBoardChangeList::linkTile(ChangeId id)
+{
+	const TLevelBoardChange& change = *slots[id].change;
+	ChangeId& head = tileHeads[change.getX() + change.getY() * BoardWidth];
+	slots[id].nextInTile = head;
+	head = id;
+}
+
+void TLevelBoardChangeList::unlinkTile(ChangeId id)
+{
+	const TLevelBoardChange& change = *slots[id].change;
+	ChangeId* link = &tileHeads[change.getX() + change.getY() * BoardWidth];
+	while (*link != InvalidId)
+	{
+		if (*link == id)
+		{
+			*link = slots[id].nextInTile;
+			break;
+		}
+		link = &slots[*link].nextInTile;
+	}
+	slots[id].nextInTile = InvalidId;
+}
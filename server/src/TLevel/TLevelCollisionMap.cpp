@@ -0,0 +1,64 @@
+#include <cstring>
+#include <tiletypes.h>
+#include "TLevelCollisionMap.h"
+
+void TLevelCollisionMap::clear()
+{
+	memset(rows, 0, sizeof(rows));
+}
+
+void TLevelCollisionMap::rebuild(const short* tiles)
+{
+	clear();
+
+	for (int y = 0; y < BoardHeight; ++y)
+	{
+		for (int x = 0; x < BoardWidth; ++x)
+		{
+			uint8_t classes = getTileClasses(tiles[x + y * BoardWidth]);
+			for (int tileClass = 0; classes != 0; ++tileClass, classes >>= 1)
+				rows[tileClass][y] |= uint64_t(classes & 1) << x;
+		}
+	}
+}
+
+void TLevelCollisionMap::setTile(int pX, int pY, short tile)
+{
+	if (pX < 0 || pY < 0 || pX >= BoardWidth || pY >= BoardHeight)
+		return;
+
+	uint8_t classes = getTileClasses(tile);
+	for (int tileClass = 0; tileClass < TILECLASS_COUNT; ++tileClass)
+	{
+		uint64_t bit = uint64_t(1) << pX;
+		if ((classes >> tileClass) & 1)
+			rows[tileClass][pY] |= bit;
+		else
+			rows[tileClass][pY] &= ~bit;
+	}
+}
+
+uint8_t TLevelCollisionMap::getTileClasses(short tile)
+{
+	// Unset tiles (-1) and anything outside of the tileset don't collide with anything.
+	if (tile < 0 || (unsigned int)tile >= tiletypes_len)
+		return 0;
+
+	switch (tiletypes[tile])
+	{
+		case 2:		return 1 << TILECLASS_HURT;
+		case 3:		return 1 << TILECLASS_CHAIR;
+		case 4:
+		case 5:		return 1 << TILECLASS_BED;
+		case 6:		return 1 << TILECLASS_SWAMP;
+		case 7:		return 1 << TILECLASS_LAVA;
+		case 8:		return 1 << TILECLASS_NEARWATER;
+		case 11:	return 1 << TILECLASS_WATER;
+		case 12:	return 1 << TILECLASS_LAVA;
+	}
+
+	if (tiletypes[tile] >= 20)
+		return 1 << TILECLASS_WALL;
+
+	return 0;
+}
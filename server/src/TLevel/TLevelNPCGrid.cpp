@@ -0,0 +1,103 @@
+#include <algorithm>
+#include "TLevelNPCGrid.h"
+
+TLevelNPCGrid::TLevelNPCGrid()
+: cells(GridWidth * GridHeight), queryStamp(0)
+{
+}
+
+void TLevelNPCGrid::clear()
+{
+	entries.clear();
+	for (auto& cell : cells)
+		cell.clear();
+}
+
+void TLevelNPCGrid::insert(TNPC* npc, int pX, int pY, int pWidth, int pHeight, uint8_t flags)
+{
+	if (update(npc, pX, pY, pWidth, pHeight, flags))
+		return;
+
+	Entry& entry = entries[npc];
+	entry.npc = npc;
+	entry.queryStamp = 0;
+	entry.flags = flags;
+	setBounds(entry, pX, pY, pWidth, pHeight);
+	linkCells(&entry);
+}
+
+bool TLevelNPCGrid::update(TNPC* npc, int pX, int pY, int pWidth, int pHeight, uint8_t flags)
+{
+	auto it = entries.find(npc);
+	if (it == entries.end())
+		return false;
+
+	Entry& entry = it->second;
+	Entry moved = entry;
+	moved.flags = flags;
+	setBounds(moved, pX, pY, pWidth, pHeight);
+
+	// Moving within the same cells doesn't need any relinking.
+	bool sameCells = (moved.cellStartX == entry.cellStartX && moved.cellStartY == entry.cellStartY &&
+		moved.cellEndX == entry.cellEndX && moved.cellEndY == entry.cellEndY);
+
+	if (!sameCells)
+		unlinkCells(&entry);
+
+	entry = moved;
+
+	if (!sameCells)
+		linkCells(&entry);
+	return true;
+}
+
+void TLevelNPCGrid::remove(TNPC* npc)
+{
+	auto it = entries.find(npc);
+	if (it == entries.end())
+		return;
+
+	unlinkCells(&it->second);
+	entries.erase(it);
+}
+
+void TLevelNPCGrid::setBounds(Entry& entry, int pX, int pY, int pWidth, int pHeight)
+{
+	entry.x = pX;
+	entry.y = pY;
+	entry.width = pWidth;
+	entry.height = pHeight;
+
+	// Negative sizes extend the other way.  The end cell includes the far edge since point
+	// queries treat bounds as inclusive.
+	entry.cellStartX = toCellX(std::min(pX, pX + pWidth));
+	entry.cellStartY = toCellY(std::min(pY, pY + pHeight));
+	entry.cellEndX = toCellX(std::max(pX, pX + pWidth));
+	entry.cellEndY = toCellY(std::max(pY, pY + pHeight));
+}
+
+void TLevelNPCGrid::linkCells(Entry* entry)
+{
+	for (int cellY = entry->cellStartY; cellY <= entry->cellEndY; ++cellY)
+	{
+		for (int cellX = entry->cellStartX; cellX <= entry->cellEndX; ++cellX)
+			cells[cellX + cellY * GridWidth].push_back(entry);
+	}
+}
+
+void TLevelNPCGrid::unlinkCells(Entry* entry)
+{
+	for (int cellY = entry->cellStartY; cellY <= entry->cellEndY; ++cellY)
+	{
+		for (int cellX = entry->cellStartX; cellX <= entry->cellEndX; ++cellX)
+		{
+			auto& cell = cells[cellX + cellY * GridWidth];
+			auto it = std::find(cell.begin(), cell.end(), entry);
+			if (it != cell.end())
+			{
+				*it = cell.back();
+				cell.pop_back();
+			}
+		}
+	}
+}
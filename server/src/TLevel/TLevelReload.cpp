@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include "IDebug.h"
+#include "IEnums.h"
+#include "TServer.h"
+#include "TLevel.h"
+#include "TPlayer.h"
+#include "TNPC.h"
+
+/*
+	TLevel: Incremental Reloading
+*/
+namespace
+{
+	bool sameChest(const TLevelChest& a, const TLevelChest& b)
+	{
+		return a.getX() == b.getX() && a.getY() == b.getY() && a.getItemIndex() == b.getItemIndex() && a.getSignIndex() == b.getSignIndex();
+	}
+
+	bool sameBaddy(const TLevelBaddy* a, const TLevelBaddy* b)
+	{
+		if (a->getType() != b->getType() || a->getStartX() != b->getStartX() || a->getStartY() != b->getStartY())
+			return false;
+
+		for (int prop = BDPROP_VERSESIGHT; prop <= BDPROP_VERSEATTACK; ++prop)
+		{
+			if (a->getProp(prop) != b->getProp(prop))
+				return false;
+		}
+		return true;
+	}
+
+	// Checks if every item of the old list is still in the new list.
+	template<typename T, typename Equal>
+	bool containsAll(const std::vector<T>& updated, const std::vector<T>& current, Equal&& equal)
+	{
+		return std::all_of(current.begin(), current.end(), [&](const T& item) {
+			return std::any_of(updated.begin(), updated.end(), [&](const T& other) { return equal(item, other); });
+		});
+	}
+
+	template<typename T, typename Equal>
+	bool contains(const std::vector<T>& list, const T& item, Equal&& equal)
+	{
+		return std::any_of(list.begin(), list.end(), [&](const T& other) { return equal(item, other); });
+	}
+}
+
+bool TLevel::reloadChanges()
+{
+	// Parse the new version of the level on the side.  Nothing is spawned for it.
+	std::unique_ptr<TLevel> updated(new TLevel(server));
+	if (!updated->parseLevel(levelName) || !canReloadChanges(*updated))
+		return reload();
+
+	reloadBoard(*updated);
+	reloadObjects(*updated);
+	reloadNPCs(*updated);
+
+	modTime = updated->modTime;
+	fileVersion = updated->fileVersion;
+
+	// Players that aren't in the level need the whole level the next time they enter it.
+	auto playerList = server->getPlayerList();
+	for (auto p : *playerList)
+	{
+		if (p->getLevel() != this)
+			p->resetLevelCache(this);
+	}
+
+	return true;
+}
+
+bool TLevel::canReloadChanges(const TLevel& updated) const
+{
+	// Only the bottom layer can be modified on the clients.
+	std::vector<int> allLayers(layers);
+	allLayers.insert(allLayers.end(), updated.layers.begin(), updated.layers.end());
+	for (int layer : allLayers)
+	{
+		if (layer > 0 && memcmp(levelTiles[layer], updated.levelTiles[layer], sizeof(levelTiles[layer])) != 0)
+			return false;
+	}
+
+	// Clients can be sent new links, chests and signs, but can't be told to remove any.
+	auto sameLink = [](const TLevelLink& a, const TLevelLink& b) { return a.getLinkStr() == b.getLinkStr(); };
+	if (!containsAll(updated.levelLinks, levelLinks, sameLink))
+		return false;
+
+	if (!containsAll(updated.levelChests, levelChests, sameChest))
+		return false;
+
+	// A sign with new text replaces the sign at the same position.
+	auto samePosition = [](const TLevelSign& a, const TLevelSign& b) { return a.getX() == b.getX() && a.getY() == b.getY(); };
+	if (!containsAll(updated.levelSigns, levelSigns, samePosition))
+		return false;
+
+	// Baddies move around and die, so any change to them needs a full reload.
+	if (levelBaddies.size() != updated.levelBaddies.size())
+		return false;
+	for (size_t i = 0; i < levelBaddies.size(); ++i)
+	{
+		if (!sameBaddy(levelBaddies[i], updated.levelBaddies[i]))
+			return false;
+	}
+
+	return true;
+}
+
+void TLevel::reloadBoard(const TLevel& updated)
+{
+	// Board changes on tiles that changed in the file would respawn the old tiles,
+	// so drop them and send the new tiles for their whole area.
+	std::vector<TLevelBoardChangeList::ChangeId> overwritten;
+	levelBoardChanges.forEach([&](auto id, TLevelBoardChange& change) {
+		for (int y = change.getY(); y < change.getY() + change.getHeight() && y < 64; ++y)
+		{
+			for (int x = change.getX(); x < change.getX() + change.getWidth() && x < 64; ++x)
+			{
+				if (levelTiles[0][x + y * 64] != updated.levelTiles[0][x + y * 64])
+				{
+					overwritten.push_back(id);
+					return;
+				}
+			}
+		}
+	});
+
+	std::vector<bool> resend(64 * 64, false);
+	for (auto id : overwritten)
+	{
+		TLevelBoardChange* change = levelBoardChanges.getChange(id);
+		for (int y = change->getY(); y < change->getY() + change->getHeight() && y < 64; ++y)
+		{
+			for (int x = change->getX(); x < change->getX() + change->getWidth() && x < 64; ++x)
+				resend[x + y * 64] = true;
+		}
+
+		cancelTimer(change->timer);
+		levelBoardChanges.erase(id);
+	}
+
+	// Send every changed tile, one horizontal run at a time.
+	for (int y = 0; y < 64; ++y)
+	{
+		int x = 0;
+		while (x < 64)
+		{
+			auto needsSending = [&](int i) {
+				return resend[i + y * 64] || levelTiles[0][i + y * 64] != updated.levelTiles[0][i + y * 64];
+			};
+
+			if (!needsSending(x))
+			{
+				++x;
+				continue;
+			}
+
+			int start = x;
+			CString tiles, oldTiles;
+			for (; x < 64 && needsSending(x); ++x)
+			{
+				tiles.writeGShort(updated.levelTiles[0][x + y * 64]);
+				oldTiles.writeGShort(levelTiles[0][x + y * 64]);
+			}
+
+			TLevelBoardChange change(start, y, x - start, 1, tiles, oldTiles, -1);
+			server->sendPacketToLevel(CString() >> (char)PLO_BOARDMODIFY << change.getBoardStr(), 0, this);
+		}
+	}
+
+	memcpy(levelTiles[0], updated.levelTiles[0], sizeof(levelTiles[0]));
+
+	// Rebuild the collision map from the new board and the changes that are still in place.
+	collisionMap.rebuild(levelTiles[0]);
+	levelBoardChanges.forEach([this](auto id, TLevelBoardChange& change) {
+		updateCollisionMap(change.getX(), change.getY(), change.getWidth(), change.getHeight(), change.getTiles());
+	});
+}
+
+void TLevel::reloadObjects(const TLevel& updated)
+{
+	auto sameLink = [](const TLevelLink& a, const TLevelLink& b) { return a.getLinkStr() == b.getLinkStr(); };
+	auto sameSign = [](const TLevelSign& a, const TLevelSign& b) {
+		return a.getX() == b.getX() && a.getY() == b.getY() && a.getText() == b.getText();
+	};
+
+	std::vector<TLevelLink> newLinks;
+	for (const auto& link : updated.levelLinks)
+	{
+		if (!contains(levelLinks, link, sameLink))
+			newLinks.push_back(link);
+	}
+
+	std::vector<TLevelChest> newChests;
+	for (const auto& chest : updated.levelChests)
+	{
+		if (!contains(levelChests, chest, sameChest))
+			newChests.push_back(chest);
+	}
+
+	std::vector<TLevelSign> newSigns;
+	for (const auto& sign : updated.levelSigns)
+	{
+		if (!contains(levelSigns, sign, sameSign))
+			newSigns.push_back(sign);
+	}
+
+	levelLinks = updated.levelLinks;
+	levelChests = updated.levelChests;
+	levelSigns = updated.levelSigns;
+	rebuildObjectIndexes();
+
+	CString linkPacket;
+	for (const auto& link : newLinks)
+		linkPacket >> (char)PLO_LEVELLINK << link.getLinkStr() << "\n";
+
+	for (auto player : levelPlayerList)
+	{
+		CString packet(linkPacket);
+		for (const auto& chest : newChests)
+		{
+			bool hasChest = player->hasChest(getChestKey(chest));
+			packet >> (char)PLO_LEVELCHEST >> (char)(hasChest ? 1 : 0) >> (char)chest.getX() >> (char)chest.getY();
+			if (!hasChest) packet >> (char)chest.getItemIndex() >> (char)chest.getSignIndex();
+			packet << "\n";
+		}
+
+		for (const auto& sign : newSigns)
+			packet >> (char)PLO_LEVELSIGN << sign.getSignStr(player) << "\n";
+
+		if (!packet.isEmpty())
+			player->sendPacket(packet);
+	}
+}
+
+void TLevel::reloadNPCs(TLevel& updated)
+{
+	auto sameDefinition = [](const NPCDefinition& a, const NPCDefinition& b) {
+		return a.x == b.x && a.y == b.y && a.image == b.image && a.code == b.code;
+	};
+
+	// Keep the npcs whose definition is still in the file.  Each npc is matched at most once,
+	// so duplicated definitions keep the right amount of npcs.
+	std::vector<bool> kept(levelNPCDefs.size(), false);
+	for (auto& definition : updated.levelNPCDefs)
+	{
+		for (size_t i = 0; i < levelNPCDefs.size(); ++i)
+		{
+			if (!kept[i] && levelNPCDefs[i].npc != nullptr && sameDefinition(levelNPCDefs[i], definition))
+			{
+				kept[i] = true;
+				definition.npc = levelNPCDefs[i].npc;
+				break;
+			}
+		}
+	}
+
+	// Delete the npcs that are no longer in the file.
+	std::vector<TNPC*> removed;
+	for (size_t i = 0; i < levelNPCDefs.size(); ++i)
+	{
+		if (!kept[i] && levelNPCDefs[i].npc != nullptr)
+			removed.push_back(levelNPCDefs[i].npc);
+	}
+
+	levelNPCDefs = std::move(updated.levelNPCDefs);
+	for (auto npc : removed)
+		server->deleteNPC(npc, true);
+
+	// Spawn the new ones for the players in the level.
+	for (auto& definition : levelNPCDefs)
+	{
+		if (definition.npc == nullptr)
+			spawnNPC(definition, true);
+	}
+}
@@ -77,7 +77,7 @@ TNPC::TNPC(TServer *pServer, NPCType type)
 #ifdef V8NPCSERVER
 	, _scriptExecutionContext(pServer->getScriptEngine())
 	, origX(x), origY(y), npcDeleteRequested(false), canWarp(NPCWarpType::None), width(32), height(32)
-	, timeout(0), _scriptEventsMask(0xFF)
+	, _scriptEventsMask(0xFF)
 #endif
 {
 	memset((void*)colors, 0, sizeof(colors));
@@ -104,6 +104,8 @@ TNPC::TNPC(TServer *pServer, NPCType type)
 
 TNPC::~TNPC()
 {
+	server->cancelGS2Compile(this);
+
 #ifdef V8NPCSERVER
 	freeScriptResources();
 #endif
@@ -428,6 +430,7 @@ CString TNPC::getProps(time_t newTime, int clientVersion) const
 CString TNPC::setProps(CString& pProps, int clientVersion, bool pForward)
 {
 	bool hasMoved = false;
+	unsigned char oldVisFlags = visFlags;
 
 	// TODO(joey): Most of these props will eventually be ignored
 
@@ -768,6 +771,9 @@ CString TNPC::setProps(CString& pProps, int clientVersion, bool pForward)
 		server->sendPacketToLevel(CString() >> (char)PLO_NPCPROPS >> (int)id << ret, map, level, 0, true);
 	}
 
+	if (hasMoved || visFlags != oldVisFlags)
+		updateLevelGrid();
+
 #ifdef V8NPCSERVER
 	if (hasMoved) testTouch();
 #endif
@@ -775,6 +781,14 @@ CString TNPC::setProps(CString& pProps, int clientVersion, bool pForward)
 	return ret;
 }
 
+void TNPC::updateLevelGrid()
+{
+#ifdef V8NPCSERVER
+	if (level != nullptr)
+		level->updateNPC(this);
+#endif
+}
+
 #ifdef V8NPCSERVER
 
 void TNPC::testForLinks()
@@ -848,9 +862,10 @@ void TNPC::freeScriptResources()
 	scriptEngine->UnregisterNpcUpdate(this);
 
 	// Clear timeouts & scheduled events
-	scriptEngine->UnregisterNpcTimer(this);
+	scriptEngine->CancelNpcTimer(_timeoutTimer);
+	for (auto & handle : _scriptTimers)
+		scriptEngine->CancelNpcTimer(handle);
 	_scriptTimers.clear();
-	timeout = 0;
 
 	// Clear triggeraction functions
 	for (auto & _triggerAction : _triggerActions)
@@ -949,19 +964,33 @@ void TNPC::updateClientCode()
 			}
 		);
 	}
+	else server->cancelGS2Compile(this);
 
 	// Update prop for players
 	this->updatePropModTime(NPCPROP_SCRIPT);
 }
 
-void TNPC::setTimeout(int newTimeout)
+CString TNPC::getByteCodePacket() const
 {
-	timeout = newTimeout;
+	CString byteCodePacket = CString() >> (char)PLO_NPCBYTECODE >> (int)id << npcBytecode;
+	if (byteCodePacket[byteCodePacket.length() - 1] != '\n')
+		byteCodePacket << "\n";
 
-	if (hasTimerUpdates())
-		server->getScriptEngine()->RegisterNpcTimer(this);
-	else
-		server->getScriptEngine()->UnregisterNpcTimer(this);
+	return CString() >> (char)PLO_RAWDATA >> (int)byteCodePacket.length() << "\n" << byteCodePacket;
+}
+
+std::chrono::milliseconds TNPC::getTimeout() const
+{
+	return server->getScriptEngine()->getNpcTimerRemaining(_timeoutTimer);
+}
+
+void TNPC::setTimeout(std::chrono::milliseconds delay)
+{
+	CScriptEngine *scriptEngine = server->getScriptEngine();
+	scriptEngine->CancelNpcTimer(_timeoutTimer);
+
+	if (delay.count() > 0)
+		_timeoutTimer = scriptEngine->ScheduleNpcTimer(this, delay);
 }
 
 void TNPC::queueNpcAction(const std::string& action, TPlayer *player, bool registerAction)
@@ -987,46 +1016,25 @@ void TNPC::queueNpcAction(const std::string& action, TPlayer *player, bool regis
 		scriptEngine->RegisterNpcUpdate(this);
 }
 
-bool TNPC::runScriptTimer()
+void TNPC::runScriptTimer(std::optional<ScriptAction>& action)
 {
-	// TODO(joey): Scheduled events, pass in delta, use milliseconds as an integer
-
-	if (timeout > 0)
+	// Scheduled event
+	if (action)
 	{
-		timeout--;
-		if (timeout == 0)
-			queueNpcAction("npc.timeout", 0, true);
-	}
-
-	// scheduled events
-	bool queued = false;
-	for (auto it = _scriptTimers.begin(); it != _scriptTimers.end();)
-	{
-		ScriptEventTimer& timer = *it;
-		timer.timer--;
-		if (timer.timer == 0)
-		{
-			_scriptExecutionContext.addAction(timer.action);
-			it = _scriptTimers.erase(it);
-			queued = true;
-			continue;
-		}
-
-		++it;
+		_scriptExecutionContext.addAction(std::move(*action));
+		registerNpcUpdates();
+		return;
 	}
 
-	// Register for npc updates
-	if (queued)
-		server->getScriptEngine()->RegisterNpcUpdate(this);
-
-	// return value dictates if this gets unregistered from timer updates
-	return hasTimerUpdates();
+	// Timeouts loaded with the npc can run out before its script was ever run.
+	if (_scriptObject)
+		queueNpcAction("npc.timeout", nullptr, true);
 }
 
-NPCEventResponse TNPC::runScriptEvents()
+NPCEventResponse TNPC::runScriptEvents(std::chrono::high_resolution_clock::time_point deadline)
 {
 	// Returns true if we still have actions to run
-	bool hasActions = _scriptExecutionContext.runExecution();
+	bool hasActions = _scriptExecutionContext.runExecution(deadline);
 
 	// Send properties modified by scripts
 	if (!propModified.empty())
@@ -1286,12 +1294,14 @@ CString TNPC::getVariableDump()
 		}
 	}
 
-	if (timeout > 0)
-		npcDump << npcNameStr << ".timeout: " << CString((float)(timeout * 0.05f)) << "\n";
+	auto timeout = getTimeout();
+	if (timeout.count() > 0)
+		npcDump << npcNameStr << ".timeout: " << CString((float)timeout.count() / 1000.0f) << "\n";
 
-	std::pair<unsigned int, double> executionData = _scriptExecutionContext.getExecutionData();
-	npcDump << npcNameStr << ".scripttime (in the last min): " << CString(executionData.second) << "\n";
-	npcDump << npcNameStr << ".scriptcalls: " << CString(executionData.first) << "\n";
+	auto profile = _scriptExecutionContext.getProfile().getSummary();
+	npcDump << npcNameStr << ".scripttime (in the last min): " << CString(profile.total) << "\n";
+	npcDump << npcNameStr << ".scriptcalls: " << CString((unsigned int)profile.calls) << "\n";
+	npcDump << npcNameStr << ".scriptmaxtime: " << CString(profile.max) << "\n";
 
 	if (!flagList.empty())
 	{
@@ -1385,6 +1395,7 @@ void TNPC::warpNPC(TLevel *pLevel, int pX, int pY)
 	// Adjust the position of the npc
 	x = pX;
 	y = pY;
+	updateLevelGrid();
 
 	updatePropModTime(NPCPROP_CURLEVEL);
 	updatePropModTime(NPCPROP_GMAPLEVELX);
@@ -1415,9 +1426,6 @@ void TNPC::saveNPC()
 	// TODO(joey): check if properties have been modified before deciding to save
 	// enumerate scriptObject variables, to save into file and load later..?
 
-	// Clean up old samples
-	//_scriptExecutionContext.getExecutionData();
-
 	/*
 	CString saveDir;
 	CString saveName;
@@ -1478,7 +1486,7 @@ void TNPC::saveNPC()
 	fileData << "COLORS " << CString((int)colors[0]) << "," << CString((int)colors[1]) << "," << CString((int)colors[2]) << "," << CString((int)colors[3]) << "," << CString((int)colors[4]) << NL;
 	fileData << "SPRITE " << CString(sprite) << NL;
 	fileData << "AP " << CString(ap) << NL;
-	fileData << "TIMEOUT " << CString(timeout / 20) << NL;
+	fileData << "TIMEOUT " << CString((int)std::chrono::duration_cast<std::chrono::seconds>(getTimeout()).count()) << NL;
 	fileData << "LAYER 0" << NL;
 	fileData << "SHAPETYPE 0" << NL;
 	fileData << "SHAPE " << CString(width) << " " << CString(height) << NL;
@@ -1684,7 +1692,7 @@ bool TNPC::loadNPC(const CString& fileName)
 			canWarp = strtoint(curLine.readString("")) != 0 ? NPCWarpType::OverworldLinks : canWarp;
 		}
 		else if (curCommand == "TIMEOUT")
-			timeout = strtoint(curLine.readString("")) * 20;
+			setTimeout(std::chrono::seconds(strtoint(curLine.readString(""))));
 		else if (curCommand == "FLAG")
 		{
 			CString flagName = curLine.readString("=");
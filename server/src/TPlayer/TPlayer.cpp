@@ -312,7 +312,7 @@ TPlayer::TPlayer(TServer* pServer, CSocket* pSocket, int pId)
 playerSock(pSocket), key(0),
 os("wind"), codepage(1252), level(0),
 id(pId), type(PLTYPE_AWAIT), versionID(CLVER_2_17),
-pmap(0), carryNpcId(0), carryNpcThrown(false), loaded(false),
+pmap(0), carryNpcId(0), carryNpcThrown(false), loaded(false), pendingLogin(0),
 nextIsRaw(false), rawPacketSize(0), isFtp(false),
 grMovementUpdated(false),
 fileQueue(pSocket),
@@ -571,16 +571,6 @@ bool TPlayer::doTimedEvents()
 		}
 	}
 
-	// Do singleplayer level events.
-	{
-		for (auto& spLevel : spLevels)
-		{
-			TLevel* level = spLevel.second;
-			if (level)
-				level->doTimedEvents();
-		}
-	}
-
 	// Save player account every 5 minutes.
 	if ((int)difftime(currTime, lastSave) > 300)
 	{
@@ -753,22 +743,19 @@ bool TPlayer::sendFile(const CString& pFile)
 bool TPlayer::sendFile(const CString& pPath, const CString& pFile)
 {
 	CString filepath = CString() << server->getServerPath() << pPath << pFile;
-	CString fileData;
-	fileData.load(filepath);
-
-	time_t modTime = 0;
-	struct stat fileStat;
-	if (stat(filepath.text(), &fileStat) != -1)
-		modTime = fileStat.st_mtime;
+	auto file = server->getFileCache().get(filepath);
 
 	// See if the file exists.
-	if (fileData.length() == 0)
+	if (!file)
 	{
 		sendPacket(CString() >> (char)PLO_FILESENDFAILED << pFile);
 
 		return false;
 	}
 
+	const CString& fileData = file->data;
+	time_t modTime = file->modTime;
+
 	// Warn for very large files.  These are the cause of many bug reports.
 	if (fileData.length() > 3145728)	// 3MB
 		serverlog.out("[%s] [WARNING] Sending a large file (over 3MB): %s\n", server->getName().text(), pFile.text());
@@ -801,25 +788,26 @@ bool TPlayer::sendFile(const CString& pPath, const CString& pFile)
 	}
 
 	// Send the file now.
-	while (fileData.length() != 0)
+	int offset = 0;
+	while (offset < fileData.length())
 	{
-		int sendSize = clip(32000, 0, fileData.length());
-		if (isClient() && versionID < CLVER_2_14) sendSize = fileData.length();
+		int sendSize = clip(32000, 0, fileData.length() - offset);
+		if (isClient() && versionID < CLVER_2_14) sendSize = fileData.length() - offset;
 
 		// Older client versions didn't send the modTime.
 		if (isClient() && versionID < CLVER_2_1)
 		{
 			// We don't add a \n to the end of the packet, so subtract 1 from the packet length.
 			sendPacket(CString() >> (char)PLO_RAWDATA >> (int)(packetLength - 1 + sendSize));
-			sendPacket(CString() >> (char)PLO_FILE >> (char)pFile.length() << pFile << fileData.subString(0, sendSize), false);
+			sendPacket(CString() >> (char)PLO_FILE >> (char)pFile.length() << pFile << fileData.subString(offset, sendSize), false);
 		}
 		else
 		{
 			sendPacket(CString() >> (char)PLO_RAWDATA >> (int)(packetLength + sendSize));
-			sendPacket(CString() >> (char)PLO_FILE >> (long long)modTime >> (char)pFile.length() << pFile << fileData.subString(0, sendSize) << "\n", false);
+			sendPacket(CString() >> (char)PLO_FILE >> (long long)modTime >> (char)pFile.length() << pFile << fileData.subString(offset, sendSize) << "\n", false);
 		}
 
-		fileData.removeI(0, sendSize);
+		offset += sendSize;
 	}
 
 	// If we had sent a large file, let the client know we finished sending it.
@@ -836,13 +824,16 @@ bool TPlayer::testSign()
 	// Check for sign collisions.
 	if ((sprite % 4) == 0)
 	{
-		std::vector<TLevelSign>& signs = level->getLevelSigns();
-		for (const auto& sign : signs)
+		// Only signs on the player's row, from half a tile to the left up to a tile and a half
+		// to the right, can be read.
+		int signY = (int)y;
+		if (y == (float)signY)
 		{
-			float signLoc[] = {(float)sign.getX(), (float)sign.getY()};
-			if (y == signLoc[1] && inrange(x, signLoc[0]-1.5f, signLoc[0]+0.5f))
+			for (int signX = (int)std::ceil(x - 0.5f); signX <= (int)std::floor(x + 1.5f); ++signX)
 			{
-				sendPacket(CString() >> (char)PLO_SAY2 << sign.getUText().replaceAll("\n", "#b"));
+				level->forEachSignAt(signX, signY, [this](const TLevelSign& sign) {
+					sendPacket(CString() >> (char)PLO_SAY2 << sign.getUText().replaceAll("\n", "#b"));
+				});
 			}
 		}
 	}
@@ -1567,6 +1558,10 @@ bool TPlayer::setLevel(const CString& pLevelName, time_t modTime)
 			sendPacket(CString() >> (char)PLO_PLAYERWARP >> (char)(x * 2) >> (char)(y * 2) << levelName);
 	}
 
+	// Adjacent levels that were asked for on another map aren't wanted anymore.
+	pendingLevels.erase(std::remove_if(pendingLevels.begin(), pendingLevels.end(),
+		[this](const SPendingLevel& pending) { return pending.fromAdjacent && pending.level->getMap() != pmap; }), pendingLevels.end());
+
 	// Send the level now.
 	bool succeed = true;
 	if (versionID >= CLVER_2_1)
@@ -1610,6 +1605,14 @@ bool TPlayer::sendLevel(TLevel* pLevel, time_t modTime, bool fromAdjacent)
 	if (pLevel == 0) return false;
 	CSettings* settings = server->getSettings();
 
+	// Hold the level back while the scripts of its npcs are compiling, so they don't show up without them.
+	// Levels behind it wait too, so they still arrive in the order they were asked for.
+	if (versionID >= CLVER_4_0211 && (!pendingLevels.empty() || pLevel->isCompilingScripts()))
+	{
+		pendingLevels.push_back({ pLevel, modTime, fromAdjacent });
+		return true;
+	}
+
 	// Send Level
 	sendPacket(CString() >> (char)PLO_LEVELNAME << pLevel->getLevelName());
 	time_t l_time = getCachedLevelModTime(pLevel);
@@ -1635,13 +1638,19 @@ bool TPlayer::sendLevel(TLevel* pLevel, time_t modTime, bool fromAdjacent)
 		sendPacket(CString() << pLevel->getSignsPacket(this));
 	}
 
+	// Gmap levels streamed in around the player already have their npcs, chests, horses and baddies.
+	bool alreadyStreamed = isGmapLevelStreamed(pLevel);
+
 	// Send board changes, chests, horses, and baddies.
 	if ( !fromAdjacent )
 	{
 		sendPacket(CString() << pLevel->getBoardChangesPacket(l_time));
-		sendPacket(CString() << pLevel->getChestPacket(this));
-		sendPacket(CString() << pLevel->getHorsePacket());
-		sendPacket(CString() << pLevel->getBaddyPacket(versionID));
+		if (!alreadyStreamed)
+		{
+			sendPacket(CString() << pLevel->getChestPacket(this));
+			sendPacket(CString() << pLevel->getHorsePacket());
+			sendPacket(CString() << pLevel->getBaddyPacket(versionID));
+		}
 	}
 
 	// If we are on a gmap, change our level back to the gmap.
@@ -1666,10 +1675,13 @@ bool TPlayer::sendLevel(TLevel* pLevel, time_t modTime, bool fromAdjacent)
 		// Send NPCs.
 		if (pmap && pmap->getType() == MapType::GMAP)
 		{
-			sendPacket(CString() >> (char)PLO_SETACTIVELEVEL << pmap->getMapName());
+			if (!alreadyStreamed)
+			{
+				sendPacket(CString() >> (char)PLO_SETACTIVELEVEL << pmap->getMapName());
 
-			auto val = pLevel->getNpcsPacket(l_time, versionID);
-			sendPacket(val);
+				auto val = pLevel->getNpcsPacket(l_time, versionID);
+				sendPacket(val);
+			}
 
 
 			/*sendPacket(CString() >> (char)PLO_SETACTIVELEVEL << pmap->getMapName());
@@ -1690,6 +1702,10 @@ bool TPlayer::sendLevel(TLevel* pLevel, time_t modTime, bool fromAdjacent)
 		}
 	}
 
+	// Stream in the gmap levels around the one we entered.
+	if ( !fromAdjacent )
+		updateGmapVisibility();
+
 	// Do props stuff.
 	// Maps send to players in adjacent levels too.
 	if (!level->isSingleplayer())
@@ -1822,22 +1838,25 @@ bool TPlayer::sendLevel141(TLevel* pLevel, time_t modTime, bool fromAdjacent)
 
 bool TPlayer::leaveLevel(bool resetCache)
 {
+	// If our own level is still waiting on its scripts, the client never got it, so it mustn't
+	// count as cached.  Adjacent levels the client asked for stay queued while it is on the same map.
+	bool levelPending = (level != 0 && isLevelPending(level));
+	pendingLevels.erase(std::remove_if(pendingLevels.begin(), pendingLevels.end(),
+		[this](const SPendingLevel& pending) { return pending.level == level; }), pendingLevels.end());
+
 	// Make sure we are on a level first.
 	if (level == 0) return true;
 
 	// Save the time we left the level for the client-side caching.
-	bool found = false;
-	for (std::vector<SCachedLevel*>::iterator i = cachedLevels.begin(); i != cachedLevels.end();)
-	{
-		SCachedLevel* cl = *i;
-		if (cl->level == level)
-		{
-			cl->modTime = (resetCache ? 0 : time(0));
-			found = true;
-			i = cachedLevels.end();
-		} else ++i;
-	}
-	if ( !found ) cachedLevels.push_back(new SCachedLevel(level, time(0)));
+	setCachedLevelModTime(level, ((resetCache || levelPending) ? 0 : time(0)));
+
+	// Walking off a gmap level leaves it in view with everything it had.  A level that is
+	// being reset has to be sent again in full.
+	auto streamed = std::find(gmapVisibleLevels.begin(), gmapVisibleLevels.end(), level);
+	if (streamed != gmapVisibleLevels.end())
+		gmapVisibleLevels.erase(streamed);
+	if (!resetCache && !levelPending && pmap && pmap->getType() == MapType::GMAP)
+		gmapVisibleLevels.push_back(level);
 
 	// Remove self from list of players in level.
 	level->removePlayer(this);
@@ -1879,8 +1898,114 @@ time_t TPlayer::getCachedLevelModTime(const TLevel* level) const
 	return 0;
 }
 
+void TPlayer::setCachedLevelModTime(TLevel* pLevel, time_t modTime)
+{
+	for (auto cl : cachedLevels)
+	{
+		if (cl->level == pLevel)
+		{
+			cl->modTime = modTime;
+			return;
+		}
+	}
+
+	cachedLevels.push_back(new SCachedLevel(pLevel, modTime));
+}
+
+bool TPlayer::isGmapLevelStreamed(const TLevel* pLevel) const
+{
+	return std::find(gmapVisibleLevels.begin(), gmapVisibleLevels.end(), pLevel) != gmapVisibleLevels.end();
+}
+
+bool TPlayer::isLevelPending(const TLevel* pLevel) const
+{
+	return std::find_if(pendingLevels.begin(), pendingLevels.end(), [pLevel](const SPendingLevel& pending) { return pending.level == pLevel; }) != pendingLevels.end();
+}
+
+void TPlayer::sendPendingLevels()
+{
+	if (pendingLevels.empty())
+		return;
+
+	// Levels that are still compiling, and any after them, go back into the list.
+	std::vector<SPendingLevel> levels;
+	levels.swap(pendingLevels);
+	for (const auto& pending : levels)
+		sendLevel(pending.level, pending.modTime, pending.fromAdjacent);
+}
+
+void TPlayer::updateGmapVisibility()
+{
+	// The client shows the gmap levels right around the one we are in.
+	std::vector<TLevel*> visibleLevels;
+	if (level && pmap && pmap->getType() == MapType::GMAP)
+	{
+		for (int my = level->getMapY() - 1; my <= level->getMapY() + 1; ++my)
+		{
+			for (int mx = level->getMapX() - 1; mx <= level->getMapX() + 1; ++mx)
+			{
+				if (mx < 0 || my < 0)
+					continue;
+
+				const std::string& levelName = pmap->getLevelAt(mx, my);
+				if (levelName.empty())
+					continue;
+
+				TLevel* visibleLevel = TLevel::findLevel(levelName, server);
+				if (visibleLevel && visibleLevel != level)
+					visibleLevels.push_back(visibleLevel);
+			}
+		}
+	}
+
+	// Levels that went out of view are cached from now on, so coming back only sends what changed.
+	// Streamed levels never got their board changes, so those stay uncached until they are entered.
+	for (auto oldLevel : gmapVisibleLevels)
+	{
+		if (oldLevel != level && std::find(visibleLevels.begin(), visibleLevels.end(), oldLevel) == visibleLevels.end())
+		{
+			if (getCachedLevelModTime(oldLevel) != 0)
+				setCachedLevelModTime(oldLevel, time(0));
+		}
+	}
+
+	// Push the levels that came into view.  The level we are in was just sent in full.
+	for (auto newLevel : visibleLevels)
+	{
+		if (!isGmapLevelStreamed(newLevel))
+			streamGmapLevel(newLevel);
+	}
+
+	gmapVisibleLevels = std::move(visibleLevels);
+}
+
+void TPlayer::streamGmapLevel(TLevel* pLevel)
+{
+	time_t l_time = getCachedLevelModTime(pLevel);
+
+	sendPacket(CString() >> (char)PLO_LEVELNAME << pLevel->getLevelName());
+
+	// Board changes only apply to a board the client already has.  Otherwise they are sent
+	// along with the board when the level is entered.
+	if (l_time != 0)
+		sendPacket(CString() << pLevel->getBoardChangesPacket(l_time));
+	sendPacket(CString() << pLevel->getChestPacket(this));
+	sendPacket(CString() << pLevel->getHorsePacket());
+	sendPacket(CString() << pLevel->getBaddyPacket(versionID));
+
+	sendPacket(CString() >> (char)PLO_SETACTIVELEVEL << pmap->getMapName());
+	sendPacket(CString() << pLevel->getNpcsPacket(l_time, versionID));
+
+	sendPacket(CString() >> (char)PLO_LEVELNAME << pmap->getMapName());
+}
+
 void TPlayer::resetLevelCache(const TLevel* level)
 {
+	// The level has to be streamed in again too.
+	auto streamed = std::find(gmapVisibleLevels.begin(), gmapVisibleLevels.end(), level);
+	if (streamed != gmapVisibleLevels.end())
+		gmapVisibleLevels.erase(streamed);
+
 	for (std::vector<SCachedLevel*>::const_iterator i = cachedLevels.begin(); i != cachedLevels.end(); ++i)
 	{
 		SCachedLevel* cl = *i;
@@ -2049,13 +2174,13 @@ bool TPlayer::addWeapon(TWeapon* weapon)
 	if (weapon == nullptr) return false;
 
 	// See if the player already has the weapon.
-	if (vecSearch<CString>(weaponList, weapon->getName()) == -1)
+	if (weaponList.add(weapon->getName()))
 	{
-		weaponList.push_back(weapon->getName());
 		if (id == -1) return true;
 
-		// Send weapon.
-		sendPacket(weapon->getWeaponPacket(versionID));
+		// Send weapon, unless it is still compiling and sent once it is done.
+		if (!server->isCompilingGS2(weapon))
+			sendPacket(weapon->getWeaponPacket(versionID));
 	}
 
 	return true;
@@ -2078,7 +2203,7 @@ bool TPlayer::deleteWeapon(TWeapon* weapon)
 	if (weapon == 0) return false;
 
 	// Remove the weapon.
-	if (vecRemove<CString>(weaponList, weapon->getName()))
+	if (weaponList.remove(weapon->getName()))
 	{
 		if (id == -1) return true;
 
@@ -2988,13 +3113,13 @@ bool TPlayer::msgPLI_OPENCHEST(CString& pPacket)
 	if (level) {
 		auto chest = level->getChest(cX, cY);
 		if (chest) {
-			auto chestStr = level->getChestStr(*chest);
+			auto chestKey = level->getChestKey(*chest);
 
-			if (!hasChest(chestStr)) {
+			if (!hasChest(chestKey)) {
 				LevelItemType chestItem = chest->getItemIndex();
 				setProps(CString() << TLevelItem::getItemPlayerProp(chestItem, this), PLSETPROPS_FORWARD | PLSETPROPS_FORWARDSELF);
 				sendPacket(CString() >> (char)PLO_LEVELCHEST >> (char)1 >> (char)cX >> (char)cY);
-				chestList.push_back(chestStr);
+				chestList.add(chestKey);
 			}
 		}
 	}
@@ -3220,14 +3345,7 @@ bool TPlayer::msgPLI_PRIVATEMESSAGE(CString& pPacket)
 bool TPlayer::msgPLI_NPCWEAPONDEL(CString& pPacket)
 {
 	CString weapon = pPacket.readString("");
-	for (std::vector<CString>::iterator i = weaponList.begin(); i != weaponList.end(); )
-	{
-		if (*i == weapon)
-		{
-			i = weaponList.erase(i);
-		}
-		else ++i;
-	}
+	weaponList.remove(weapon);
 	return true;
 }
 
@@ -42,9 +42,47 @@ CString _zlibFix(
 	TPlayer: Manage Account
 */
 bool TPlayer::sendLogin()
+{
+	// The account is read on a loader thread so a crowd of logins doesn't stall the server.
+	// Until it is ready the player waits without being loaded, the same as it did for the listserver.
+	// Each load gets its own token, so a load for an earlier connection that had the same id, or
+	// for an earlier login of this one, is ignored when it finishes.
+	static unsigned int nextLoginToken = 0;
+	if (++nextLoginToken == 0)
+		++nextLoginToken;
+	pendingLogin = nextLoginToken;
+
+	TServer* playerServer = server;
+	int playerId = id;
+	unsigned int loginToken = pendingLogin;
+	server->getAccountLoader().load(*this, accountName, (isRC() || isNC() ? true : false),
+		[playerServer, playerId, loginToken](std::unique_ptr<TAccount> account, bool loadedFromDefault)
+		{
+			TPlayer* player = playerServer->getPlayer(playerId, PLTYPE_ANYPLAYER | PLTYPE_ANYNC);
+			if (!player || player->pendingLogin != loginToken)
+				return;
+			player->pendingLogin = 0;
+
+			// If it fails, disconnect him.
+			if (!player->finishLogin(std::move(account), loadedFromDefault))
+			{
+				player->setId(0);	// Prevent saving of the account.
+				player->disconnect();
+			}
+		});
+
+	return true;
+}
+
+bool TPlayer::finishLogin(std::unique_ptr<TAccount> pAccount, bool pLoadedFromDefault)
 {
 	// We don't need to check if this fails.. because the defaults have already been loaded :)
-	loadAccount(accountName, (isRC() || isNC() ? true : false));
+	if (pAccount)
+	{
+		CString requestedAccount(accountName);
+		TAccount::operator=(*pAccount);
+		finishLoading(requestedAccount, pLoadedFromDefault);
+	}
 
 	// Check to see if the player is banned or not.
 	if (isBanned && !hasRight(PLPERM_MODIFYSTAFFACCOUNT))
@@ -286,16 +324,15 @@ bool TPlayer::sendLoginClient()
 		this->setFlag("gr.ip", this->accountIpStr, true);
 
 	// Send the player's flags.
-	for (auto i = flagList.begin(); i != flagList.end(); ++i)
+	for (auto [flagName, flagValue] : flagList)
 	{
-		if (i->second.isEmpty()) sendPacket(CString() >> (char)PLO_FLAGSET << i->first);
-		else sendPacket(CString() >> (char)PLO_FLAGSET << i->first << "=" << i->second);
+		if (flagValue.isEmpty()) sendPacket(CString() >> (char)PLO_FLAGSET << flagName);
+		else sendPacket(CString() >> (char)PLO_FLAGSET << flagName << "=" << flagValue);
 	}
 
 	// Send the server's flags to the player.
-	std::unordered_map<std::string, CString> * serverFlags = server->getServerFlags();
-	for (auto i = serverFlags->begin(); i != serverFlags->end(); ++i)
-		sendPacket(CString() >> (char)PLO_FLAGSET << i->first << "=" << i->second);
+	for (auto [flagName, flagValue] : *server->getServerFlags())
+		sendPacket(CString() >> (char)PLO_FLAGSET << flagName << "=" << flagValue);
 
 	// Delete the bomb and bow.  They get automagically added by the client for
 	// God knows which reason.  Bomb and Bow must be capitalized.
@@ -303,7 +340,7 @@ bool TPlayer::sendLoginClient()
 	sendPacket(CString() >> (char)PLO_NPCWEAPONDEL << "Bow");
 
 	// Send the player's weapons.
-	for (std::vector<CString>::iterator i = weaponList.begin(); i != weaponList.end(); ++i)
+	for (auto i = weaponList.begin(); i != weaponList.end(); ++i)
 	{
 		TWeapon* weapon = server->getWeapon(*i);
 		if (weapon == 0)
@@ -319,7 +356,10 @@ bool TPlayer::sendLoginClient()
 			}
 			continue;
 		}
-		sendPacket(weapon->getWeaponPacket(versionID));
+
+		// Weapons still compiling are sent once they are done
+		if (!server->isCompilingGS2(weapon))
+			sendPacket(weapon->getWeaponPacket(versionID));
 	}
 
 	if (versionID >= CLVER_4_0211)
@@ -327,7 +367,7 @@ bool TPlayer::sendLoginClient()
 		// Send the player's weapons.
 		for (auto & i : server->getClassList())
 		{
-			if (i.second != nullptr)
+			if (i.second != nullptr && !server->isCompilingGS2(i.second.get()))
 				sendPacket(i.second->getClassPacket());
 		}
 	}
@@ -616,4 +616,28 @@ void TPlayer::sendNCAddr()
 	}
 }
 
+// Sends the scripts using the most execution time, and how the npc scripts are keeping up (RC and NC)
+void TPlayer::sendScriptStats(size_t count)
+{
+	auto npcStats = server->calculateNpcStats(count);
+
+	sendPacket(CString() >> (char)PLO_RC_CHAT << "Top scripts using the most execution time (in the last min)");
+
+	int idx = 0;
+	for (auto & [profile, name] : npcStats)
+	{
+		idx++;
+		sendPacket(CString() >> (char)PLO_RC_CHAT << CString(idx) << ". 	" << CString(profile.total) << "	" << CString((unsigned int)profile.calls) << " calls, max "
+			<< CString(profile.max * 1000.0) << " ms, 99% under " << CString(profile.getPercentile(0.99) * 1000.0) << " ms	" << name);
+	}
+
+	auto& scheduler = server->getScriptEngine()->getNpcScheduler();
+	auto& schedulerStats = scheduler.getStats();
+	sendPacket(CString() >> (char)PLO_RC_CHAT << "Npc script ticks: median " << CString(scheduler.getTickTime(0.5).count() / 1000.0)
+		<< " ms, 99th percentile " << CString(scheduler.getTickTime(0.99).count() / 1000.0) << " ms, max " << CString(scheduler.getTickTime(1.0).count() / 1000.0) << " ms");
+	sendPacket(CString() >> (char)PLO_RC_CHAT << "Npc turns: " << CString((unsigned long long)schedulerStats.turns) << ", carried over " << CString((unsigned long long)schedulerStats.carriedOver)
+		<< ", deferred " << CString((unsigned long long)schedulerStats.deferred) << ", over quota " << CString((unsigned long long)schedulerStats.overruns)
+		<< ", deprioritized " << CString((unsigned long long)schedulerStats.demotions));
+}
+
 #endif
\ No newline at end of file
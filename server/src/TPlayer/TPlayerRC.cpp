@@ -1,4 +1,5 @@
 #include "IDebug.h"
+#include <algorithm>
 #include <vector>
 #include <map>
 #include <sys/stat.h>
@@ -11,6 +12,7 @@
 #endif
 #include <stdio.h>
 #include <fmt/format.h>
+#include "utilities/stringutils.h"
 #include "utilities/timeunits.h"
 
 #include "TServer.h"
@@ -73,15 +75,15 @@ void TPlayer::setPropsRC(CString& pPacket, TPlayer* rc)
 	setProps(props, (id != -1 ? PLSETPROPS_FORWARD | PLSETPROPS_FORWARDSELF : 0), rc);
 
 	// Clear flags
-	for (auto i = flagList.begin(); i != flagList.end(); ++i)
+	for (auto [flagName, flagValue] : flagList)
 	{
-		outPacket >> (char)PLO_FLAGDEL << i->first;
-		if (!i->second.isEmpty()) outPacket << "=" << i->second;
+		outPacket >> (char)PLO_FLAGDEL << flagName;
+		if (!flagValue.isEmpty()) outPacket << "=" << flagValue;
 		outPacket << "\n";
 	}
 
 	// Clear Weapons
-	for (std::vector<CString>::iterator i = weaponList.begin(); i != weaponList.end(); ++i)
+	for (auto i = weaponList.begin(); i != weaponList.end(); ++i)
 	{
 		outPacket >> (char)PLO_NPCWEAPONDEL << *i << "\n";
 
@@ -126,7 +128,7 @@ void TPlayer::setPropsRC(CString& pPacket, TPlayer* rc)
 	{
 		unsigned char len = pPacket.readGUChar();
 		char loc[2] = {pPacket.readGChar(), pPacket.readGChar()};
-		chestList.push_back(CString() << CString((int)loc[0]) << ":" << CString((int)loc[1]) << ":" << pPacket.readChars(len - 2));
+		chestList.add(TChestList::makeKey(pPacket.readChars(len - 2), loc[0], loc[1]));
 		--chestCount;
 	}
 
@@ -179,19 +181,19 @@ CString TPlayer::getPropsRC()
 
 	// Add the player's flags.
 	ret >> (short)flagList.size();
-	for (auto i = flagList.begin(); i != flagList.end(); ++i)
+	for (auto [flagName, flagValue] : flagList)
 	{
-		CString flag = i->first;
-		if (!i->second.isEmpty()) flag << "=" << i->second;
+		CString flag = flagName;
+		if (!flagValue.isEmpty()) flag << "=" << flagValue;
 		if (flag.length() > 0xDF) flag.removeI(0xDF);
 		ret >> (char)flag.length() << flag;
 	}
 
 	// Add the player's chests.
 	ret >> (short)chestList.size();
-	for (std::vector<CString>::iterator i = chestList.begin(); i != chestList.end(); ++i)
+	for (auto i = chestList.begin(); i != chestList.end(); ++i)
 	{
-		std::vector<CString> chest = (*i).tokenize(":");
+		std::vector<CString> chest = TChestList::toString(*i).tokenize(":");
 		if (chest.size() == 3)
 		{
 			CString chestData;
@@ -419,7 +421,7 @@ bool TPlayer::msgPLI_RC_UPDATELEVELS(CString& pPacket)
 	for (int i = 0; i < levelCount; ++i)
 	{
 		TLevel* level = server->getLevel(pPacket.readChars(pPacket.readGUChar()));
-		if (level) level->reload();
+		if (level) level->reloadChanges();
 	}
 	return true;
 }
@@ -480,9 +482,9 @@ bool TPlayer::msgPLI_RC_SERVERFLAGSGET(CString& pPacket)
 	}
 	CString ret;
 	ret >> (char)PLO_RC_SERVERFLAGSGET >> (short)server->getServerFlags()->size();
-	for (auto i = server->getServerFlags()->begin(); i != server->getServerFlags()->end(); ++i)
+	for (auto [flagName, flagValue] : *server->getServerFlags())
 	{
-		CString flag = CString() << i->first << "=" << i->second;
+		CString flag = CString() << flagName << "=" << flagValue;
 		ret >> (char)flag.length() << flag;
 	}
 	sendPacket(ret);
@@ -499,10 +501,10 @@ bool TPlayer::msgPLI_RC_SERVERFLAGSSET(CString& pPacket)
 	}
 
 	unsigned short count = pPacket.readGUShort();
-	std::unordered_map<std::string, CString> * serverFlags = server->getServerFlags();
+	TFlagList* serverFlags = server->getServerFlags();
 
 	// Save server flags.
-	std::unordered_map<std::string, CString> oldFlags = *serverFlags;
+	TFlagList oldFlags = *serverFlags;
 
 	// Delete server flags.
 	serverFlags->clear();
@@ -512,37 +514,27 @@ bool TPlayer::msgPLI_RC_SERVERFLAGSSET(CString& pPacket)
 		server->setFlag(pPacket.readChars(pPacket.readGUChar()), false);
 
 	// Send flag changes to all players.
-	for (auto i = serverFlags->begin(); i != serverFlags->end(); ++i)
+	for (auto [flagName, flagValue] : *serverFlags)
 	{
-		bool found = false;
-		for (auto j = oldFlags.begin(); j != oldFlags.end();)
-		{
-			// Flag name
-			if (i->first == j->first)
-			{
-				// Check to see if the values are the same.
-				// If they are, set found to true so we don't send it to the player again.
-				if (i->second == j->second)
-					found = true;
-				oldFlags.erase(j++);
-				if (found) break;
-			}
-			else ++j;
-		}
+		// Check to see if the values are the same.
+		// If they are, set found to true so we don't send it to the player again.
+		auto name = utilities::toStringView(flagName);
+		bool found = (oldFlags.contains(name) && oldFlags.get(name) == flagValue);
+		oldFlags.erase(name);
 
 		// If we didn't find a match, this is either a new flag, or a changed flag.
 		if (!found)
 		{
-			if (i->second.isEmpty())
-				server->sendPacketTo(PLTYPE_ANYCLIENT, CString() >> (char)PLO_FLAGSET << i->first);
+			if (flagValue.isEmpty())
+				server->sendPacketTo(PLTYPE_ANYCLIENT, CString() >> (char)PLO_FLAGSET << flagName);
 			else
-				server->sendPacketTo(PLTYPE_ANYCLIENT, CString() >> (char)PLO_FLAGSET << i->first << "=" << i->second);
+				server->sendPacketTo(PLTYPE_ANYCLIENT, CString() >> (char)PLO_FLAGSET << flagName << "=" << flagValue);
 		}
 	}
 
 	// If any flags were deleted, tell that to the players now.
-	for (auto i = oldFlags.begin(); i != oldFlags.end(); ++i)
-		server->sendPacketTo(PLTYPE_ANYCLIENT, CString() >> (char)PLO_FLAGDEL << i->first);
+	for (auto [flagName, flagValue] : oldFlags)
+		server->sendPacketTo(PLTYPE_ANYCLIENT, CString() >> (char)PLO_FLAGDEL << flagName);
 
 	rclog.out("%s has updated the server flags.\n", accountName.text());
 	server->sendPacketTo(PLTYPE_ANYRC, CString() >> (char)PLO_RC_CHAT << accountName << " has updated the server flags.");
@@ -607,6 +599,10 @@ bool TPlayer::msgPLI_RC_ACCOUNTDEL(CString& pPacket)
 
 	// Remove the account from the file system.
 	server->getAccountsFileSystem()->removeFile(accfile);
+	server->getAccountIndex().removeAccount(accfile);
+
+	// Drop any save that is still waiting, or it would write the account back afterwards.
+	server->getAccountWriter().discard(accpath);
 
 	// Delete the file now.
 	remove(accpath.text());
@@ -631,26 +627,25 @@ bool TPlayer::msgPLI_RC_ACCOUNTLISTGET(CString& pPacket)
 	if (name.length() == 0)
 		name = "*";
 
-	// Start our packet.
-	CString ret;
-	ret >> (char)PLO_RC_ACCOUNTLISTGET;
-
-	// Search through all the accounts.
-	CFileSystem* fs = server->getAccountsFileSystem();
-	for (std::map<CString, CString>::iterator i = fs->getFileList().begin(); i != fs->getFileList().end(); ++i)
-	{
-		CString acc = removeExtension(i->first);
-		if (acc.isEmpty()) continue;
-		if (!acc.match(name)) continue;
-		if (conditions.length() != 0)
+	// Search through all the accounts in the background, and answer once the search is
+	// done as long as the RC is still around.
+	TServer* playerServer = server;
+	int playerId = getId();
+	CString playerAccount = accountName;
+	server->getAccountIndex().search(name, conditions,
+		[playerServer, playerId, playerAccount](const std::vector<CString>& accounts)
 		{
-			if (TAccount::meetsConditions(i->second, conditions))
+			TPlayer* player = playerServer->getPlayer(playerId);
+			if (!player || player->getAccountName() != playerAccount)
+				return;
+
+			CString ret;
+			ret >> (char)PLO_RC_ACCOUNTLISTGET;
+			for (auto & acc : accounts)
 				ret >> (char)acc.length() << acc;
-		}
-		else ret >> (char)acc.length() << acc;
-	}
+			player->sendPacket(ret);
+		});
 
-	sendPacket(ret);
 	return true;
 }
 
@@ -1063,7 +1058,7 @@ bool TPlayer::msgPLI_RC_CHAT(CString& pPacket)
 				{
 					server->sendPacketTo(PLTYPE_ANYRC, CString() >> (char)PLO_RC_CHAT << "Server: " << accountName << " updated level: " << level->getLevelName());
 					rclog.out("%s updated level: %s\n", accountName.text(), level->getLevelName().text());
-					level->reload();
+					level->reloadChanges();
 				}
 			}
 		}
@@ -1145,20 +1140,9 @@ bool TPlayer::msgPLI_RC_CHAT(CString& pPacket)
 			nclog.out("%s saved the npcs to disk.\n", accountName.text());
 			server->saveNpcs();
 		}
-		else if (words[0] == "/stats" && words.size() == 1)
+		else if (words[0] == "/stats" && words.size() <= 2)
 		{
-			auto npcStats = server->calculateNpcStats();
-
-			sendPacket(CString() >> (char)PLO_RC_CHAT << "Top scripts using the most execution time (in the last min)");
-
-			int idx = 0;
-			for (auto it = npcStats.begin(); it != npcStats.end(); ++it)
-			{
-				idx++;
-				sendPacket(CString() >> (char)PLO_RC_CHAT << CString(idx) << ". 	" << CString((*it).first) << "	" << (*it).second);
-				if (idx == 50)
-					break;
-			}
+			sendScriptStats(words.size() == 2 ? (size_t)std::max(strtoint(words[1]), 1) : 50);
 		}
 #endif
 		else if(words[0] == "/find" && words.size() > 1)
@@ -1173,7 +1157,7 @@ bool TPlayer::msgPLI_RC_CHAT(CString& pPacket)
 			// Search for the files.
 			for (unsigned int i = 0; i < FS_COUNT; ++i)
 			{
-				auto& fileList = server->getFileSystem(i)->getFileList();
+				auto fileList = server->getFileSystem(i)->getFileList();
 				CString fs("none");
 				if (i == 0) fs = "all";
 				if (i == 1) fs = "file";
@@ -1183,7 +1167,7 @@ bool TPlayer::msgPLI_RC_CHAT(CString& pPacket)
 				if (i == 5) fs = "sword";
 				if (i == 6) fs = "shield";
 
-				for (std::map<CString, CString>::const_iterator i = fileList.begin(); i != fileList.end(); ++i)
+				for (std::map<CString, CString>::const_iterator i = fileList->begin(); i != fileList->end(); ++i)
 				{
 					if (i->first.match(search))
 						found[i->second.removeAll(server->getServerPath())] = fs;
@@ -1606,6 +1590,7 @@ bool TPlayer::msgPLI_RC_FILEBROWSER_START(CString& pPacket)
 	fs.addDir(lastFolder);
 
 	// Construct the file list.
+	auto fileList = fs.getFileList();
 	CString files;
 	std::vector<CString> wildcards = folderMap[lastFolder].tokenize("\n");
 	for (std::vector<CString>::iterator i = wildcards.begin(); i != wildcards.end(); ++i)
@@ -1613,7 +1598,7 @@ bool TPlayer::msgPLI_RC_FILEBROWSER_START(CString& pPacket)
 		CString rights = (*i).readString(":");
 		CString wildcard = (*i).readString("");
 		(*i).setRead(0);
-		for (std::map<CString, CString>::iterator j = fs.getFileList().begin(); j != fs.getFileList().end(); ++j)
+		for (std::map<CString, CString>::const_iterator j = fileList->begin(); j != fileList->end(); ++j)
 		{
 			// See if the file matches the wildcard.
 			if (!j->first.match(wildcard))
@@ -1696,6 +1681,7 @@ bool TPlayer::msgPLI_RC_FILEBROWSER_CD(CString& pPacket)
 	// Construct the file list.
 	// file packet: {CHAR name_length}{STRING name}{CHAR rights_length}{STRING rights}{INT5 file_size}{INT5 file_mod_time}
 	// files: {CHAR file_packet_length}{file_packet}[space]{CHAR file_packet_length}{file_packet}[space]
+	auto fileList = fs.getFileList();
 	CString files;
 	std::vector<CString> wildcards = folderMap[lastFolder].tokenize("\n");
 	for (std::vector<CString>::iterator i = wildcards.begin(); i != wildcards.end(); ++i)
@@ -1703,7 +1689,7 @@ bool TPlayer::msgPLI_RC_FILEBROWSER_CD(CString& pPacket)
 		CString rights = (*i).readString(":");
 		CString wildcard = (*i).readString("");
 		(*i).setRead(0);
-		for (std::map<CString, CString>::iterator j = fs.getFileList().begin(); j != fs.getFileList().end(); ++j)
+		for (std::map<CString, CString>::const_iterator j = fileList->begin(); j != fileList->end(); ++j)
 		{
 			// See if the file matches the wildcard.
 			if (!j->first.match(wildcard))
@@ -2159,15 +2145,13 @@ void updateFile(TPlayer* player, TServer* server, CString& dir, CString& file)
 	CString fullPath(dir);
 	fullPath << file;
 
-	// Find the file extension.
-	CString ext = getExtension(file);
-
 	// Check and see if it is an account.
 	if (dir == "accounts/")
 	{
 		CFileSystem* fs = server->getAccountsFileSystem();
 		if (fs->find(file).isEmpty())
 			fs->addFile(CString() << dir << file);
+		server->getAccountIndex().loadAccount(file, fs->find(file));
 		return;
 	}
 
@@ -2213,76 +2197,6 @@ void updateFile(TPlayer* player, TServer* server, CString& dir, CString& file)
 		}
 	}
 
-	// If it is a level, see if we can update it.
-	// TODO: Should combine all server options loading/saving into one function in TServer.
-	if (ext == ".nw" || ext == ".graal" || ext == ".zelda")
-	{
-		TLevel* l = TLevel::findLevel(file, server);
-		if (l) l->reload();
-	}
-	else if (ext == ".dump" || dir.findi(CString("weapons")) > -1)
-		server->loadWeapons(true);
-	else if (file == "serveroptions.txt")
-	{
-		server->loadSettings();
-		server->loadMaps();
-	}
-	else if (file == "adminconfig.txt")
-		server->loadAdminSettings();
-	else if (file == "allowedversions.txt")
-		server->loadAllowedVersions();
-	else if (file == "foldersconfig.txt")
-		server->loadFileSystem();
-	else if (file == "serverflags.txt")
-		server->loadServerFlags();
-	else if (file == "servermessage.html")
-		server->loadServerMessage();
-	else if (file == "ipbans.txt")
-		server->loadIPBans();
-	else if (file == "rules.txt")
-		server->loadWordFilter();
-	else
-	{
-		// Check if this is a file that previously existed on the server so we
-		// can notify existing clients that the file was updated.
-		auto fileSystem = server->getFileSystem(FS_FILE);
-		if (!isNewFile && !fileSystem->find(file).isEmpty())
-		{
-			// Game files
-			const auto& playerList = *server->getPlayerList();
-			auto fileName = file.toString();
-
-			CString updatePacket;
-			updatePacket >> (char)PLO_UPDATEPACKAGEISUPDATED << file << "\n";
-
-			// Ganis need to be recompiled on update
-			CString bytecodePacket;
-			if (ext == ".gani")
-			{
-				auto& aniManager = server->getAnimationManager();
-
-				// delete the resource
-				aniManager.deleteResource(fileName);
-
-				// reload the resource to compile the bytecode again
-				auto findAni = aniManager.findOrAddResource(fileName);
-				if (findAni)
-					bytecodePacket << findAni->getBytecodePacket();
-			}
-
-			// Send the update packet to any v4+ clients that have seen this file
-			for (auto pl : playerList)
-			{
-				if (pl->isClient() && pl->getVersion() >= CLVER_4_0211)
-				{
-					if (pl->hasSeenFile(fileName))
-						pl->sendPacket(updatePacket);
-
-					// Send GS2 gani scripts
-					if (!bytecodePacket.isEmpty())
-						pl->sendPacket(bytecodePacket);
-				}
-			}
-		}
-	}
+	// Reload whatever depends on the file.
+	server->reloadFile(dir, file, isNewFile);
 }
@@ -18,14 +18,11 @@ bool TPlayer::msgPLI_VERIFYWANTSEND(CString& pPacket)
 
 	if (!ignoreChecksum)
 	{
-		CString fileData = server->getFileSystem()->load(fileName);
-		if (!fileData.isEmpty())
+		auto file = server->getFileCache().get(server->getFileSystem()->find(fileName));
+		if (file && file->checksum == fileChecksum)
 		{
-			if (calculateCrc32Checksum(fileData) == fileChecksum)
-			{
-				sendPacket(CString() >> (char)PLO_FILEUPTODATE << fileName);
-				return true;
-			}
+			sendPacket(CString() >> (char)PLO_FILEUPTODATE << fileName);
+			return true;
 		}
 	}
 
@@ -46,39 +43,53 @@ bool TPlayer::msgPLI_UPDATEPACKAGEREQUESTFILE(CString& pPacket)
 	if (installType == 2)
 		fileChecksums.clear();
 	
+	// Packages are loaded in the background, and are usually ready by the time they are asked for.
+	// If one is still loading, answer once it is done as long as the player is still around.
+	TServer* playerServer = server;
+	int playerId = getId();
+	CString playerAccount = accountName;
+	server->getPackageManager().whenReady(packageName.toString(),
+		[playerServer, playerId, playerAccount, packageName, fileChecksums](const auto& updatePackage)
+		{
+			TPlayer* player = playerServer->getPlayer(playerId);
+			if (player && player->getAccountName() == playerAccount)
+				player->sendUpdatePackage(packageName, updatePackage.get(), fileChecksums);
+		});
+	
+	return true;
+}
+
+void TPlayer::sendUpdatePackage(const CString& pPackageName, const TUpdatePackage* pPackage, CString pFileChecksums)
+{
 	auto totalDownloadSize = 0;
 	std::vector<std::string> missingFiles;
 	
+	if (pPackage)
 	{
-		auto updatePackage = server->getPackageManager().findOrAddResource(packageName.toString());
-		if (updatePackage)
+		for (const auto& [fileName, entry] : pPackage->getFileList())
 		{
-			for (const auto& [fileName, entry] : updatePackage->getFileList())
+			// Compare the checksum for each file entry if the checksum is provided
+			bool needsFile = true;
+			if (pFileChecksums.bytesLeft() >= 5)
 			{
-				// Compare the checksum for each file entry if the checksum is provided
-				bool needsFile = true;
-				if (fileChecksums.bytesLeft() >= 5)
-				{
-					uint32_t userFileChecksum = fileChecksums.readGUInt5();
-					if (entry.checksum == userFileChecksum)
-						needsFile = false;
-				}
-				
-				if (needsFile)
-				{
-					totalDownloadSize += entry.size;
-					missingFiles.push_back(fileName);
-				}
+				uint32_t userFileChecksum = pFileChecksums.readGUInt5();
+				if (entry.checksum == userFileChecksum)
+					needsFile = false;
+			}
+			
+			if (needsFile)
+			{
+				totalDownloadSize += entry.size;
+				missingFiles.push_back(fileName);
 			}
 		}
 	}
 	
-	sendPacket(CString() >> (char)PLO_UPDATEPACKAGESIZE >> (char)packageName.length() << packageName
+	sendPacket(CString() >> (char)PLO_UPDATEPACKAGESIZE >> (char)pPackageName.length() << pPackageName
 	                     >> (long long)totalDownloadSize);
 	
 	for (const auto& wantFile : missingFiles)
 		this->sendFile(wantFile);
 	
-	sendPacket(CString() >> (char)PLO_UPDATEPACKAGEDONE << packageName);
-	return true;
+	sendPacket(CString() >> (char)PLO_UPDATEPACKAGEDONE << pPackageName);
 }
@@ -3,14 +3,14 @@
 #include "TServer.h"
 
 TScriptClass::TScriptClass(TServer *server, const std::string& className, const std::string& classSource)
-	: _className(className)
+	: _server(server), _className(className)
 {
 	parseScripts(server, classSource);
 }
 
 TScriptClass::~TScriptClass()
 {
-
+	_server->cancelGS2Compile(this);
 }
 
 void TScriptClass::parseScripts(TServer *server, const std::string& classSource)
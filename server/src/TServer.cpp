@@ -1,7 +1,10 @@
 #include "IDebug.h"
+#include <sys/stat.h>
+#include <algorithm>
 #include <thread>
 #include <atomic>
 #include <chrono>
+#include <filesystem>
 #include <functional>
 
 #include <fmt/format.h>
@@ -38,7 +41,7 @@ auto methodstub(T* t, R(T::*m)(Args...)) {
 }
 
 TServer::TServer(const CString& pName)
-	: running(false), doRestart(false), name(pName), serverlist(this), wordFilter(this), animationManager(this), packageManager(this), serverStartTime(0),
+	: running(false), doRestart(false), fileWatchesComplete(false), name(pName), serverlist(this), wordFilter(this), animationManager(this), packageManager(&filesystem[FS_ALL], &fileCache), serverStartTime(0),
 	triggerActionDispatcher(methodstub(this, &TServer::createTriggerCommands))
 #ifdef V8NPCSERVER
 	, mScriptEngine(this), mPmHandlerNpc(nullptr)
@@ -73,9 +76,12 @@ TServer::TServer(const CString& pName)
 	scriptlog.setFilename(scriptPath);
 #endif
 
-	// Announce ourself to other classes.
-	for (auto & fs : filesystem) {
-		fs.setServer(this);
+	// Announce ourself to other classes.  The file systems share one index, so
+	// the files they have in common are only kept and loaded once.
+	fileIndex = std::make_shared<CFileIndex>();
+	for (int i = 0; i < FS_COUNT; ++i) {
+		filesystem[i].setServer(this);
+		filesystem[i].setIndex(fileIndex, i);
 	}
 	filesystem_accounts.setServer(this);
 }
@@ -312,6 +318,9 @@ void TServer::cleanup()
 	playerIds.clear();
 	playerList.clear();
 
+	// Write the accounts the players saved on their way out.
+	accountWriter.flush();
+
 	for (auto& level : levelList) {
 		delete level;
 	}
@@ -354,16 +363,36 @@ bool TServer::doMain()
 	// Update our socket manager.
 	sockManager.update(0, 5000);		// 5ms
 
+	// Answer the players waiting on update packages that finished loading.
+	packageManager.update();
+
+	// Log in the players whose accounts were read, answer the account searches that finished,
+	// and pick up the accounts that were written.
+	accountLoader.update();
+	accountIndex.update();
+	for (auto & write : accountWriter.update())
+	{
+		CString accountFile = write.path.subString(write.path.findl(CFileSystem::getPathSeparator()) + 1);
+		if (write.saved)
+			accountIndex.loadAccount(accountFile, write.path);
+		else
+			rclog.out("** Error saving account: %s\n", removeExtension(accountFile).text());
+	}
+
 	// Current time
 	auto currentTimer = std::chrono::high_resolution_clock::now();
 
 #ifdef V8NPCSERVER
     mScriptEngine.RunScripts(currentTimer);
-
-	// enable when we switch to async compiling
-	//gs2ScriptManager.runQueue();
 #endif
 
+	// Hand out GS2 scripts that finished compiling, and send the levels that waited on them
+	if (gs2ScriptManager.runQueue() > 0)
+	{
+		for (auto player : playerList)
+			player->sendPendingLevels();
+	}
+
 	// Every second, do some events.
 	auto time_diff = std::chrono::duration_cast<std::chrono::milliseconds>(currentTimer - lastTimer);
 	if (time_diff.count() >= 1000)
@@ -393,26 +422,14 @@ bool TServer::doTimedEvents()
 		}
 	}
 
-	// Do level events.
-	{
-		for (auto level : levelList)
-		{
-            assert(level);
-			level->doTimedEvents();
-		}
-
-		// Group levels.
-		for (auto & groupLevel : groupLevels)
-		{
-			for (auto & j : groupLevel.second)
-			{
-				TLevel* level = j.second;
-				assert(level);
+	// Do level events.  Only the respawns and timeouts that expire this second are touched,
+	// including those of group and singleplayer levels.
+	levelTimers.advance(levelTimers.getCurrentTick() + 1, [](auto& callback) {
+		callback();
+	});
 
-				level->doTimedEvents();
-			}
-		}
-	}
+	// Apply the file changes since the last second.
+	handleFileChanges();
 
 	// Send NW time.
 	auto time_diff = std::chrono::duration_cast<std::chrono::seconds>(lastTimer - lastNWTimer);
@@ -440,12 +457,9 @@ bool TServer::doTimedEvents()
 	{
 		last3mTimer = lastTimer;
 
-		// TODO(joey): probably a better way to do this..
-
-		// Resynchronize the file systems.
-		filesystem_accounts.resync();
-		for (auto & i : filesystem)
-			i.resync();
+		// Resynchronize the file systems, unless changes are picked up as they happen.
+		if (!fileWatchesComplete)
+			resyncFileSystems();
 	}
 
 	// Save stuff every 5 minutes.
@@ -532,13 +546,25 @@ void TServer::loadAllFolders()
 	for (auto & fs : filesystem)
 		fs.clear();
 
-	filesystem[0].addDir("world");
+	std::vector<std::pair<CString, CString>> folders;
+	folders.emplace_back("world", "*");
 	if (settings.getStr("sharefolder").length() > 0)
 	{
-		std::vector<CString> folders = settings.getStr("sharefolder").tokenize(",");
-		for (auto & folder : folders)
-			filesystem[0].addDir(folder.trim());
+		std::vector<CString> shareFolders = settings.getStr("sharefolder").tokenize(",");
+		for (auto & folder : shareFolders)
+			folders.emplace_back(folder.trim(), "*");
 	}
+	addFolders(filesystem[0], filesystemTypes[0], folders);
+}
+
+void TServer::addFolders(CFileSystem& fs, const char* fsName, const std::vector<std::pair<CString, CString>>& folders)
+{
+	// Every folder is read at once, so the time spent is reported per file system.
+	auto start = std::chrono::high_resolution_clock::now();
+	fs.addDirs(folders);
+	auto time_diff = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+
+	serverlog.out("[%s]        loaded %d files in %d folders to %s (%lld ms)\n", name.text(), (int)fs.getFileCount(), (int)fs.getDirList().size(), fsName, (long long)time_diff.count());
 }
 
 void TServer::loadFolderConfig()
@@ -546,6 +572,7 @@ void TServer::loadFolderConfig()
 	for (auto & i : filesystem)
 		i.clear();
 
+	std::vector<std::pair<CString, CString>> folders[FS_COUNT];
 	foldersConfig = CString::loadToken(CString() << serverpath << "config/foldersconfig.txt", "\n", true);
 	for (auto & configLine : foldersConfig)
 	{
@@ -577,10 +604,18 @@ void TServer::loadFolderConfig()
 		// Add it to the appropriate file system.
 		if (fs != nullptr)
 		{
-			fs->addDir(dir, wildcard);
+			folders[fs - filesystem].emplace_back(dir, wildcard);
 			serverlog.out("[%s]        adding %s [%s] to %s\n", name.text(), dir.text(), wildcard.text(), type.text());
 		}
-		filesystem[0].addDir(dir, wildcard);
+		if (fs != &filesystem[0])
+			folders[0].emplace_back(dir, wildcard);
+	}
+
+	// Load each file system in one go.
+	for (int i = 0; i < FS_COUNT; ++i)
+	{
+		if (!folders[i].empty())
+			addFolders(filesystem[i], filesystemTypes[i], folders[i]);
 	}
 }
 
@@ -631,6 +666,13 @@ int TServer::loadConfigFiles()
 	serverlog.out("[%s]      Loading classes...\n", name.text());
 	loadClasses(true);
 
+	auto& bytecodeCache = gs2ScriptManager.getBytecodeCache();
+	if (bytecodeCache.isOpen())
+	{
+		serverlog.out("[%s]      %u GS2 scripts loaded from the bytecode cache, %u rejected, %u unused removed, %zu compiling in the background.\n", name.text(),
+			bytecodeCache.getStats().hits, bytecodeCache.getStats().rejected, bytecodeCache.getStats().pruned, gs2ScriptManager.getCompileCount());
+	}
+
 	// Load maps.
 	serverlog.out("[%s]      Loading maps...\n", name.text());
 	loadMaps(true);
@@ -639,6 +681,11 @@ int TServer::loadConfigFiles()
 	// Load database npcs.
 	serverlog.out("[%s]      Loading npcs...\n", name.text());
 	loadNpcs(true);
+
+	auto& codeCacheStats = mScriptEngine.getCodeCache().getStats();
+	serverlog.out("[%s]      Compiled %u scripts in %.1f ms, %u loaded from the code cache, %u rejected, %u unused removed.\n", name.text(),
+		mScriptEngine.getCompileCount(), std::chrono::duration<double, std::milli>(mScriptEngine.getCompileTime()).count(),
+		codeCacheStats.hits, codeCacheStats.rejected, codeCacheStats.pruned);
 #endif
 
 	// Load map levels - doing this after db npcs are loaded incase
@@ -672,6 +719,30 @@ void TServer::loadSettings()
 	// Load staff list
 	staffList = settings.getStr("staff").tokenize(",");
 
+	// How long account saves wait for more saves of the same account before they are written, in milliseconds.
+	accountWriter.setDelay(std::chrono::milliseconds(std::max(settings.getInt("accountsavedelay", 2000), 0)));
+
+	// Amount of served file data to keep in memory, in megabytes.
+	fileCache.setMaxSize((size_t)std::max(settings.getInt("filecachesize", 64), 0) * 1024 * 1024);
+
+	// Keep compiled GS2 bytecode on disk, so scripts don't have to be compiled again after a restart.
+	if (settings.getBool("gs2bytecodecache", true))
+		gs2ScriptManager.setBytecodeCache(std::filesystem::path(serverpath.text()) / "cache" / "gs2");
+	else
+		gs2ScriptManager.setBytecodeCache({});
+
+#ifdef V8NPCSERVER
+	// How long npc scripts may run per server tick, and per npc within a tick, in milliseconds.
+	mScriptEngine.setScriptBudget(std::chrono::microseconds((int)(std::max(settings.getFloat("scripttickbudget", 10.0f), 0.1f) * 1000)),
+		std::chrono::microseconds((int)(std::max(settings.getFloat("scriptnpcquota", 2.0f), 0.1f) * 1000)));
+
+	// Keep compiled scripts on disk, so they don't all have to be compiled again after a restart.
+	if (settings.getBool("scriptcodecache", true))
+		mScriptEngine.setCodeCache(std::filesystem::path(serverpath.text()) / "cache" / "v8");
+	else
+		mScriptEngine.setCodeCache({});
+#endif
+
 	// Send our ServerHQ info in case we got changed the staffonly setting.
 	getServerList()->sendServerHQ();
 }
@@ -717,14 +788,239 @@ void TServer::loadAllowedVersions()
 
 void TServer::loadFileSystem()
 {
-	for (auto & i : filesystem)
-		i.clear();
+	fileIndex->clear();
 	filesystem_accounts.clear();
-	filesystem_accounts.addDir("accounts", "*.txt");
+	addFolders(filesystem_accounts, "accounts", { std::make_pair(CString("accounts"), CString("*.txt")) });
 	if ( settings.getBool("nofoldersconfig", false))
 		loadAllFolders();
 	else
 		loadFolderConfig();
+
+	serverlog.out("[%s]        file index holds %d files in %d folders\n", name.text(), (int)fileIndex->getFileCount(), (int)fileIndex->getDirectoryCount());
+	updateFileWatches();
+
+	// Read the searchable fields of every account in the background.
+	accountIndex.load(filesystem_accounts.getFileList());
+
+	// Work out the contents of every update package in the background, so they are
+	// ready by the time players ask for them.
+	auto fileList = filesystem[FS_ALL].getFileList();
+	for (auto & [file, path] : *fileList)
+	{
+		if (getExtension(file) == ".gupd")
+			packageManager.queue(file.toString());
+	}
+}
+
+void TServer::resyncFileSystems()
+{
+	// Every file system that shares the index is loaded again along with the first.
+	filesystem_accounts.resync();
+	filesystem[FS_ALL].resync();
+	accountIndex.load(filesystem_accounts.getFileList());
+
+	updateFileWatches();
+}
+
+void TServer::updateFileWatches()
+{
+	fileWatchesComplete = false;
+	if (!fileWatcher.isAvailable())
+		return;
+
+	// Gather the directories of every file system.
+	std::set<CString> directories;
+	auto addDirectories = [&directories](CFileSystem& fs) {
+		for (auto & dir : fs.getDirList())
+			directories.insert(dir.subString(0, dir.findl(CFileSystem::getPathSeparator()) + 1));
+	};
+	addDirectories(filesystem_accounts);
+	for (auto & fs : filesystem)
+		addDirectories(fs);
+
+	// The weapons folder isn't part of any file system, but changes to it still reload the weapons.
+	CString weaponDir = CString() << serverpath << "weapons" << CFileSystem::getPathSeparator();
+
+	for (auto & dir : fileWatcher.getDirectories())
+	{
+		if (dir != weaponDir && directories.find(dir) == directories.end())
+			fileWatcher.unwatch(dir);
+	}
+
+	fileWatchesComplete = true;
+	for (auto & dir : directories)
+	{
+		if (!fileWatcher.watch(dir))
+			fileWatchesComplete = false;
+	}
+	fileWatcher.watch(weaponDir);
+
+	if (!fileWatchesComplete)
+		serverlog.out("[%s] ** [Error] Could not watch every folder for changes.  The file systems will be resynchronized every 3 minutes.\n", name.text());
+}
+
+void TServer::handleFileChanges()
+{
+	if (!fileWatcher.isAvailable())
+		return;
+
+	std::vector<CFileChange> changes;
+	if (!fileWatcher.poll(changes))
+	{
+		serverlog.out("[%s] :: Missed some file changes, resynchronizing the file systems...\n", name.text());
+		resyncFileSystems();
+		fileCache.clear();
+		packageManager.queueAll();
+	}
+
+	// Apply all of the changes to the file lists at once.  Files are new if they weren't
+	// in the list from before the changes.
+	std::unordered_set<std::string> newFiles;
+	for (auto & change : changes)
+	{
+		if (change.type == FILECHANGE_WRITTEN && filesystem[FS_ALL].find(change.file).isEmpty())
+			newFiles.insert(change.file.toString());
+	}
+	filesystem_accounts.syncFiles(changes);
+	filesystem[FS_ALL].syncFiles(changes);
+
+	CString accountDir = CString() << serverpath << "accounts" << CFileSystem::getPathSeparator();
+	CString weaponDir = CString() << serverpath << "weapons" << CFileSystem::getPathSeparator();
+	for (auto & change : changes)
+	{
+		CString fullPath = CString() << change.directory << change.file;
+		fileCache.invalidate(fullPath);
+		if (change.type == FILECHANGE_REMOVED)
+		{
+			packageManager.fileChanged(change.file.toString());
+			reloadedFiles.erase(fullPath.toString());
+		}
+
+		// Accounts are only kept in the file list and the account index.
+		if (change.directory.find(accountDir) == 0)
+		{
+			if (change.type == FILECHANGE_REMOVED)
+				accountIndex.removeAccount(change.file);
+			else if (change.type == FILECHANGE_WRITTEN && !filesystem_accounts.find(change.file).isEmpty())
+				accountIndex.loadAccount(change.file, CString() << change.directory << change.file);
+			continue;
+		}
+
+		// Files that are still being written are reloaded once they are closed.
+		if (change.type != FILECHANGE_WRITTEN)
+			continue;
+
+		// Weapons the server saved itself are already up to date.
+		if (change.directory == weaponDir)
+		{
+			if (change.file.match("weapon*.txt") && recordFileVersion(fullPath))
+				reloadWeapon(change.file);
+			continue;
+		}
+
+		CString dir(change.directory);
+		dir.removeI(0, serverpath.length());
+		reloadFile(dir, change.file, newFiles.find(change.file.toString()) != newFiles.end());
+	}
+}
+
+void TServer::reloadFile(const CString& pDir, const CString& pFile, bool pIsNewFile)
+{
+	// Uploads from RC are seen again by the file watcher, so skip the versions that were already reloaded.
+	CString fullPath = CString() << serverpath << pDir << pFile;
+	fileCache.invalidate(fullPath);
+	if (!recordFileVersion(fullPath))
+		return;
+
+	// Update packages that reference the file need its checksum worked out again.
+	packageManager.fileChanged(pFile.toString());
+
+	// Find the file extension.
+	CString ext = getExtension(pFile);
+
+	// If it is a level, see if we can update it.
+	// TODO: Should combine all server options loading/saving into one function in TServer.
+	if (ext == ".nw" || ext == ".graal" || ext == ".zelda")
+	{
+		TLevel* l = TLevel::findLevel(pFile, this);
+		if (l) l->reloadChanges();
+	}
+	else if (ext == ".dump" || pDir.findi(CString("weapons")) > -1)
+		loadWeapons(true);
+	else if (pFile == "serveroptions.txt")
+	{
+		loadSettings();
+		loadMaps();
+	}
+	else if (pFile == "adminconfig.txt")
+		loadAdminSettings();
+	else if (pFile == "allowedversions.txt")
+		loadAllowedVersions();
+	else if (pFile == "foldersconfig.txt")
+		loadFileSystem();
+	else if (pFile == "serverflags.txt")
+		loadServerFlags();
+	else if (pFile == "servermessage.html")
+		loadServerMessage();
+	else if (pFile == "ipbans.txt")
+		loadIPBans();
+	else if (pFile == "rules.txt")
+		loadWordFilter();
+	else
+	{
+		// Check if this is a file that previously existed on the server so we
+		// can notify existing clients that the file was updated.
+		if (!pIsNewFile && !filesystem[FS_FILE].find(pFile).isEmpty())
+		{
+			// Game files
+			auto fileName = pFile.toString();
+
+			CString updatePacket;
+			updatePacket >> (char)PLO_UPDATEPACKAGEISUPDATED << pFile << "\n";
+
+			// Ganis need to be recompiled on update
+			CString bytecodePacket;
+			if (ext == ".gani")
+			{
+				// delete the resource
+				animationManager.deleteResource(fileName);
+
+				// reload the resource to compile the bytecode again
+				auto findAni = animationManager.findOrAddResource(fileName);
+				if (findAni)
+					bytecodePacket << findAni->getBytecodePacket();
+			}
+
+			// Send the update packet to any v4+ clients that have seen this file
+			for (auto pl : playerList)
+			{
+				if (pl->isClient() && pl->getVersion() >= CLVER_4_0211)
+				{
+					if (pl->hasSeenFile(fileName))
+						pl->sendPacket(updatePacket);
+
+					// Send GS2 gani scripts
+					if (!bytecodePacket.isEmpty())
+						pl->sendPacket(bytecodePacket);
+				}
+			}
+		}
+	}
+}
+
+bool TServer::recordFileVersion(const CString& pFullPath)
+{
+	// Files are told apart by their modification time and size.
+	struct stat fileStat;
+	if (stat(pFullPath.text(), &fileStat) == -1)
+		return true;
+
+	auto& recorded = reloadedFiles[pFullPath.toString()];
+	if (recorded.first == fileStat.st_mtime && recorded.second == (long long)fileStat.st_size)
+		return false;
+
+	recorded = std::make_pair(fileStat.st_mtime, (long long)fileStat.st_size);
+	return true;
 }
 
 void TServer::loadServerFlags()
@@ -750,8 +1046,8 @@ void TServer::loadClasses(bool print)
 {
 	CFileSystem scriptFS(this);
 	scriptFS.addDir("scripts", "*.txt");
-	const std::map<CString, CString> &scriptFileList = scriptFS.getFileList();
-	for (auto & scriptFile : scriptFileList)
+	auto scriptFileList = scriptFS.getFileList();
+	for (auto & scriptFile : *scriptFileList)
 	{
 		std::string className = scriptFile.first.subString(0, scriptFile.first.length() - 4).text();
 
@@ -769,8 +1065,8 @@ void TServer::loadWeapons(bool print)
 	weaponFS.addDir("weapons", "weapon*.txt");
 	CFileSystem bcweaponFS(this);
 	bcweaponFS.addDir("weapon_bytecode", "*");
-	const std::map<CString, CString> &weaponFileList = weaponFS.getFileList();
-	for (auto & weaponFile : weaponFileList)
+	auto weaponFileList = weaponFS.getFileList();
+	for (auto & weaponFile : *weaponFileList)
 	{
 		TWeapon *weapon = TWeapon::loadWeapon(weaponFile.first, this);
 		if (weapon == nullptr) continue;
@@ -779,35 +1075,7 @@ void TServer::loadWeapons(bool print)
 		else
 			weapon->setModTime(bcweaponFS.getModTime(weapon->getByteCodeFile()));
 
-		// Check if the weapon exists.
-		if (weaponList.find(weapon->getName()) == weaponList.end())
-		{
-			weaponList[weapon->getName()] = weapon;
-			if (print) serverlog.out("[%s]        %s\n", name.text(), weapon->getName().c_str());
-		}
-		else
-		{
-			// If the weapon exists, and the version on disk is newer, reload it.
-			TWeapon* w = weaponList[weapon->getName()];
-			if (w->getModTime() < weapon->getModTime())
-			{
-				delete w;
-				weaponList[weapon->getName()] = weapon;
-				updateWeaponForPlayers(weapon);
-				if (print) {
-					serverlog.out("[%s]        %s [updated]\n", name.text(), weapon->getName().c_str());
-
-					TServer::sendPacketTo(PLTYPE_ANYRC, CString() >> (char)PLO_RC_CHAT << "Server: Updated weapon " << weapon->getName() << " ");
-				}
-			}
-			else
-			{
-				// TODO(joey): even though were deleting the weapon because its skipped, its still queuing its script action
-				//	and attempting to execute it. Technically the code needs to be run again though, will fix soon.
-				if (print) serverlog.out("[%s]        %s [skipped]\n", name.text(), weapon->getName().c_str());
-				delete weapon;
-			}
-		}
+		addWeapon(weapon, print);
 	}
 
 	// Add the default weapons.
@@ -820,6 +1088,55 @@ void TServer::loadWeapons(bool print)
 	if (weaponList.find("joltbomb") == weaponList.end()) weaponList["joltbomb"] = new TWeapon(this, TLevelItem::getItemId("joltbomb"));
 }
 
+void TServer::reloadWeapon(const CString& pFile)
+{
+	TWeapon *weapon = TWeapon::loadWeapon(pFile, this);
+	if (weapon == nullptr) return;
+
+	CString modFile = CString() << serverpath << "weapons" << CFileSystem::getPathSeparator() << pFile;
+	if (!weapon->getByteCodeFile().empty())
+		modFile = CString() << serverpath << "weapon_bytecode" << CFileSystem::getPathSeparator() << weapon->getByteCodeFile();
+
+	struct stat fileStat;
+	if (stat(modFile.text(), &fileStat) != -1)
+		weapon->setModTime(fileStat.st_mtime);
+
+	addWeapon(weapon, true);
+}
+
+void TServer::addWeapon(TWeapon* weapon, bool print)
+{
+	// Check if the weapon exists.
+	if (weaponList.find(weapon->getName()) == weaponList.end())
+	{
+		weaponList[weapon->getName()] = weapon;
+		if (print) serverlog.out("[%s]        %s\n", name.text(), weapon->getName().c_str());
+	}
+	else
+	{
+		// If the weapon exists, and the version on disk is newer, reload it.
+		TWeapon* w = weaponList[weapon->getName()];
+		if (w->getModTime() < weapon->getModTime())
+		{
+			delete w;
+			weaponList[weapon->getName()] = weapon;
+			updateWeaponForPlayers(weapon);
+			if (print) {
+				serverlog.out("[%s]        %s [updated]\n", name.text(), weapon->getName().c_str());
+
+				TServer::sendPacketTo(PLTYPE_ANYRC, CString() >> (char)PLO_RC_CHAT << "Server: Updated weapon " << weapon->getName() << " ");
+			}
+		}
+		else
+		{
+			// TODO(joey): even though were deleting the weapon because its skipped, its still queuing its script action
+			//	and attempting to execute it. Technically the code needs to be run again though, will fix soon.
+			if (print) serverlog.out("[%s]        %s [skipped]\n", name.text(), weapon->getName().c_str());
+			delete weapon;
+		}
+	}
+}
+
 void TServer::loadMapLevels()
 {
 	// Load gmap levels based on options provided by the gmap file
@@ -941,8 +1258,8 @@ void TServer::loadNpcs(bool print)
 {
 	CFileSystem npcFS(this);
 	npcFS.addDir("npcs", "npc*.txt");
-	const std::map<CString, CString> &npcFileList = npcFS.getFileList();
-	for (auto it = npcFileList.begin(); it != npcFileList.end(); ++it)
+	auto npcFileList = npcFS.getFileList();
+	for (auto it = npcFileList->begin(); it != npcFileList->end(); ++it)
 	{
 		bool loaded = false;
 
@@ -997,8 +1314,8 @@ void TServer::loadWordFilter()
 void TServer::saveServerFlags()
 {
 	CString out;
-	for (auto & mServerFlag : mServerFlags)
-		out << mServerFlag.first << "=" << mServerFlag.second << "\r\n";
+	for (auto [flagName, flagValue] : mServerFlags)
+		out << flagName << "=" << flagValue << "\r\n";
 	out.save(CString() << serverpath << "serverflags.txt");
 }
 
@@ -1006,7 +1323,7 @@ void TServer::saveWeapons()
 {
 	CFileSystem weaponFS(this);
 	weaponFS.addDir("weapons", "weapon*.txt");
-	const std::map<CString, CString>& weaponFileList = weaponFS.getFileList();
+	auto weaponFileList = weaponFS.getFileList();
 
 	for (auto & weapon : weaponList)
 	{
@@ -1037,49 +1354,64 @@ void TServer::saveNpcs()
 	}
 }
 
-std::vector<std::pair<double, std::string>> TServer::calculateNpcStats()
+std::vector<std::pair<ScriptProfile::Summary, std::string>> TServer::calculateNpcStats(size_t count)
 {
-	std::vector<std::pair<double, std::string>> script_profiles;
+	// Only the scripts that make the list get a name.
+	struct ScriptEntry
+	{
+		ScriptProfile::Summary summary;
+		TNPC *npc;
+		const CString *weaponName;
+	};
+
+	std::vector<ScriptEntry> scripts;
+	auto now = std::chrono::high_resolution_clock::now();
 
 	// Iterate npcs
-	for (auto it = npcList.begin(); it != npcList.end(); ++it)
+	for (auto npc : npcList)
 	{
-		TNPC *npc = *it;
-		ScriptExecutionContext& context = npc->getExecutionContext();
-		std::pair<unsigned int, double> executionData = context.getExecutionData();
-		if (executionData.second > 0.0)
-		{
-			std::string npcName = npc->getName();
-			if (npcName.empty())
-				npcName = "Level npc " + std::to_string(npc->getId());
-
-			TLevel *npcLevel = npc->getLevel();
-			if (npcLevel != nullptr) {
-				npcName.append(" (in level ").append(npcLevel->getLevelName().text()).
-					append(" at pos (").append(CString(npc->getY() / 16.0).text()).
-					append(", ").append(CString(npc->getX() / 16.0).text()).append(")");
-			}
-
-			script_profiles.push_back(std::make_pair(executionData.second, npcName));
-		}
+		auto summary = npc->getExecutionContext().getProfile().getSummary(now);
+		if (summary.total > 0.0)
+			scripts.push_back({ summary, npc, nullptr });
 	}
 
 	// Iterate weapons
-	for (auto it = weaponList.begin(); it != weaponList.end(); ++it)
+	for (auto & [weaponName, weapon] : weaponList)
 	{
-		TWeapon *weapon = (*it).second;
-		ScriptExecutionContext& context = weapon->getExecutionContext();
-		std::pair<unsigned int, double> executionData = context.getExecutionData();
+		auto summary = weapon->getExecutionContext().getProfile().getSummary(now);
+		if (summary.total > 0.0)
+			scripts.push_back({ summary, nullptr, &weaponName });
+	}
+
+	count = std::min(count, scripts.size());
+	std::partial_sort(scripts.begin(), scripts.begin() + count, scripts.end(), [](const ScriptEntry& a, const ScriptEntry& b) {
+		return a.summary.total > b.summary.total;
+	});
 
-		if (executionData.second > 0.0)
+	std::vector<std::pair<ScriptProfile::Summary, std::string>> script_profiles;
+	for (size_t i = 0; i < count; ++i)
+	{
+		TNPC *npc = scripts[i].npc;
+		if (npc == nullptr)
 		{
-			std::string weaponName("Weapon ");
-			weaponName.append((*it).first.text());
-			script_profiles.push_back(std::make_pair(executionData.second, weaponName));
+			script_profiles.emplace_back(scripts[i].summary, std::string("Weapon ").append(scripts[i].weaponName->text()));
+			continue;
+		}
+
+		std::string npcName = npc->getName();
+		if (npcName.empty())
+			npcName = "Level npc " + std::to_string(npc->getId());
+
+		TLevel *npcLevel = npc->getLevel();
+		if (npcLevel != nullptr) {
+			npcName.append(" (in level ").append(npcLevel->getLevelName().text()).
+				append(" at pos (").append(CString(npc->getY() / 16.0).text()).
+				append(", ").append(CString(npc->getX() / 16.0).text()).append(")");
 		}
+
+		script_profiles.emplace_back(scripts[i].summary, npcName);
 	}
 
-	std::sort(script_profiles.rbegin(), script_profiles.rend());
 	return script_profiles;
 }
 #endif
@@ -1170,13 +1502,7 @@ TWeapon* TServer::getWeapon(const CString& name)
 
 CString TServer::getFlag(const std::string& pFlagName)
 {
-#ifdef V8NPCSERVER
-	if (mServerFlags.find(pFlagName) != mServerFlags.end())
-		return mServerFlags[pFlagName];
-	return "";
-#else
-	return mServerFlags[pFlagName];
-#endif
+	return mServerFlags.get(pFlagName);
 }
 
 CFileSystem* TServer::getFileSystemByType(CString& type)
@@ -1552,10 +1878,8 @@ bool TServer::deleteFlag(const std::string& pFlagName, bool pSendToPlayers)
 	if ( settings.getBool("dontaddserverflags", false))
 		return false;
 
-	std::unordered_map<std::string, CString>::iterator mServerFlag;
-	if ((mServerFlag = mServerFlags.find(pFlagName)) != mServerFlags.end())
+	if (mServerFlags.erase(pFlagName))
 	{
-		mServerFlags.erase(mServerFlag);
 		if (pSendToPlayers)
             sendPacketToAll(CString() >> (char)PLO_FLAGDEL << pFlagName, nullptr);
 		return true;
@@ -1581,16 +1905,16 @@ bool TServer::setFlag(const std::string& pFlagName, const CString& pFlagValue, b
 		return deleteFlag(pFlagName);
 
 	// optimize
-	if (mServerFlags[pFlagName] == pFlagValue)
+	if (mServerFlags.contains(pFlagName) && mServerFlags.get(pFlagName) == pFlagValue)
 		return true;
 
 	// set flag
 	if (settings.getBool("cropflags", true))
 	{
 		int fixedLength = 223 - 1 - (int)pFlagName.length();
-		mServerFlags[pFlagName] = pFlagValue.subString(0, fixedLength);
+		mServerFlags.set(pFlagName, pFlagValue.subString(0, fixedLength));
 	}
-	else mServerFlags[pFlagName] = pFlagValue;
+	else mServerFlags.set(pFlagName, pFlagValue);
 
 	if (pSendToPlayers)
         sendPacketToAll(CString() >> (char)PLO_FLAGSET << pFlagName << "=" << pFlagValue, nullptr);
@@ -1850,6 +2174,10 @@ bool TServer::NC_DelWeapon(const CString& pWeaponName)
 
 void TServer::updateWeaponForPlayers(TWeapon *pWeapon)
 {
+	// Weapons still compiling are sent once they are done
+	if (isCompilingGS2(pWeapon))
+		return;
+
 	// Update Weapons
 	for (auto player : playerList)
 	{
@@ -1866,6 +2194,10 @@ void TServer::updateWeaponForPlayers(TWeapon *pWeapon)
 
 void TServer::updateClassForPlayers(TScriptClass *pClass)
 {
+	// Classes still compiling are sent once they are done
+	if (isCompilingGS2(pClass))
+		return;
+
 	// Update Weapons
 	for (auto player : playerList)
 	{
@@ -1896,7 +2228,7 @@ void TServer::compileScript(ScriptObjType& scriptObject, GS2ScriptManager::user_
 {
 	std::string script{ scriptObject.getSource().getClientGS2() };
 
-	gs2ScriptManager.compileScript(script, [cb, &scriptObject, this](const CompilerResponse& resp)
+	auto onCompiled = [cb, &scriptObject, this](const CompilerResponse& resp)
 	{
 		if (!resp.errors.empty())
 		{
@@ -1921,7 +2253,46 @@ void TServer::compileScript(ScriptObjType& scriptObject, GS2ScriptManager::user_
 		{
 			cb(resp);
 		}
+	};
+
+	// Scripts that aren't in the cache are compiled on the compiler threads, and sent to
+	// players once they finish. Until then, the object counts as compiling.
+	auto cachedResp = gs2ScriptManager.compileScriptAsync(script, &scriptObject, [onCompiled, &scriptObject, this](const CompilerResponse& resp)
+	{
+		onCompiled(resp);
+		sendCompiledGS2Script(scriptObject);
 	});
+
+	if (cachedResp)
+		onCompiled(*cachedResp);
+}
+
+void TServer::sendCompiledGS2Script(TNPC& npc)
+{
+	TLevel *npcLevel = npc.getLevel();
+	if (npcLevel == nullptr || npc.getByteCode().isEmpty())
+		return;
+
+	// Players that are still waiting on the level get the npc along with it
+	CString byteCodePacket = npc.getByteCodePacket();
+	for (auto player : playerList)
+	{
+		if (!player->isClient() || player->getVersion() < CLVER_4_0211 || player->isLevelPending(npcLevel))
+			continue;
+
+		if (player->getLevel() == npcLevel || player->isGmapLevelStreamed(npcLevel))
+			player->sendPacket(byteCodePacket);
+	}
+}
+
+void TServer::sendCompiledGS2Script(TWeapon& weapon)
+{
+	updateWeaponForPlayers(&weapon);
+}
+
+void TServer::sendCompiledGS2Script(TScriptClass& cls)
+{
+	updateClassForPlayers(&cls);
 }
 
 void TServer::compileGS2Script(const std::string& source, GS2ScriptManager::user_callback_type cb)
@@ -2034,8 +2405,8 @@ void TServer::TS_Reload()
 	translationFS.addDir("translations", "*.po");
 
 	// Load Each File
-	const std::map<CString, CString> &temp = translationFS.getFileList();
-	for (auto & i : temp)
+	auto temp = translationFS.getFileList();
+	for (auto & i : *temp)
 		this->TS_Load(removeExtension(i.first), i.second);
 }
 
@@ -1,23 +1,38 @@
+#include <cstdio>
+#include <cstdlib>
 #include <filesystem>
+#include <sys/stat.h>
+#include "IUtil.h"
 #include "TUpdatePackage.h"
 #include "CFileSystem.h"
-#include "TServer.h"
+#include "CFileCache.h"
 
-std::optional<TUpdatePackage> TUpdatePackage::load(TServer* const server, const std::string& name)
+std::optional<TUpdatePackage> TUpdatePackage::load(const CFileSystem& fileSystem, const std::string& name,
+                                                   const TUpdatePackage* previous,
+                                                   const std::unordered_set<std::string>& changedFiles,
+                                                   CFileCache* fileCache)
 {
-	auto fileSystem = server->getFileSystem();
-
 	// Search for the file in the filesystem, and load the contents
-	auto fileContents = fileSystem->load(name);
-	if (fileContents.isEmpty())
+	CString packagePath = fileSystem.find(name);
+	CString packageData;
+	if (packagePath.isEmpty() || !packageData.load(packagePath) || packageData.isEmpty())
 		return std::nullopt;
 	
-	// Calculate the checksum for the gupd file
+	// The checksum for the gupd file is calculated when it is loaded
 	TUpdatePackage updatePackage(name);
-	updatePackage.checksum = calculateCrc32Checksum(fileContents);
+	updatePackage.checksum = calculateCrc32Checksum(packageData);
+	
+	// Without an earlier version of the package, start from the manifest written last time
+	CString manifestPath = CString() << packagePath.subString(0, packagePath.findl(CFileSystem::getPathSeparator()) + 1)
+	                                 << "." << name.c_str() << ".manifest";
+	TUpdatePackage manifest(name);
+	if (!previous && manifest.loadManifest(manifestPath))
+		previous = &manifest;
 	
-	// Calculate the checksum and filesize for each file referenced in the package
-	auto packageLines = fileContents.tokenize("\n");
+	bool manifestChanged = (previous == nullptr);
+	
+	// Get the checksum and filesize for each file referenced in the package
+	auto packageLines = packageData.tokenize("\n");
 	for (const auto& line : packageLines)
 	{
 		auto startPos = line.findi("FILE");
@@ -27,23 +42,117 @@ std::optional<TUpdatePackage> TUpdatePackage::load(TServer* const server, const
 		{
 			std::string filePath = line.subString(4).trim().toString();
 			std::string baseFileName = std::filesystem::path(filePath).filename().string();
-			
-			CString updateFileData = fileSystem->load(baseFileName);
+			if (updatePackage.fileList.find(baseFileName) != updatePackage.fileList.end())
+				continue;
 			
 			// File was not found in the filesystem
-			if (updateFileData.isEmpty())
+			CString updateFilePath = fileSystem.find(baseFileName);
+			struct stat fileStat;
+			if (updateFilePath.isEmpty() || stat(updateFilePath.text(), &fileStat) == -1 || fileStat.st_size == 0)
+			{
+				updatePackage.missingFiles.push_back(baseFileName);
 				continue;
+			}
 			
-			uint32_t fileLength(updateFileData.length());
-			
-			updatePackage.fileList.emplace(baseFileName, FileEntry{
-				.size = fileLength,
-				.checksum = calculateCrc32Checksum(updateFileData)
-			});
+			// Reuse the entry if the file hasn't been touched since it was read.  The file is
+			// stat'd before it is read, so a file that changes while it is read is read again next time.
+			FileEntry entry{};
+			auto prevEntry = previous ? previous->fileList.find(baseFileName) : updatePackage.fileList.end();
+			if (previous && prevEntry != previous->fileList.end() && changedFiles.find(baseFileName) == changedFiles.end() &&
+				prevEntry->second.size == (uint32_t)fileStat.st_size && prevEntry->second.modTime == fileStat.st_mtime)
+			{
+				entry = prevEntry->second;
+			}
+			else if (fileCache)
+			{
+				// Changed files were dropped from the cache before the package was queued
+				auto file = fileCache->get(updateFilePath);
+				if (!file)
+				{
+					updatePackage.missingFiles.push_back(baseFileName);
+					continue;
+				}
+				
+				entry = FileEntry{
+					.size = (uint32_t)file->data.length(),
+					.checksum = file->checksum,
+					.modTime = file->modTime
+				};
+				manifestChanged = true;
+			}
+			else
+			{
+				CString updateFile;
+				if (!updateFile.load(updateFilePath) || updateFile.isEmpty())
+				{
+					updatePackage.missingFiles.push_back(baseFileName);
+					continue;
+				}
+				
+				entry = FileEntry{
+					.size = (uint32_t)updateFile.length(),
+					.checksum = calculateCrc32Checksum(updateFile),
+					.modTime = fileStat.st_mtime
+				};
+				manifestChanged = true;
+			}
 			
-			updatePackage.packageSize += fileLength;
+			updatePackage.fileList.emplace(baseFileName, entry);
+			updatePackage.packageSize += entry.size;
 		}
 	}
 	
+	if (previous && previous->fileList.size() != updatePackage.fileList.size())
+		manifestChanged = true;
+	
+	if (manifestChanged)
+		updatePackage.saveManifest(manifestPath);
+	
 	return updatePackage;
 }
+
+bool TUpdatePackage::loadManifest(const CString& path)
+{
+	CString manifestData;
+	if (!manifestData.load(path))
+		return false;
+	
+	auto manifestLines = manifestData.tokenize("\n");
+	if (manifestLines.empty() || manifestLines[0].trim() != "GUPDMANIFEST 1")
+		return false;
+	
+	// Lines are in the format of FILE size checksum modtime filename
+	for (auto& line : manifestLines)
+	{
+		if (line.readString(" ") != "FILE")
+			continue;
+		
+		FileEntry entry{};
+		entry.size = (uint32_t)strtoul(line.readString(" ").text(), nullptr, 10);
+		entry.checksum = (uint32_t)strtoul(line.readString(" ").text(), nullptr, 10);
+		entry.modTime = (time_t)strtoll(line.readString(" ").text(), nullptr, 10);
+		
+		std::string fileName = line.readString("").trim().toString();
+		if (!fileName.empty())
+			fileList[fileName] = entry;
+	}
+	
+	return true;
+}
+
+bool TUpdatePackage::saveManifest(const CString& path) const
+{
+	CString manifestData("GUPDMANIFEST 1\n");
+	for (const auto& [fileName, entry] : fileList)
+	{
+		manifestData << "FILE " << CString((unsigned int)entry.size) << " " << CString((unsigned int)entry.checksum)
+		             << " " << CString((long long)entry.modTime) << " " << fileName.c_str() << "\n";
+	}
+	
+	// Write to a temporary file first, so the manifest is never seen half written
+	CString tempPath = CString() << path << ".tmp";
+	if (!manifestData.save(tempPath))
+		return false;
+	
+	return rename(tempPath.text(), path.text()) == 0;
+}
@@ -0,0 +1,230 @@
+#include "TUpdatePackageManager.h"
+#include "CFileSystem.h"
+
+TUpdatePackageManager::TUpdatePackageManager(CFileSystem* pFileSystem, CFileCache* pFileCache)
+	: fileSystem(pFileSystem), fileCache(pFileCache), pendingJobs(0), running(true)
+{
+	worker = std::thread(&TUpdatePackageManager::runWorker, this);
+}
+
+TUpdatePackageManager::~TUpdatePackageManager()
+{
+	{
+		std::scoped_lock lock(queueLock);
+		running = false;
+	}
+	
+	queueCondition.notify_all();
+	if (worker.joinable())
+		worker.join();
+}
+
+void TUpdatePackageManager::queue(const std::string& packageName)
+{
+	// Package names come from clients, so only keep track of packages that exist
+	auto it = packages.find(packageName);
+	if (it == packages.end())
+	{
+		if (fileSystem->find(packageName).isEmpty())
+			return;
+
+		it = packages.try_emplace(packageName).first;
+	}
+
+	auto& entry = it->second;
+	entry.ready = false;
+	
+	// A package that is already loading is loaded again once it is done
+	if (entry.loading)
+		entry.stale = true;
+	else
+		startJob(packageName, entry);
+}
+
+void TUpdatePackageManager::queueAll()
+{
+	for (auto& [packageName, entry] : packages)
+		queue(packageName);
+}
+
+void TUpdatePackageManager::whenReady(const std::string& packageName, ReadyCallback callback)
+{
+	auto it = packages.find(packageName);
+	if (it != packages.end() && it->second.ready)
+	{
+		callback(it->second.package);
+		return;
+	}
+	
+	if (it == packages.end())
+	{
+		queue(packageName);
+		it = packages.find(packageName);
+		if (it == packages.end())
+		{
+			callback(nullptr);
+			return;
+		}
+	}
+	
+	it->second.waiting.push_back(std::move(callback));
+}
+
+TUpdatePackageManager::PackagePtr TUpdatePackageManager::find(const std::string& packageName) const
+{
+	auto it = packages.find(packageName);
+	if (it == packages.end() || !it->second.ready)
+		return nullptr;
+	
+	return it->second.package;
+}
+
+void TUpdatePackageManager::fileChanged(const std::string& fileName)
+{
+	std::vector<std::string> changedPackages;
+	if (packages.find(fileName) != packages.end())
+		changedPackages.push_back(fileName);
+	
+	auto it = references.find(fileName);
+	if (it != references.end())
+		changedPackages.insert(changedPackages.end(), it->second.begin(), it->second.end());
+	
+	for (const auto& packageName : changedPackages)
+	{
+		auto entry = packages.find(packageName);
+		if (entry == packages.end())
+			continue;
+		
+		entry->second.changedFiles.insert(fileName);
+		queue(packageName);
+	}
+}
+
+void TUpdatePackageManager::update()
+{
+	std::deque<Result> finished;
+	{
+		std::scoped_lock lock(queueLock);
+		if (results.empty())
+			return;
+		
+		finished.swap(results);
+	}
+	
+	for (auto& result : finished)
+		finishJob(result);
+}
+
+bool TUpdatePackageManager::isBusy() const
+{
+	std::scoped_lock lock(queueLock);
+	return pendingJobs > 0;
+}
+
+void TUpdatePackageManager::startJob(const std::string& packageName, Package& entry)
+{
+	entry.loading = true;
+	entry.stale = false;
+	
+	Job job{ packageName, entry.package, std::move(entry.changedFiles) };
+	entry.changedFiles.clear();
+	
+	{
+		std::scoped_lock lock(queueLock);
+		jobs.push_back(std::move(job));
+		++pendingJobs;
+	}
+	
+	queueCondition.notify_one();
+}
+
+void TUpdatePackageManager::finishJob(Result& result)
+{
+	auto it = packages.find(result.packageName);
+	if (it == packages.end())
+		return;
+	
+	auto& entry = it->second;
+	entry.loading = false;
+	
+	PackagePtr previous = std::move(entry.package);
+	if (result.package)
+		entry.package = std::make_shared<const TUpdatePackage>(std::move(result.package.value()));
+	
+	setReferences(result.packageName, previous, entry.package);
+	
+	// Files changed while the package was loading, so it has to be loaded again
+	if (entry.stale)
+	{
+		startJob(result.packageName, entry);
+		return;
+	}
+	
+	entry.ready = true;
+	
+	std::vector<ReadyCallback> waiting;
+	waiting.swap(entry.waiting);
+	
+	// Packages that were removed, or couldn't be read, are forgotten again
+	PackagePtr package = entry.package;
+	if (!package)
+		packages.erase(it);
+	
+	for (auto& callback : waiting)
+		callback(package);
+}
+
+void TUpdatePackageManager::setReferences(const std::string& packageName, const PackagePtr& previous, const PackagePtr& current)
+{
+	if (previous)
+	{
+		auto removeReference = [this, &packageName](const std::string& fileName) {
+			auto it = references.find(fileName);
+			if (it == references.end())
+				return;
+			
+			it->second.erase(packageName);
+			if (it->second.empty())
+				references.erase(it);
+		};
+		
+		for (const auto& [fileName, fileEntry] : previous->getFileList())
+			removeReference(fileName);
+		for (const auto& fileName : previous->getMissingFiles())
+			removeReference(fileName);
+	}
+	
+	// Missing files are referenced too, so the package picks them up once they are added
+	if (current)
+	{
+		for (const auto& [fileName, fileEntry] : current->getFileList())
+			references[fileName].insert(packageName);
+		for (const auto& fileName : current->getMissingFiles())
+			references[fileName].insert(packageName);
+	}
+}
+
+void TUpdatePackageManager::runWorker()
+{
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock lock(queueLock);
+			queueCondition.wait(lock, [this] { return !running || !jobs.empty(); });
+			if (!running)
+				return;
+			
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		
+		Result result{ job.packageName, TUpdatePackage::load(*fileSystem, job.packageName, job.previous.get(), job.changedFiles, fileCache) };
+		
+		{
+			std::scoped_lock lock(queueLock);
+			results.push_back(std::move(result));
+			--pendingJobs;
+		}
+	}
+}
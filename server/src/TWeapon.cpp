@@ -37,6 +37,8 @@ TWeapon::TWeapon(TServer *pServer, std::string pName, std::string pImage, std::s
 
 TWeapon::~TWeapon()
 {
+	server->cancelGS2Compile(this);
+
 #ifdef V8NPCSERVER
 	freeScriptResources();
 #endif
@@ -171,8 +173,12 @@ bool TWeapon::saveWeapon()
 		output << "SCRIPTEND\r\n";
 	}
 
-	// Save it.
-	return output.save(filename);
+	// Save it.  The file watcher doesn't need to load it back in.
+	if (!output.save(filename))
+		return false;
+
+	server->recordFileVersion(filename);
+	return true;
 }
 
 // -- Function: Get Player Packet -- //
@@ -261,6 +267,7 @@ void TWeapon::updateWeapon(std::string pImage, std::string pCode, const time_t p
 			}
 		});
 	}
+	else server->cancelGS2Compile(this);
 	
 	auto gs1Script = _source.getClientGS1();
 	if (!gs1Script.empty())
@@ -0,0 +1,41 @@
+#include <mutex>
+#include "InternTable.h"
+
+namespace utilities
+{
+	uint32_t InternTable::intern(std::string_view str)
+	{
+		{
+			std::shared_lock readLock(lock);
+			auto it = ids.find(str);
+			if (it != ids.end())
+				return it->second;
+		}
+
+		std::unique_lock writeLock(lock);
+		auto [it, inserted] = ids.try_emplace(std::string(str), (uint32_t)strings.size());
+		if (inserted)
+			strings.push_back(CString(it->first));
+		return it->second;
+	}
+
+	uint32_t InternTable::find(std::string_view str) const
+	{
+		std::shared_lock readLock(lock);
+		auto it = ids.find(str);
+		return (it != ids.end() ? it->second : InvalidId);
+	}
+
+	const CString& InternTable::get(uint32_t id) const
+	{
+		// The strings are never moved once they are added, so the reference outlives the lock.
+		std::shared_lock readLock(lock);
+		return strings[id];
+	}
+
+	size_t InternTable::size() const
+	{
+		std::shared_lock readLock(lock);
+		return strings.size();
+	}
+}